@@ -0,0 +1,410 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// cuckoo_hash_table.cpp
+//
+// Identification: src/container/hash/cuckoo_hash_table.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/rid.h"
+#include "container/hash/cuckoo_hash_table.h"
+
+namespace bustub {
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+CUCKOO_HASH_TABLE_TYPE::CuckooHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
+                                        const KeyComparator &comparator, size_t num_buckets,
+                                        HashFunction<KeyType> hash_fn)
+    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
+  NewHeaderPage(&header_page_id_);
+  buffer_pool_manager_->UnpinPage(header_page_id_, true);
+
+  // 至少两个bucket, 每个key的两个候选位置才能不同
+  num_buckets = std::max<size_t>(num_buckets, 2);
+  bucket_page_ids_.resize(num_buckets);
+  for (auto &bucket_page_id : bucket_page_ids_) {
+    NewBucketPage(&bucket_page_id);
+    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  }
+  WriteHeader();
+}
+
+/*****************************************************************************
+ * HELPERS
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::Hash(const KeyType &key) -> uint64_t {
+  return hash_fn_.GetHash(key);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::CandidateBuckets(uint64_t hash, size_t num_buckets) -> std::pair<size_t, size_t> {
+  size_t first = static_cast<uint32_t>(hash) % num_buckets;
+  size_t second = static_cast<uint32_t>(hash >> 32) % num_buckets;
+  // 两半hash落到同一个bucket时取下一个
+  if (second == first) {
+    second = (first + 1) % num_buckets;
+  }
+  return {first, second};
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BUCKET_TYPE * {
+  return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(buffer_pool_manager_->FetchPage(bucket_page_id)->GetData());
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::NewBucketPage(page_id_t *bucket_page_id) -> HASH_TABLE_BUCKET_TYPE * {
+  auto bucket_page =
+      reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(buffer_pool_manager_->NewPage(bucket_page_id)->GetData());
+  bucket_page->Init();
+  return bucket_page;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::FetchHeaderPage(page_id_t header_page_id) -> HashTableHeaderPage * {
+  return reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id)->GetData());
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::NewHeaderPage(page_id_t *header_page_id) -> HashTableHeaderPage * {
+  auto header_page =
+      reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->NewPage(header_page_id)->GetData());
+  header_page->SetPageId(*header_page_id);
+  header_page->SetNextPageId(INVALID_PAGE_ID);
+  header_page->ClearBlockPageIds();
+  return header_page;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void CUCKOO_HASH_TABLE_TYPE::WriteHeader() {
+  page_id_t header_page_id = header_page_id_;
+  auto header_page = FetchHeaderPage(header_page_id);
+  header_page->SetSize(bucket_page_ids_.size());
+  size_t index = 0;
+  while (true) {
+    header_page->ClearBlockPageIds();
+    for (; index < bucket_page_ids_.size() && header_page->NumBlocks() < HEADER_ARRAY_SIZE; index++) {
+      header_page->AddBlockPageId(bucket_page_ids_[index]);
+    }
+    if (index == bucket_page_ids_.size()) {
+      break;
+    }
+    // 一页header放不下, 接着写链上的下一页, 链不够长就在尾部接新页
+    page_id_t next_page_id = header_page->GetNextPageId();
+    HashTableHeaderPage *next_page;
+    if (next_page_id == INVALID_PAGE_ID) {
+      next_page = NewHeaderPage(&next_page_id);
+      header_page->SetNextPageId(next_page_id);
+    } else {
+      next_page = FetchHeaderPage(next_page_id);
+    }
+    buffer_pool_manager_->UnpinPage(header_page_id, true);
+    header_page_id = next_page_id;
+    header_page = next_page;
+  }
+  buffer_pool_manager_->UnpinPage(header_page_id, true);
+}
+
+/*****************************************************************************
+ * OVERFLOW CHAINS
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void CUCKOO_HASH_TABLE_TYPE::CollectValues(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key,
+                                           std::vector<ValueType> *result) {
+  bucket->GetValue(key, comparator_, result);
+  page_id_t overflow_page_id = bucket->GetOverflowPageId();
+  while (overflow_page_id != INVALID_PAGE_ID) {
+    auto overflow_page = FetchBucketPage(overflow_page_id);
+    overflow_page->GetValue(key, comparator_, result);
+    page_id_t next_page_id = overflow_page->GetOverflowPageId();
+    buffer_pool_manager_->UnpinPage(overflow_page_id, false);
+    overflow_page_id = next_page_id;
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void CUCKOO_HASH_TABLE_TYPE::InsertOverflow(page_id_t bucket_page_id, const MappingType &entry) {
+  // 找链上第一个有空位的溢出页, 都满了就在链尾接一个新页
+  page_id_t tail_page_id = bucket_page_id;
+  page_id_t overflow_page_id = FetchBucketPage(bucket_page_id)->GetOverflowPageId();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  while (overflow_page_id != INVALID_PAGE_ID) {
+    auto overflow_page = FetchBucketPage(overflow_page_id);
+    if (overflow_page->Insert(entry.first, entry.second, comparator_)) {
+      buffer_pool_manager_->UnpinPage(overflow_page_id, true);
+      return;
+    }
+    tail_page_id = overflow_page_id;
+    overflow_page_id = overflow_page->GetOverflowPageId();
+    buffer_pool_manager_->UnpinPage(tail_page_id, false);
+  }
+
+  page_id_t new_page_id;
+  NewBucketPage(&new_page_id)->Insert(entry.first, entry.second, comparator_);
+  buffer_pool_manager_->UnpinPage(new_page_id, true);
+  FetchBucketPage(tail_page_id)->SetOverflowPageId(new_page_id);
+  buffer_pool_manager_->UnpinPage(tail_page_id, true);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::RemoveOverflow(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key,
+                                            const ValueType &value) -> bool {
+  page_id_t prev_page_id = INVALID_PAGE_ID;
+  page_id_t overflow_page_id = bucket->GetOverflowPageId();
+  while (overflow_page_id != INVALID_PAGE_ID) {
+    auto overflow_page = FetchBucketPage(overflow_page_id);
+    page_id_t next_page_id = overflow_page->GetOverflowPageId();
+    if (overflow_page->Remove(key, value, comparator_)) {
+      auto empty = overflow_page->IsEmpty();
+      buffer_pool_manager_->UnpinPage(overflow_page_id, true);
+      if (empty) {
+        // 空的溢出页从链上摘掉, prev_page_id无效说明前一页就是bucket本身
+        if (prev_page_id == INVALID_PAGE_ID) {
+          bucket->SetOverflowPageId(next_page_id);
+        } else {
+          FetchBucketPage(prev_page_id)->SetOverflowPageId(next_page_id);
+          buffer_pool_manager_->UnpinPage(prev_page_id, true);
+        }
+        buffer_pool_manager_->DeletePage(overflow_page_id);
+      }
+      return true;
+    }
+    buffer_pool_manager_->UnpinPage(overflow_page_id, false);
+    prev_page_id = overflow_page_id;
+    overflow_page_id = next_page_id;
+  }
+  return false;
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result)
+    -> bool {
+  table_latch_.RLock();
+  auto size = result->size();
+  auto [first, second] = CandidateBuckets(Hash(key), bucket_page_ids_.size());
+  for (auto bucket : {first, second}) {
+    auto bucket_page = FetchBucketPage(bucket_page_ids_[bucket]);
+    reinterpret_cast<Page *>(bucket_page)->RLatch();
+    CollectValues(bucket_page, key, result);
+    reinterpret_cast<Page *>(bucket_page)->RUnlatch();
+    buffer_pool_manager_->UnpinPage(bucket_page_ids_[bucket], false);
+  }
+  table_latch_.RUnlock();
+  return result->size() > size;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
+  table_latch_.RLock();
+  auto [first, second] = CandidateBuckets(Hash(key), bucket_page_ids_.size());
+  page_id_t first_page_id = bucket_page_ids_[first];
+  page_id_t second_page_id = bucket_page_ids_[second];
+  auto first_page = FetchBucketPage(first_page_id);
+  auto second_page = FetchBucketPage(second_page_id);
+  // 两个bucket按page_id顺序加latch, 两个insert不会互相等待
+  auto low_page = reinterpret_cast<Page *>(first_page_id < second_page_id ? first_page : second_page);
+  auto high_page = reinterpret_cast<Page *>(first_page_id < second_page_id ? second_page : first_page);
+  low_page->WLatch();
+  high_page->WLatch();
+  std::vector<ValueType> values;
+  CollectValues(first_page, key, &values);
+  CollectValues(second_page, key, &values);
+  auto exists = std::find(values.begin(), values.end(), value) != values.end();
+  // 放进空一些的那个候选bucket
+  auto to_first = first_page->NumReadable() <= second_page->NumReadable();
+  auto inserted = !exists && (to_first ? first_page : second_page)->Insert(key, value, comparator_);
+  high_page->WUnlatch();
+  low_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(first_page_id, inserted && to_first);
+  buffer_pool_manager_->UnpinPage(second_page_id, inserted && !to_first);
+  table_latch_.RUnlock();
+  if (exists || inserted) {
+    return inserted;
+  }
+
+  // 两个候选bucket都满了, 拿写锁换出别的条目, 还不行就扩容
+  table_latch_.WLock();
+  std::tie(first, second) = CandidateBuckets(Hash(key), bucket_page_ids_.size());
+  values.clear();
+  for (auto bucket : {first, second}) {
+    CollectValues(FetchBucketPage(bucket_page_ids_[bucket]), key, &values);
+    buffer_pool_manager_->UnpinPage(bucket_page_ids_[bucket], false);
+  }
+  exists = std::find(values.begin(), values.end(), value) != values.end();
+  MappingType entry(key, value);
+  if (!exists) {
+    // 两个候选bucket里全是这个key时, 换出和扩容都腾不出位置, 直接接到溢出链上
+    if (values.size() >= 2 * BUCKET_ARRAY_SIZE) {
+      InsertOverflow(bucket_page_ids_[first], entry);
+    } else if (!InsertDisplacing(bucket_page_ids_, entry)) {
+      Rehash(2 * bucket_page_ids_.size(), &entry);
+    }
+  }
+  table_latch_.WUnlock();
+  return !exists;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::InsertDisplacing(const std::vector<page_id_t> &buckets, const MappingType &entry)
+    -> bool {
+  auto [first, second] = CandidateBuckets(Hash(entry.first), buckets.size());
+  auto first_page = FetchBucketPage(buckets[first]);
+  auto second_page = FetchBucketPage(buckets[second]);
+  auto to_first = first_page->NumReadable() <= second_page->NumReadable();
+  auto inserted = (to_first ? first_page : second_page)->Insert(entry.first, entry.second, comparator_);
+  buffer_pool_manager_->UnpinPage(buckets[first], inserted && to_first);
+  buffer_pool_manager_->UnpinPage(buckets[second], inserted && !to_first);
+  if (inserted) {
+    return true;
+  }
+
+  // 两个都满了: 从bucket里随机换出一个条目, 换出的条目去它的另一个候选bucket, 那里也满就接着换
+  MappingType current = entry;
+  size_t bucket = (kick_seed_ & 1) != 0 ? first : second;
+  std::vector<std::pair<size_t, uint32_t>> path;
+  while (path.size() < CUCKOO_MAX_KICKS) {
+    kick_seed_ = kick_seed_ * 1103515245 + 12345;
+    uint32_t slot = (kick_seed_ >> 8) % BUCKET_ARRAY_SIZE;
+    auto bucket_page = FetchBucketPage(buckets[bucket]);
+    MappingType victim(bucket_page->KeyAt(slot), bucket_page->ValueAt(slot));
+    bucket_page->RemoveAt(slot);
+    bucket_page->InsertAt(slot, current.first, current.second);
+    buffer_pool_manager_->UnpinPage(buckets[bucket], true);
+    path.emplace_back(bucket, slot);
+    current = victim;
+
+    auto [victim_first, victim_second] = CandidateBuckets(Hash(current.first), buckets.size());
+    bucket = victim_first == bucket ? victim_second : victim_first;
+    bucket_page = FetchBucketPage(buckets[bucket]);
+    inserted = bucket_page->Insert(current.first, current.second, comparator_);
+    buffer_pool_manager_->UnpinPage(buckets[bucket], inserted);
+    if (inserted) {
+      return true;
+    }
+  }
+
+  // 没有腾出空位, 沿路径倒着换回去, 表恢复原样
+  for (auto it = path.rbegin(); it != path.rend(); ++it) {
+    auto bucket_page = FetchBucketPage(buckets[it->first]);
+    MappingType placed(bucket_page->KeyAt(it->second), bucket_page->ValueAt(it->second));
+    bucket_page->RemoveAt(it->second);
+    bucket_page->InsertAt(it->second, current.first, current.second);
+    buffer_pool_manager_->UnpinPage(buckets[it->first], true);
+    current = placed;
+  }
+  return false;
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
+  table_latch_.RLock();
+  // 条目只在写锁下移动, 读锁下它一定还在两个候选bucket之一
+  auto [first, second] = CandidateBuckets(Hash(key), bucket_page_ids_.size());
+  auto removed = false;
+  for (auto bucket : {first, second}) {
+    if (removed) {
+      break;
+    }
+    auto bucket_page = FetchBucketPage(bucket_page_ids_[bucket]);
+    reinterpret_cast<Page *>(bucket_page)->WLatch();
+    removed = bucket_page->Remove(key, value, comparator_) || RemoveOverflow(bucket_page, key, value);
+    reinterpret_cast<Page *>(bucket_page)->WUnlatch();
+    buffer_pool_manager_->UnpinPage(bucket_page_ids_[bucket], removed);
+  }
+  table_latch_.RUnlock();
+  return removed;
+}
+
+/*****************************************************************************
+ * RESIZE
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void CUCKOO_HASH_TABLE_TYPE::Resize(size_t initial_size) {
+  table_latch_.WLock();
+  Rehash(std::max(2 * initial_size, bucket_page_ids_.size()), nullptr);
+  table_latch_.WUnlock();
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void CUCKOO_HASH_TABLE_TYPE::Place(const std::vector<page_id_t> &buckets, const MappingType &entry) {
+  if (!InsertDisplacing(buckets, entry)) {
+    InsertOverflow(buckets[CandidateBuckets(Hash(entry.first), buckets.size()).first], entry);
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void CUCKOO_HASH_TABLE_TYPE::Rehash(size_t num_buckets, const MappingType *extra) {
+  std::vector<page_id_t> buckets(num_buckets);
+  for (auto &bucket_page_id : buckets) {
+    NewBucketPage(&bucket_page_id);
+    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  }
+  if (extra != nullptr) {
+    Place(buckets, *extra);
+  }
+  // 旧bucket和它的溢出链逐页搬完就删掉
+  std::vector<MappingType> entries;
+  for (auto bucket_page_id : bucket_page_ids_) {
+    for (page_id_t page_id = bucket_page_id; page_id != INVALID_PAGE_ID;) {
+      auto bucket_page = FetchBucketPage(page_id);
+      entries.clear();
+      for (uint32_t slot = 0; slot < BUCKET_ARRAY_SIZE; slot++) {
+        if (bucket_page->IsReadable(slot)) {
+          entries.emplace_back(bucket_page->KeyAt(slot), bucket_page->ValueAt(slot));
+        }
+      }
+      page_id_t next_page_id = bucket_page->GetOverflowPageId();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      buffer_pool_manager_->DeletePage(page_id);
+      for (const auto &entry : entries) {
+        Place(buckets, entry);
+      }
+      page_id = next_page_id;
+    }
+  }
+  bucket_page_ids_.swap(buckets);
+  WriteHeader();
+}
+
+/*****************************************************************************
+ * GETSIZE
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto CUCKOO_HASH_TABLE_TYPE::GetSize() -> size_t {
+  table_latch_.RLock();
+  auto size = bucket_page_ids_.size();
+  table_latch_.RUnlock();
+  return size;
+}
+
+template class CuckooHashTable<int, int, IntComparator>;
+
+template class CuckooHashTable<GenericKey<4>, RID, GenericComparator<4>>;
+template class CuckooHashTable<GenericKey<8>, RID, GenericComparator<8>>;
+template class CuckooHashTable<GenericKey<16>, RID, GenericComparator<16>>;
+template class CuckooHashTable<GenericKey<32>, RID, GenericComparator<32>>;
+template class CuckooHashTable<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
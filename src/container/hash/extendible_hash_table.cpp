@@ -10,9 +10,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cmath>
+#include <deque>
 #include <iostream>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -20,6 +24,7 @@
 #include "common/logger.h"
 #include "common/rid.h"
 #include "container/hash/extendible_hash_table.h"
+#include "storage/index/external_sorter.h"
 
 namespace bustub {
 
@@ -29,16 +34,17 @@ namespace bustub {
  * BufferPoolManager *buffer_pool_manager_;
  * KeyComparator comparator_;
  *
- * // Readers includes inserts and removes, writers are splits and merges
+ * // Readers include inserts, removes and splits that keep the directory size,
+ * // writers double or shrink the directory and merge buckets
  * ReaderWriterLatch table_latch_;
- * HashFunction<KeyType> hash_fn_;
+ * std::unique_ptr<HashFunction<KeyType>> hash_fn_;
  */
 
 // 创建一个新的hash_table，可以创建一个bucket，id是0，也可以直接创建两个，id是0和1
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
+                                     const KeyComparator &comparator, const HashFunction<KeyType> &hash_fn)
+    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(hash_fn.Clone()) {
   // dir_page是一个page
   auto dir_page = buffer_pool_manager_->NewPage(&directory_page_id_);  // 得到分配的page_id
   // 把dir_page转化为一个HashTableDirectoryPage， 分配目录页
@@ -47,8 +53,8 @@ HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager
   // 初始化两个bucket
   page_id_t bucket_page_0;
   page_id_t bucket_page_1;
-  buffer_pool_manager_->NewPage(&bucket_page_0);
-  buffer_pool_manager_->NewPage(&bucket_page_1);
+  NewBucketPage(&bucket_page_0);
+  NewBucketPage(&bucket_page_1);
 
   // 对应的page_id设置桶的id并设置ld
   dir_page_data->SetBucketPageId(0, bucket_page_0);
@@ -59,18 +65,26 @@ HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager
   // 更新
   dir_page_data->IncrGlobalDepth();
   dir_page_data->SetPageId(directory_page_id_);
+  dir_page_data->SetNextSegmentPageId(INVALID_PAGE_ID);
+  segment_page_ids_.push_back(directory_page_id_);
+  global_depth_ = dir_page_data->GetGlobalDepth();
 
   // UnpinPage
   buffer_pool_manager_->UnpinPage(directory_page_id_, true);  // 需要更新
-  buffer_pool_manager_->UnpinPage(bucket_page_0, false);
-  buffer_pool_manager_->UnpinPage(bucket_page_1, false);
+  buffer_pool_manager_->UnpinPage(bucket_page_0, true);
+  buffer_pool_manager_->UnpinPage(bucket_page_1, true);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_TYPE::~ExtendibleHashTable() {
+  StopCompaction();
 }
 
 /*****************************************************************************
  * HELPERS
  *****************************************************************************/
 /**
- * Hash - simple helper to downcast MurmurHash's 64-bit hash to 32-bit
+ * Hash - simple helper to downcast the hash function's 64-bit hash to 32-bit
  * for extendible hashing.
  *
  * @param key the key to hash
@@ -78,7 +92,7 @@ HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Hash(KeyType key) -> uint32_t {
-  return static_cast<uint32_t>(hash_fn_.GetHash(key));
+  return static_cast<uint32_t>(hash_fn_->GetHash(key));
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
@@ -90,25 +104,139 @@ auto HASH_TABLE_TYPE::Pow(uint32_t base, uint32_t power) -> uint32_t {
  * 头文件定义DirectoryIndex = Hash(key) & GLOBAL_DEPTH_MASK
  *
  * @param key the key to use for lookup
- * @param dir_page to use for lookup of global depth
  * @return the directory index 也就是bucket_id
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
-inline auto HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t {
-  return Hash(key) & dir_page->GetGlobalDepthMask();
+inline auto HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key) -> uint32_t {
+  return Hash(key) & ((1U << global_depth_) - 1);
 }
 
-/**
- * Get the bucket page_id corresponding to a key.
- *
- * @param key the key for lookup
- * @param dir_page a pointer to the hash table's directory page
- * @return the bucket page_id corresponding to the input key
- * 根据key和dir_page_data得到对应的bucket_page_id
- */
 template <typename KeyType, typename ValueType, typename KeyComparator>
-inline auto HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t {
-  return dir_page->GetBucketPageId(KeyToDirectoryIndex(key, dir_page));
+inline auto HASH_TABLE_TYPE::SegmentPageId(uint32_t directory_idx) -> page_id_t {
+  // 还没复制出来的段和去掉最高位的那一段相同, 一直找到复制出来的段为止, 第0段总是存在
+  uint32_t segment = directory_idx / DIRECTORY_ARRAY_SIZE;
+  while (segment_page_ids_[segment] == INVALID_PAGE_ID) {
+    segment &= ~(1U << (31 - __builtin_clz(segment)));
+  }
+  return segment_page_ids_[segment];
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::FetchSegmentPage(uint32_t directory_idx) -> HashTableDirectoryPage * {
+  auto tem_page = buffer_pool_manager_->FetchPage(SegmentPageId(directory_idx));
+  return reinterpret_cast<HashTableDirectoryPage *>(tem_page->GetData());
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::GetDirectoryEntry(uint32_t directory_idx) -> std::pair<page_id_t, uint32_t> {
+  auto segment = FetchSegmentPage(directory_idx);
+  uint32_t slot = directory_idx % DIRECTORY_ARRAY_SIZE;
+  reinterpret_cast<Page *>(segment)->RLatch();
+  std::pair<page_id_t, uint32_t> entry{segment->GetBucketPageId(slot), segment->GetLocalDepth(slot)};
+  reinterpret_cast<Page *>(segment)->RUnlatch();
+  buffer_pool_manager_->UnpinPage(SegmentPageId(directory_idx), false);
+  return entry;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::TryGetDirectoryEntry(uint32_t directory_idx, std::pair<page_id_t, uint32_t> *entry) -> bool {
+  Page *segment_page = buffer_pool_manager_->FetchPage(SegmentPageId(directory_idx));
+  if (segment_page == nullptr) {
+    return false;
+  }
+  auto segment = reinterpret_cast<HashTableDirectoryPage *>(segment_page->GetData());
+  uint32_t slot = directory_idx % DIRECTORY_ARRAY_SIZE;
+  segment_page->RLatch();
+  *entry = {segment->GetBucketPageId(slot), segment->GetLocalDepth(slot)};
+  segment_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(SegmentPageId(directory_idx), false);
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::LatchBucket(KeyType key, bool exclusive, page_id_t *bucket_page_id, uint32_t *local_depth)
+    -> HASH_TABLE_BUCKET_TYPE * {
+  auto directory_idx = KeyToDirectoryIndex(key);
+  auto bucket_page_id_seen = GetDirectoryEntry(directory_idx).first;
+  while (true) {
+    auto hash_bucket_page = FetchBucketPage(bucket_page_id_seen);
+    auto bucket_page = reinterpret_cast<Page *>(hash_bucket_page);
+    exclusive ? bucket_page->WLatch() : bucket_page->RLatch();
+    // 拿到bucket的latch之后再确认目录项没有被并发的split改掉, split必须先拿到这个bucket的写latch
+    auto [current_page_id, current_local_depth] = GetDirectoryEntry(directory_idx);
+    if (current_page_id == bucket_page_id_seen) {
+      *bucket_page_id = current_page_id;
+      *local_depth = current_local_depth;
+      return hash_bucket_page;
+    }
+    exclusive ? bucket_page->WUnlatch() : bucket_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(bucket_page_id_seen, false);
+    bucket_page_id_seen = current_page_id;
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::PendingSegments(uint32_t first, uint32_t stride) -> std::vector<uint32_t> {
+  std::vector<uint32_t> pending;
+  uint32_t segment_stride = std::max<uint32_t>(stride / DIRECTORY_ARRAY_SIZE, 1);
+  for (uint32_t segment = first / DIRECTORY_ARRAY_SIZE; segment < segment_page_ids_.size();
+       segment += segment_stride) {
+    if (segment_page_ids_[segment] == INVALID_PAGE_ID) {
+      pending.push_back(segment);
+    }
+  }
+  return pending;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::MaterializeSegment(uint32_t segment) {
+  // 复制当前读到的内容, 然后接到链表中前一个已经复制出来的段后面
+  page_id_t source_page_id = SegmentPageId(segment * DIRECTORY_ARRAY_SIZE);
+  page_id_t new_segment_page_id;
+  auto new_segment =
+      reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->NewPage(&new_segment_page_id)->GetData());
+  auto source = reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(source_page_id)->GetData());
+  for (uint32_t slot = 0; slot < DIRECTORY_ARRAY_SIZE; slot++) {
+    new_segment->SetBucketPageId(slot, source->GetBucketPageId(slot));
+    new_segment->SetLocalDepth(slot, source->GetLocalDepth(slot));
+  }
+  buffer_pool_manager_->UnpinPage(source_page_id, false);
+
+  uint32_t prev = segment - 1;
+  while (segment_page_ids_[prev] == INVALID_PAGE_ID) {
+    prev--;
+  }
+  auto prev_segment = reinterpret_cast<HashTableDirectoryPage *>(
+      buffer_pool_manager_->FetchPage(segment_page_ids_[prev])->GetData());
+  new_segment->SetPageId(new_segment_page_id);
+  new_segment->SetNextSegmentPageId(prev_segment->GetNextSegmentPageId());
+  prev_segment->SetNextSegmentPageId(new_segment_page_id);
+  buffer_pool_manager_->UnpinPage(segment_page_ids_[prev], true);
+  buffer_pool_manager_->UnpinPage(new_segment_page_id, true);
+  segment_page_ids_[segment] = new_segment_page_id;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::ForEachEntry(uint32_t first, uint32_t stride,
+                                   const std::function<void(HashTableDirectoryPage *, uint32_t)> &fn) {
+  // 要改的段如果还是镜像, 改之前先复制出来
+  for (uint32_t segment : PendingSegments(first, stride)) {
+    MaterializeSegment(segment);
+  }
+  uint32_t size = 1U << global_depth_;
+  uint32_t idx = first;
+  while (idx < size) {
+    // 同一段内的目录项一起处理, 每段只fetch一次
+    uint32_t segment_end = (idx / DIRECTORY_ARRAY_SIZE + 1) * DIRECTORY_ARRAY_SIZE;
+    auto segment = FetchSegmentPage(idx);
+    page_id_t segment_page_id = SegmentPageId(idx);
+    reinterpret_cast<Page *>(segment)->WLatch();
+    for (; idx < segment_end && idx < size; idx += stride) {
+      fn(segment, idx);
+    }
+    reinterpret_cast<Page *>(segment)->WUnlatch();
+    buffer_pool_manager_->UnpinPage(segment_page_id, true);
+  }
 }
 
 /**
@@ -138,6 +266,137 @@ auto HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BU
   return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(bucket_page->GetData());
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::NewBucketPage(page_id_t *bucket_page_id) -> HASH_TABLE_BUCKET_TYPE * {
+  auto bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(
+      buffer_pool_manager_->NewPage(bucket_page_id)->GetData());
+  bucket_page->Init();
+  return bucket_page;
+}
+
+/*****************************************************************************
+ * OVERFLOW CHAINS
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::ScanBucket(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key,
+                                 const std::function<bool(const ValueType &)> &fn) -> bool {
+  // 一次只取一页的value, 溢出链再长也不会一次性物化
+  std::vector<ValueType> values;
+  bucket->GetValue(key, comparator_, &values);
+  for (const auto &value : values) {
+    if (!fn(value)) {
+      return false;
+    }
+  }
+  page_id_t overflow_page_id = bucket->GetOverflowPageId();
+  while (overflow_page_id != INVALID_PAGE_ID) {
+    auto overflow_page = FetchBucketPage(overflow_page_id);
+    values.clear();
+    overflow_page->GetValue(key, comparator_, &values);
+    page_id_t next_page_id = overflow_page->GetOverflowPageId();
+    buffer_pool_manager_->UnpinPage(overflow_page_id, false);
+    for (const auto &value : values) {
+      if (!fn(value)) {
+        return false;
+      }
+    }
+    overflow_page_id = next_page_id;
+  }
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::CollectValues(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, std::vector<ValueType> *result)
+    -> bool {
+  ScanBucket(bucket, key, [result](const ValueType &value) {
+    result->push_back(value);
+    return true;
+  });
+  return !result->empty();
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::ContainsPair(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, const ValueType &value)
+    -> bool {
+  return !ScanBucket(bucket, key, [&value](const ValueType &other) { return !(other == value); });
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::GetOverflowHash(HASH_TABLE_BUCKET_TYPE *bucket, uint32_t *hash) -> bool {
+  // 溢出页里的key的hash都相同, 空的溢出页会从链上摘掉, 所以看第一页的任意一项即可
+  page_id_t overflow_page_id = bucket->GetOverflowPageId();
+  if (overflow_page_id == INVALID_PAGE_ID) {
+    return false;
+  }
+  auto overflow_page = FetchBucketPage(overflow_page_id);
+  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
+    if (overflow_page->IsReadable(i)) {
+      *hash = Hash(overflow_page->KeyAt(i));
+      break;
+    }
+  }
+  buffer_pool_manager_->UnpinPage(overflow_page_id, false);
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::InsertOverflow(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, const ValueType &value) {
+  // 找链上第一个有空位的溢出页, 都满了就在链尾接一个新页
+  page_id_t tail_page_id = INVALID_PAGE_ID;
+  page_id_t overflow_page_id = bucket->GetOverflowPageId();
+  while (overflow_page_id != INVALID_PAGE_ID) {
+    auto overflow_page = FetchBucketPage(overflow_page_id);
+    if (!overflow_page->IsFull()) {
+      overflow_page->Insert(key, value, comparator_);
+      buffer_pool_manager_->UnpinPage(overflow_page_id, true);
+      return;
+    }
+    tail_page_id = overflow_page_id;
+    overflow_page_id = overflow_page->GetOverflowPageId();
+    buffer_pool_manager_->UnpinPage(tail_page_id, false);
+  }
+
+  page_id_t new_page_id;
+  NewBucketPage(&new_page_id)->Insert(key, value, comparator_);
+  buffer_pool_manager_->UnpinPage(new_page_id, true);
+  if (tail_page_id == INVALID_PAGE_ID) {
+    bucket->SetOverflowPageId(new_page_id);
+    return;
+  }
+  FetchBucketPage(tail_page_id)->SetOverflowPageId(new_page_id);
+  buffer_pool_manager_->UnpinPage(tail_page_id, true);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::RemoveOverflow(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, const ValueType &value)
+    -> bool {
+  page_id_t prev_page_id = INVALID_PAGE_ID;
+  page_id_t overflow_page_id = bucket->GetOverflowPageId();
+  while (overflow_page_id != INVALID_PAGE_ID) {
+    auto overflow_page = FetchBucketPage(overflow_page_id);
+    page_id_t next_page_id = overflow_page->GetOverflowPageId();
+    if (overflow_page->Remove(key, value, comparator_)) {
+      auto empty = overflow_page->IsEmpty();
+      buffer_pool_manager_->UnpinPage(overflow_page_id, true);
+      if (empty) {
+        // 空的溢出页从链上摘掉, prev_page_id无效说明前一页就是bucket本身
+        if (prev_page_id == INVALID_PAGE_ID) {
+          bucket->SetOverflowPageId(next_page_id);
+        } else {
+          FetchBucketPage(prev_page_id)->SetOverflowPageId(next_page_id);
+          buffer_pool_manager_->UnpinPage(prev_page_id, true);
+        }
+        buffer_pool_manager_->DeletePage(overflow_page_id);
+      }
+      return true;
+    }
+    buffer_pool_manager_->UnpinPage(overflow_page_id, false);
+    prev_page_id = overflow_page_id;
+    overflow_page_id = next_page_id;
+  }
+  return false;
+}
+
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
@@ -153,22 +412,178 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool {
   table_latch_.RLock();
 
-  auto dir_page = FetchDirectoryPage();
-  auto bucket_page_id = KeyToPageId(key, dir_page);
-  auto hash_bucket_page = FetchBucketPage(bucket_page_id);
   // 加读锁
-  reinterpret_cast<Page *>(hash_bucket_page)->RLatch();
-  auto success = hash_bucket_page->GetValue(key, comparator_, result);
+  page_id_t bucket_page_id;
+  uint32_t local_depth;
+  auto hash_bucket_page = LatchBucket(key, false, &bucket_page_id, &local_depth);
+  auto success = CollectValues(hash_bucket_page, key, result);
   reinterpret_cast<Page *>(hash_bucket_page)->RUnlatch();
   // 取消对该页的引用
   buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
 
   table_latch_.RUnlock();
 
   return success;
 }
 
+/**
+ * Streams the values associated with a key.
+ *
+ * @param transaction the current transaction
+ * @param key the key to look up
+ * @param fn called with each value, returns false to stop the scan
+ * @return true if the scan ran to the end
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::ScanValues(Transaction *transaction, const KeyType &key,
+                                 const std::function<bool(const ValueType &)> &fn) -> bool {
+  table_latch_.RLock();
+  page_id_t bucket_page_id;
+  uint32_t local_depth;
+  auto hash_bucket_page = LatchBucket(key, false, &bucket_page_id, &local_depth);
+  auto complete = ScanBucket(hash_bucket_page, key, fn);
+  reinterpret_cast<Page *>(hash_bucket_page)->RUnlatch();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  table_latch_.RUnlock();
+  return complete;
+}
+
+namespace {
+// 批量查询时预取bucket开头的几个cache line, 覆盖两个bitmap和前面的槽位
+constexpr size_t CACHE_LINE_SIZE = 64;
+constexpr size_t PREFETCH_BYTES = 4 * CACHE_LINE_SIZE;
+// 批量查询一次最多同时pin住的bucket数
+constexpr size_t PREFETCH_MAX_BUCKETS = 32;
+}  // namespace
+
+/**
+ * Performs point queries for a batch of keys.
+ *
+ * @param transaction the current transaction
+ * @param keys the keys to look up
+ * @param[out] results results[i] receives the value(s) associated with keys[i]
+ * @return the number of keys that were found
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::GetValues(Transaction *transaction, const std::vector<KeyType> &keys,
+                                std::vector<std::vector<ValueType>> *results) -> int {
+  results->assign(keys.size(), std::vector<ValueType>());
+  table_latch_.RLock();
+
+  // 先算出每个key的目录下标, 按目录下标排序, 每个目录段只fetch一次
+  std::vector<std::pair<page_id_t, size_t>> order(keys.size());
+  std::vector<uint32_t> directory_idx(keys.size());
+  std::vector<uint32_t> local_depth(keys.size());
+  std::vector<uint64_t> hashes(keys.size());
+  hash_fn_->GetHashes(keys.data(), keys.size(), hashes.data());
+  for (size_t i = 0; i < keys.size(); i++) {
+    directory_idx[i] = static_cast<uint32_t>(hashes[i]) & ((1U << global_depth_) - 1);
+    order[i] = {directory_idx[i], i};
+  }
+  std::sort(order.begin(), order.end());
+  for (size_t begin = 0; begin < order.size();) {
+    page_id_t segment_page_id = SegmentPageId(order[begin].first);
+    Page *segment_page = buffer_pool_manager_->FetchPage(segment_page_id);
+    if (segment_page == nullptr) {
+      table_latch_.RUnlock();
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch directory segment for batched lookup");
+    }
+    auto segment = reinterpret_cast<HashTableDirectoryPage *>(segment_page->GetData());
+    size_t end = begin;
+    segment_page->RLatch();
+    for (; end < order.size() && SegmentPageId(order[end].first) == segment_page_id; end++) {
+      local_depth[order[end].second] = segment->GetLocalDepth(order[end].first % DIRECTORY_ARRAY_SIZE);
+      order[end].first = segment->GetBucketPageId(order[end].first % DIRECTORY_ARRAY_SIZE);
+    }
+    segment_page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(segment_page_id, false);
+    begin = end;
+  }
+  // 再按bucket排序, 同一个bucket只fetch一次
+  std::sort(order.begin(), order.end());
+
+  // 每个bucket对应order中的一段[begin, end)
+  std::vector<std::pair<size_t, size_t>> groups;
+  for (size_t begin = 0; begin < order.size();) {
+    size_t end = begin;
+    while (end < order.size() && order[end].first == order[begin].first) {
+      end++;
+    }
+    groups.emplace_back(begin, end);
+    begin = end;
+  }
+
+  // 一个窗口内的bucket先全部fetch, 缺页的读盘在扫描之前都发出去
+  // 窗口只占buffer pool的一小部分, 给并发的操作留出frame
+  size_t window = std::clamp<size_t>(buffer_pool_manager_->GetPoolSize() / 8, 1, PREFETCH_MAX_BUCKETS);
+  std::vector<Page *> pages;
+  int found = 0;
+  for (size_t first_group = 0; first_group < groups.size();) {
+    pages.clear();
+    for (size_t g = first_group; g < groups.size() && pages.size() < window; g++) {
+      Page *page = buffer_pool_manager_->FetchPage(order[groups[g].first].first);
+      // 没有空闲frame时窗口就此截断, 一个bucket都拿不到时放弃这次查询, 之前的窗口都已经unpin了
+      if (page == nullptr) {
+        if (!pages.empty()) {
+          break;
+        }
+        table_latch_.RUnlock();
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch bucket page for batched lookup");
+      }
+      for (size_t offset = 0; offset < PREFETCH_BYTES; offset += CACHE_LINE_SIZE) {
+        __builtin_prefetch(page->GetData() + offset);
+      }
+      pages.push_back(page);
+    }
+
+    for (size_t g = first_group; g < first_group + pages.size(); g++) {
+      auto [begin, end] = groups[g];
+      Page *page = pages[g - first_group];
+      page->RLatch();
+      // 读目录段缺frame时先放掉窗口尾部还没扫描的bucket, 只剩当前bucket还不够就放弃这次查询
+      auto first = order[begin].second;
+      std::pair<page_id_t, uint32_t> entry;
+      while (!TryGetDirectoryEntry(directory_idx[first], &entry)) {
+        if (first_group + pages.size() == g + 1) {
+          page->RUnlatch();
+          buffer_pool_manager_->UnpinPage(order[begin].first, false);
+          table_latch_.RUnlock();
+          throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch directory segment for batched lookup");
+        }
+        buffer_pool_manager_->UnpinPage(order[groups[first_group + pages.size() - 1].first].first, false);
+        pages.pop_back();
+      }
+      // bucket的local depth没变说明读目录之后它没有被split过, 这一组key仍然都在这个bucket里
+      auto valid = entry == std::make_pair(order[begin].first, local_depth[first]);
+      auto hash_bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(page->GetData());
+      for (size_t i = begin; i < end && valid; i++) {
+        size_t index = order[i].second;
+        found += static_cast<int>(CollectValues(hash_bucket_page, keys[index], &(*results)[index]));
+      }
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(order[begin].first, false);
+      // 被split过的bucket逐个key重新查, 先放掉窗口尾部, 和单个key查询需要的frame一样多
+      while (!valid && first_group + pages.size() > g + 1) {
+        buffer_pool_manager_->UnpinPage(order[groups[first_group + pages.size() - 1].first].first, false);
+        pages.pop_back();
+      }
+      for (size_t i = begin; i < end && !valid; i++) {
+        size_t index = order[i].second;
+        page_id_t bucket_page_id;
+        uint32_t bucket_local_depth;
+        hash_bucket_page = LatchBucket(keys[index], false, &bucket_page_id, &bucket_local_depth);
+        found += static_cast<int>(CollectValues(hash_bucket_page, keys[index], &(*results)[index]));
+        reinterpret_cast<Page *>(hash_bucket_page)->RUnlatch();
+        buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+      }
+    }
+    first_group += pages.size();
+  }
+
+  table_latch_.RUnlock();
+  return found;
+}
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
@@ -183,26 +598,23 @@ auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
   table_latch_.RLock();
-  auto dir_page = FetchDirectoryPage();
-  auto bucket_page_id = KeyToPageId(key, dir_page);
-  auto hash_bucket_page = FetchBucketPage(bucket_page_id);
-  reinterpret_cast<Page *>(hash_bucket_page)->WLatch();
-  // std::cout << "start insert" << std::endl;
+  page_id_t bucket_page_id;
+  uint32_t local_depth;
+  auto hash_bucket_page = LatchBucket(key, true, &bucket_page_id, &local_depth);
   if (hash_bucket_page->IsFull()) {
     // bucket满了需要split再insert
     reinterpret_cast<Page *>(hash_bucket_page)->WUnlatch();
     buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
     table_latch_.RUnlock();
-    // std::cout << "using split" << std::endl;
     return SplitInsert(transaction, key, value);
   }
-  // 没有满可以直接Insert
-  auto success = hash_bucket_page->Insert(key, value, comparator_);
+  // 没有满可以直接Insert, 有溢出链时先确认链上没有相同的kv对
+  auto success = (hash_bucket_page->GetOverflowPageId() == INVALID_PAGE_ID ||
+                  !ContainsPair(hash_bucket_page, key, value)) &&
+                 hash_bucket_page->Insert(key, value, comparator_);
   reinterpret_cast<Page *>(hash_bucket_page)->WUnlatch();
 
   buffer_pool_manager_->UnpinPage(bucket_page_id, success);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
   table_latch_.RUnlock();
   return success;
 }
@@ -217,81 +629,343 @@ auto HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  // std::cout << "split insert key = " << key << std::endl;
-  table_latch_.WLock();
-  auto dir_page = FetchDirectoryPage();
-  auto success = false;   // 返回值,是否插入成功
-  auto inserted = false;  // 判断是否在bucket没有满的时候执行insert操作
-  auto growed = false;
-
-  while (!inserted) {
-    // 没有分裂出可以执行insert的bucket就一直分裂
-    auto old_global_depth = dir_page->GetGlobalDepth();
-    auto bucket_page_id = KeyToPageId(key, dir_page);
-    auto hash_bucket_page = FetchBucketPage(bucket_page_id);
+  while (true) {
+    // 不需要扩充directory的split只持有table读锁, 只latch这个bucket和要改的目录段
+    table_latch_.RLock();
+    page_id_t bucket_page_id;
+    uint32_t local_depth;
+    auto hash_bucket_page = LatchBucket(key, true, &bucket_page_id, &local_depth);
     auto bucket_page = reinterpret_cast<Page *>(hash_bucket_page);
-    auto bucket_idx = KeyToDirectoryIndex(key, dir_page);
-    // auto bucket_local_depth = dir_page->GetLocalDepth(bucket_idx);
-
-    bucket_page->WLatch();
+    if (!hash_bucket_page->IsFull()) {
+      auto success = !ContainsPair(hash_bucket_page, key, value) && hash_bucket_page->Insert(key, value, comparator_);
+      bucket_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, success);
+      table_latch_.RUnlock();
+      return success;
+    }
+    // 所有key(包括溢出链上的)的hash都和新key相同时分裂也分不开, 只能接到溢出链上
+    auto hash = Hash(key);
+    uint32_t overflow_hash;
+    auto separable = GetOverflowHash(hash_bucket_page, &overflow_hash) && overflow_hash != hash;
+    for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE && !separable; i++) {
+      separable = hash_bucket_page->IsReadable(i) && Hash(hash_bucket_page->KeyAt(i)) != hash;
+    }
+    if (!separable) {
+      auto success = !ContainsPair(hash_bucket_page, key, value);
+      if (success) {
+        InsertOverflow(hash_bucket_page, key, value);
+      }
+      bucket_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, success);
+      table_latch_.RUnlock();
+      return success;
+    }
+    // split要改的目录段都已经复制出来时才能只持有读锁
+    auto directory_idx = KeyToDirectoryIndex(key);
+    uint32_t high_bit = 1U << local_depth;
+    if (local_depth < global_depth_ && PendingSegments(directory_idx & (high_bit - 1), high_bit).empty()) {
+      SplitBucket(directory_idx, bucket_page_id, local_depth, hash_bucket_page);
+      table_latch_.RUnlock();
+      continue;
+    }
+    bucket_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+    table_latch_.RUnlock();
 
-    if (hash_bucket_page->IsFull()) {
-      // 判断是否需要扩充directory
-      if (dir_page->GetGlobalDepth() == dir_page->GetLocalDepth(bucket_idx)) {
-        dir_page->IncrGlobalDepth();
-        growed = true;
+    // 扩充directory和复制目录段需要table写锁, 拿到之后重新检查; 等锁期间bucket可能已经被别的线程split
+    table_latch_.WLock();
+    directory_idx = KeyToDirectoryIndex(key);
+    std::tie(bucket_page_id, local_depth) = GetDirectoryEntry(directory_idx);
+    auto full = false;
+    if (local_depth == global_depth_) {
+      full = FetchBucketPage(bucket_page_id)->IsFull();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+    }
+    auto can_grow = global_depth_ < MAX_GLOBAL_DEPTH;
+    if (full && can_grow) {
+      GrowDirectory();
+    } else if (local_depth < global_depth_) {
+      high_bit = 1U << local_depth;
+      for (uint32_t segment : PendingSegments(directory_idx & (high_bit - 1), high_bit)) {
+        MaterializeSegment(segment);
       }
+    }
+    table_latch_.WUnlock();
+    if (full && !can_grow) {
+      return false;
+    }
+  }
+}
 
-      // 找到要分裂的bucket并更新
-      dir_page->IncrLocalDepth(bucket_idx);
-      auto split_bucket_idx = dir_page->GetSplitImageIndex(bucket_idx);  // 得到bucket_idx分裂的新split_bucket_idx
-      page_id_t split_page_id;                                           // 用来新分配一个page
-      auto new_page = buffer_pool_manager_->NewPage(&split_page_id);     // 新分配一个page并给split_page_id赋值
-      auto split_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(new_page->GetData());
-      // 给新的bucket_page的id和ld对应起来
-      dir_page->SetBucketPageId(split_bucket_idx, split_page_id);
-      dir_page->SetLocalDepth(split_bucket_idx,
-                              dir_page->GetLocalDepth(bucket_idx));  // 新的ld和之前的bucket_idx的ld一样
-
-      // 对原来bucket_idx内的每个page重新分配
-      uint32_t all_num_readable = hash_bucket_page->NumReadable();  // 满的这个bucket总共的存储数
-      uint32_t tem_num_readable = 0;
-      while (tem_num_readable < all_num_readable) {
-        if (hash_bucket_page->IsReadable(tem_num_readable)) {
-          auto tem_key = hash_bucket_page->KeyAt(tem_num_readable);
-          uint32_t new_bucket_idx = Hash(tem_key) & (Pow(2, dir_page->GetLocalDepth(bucket_idx)) - 1);
-          if ((new_bucket_idx ^ split_bucket_idx) == 0) {
-            // 相同为0, 不同为1
-            auto tem_value = hash_bucket_page->ValueAt(tem_num_readable);
-            split_page->Insert(tem_key, tem_value, comparator_);
-            hash_bucket_page->RemoveAt(tem_num_readable);
-          }
-          tem_num_readable++;
-        }
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::SplitBucket(uint32_t directory_idx, page_id_t bucket_page_id, uint32_t local_depth,
+                                  HASH_TABLE_BUCKET_TYPE *bucket) {
+  page_id_t split_page_id;
+  auto split_page = NewBucketPage(&split_page_id);
+
+  // 有溢出链的bucket留在链上key的hash那一侧, split_page接另一侧
+  uint32_t high_bit = 1U << local_depth;
+  uint32_t overflow_hash;
+  auto keep_high = GetOverflowHash(bucket, &overflow_hash) && (overflow_hash & high_bit) != 0;
+
+  // 先搬key再改目录, 目录指向split_page之前别的线程看不到它
+  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
+    if (bucket->IsReadable(i) && ((Hash(bucket->KeyAt(i)) & high_bit) != 0) != keep_high) {
+      split_page->Insert(bucket->KeyAt(i), bucket->ValueAt(i), comparator_);
+      bucket->RemoveAt(i);
+    }
+  }
+  buffer_pool_manager_->UnpinPage(split_page_id, true);
+
+  // 指向原bucket的目录项低local_depth位相同, 新的最高位和原bucket那一侧不同的改指向split_page
+  ForEachEntry(directory_idx & (high_bit - 1), high_bit, [&](HashTableDirectoryPage *segment, uint32_t idx) {
+    segment->SetLocalDepth(idx % DIRECTORY_ARRAY_SIZE, local_depth + 1);
+    if (((idx & high_bit) != 0) != keep_high) {
+      segment->SetBucketPageId(idx % DIRECTORY_ARRAY_SIZE, split_page_id);
+    }
+  });
+  reinterpret_cast<Page *>(bucket)->WUnlatch();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::GrowDirectory() {
+  if (global_depth_ < MAX_BUCKET_DEPTH) {
+    // 目录还在一页内, 把前一半复制到后一半
+    auto dir_page = FetchDirectoryPage();
+    uint32_t size = dir_page->Size();
+    for (uint32_t i = 0; i < size; i++) {
+      dir_page->SetBucketPageId(i + size, dir_page->GetBucketPageId(i));
+      dir_page->SetLocalDepth(i + size, dir_page->GetLocalDepth(i));
+    }
+    dir_page->IncrGlobalDepth();
+    buffer_pool_manager_->UnpinPage(directory_page_id_, true);
+    global_depth_++;
+    return;
+  }
+
+  // 目录已经占满整页, 新的一半先不复制, 读的时候找前一半对应的段, 第一次要改的时候再复制出来
+  segment_page_ids_.resize(segment_page_ids_.size() * 2, INVALID_PAGE_ID);
+  auto dir_page = FetchDirectoryPage();
+  dir_page->IncrGlobalDepth();
+  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
+  global_depth_++;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::ShrinkDirectory() {
+  if (global_depth_ > MAX_BUCKET_DEPTH) {
+    // 后一半的段和前一半完全相同, 复制出来的直接删掉
+    size_t segment_count = segment_page_ids_.size() / 2;
+    for (size_t i = segment_count; i < segment_page_ids_.size(); i++) {
+      if (segment_page_ids_[i] != INVALID_PAGE_ID) {
+        buffer_pool_manager_->DeletePage(segment_page_ids_[i]);
       }
-      buffer_pool_manager_->UnpinPage(split_page_id, true, nullptr);
-      // redirect the rest of the buckets.
-      //! for more info, see VerifyIntegrity().
-      for (uint32_t i = Pow(2, old_global_depth); i < dir_page->Size(); i++) {
-        if (i == split_bucket_idx) {
+    }
+    segment_page_ids_.resize(segment_count);
+    size_t tail = segment_count - 1;
+    while (segment_page_ids_[tail] == INVALID_PAGE_ID) {
+      tail--;
+    }
+    page_id_t tail_page_id = segment_page_ids_[tail];
+    auto tail_segment =
+        reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(tail_page_id)->GetData());
+    tail_segment->SetNextSegmentPageId(INVALID_PAGE_ID);
+    buffer_pool_manager_->UnpinPage(tail_page_id, true);
+  }
+  auto dir_page = FetchDirectoryPage();
+  dir_page->DecrGlobalDepth();
+  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
+  global_depth_--;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::CanShrink() -> bool {
+  auto can_shrink = global_depth_ > 1;
+  for (size_t i = 0; i < segment_page_ids_.size() && can_shrink; i++) {
+    // 镜像段的内容和它对应的段相同, 不用重复检查
+    if (segment_page_ids_[i] == INVALID_PAGE_ID) {
+      continue;
+    }
+    auto segment = reinterpret_cast<HashTableDirectoryPage *>(
+        buffer_pool_manager_->FetchPage(segment_page_ids_[i])->GetData());
+    uint32_t size = std::min<uint32_t>(1U << global_depth_, DIRECTORY_ARRAY_SIZE);
+    for (uint32_t slot = 0; slot < size && can_shrink; slot++) {
+      can_shrink = segment->GetLocalDepth(slot) < global_depth_;
+    }
+    buffer_pool_manager_->UnpinPage(segment_page_ids_[i], false);
+  }
+  return can_shrink;
+}
+
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+namespace {
+// 批量建表时一次交给GetHashes的key数
+constexpr size_t HASH_BATCH_SIZE = 64;
+
+// 批量建表时的一个bucket: hash低local_depth_位等于prefix_的条目都在这个bucket里
+struct BulkBucket {
+  uint32_t prefix_;
+  uint32_t local_depth_;
+};
+
+auto InBucket(uint32_t hash, const BulkBucket &bucket) -> bool {
+  return (hash & ((1ULL << bucket.local_depth_) - 1)) == bucket.prefix_;
+}
+}  // namespace
+
+/**
+ * Fills an empty hash table from a stream of distinct key-value pairs.
+ *
+ * @param transaction the current transaction
+ * @param next hands out one pair per call, returns false at the end of the input
+ * @return false if the table was not empty
+ * @throws Exception if a full bucket at MAX_GLOBAL_DEPTH could not take some pairs
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::BulkLoad(Transaction *transaction, const std::function<bool(MappingType *)> &next) -> bool {
+  table_latch_.WLock();
+  // 只能从刚建好的空表开始: global depth为1, 两个空bucket
+  page_id_t old_bucket_page_ids[2] = {GetDirectoryEntry(0).first, GetDirectoryEntry(1).first};
+  auto empty = global_depth_ == 1;
+  for (auto bucket_page_id : old_bucket_page_ids) {
+    if (empty) {
+      auto bucket_page = FetchBucketPage(bucket_page_id);
+      empty = bucket_page->IsEmpty() && bucket_page->GetOverflowPageId() == INVALID_PAGE_ID;
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+    }
+  }
+  if (!empty) {
+    table_latch_.WUnlock();
+    return false;
+  }
+
+  // 每个key只算一次hash, 按反转后的hash做外部排序, 内存里最多留一个run, 排完后hash低位相同的条目连成一段
+  using Record = std::pair<uint32_t, MappingType>;
+  size_t run_size = buffer_pool_manager_->GetPoolSize() * (PAGE_SIZE / sizeof(Record));
+  ExternalSorter<uint32_t, MappingType, HashOrderComparator> sorter(buffer_pool_manager_, HashOrderComparator(),
+                                                                    run_size);
+  std::vector<MappingType> batch(HASH_BATCH_SIZE);
+  std::vector<KeyType> keys(HASH_BATCH_SIZE);
+  std::vector<uint64_t> hashes(HASH_BATCH_SIZE);
+  for (auto more = true; more;) {
+    size_t count = 0;
+    for (; count < HASH_BATCH_SIZE && (more = next(&batch[count])); count++) {
+      keys[count] = batch[count].first;
+    }
+    hash_fn_->GetHashes(keys.data(), count, hashes.data());
+    for (size_t i = 0; i < count; i++) {
+      sorter.Add({HashOrderComparator::ReverseBits(static_cast<uint32_t>(hashes[i])), batch[i]});
+    }
+  }
+  sorter.Finish();
+
+  // 排好序的条目最多往前看一个bucket多一条, 就能决定当前这段成为一个bucket还是再切开
+  std::deque<Record> ahead;
+  Record record;
+  auto peek = [&](size_t count) {
+    while (ahead.size() < count && sorter.Next(&record)) {
+      ahead.emplace_back(HashOrderComparator::ReverseBits(record.first), record.second);
+    }
+  };
+  // 把队首属于bucket的条目写进新的bucket页; 一页放不下的只能是同一个hash, 接到溢出链上,
+  // 只有MAX_GLOBAL_DEPTH的bucket会剩下hash不同又放不下的条目, 记下来, 装完后报错
+  auto dropped = false;
+  auto write_bucket = [&](const BulkBucket &bucket) {
+    page_id_t bucket_page_id;
+    auto page = NewBucketPage(&bucket_page_id);
+    page_id_t page_id = bucket_page_id;
+    uint32_t slot = 0;
+    peek(1);
+    uint32_t first_hash = ahead.empty() ? 0 : ahead.front().first;
+    auto one_hash = true;
+    for (; !ahead.empty() && InBucket(ahead.front().first, bucket); ahead.pop_front(), peek(1)) {
+      const auto &[hash, pair] = ahead.front();
+      one_hash = one_hash && hash == first_hash;
+      if (page_id != bucket_page_id || slot == BUCKET_ARRAY_SIZE) {
+        if (!one_hash) {
+          dropped = true;
           continue;
         }
-        uint32_t redirect_bucket_idx = i & (Pow(2, old_global_depth) - 1);
-        dir_page->SetBucketPageId(i, dir_page->GetBucketPageId(redirect_bucket_idx));
-        dir_page->SetLocalDepth(i, dir_page->GetLocalDepth(redirect_bucket_idx));
+        if (slot == BUCKET_ARRAY_SIZE) {
+          page_id_t overflow_page_id;
+          auto overflow_page = NewBucketPage(&overflow_page_id);
+          page->SetOverflowPageId(overflow_page_id);
+          buffer_pool_manager_->UnpinPage(page_id, true);
+          page = overflow_page;
+          page_id = overflow_page_id;
+          slot = 0;
+        }
       }
+      page->InsertAt(slot++, pair.first, pair.second);
+    }
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    return bucket_page_id;
+  };
+  auto map_bucket = [&](const BulkBucket &bucket, page_id_t bucket_page_id) {
+    while (global_depth_ < bucket.local_depth_) {
+      GrowDirectory();
+    }
+    ForEachEntry(bucket.prefix_, 1U << bucket.local_depth_, [&](HashTableDirectoryPage *segment, uint32_t idx) {
+      segment->SetBucketPageId(idx % DIRECTORY_ARRAY_SIZE, bucket_page_id);
+      segment->SetLocalDepth(idx % DIRECTORY_ARRAY_SIZE, bucket.local_depth_);
+    });
+  };
 
-    } else {
-      success = hash_bucket_page->Insert(key, value, comparator_);
-      inserted = true;
+  // 按hash前缀逐位切分, 先处理0那一半, 和排序的顺序一致
+  std::vector<BulkBucket> pending{{0, 0}};
+  while (!pending.empty()) {
+    auto range = pending.back();
+    pending.pop_back();
+    peek(BUCKET_ARRAY_SIZE + 1);
+    size_t count = 0;
+    while (count < ahead.size() && InBucket(ahead[count].first, range)) {
+      count++;
     }
-    // 定义在循环内, 结束该循环的时候得unpin
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true, nullptr);
-    bucket_page->WUnlatch();
+    if (range.local_depth_ > 0 && (count <= BUCKET_ARRAY_SIZE || range.local_depth_ == MAX_GLOBAL_DEPTH)) {
+      map_bucket(range, write_bucket(range));
+      continue;
+    }
+    if (range.local_depth_ > 0 && ahead[count - 1].first == ahead.front().first) {
+      // 开头超过一页的条目hash全都相同: 整串写进一个bucket和它的溢出链, 再在它和下一个hash第一个不同的位上切开
+      uint32_t hash = ahead.front().first;
+      page_id_t bucket_page_id = write_bucket({hash, 32});
+      peek(1);
+      uint32_t depth = range.local_depth_;
+      if (!ahead.empty() && InBucket(ahead.front().first, range)) {
+        depth = std::min<uint32_t>(__builtin_ctz(hash ^ ahead.front().first) + 1, MAX_GLOBAL_DEPTH);
+      }
+      BulkBucket bucket{hash & ((1U << depth) - 1), depth};
+      for (peek(1); !ahead.empty() && InBucket(ahead.front().first, bucket); peek(1)) {
+        ahead.pop_front();
+        dropped = true;
+      }
+      // 路径上排在这个hash前面的兄弟一定是空的, 排在后面的留到后面处理
+      for (uint32_t d = range.local_depth_; d < depth; d++) {
+        uint32_t bit = 1U << d;
+        BulkBucket sibling{(hash & (bit - 1)) | (~hash & bit), d + 1};
+        if ((hash & bit) != 0) {
+          map_bucket(sibling, write_bucket(sibling));
+        } else {
+          pending.push_back(sibling);
+        }
+      }
+      map_bucket(bucket, bucket_page_id);
+      continue;
+    }
+    pending.push_back({range.prefix_ | (1U << range.local_depth_), range.local_depth_ + 1});
+    pending.push_back({range.prefix_, range.local_depth_ + 1});
+  }
+  for (auto bucket_page_id : old_bucket_page_ids) {
+    buffer_pool_manager_->DeletePage(bucket_page_id);
   }
-  buffer_pool_manager_->UnpinPage(directory_page_id_, growed, nullptr);
   table_latch_.WUnlock();
-  return success;
+  if (dropped) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "ExtendibleHashTable::BulkLoad: a bucket at max depth overflowed");
+  }
+  return true;
 }
 
 /*****************************************************************************
@@ -308,23 +982,28 @@ auto HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key,
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
   table_latch_.RLock();
-  auto dir_page = FetchDirectoryPage();
-  auto bucket_page_id = KeyToPageId(key, dir_page);
-  auto hash_bucket_page = FetchBucketPage(bucket_page_id);
+  page_id_t bucket_page_id;
+  uint32_t local_depth;
+  auto hash_bucket_page = LatchBucket(key, true, &bucket_page_id, &local_depth);
   auto bucket_page = reinterpret_cast<Page *>(hash_bucket_page);
-  // 加锁并且unpin
-  bucket_page->WLatch();
-  auto success = hash_bucket_page->Remove(key, value, comparator_);
+  // unpin之前记下是否为空
+  auto success =
+      hash_bucket_page->Remove(key, value, comparator_) || RemoveOverflow(hash_bucket_page, key, value);
+  auto empty = success && hash_bucket_page->IsEmpty() && hash_bucket_page->GetOverflowPageId() == INVALID_PAGE_ID;
+  // 阈值以下的bucket交给Compact去合并, 不在remove里做
+  auto underfull = success && !empty && local_depth > 1 && hash_bucket_page->NumReadable() < MERGE_CANDIDATE_SIZE;
   bucket_page->WUnlatch();
 
   buffer_pool_manager_->UnpinPage(bucket_page_id, success, nullptr);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
 
   table_latch_.RUnlock();
+  if (underfull) {
+    std::lock_guard<std::mutex> guard(merge_latch_);
+    merge_candidates_.insert(Hash(key) & ((1U << local_depth) - 1));
+  }
   // 需要merge
-  if (success && hash_bucket_page->IsEmpty()) {
+  if (empty) {
     Merge(transaction, key, value);
-    // while (ExtraMerge(transaction, key, value)) {}
   }
   return success;
 }
@@ -336,48 +1015,129 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {
   table_latch_.WLock();
 
-  auto dir_page_data = FetchDirectoryPage();
-
-  // traverse the directory page and merge all empty buckets.
-  uint32_t i = 0;
-  while (i < dir_page_data->Size()) {
-    auto old_local_depth = dir_page_data->GetLocalDepth(i);
-    auto bucket_page_id = dir_page_data->GetBucketPageId(i);
-    auto bucket_page_data = FetchBucketPage(bucket_page_id);
-    auto bucket_page = reinterpret_cast<Page *>(bucket_page_data);
-    bucket_page->RLatch();
-    if (old_local_depth > 1 && bucket_page_data->IsEmpty()) {
-      auto split_bucket_idx = dir_page_data->GetSplitImageIndex(i);
-      if (dir_page_data->GetLocalDepth(split_bucket_idx) == old_local_depth) {
-        dir_page_data->DecrLocalDepth(i);
-        dir_page_data->DecrLocalDepth(split_bucket_idx);
-        dir_page_data->SetBucketPageId(i, dir_page_data->GetBucketPageId(split_bucket_idx));
-        auto new_bucket_page_id = dir_page_data->GetBucketPageId(i);
-
-        // after merging the buckets, all buckets with the same page id as the bucket pair need to be updated.
-        //! For more info, see VerifyIntegrity().
-        for (uint32_t j = 0; j < dir_page_data->Size(); j++) {
-          if (j == i || j == split_bucket_idx) {
-            continue;
-          }
-          auto cur_bucket_page_id = dir_page_data->GetBucketPageId(j);
-          if (cur_bucket_page_id == bucket_page_id || cur_bucket_page_id == new_bucket_page_id) {
-            dir_page_data->SetLocalDepth(j, dir_page_data->GetLocalDepth(i));
-            dir_page_data->SetBucketPageId(j, new_bucket_page_id);
-          }
-        }
-      }
-      if (dir_page_data->CanShrink()) {
-        dir_page_data->DecrGlobalDepth();
+  // remove路径上只合并空bucket
+  auto shrinkable = false;
+  MergeImages(Hash(key), 0, &shrinkable);
+
+  // 只有local depth等于global depth的bucket被合并过, 目录才可能收缩
+  while (shrinkable && CanShrink()) {
+    ShrinkDirectory();
+  }
+
+  table_latch_.WUnlock();
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::MergeImages(uint32_t hash, uint32_t max_size, bool *shrinkable) -> int {
+  int freed = 0;
+  while (true) {
+    auto directory_idx = hash & ((1U << global_depth_) - 1);
+    auto [bucket_page_id, local_depth] = GetDirectoryEntry(directory_idx);
+    if (local_depth <= 1) {
+      break;
+    }
+    uint32_t high_bit = 1U << (local_depth - 1);
+    auto [image_page_id, image_local_depth] = GetDirectoryEntry(directory_idx ^ high_bit);
+    if (image_local_depth != local_depth) {
+      break;
+    }
+    auto bucket_page = FetchBucketPage(bucket_page_id);
+    auto image_page = FetchBucketPage(image_page_id);
+    auto chained =
+        bucket_page->GetOverflowPageId() != INVALID_PAGE_ID || image_page->GetOverflowPageId() != INVALID_PAGE_ID;
+    auto bucket_size = bucket_page->NumReadable();
+    auto image_size = image_page->NumReadable();
+    auto bucket_empty = bucket_size == 0 && bucket_page->GetOverflowPageId() == INVALID_PAGE_ID;
+    auto image_empty = image_size == 0 && image_page->GetOverflowPageId() == INVALID_PAGE_ID;
+    if (!bucket_empty && !image_empty && (chained || bucket_size + image_size > max_size)) {
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+      buffer_pool_manager_->UnpinPage(image_page_id, false);
+      break;
+    }
+
+    // 留下非空且条目多的那个, 另一个的条目搬过去之后删掉
+    auto keep_image = bucket_empty || (!image_empty && image_size > bucket_size);
+    auto merged_page_id = keep_image ? image_page_id : bucket_page_id;
+    auto removed_page_id = keep_image ? bucket_page_id : image_page_id;
+    auto merged_page = keep_image ? image_page : bucket_page;
+    auto removed_page = keep_image ? bucket_page : image_page;
+    for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
+      if (removed_page->IsReadable(i)) {
+        merged_page->Insert(removed_page->KeyAt(i), removed_page->ValueAt(i), comparator_);
       }
     }
-    bucket_page->RUnlatch();
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    i++;
+    buffer_pool_manager_->UnpinPage(merged_page_id, true);
+    buffer_pool_manager_->UnpinPage(removed_page_id, false);
+
+    // 两个bucket的所有目录项都指向留下来的那个; 合并后可能还能和上一层继续合并
+    ForEachEntry(directory_idx & (high_bit - 1), high_bit, [&](HashTableDirectoryPage *segment, uint32_t idx) {
+      segment->SetLocalDepth(idx % DIRECTORY_ARRAY_SIZE, local_depth - 1);
+      segment->SetBucketPageId(idx % DIRECTORY_ARRAY_SIZE, merged_page_id);
+    });
+    buffer_pool_manager_->DeletePage(removed_page_id);
+    freed++;
+    *shrinkable = *shrinkable || local_depth == global_depth_;
   }
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
+  return freed;
+}
 
-  table_latch_.WUnlock();
+/*****************************************************************************
+ * COMPACTION
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::Compact() -> int {
+  std::vector<uint32_t> candidates;
+  {
+    std::lock_guard<std::mutex> guard(merge_latch_);
+    candidates.assign(merge_candidates_.begin(), merge_candidates_.end());
+    merge_candidates_.clear();
+  }
+  // 按前缀排序, 相邻的bucket连着合并
+  std::sort(candidates.begin(), candidates.end());
+
+  int freed = 0;
+  // 每次拿写锁只合并一小批, 中间放开让前台的读写进来
+  constexpr size_t batch_size = 16;
+  for (size_t begin = 0; begin < candidates.size(); begin += batch_size) {
+    table_latch_.WLock();
+    auto shrinkable = false;
+    for (size_t i = begin; i < std::min(begin + batch_size, candidates.size()); i++) {
+      freed += MergeImages(candidates[i], MERGE_MAX_SIZE, &shrinkable);
+    }
+    while (shrinkable && CanShrink()) {
+      ShrinkDirectory();
+    }
+    table_latch_.WUnlock();
+  }
+  return freed;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::StartCompaction() {
+  if (compaction_running_.exchange(true)) {
+    return;
+  }
+  compaction_thread_ = std::thread([this]() {
+    // 等一个compaction_interval, StopCompaction会提前叫醒
+    std::unique_lock<std::mutex> lock(compaction_latch_);
+    while (!compaction_cv_.wait_for(lock, compaction_interval, [this]() { return !compaction_running_; })) {
+      lock.unlock();
+      Compact();
+      lock.lock();
+    }
+  });
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::StopCompaction() {
+  {
+    std::lock_guard<std::mutex> guard(compaction_latch_);
+    compaction_running_ = false;
+  }
+  compaction_cv_.notify_all();
+  if (compaction_thread_.joinable()) {
+    compaction_thread_.join();
+  }
 }
 
 /*****************************************************************************
@@ -399,9 +1159,54 @@ auto HASH_TABLE_TYPE::GetGlobalDepth() -> uint32_t {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::VerifyIntegrity() {
   table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  dir_page->VerifyIntegrity();
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
+  if (global_depth_ <= MAX_BUCKET_DEPTH) {
+    HashTableDirectoryPage *dir_page = FetchDirectoryPage();
+    dir_page->VerifyIntegrity();
+    assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
+    table_latch_.RUnlock();
+    return;
+  }
+
+  // 目录分成多段时按同样的三个条件检查所有段
+  std::unordered_map<page_id_t, uint32_t> page_id_to_count;
+  std::unordered_map<page_id_t, uint32_t> page_id_to_ld;
+  // 镜像段读它对应的段, 链表上只有复制出来的段
+  page_id_t next_segment_page_id = directory_page_id_;
+  for (uint32_t i = 0; i < segment_page_ids_.size(); i++) {
+    page_id_t segment_page_id = SegmentPageId(i * DIRECTORY_ARRAY_SIZE);
+    auto materialized = segment_page_ids_[i] != INVALID_PAGE_ID;
+    if (materialized && segment_page_id != next_segment_page_id) {
+      LOG_WARN("Verify Integrity: segment page_id: %d, linked page_id: %d", segment_page_id, next_segment_page_id);
+      assert(segment_page_id == next_segment_page_id);
+    }
+    auto segment = reinterpret_cast<HashTableDirectoryPage *>(
+        buffer_pool_manager_->FetchPage(segment_page_id)->GetData());
+    for (uint32_t slot = 0; slot < DIRECTORY_ARRAY_SIZE; slot++) {
+      page_id_t curr_page_id = segment->GetBucketPageId(slot);
+      uint32_t curr_ld = segment->GetLocalDepth(slot);
+      assert(curr_ld <= global_depth_);
+      ++page_id_to_count[curr_page_id];
+      if (page_id_to_ld.count(curr_page_id) > 0 && curr_ld != page_id_to_ld[curr_page_id]) {
+        LOG_WARN("Verify Integrity: curr_local_depth: %u, old_local_depth %u, for page_id: %u", curr_ld,
+                 page_id_to_ld[curr_page_id], curr_page_id);
+        assert(curr_ld == page_id_to_ld[curr_page_id]);
+      }
+      page_id_to_ld[curr_page_id] = curr_ld;
+    }
+    if (materialized) {
+      next_segment_page_id = segment->GetNextSegmentPageId();
+    }
+    buffer_pool_manager_->UnpinPage(segment_page_id, false);
+  }
+  assert(next_segment_page_id == INVALID_PAGE_ID);
+  for (const auto &[curr_page_id, curr_count] : page_id_to_count) {
+    uint32_t required_count = 0x1 << (global_depth_ - page_id_to_ld[curr_page_id]);
+    if (curr_count != required_count) {
+      LOG_WARN("Verify Integrity: curr_count: %u, required_count %u, for page_id: %u", curr_count, required_count,
+               curr_page_id);
+      assert(curr_count == required_count);
+    }
+  }
   table_latch_.RUnlock();
 }
 
@@ -11,12 +11,183 @@
 //===----------------------------------------------------------------------===//
 #include "execution/executors/index_scan_executor.h"
 
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "execution/expressions/constant_value_expression.h"
+#include "storage/index/b_plus_tree_index.h"
+#include "type/value_factory.h"
+
 namespace bustub {
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx),
+      plan_(plan),
+      index_info_(nullptr),
+      table_info_(nullptr),
+      index_only_(false) {}
+
+void IndexScanExecutor::CollectColumns(const AbstractExpression *expr, std::vector<uint32_t> *columns) {
+  if (expr == nullptr) {
+    return;
+  }
+  if (const auto *column = dynamic_cast<const ColumnValueExpression *>(expr); column != nullptr) {
+    columns->push_back(column->GetColIdx());
+  }
+  for (const auto *child : expr->GetChildren()) {
+    CollectColumns(child, columns);
+  }
+}
+
+void IndexScanExecutor::DeriveBounds(std::unique_ptr<Value> *low, std::unique_ptr<Value> *high) const {
+  const auto *comparison = dynamic_cast<const ComparisonExpression *>(plan_->GetPredicate());
+  if (comparison == nullptr) {
+    return;
+  }
+  // 只认 列 op 常量 或 常量 op 列, 列必须是索引的第一个key列
+  const auto *column = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(0));
+  const auto *constant = dynamic_cast<const ConstantValueExpression *>(comparison->GetChildAt(1));
+  ComparisonType type = comparison->GetComparisonType();
+  if (column == nullptr || constant == nullptr) {
+    column = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(1));
+    constant = dynamic_cast<const ConstantValueExpression *>(comparison->GetChildAt(0));
+    switch (type) {
+      case ComparisonType::LessThan:
+        type = ComparisonType::GreaterThan;
+        break;
+      case ComparisonType::LessThanOrEqual:
+        type = ComparisonType::GreaterThanOrEqual;
+        break;
+      case ComparisonType::GreaterThan:
+        type = ComparisonType::LessThan;
+        break;
+      case ComparisonType::GreaterThanOrEqual:
+        type = ComparisonType::LessThanOrEqual;
+        break;
+      default:
+        break;
+    }
+  }
+  if (column == nullptr || constant == nullptr || column->GetColIdx() != index_info_->index_->GetKeyAttrs()[0]) {
+    return;
+  }
+  // 边界都按闭区间给出, 开区间的端点由谓词过滤
+  Value value = constant->Evaluate(nullptr, nullptr);
+  if (type == ComparisonType::Equal || type == ComparisonType::GreaterThan ||
+      type == ComparisonType::GreaterThanOrEqual) {
+    *low = std::make_unique<Value>(value);
+  }
+  if (type == ComparisonType::Equal || type == ComparisonType::LessThan || type == ComparisonType::LessThanOrEqual) {
+    *high = std::make_unique<Value>(value);
+  }
+}
+
+template <size_t KeySize>
+auto IndexScanExecutor::ScanBPlusTree(Index *index, const Value *low, const Value *high) -> bool {
+  using TreeIndex = BPlusTreeIndex<GenericKey<KeySize>, RID, GenericComparator<KeySize>>;
+  using Iterator = IndexIterator<GenericKey<KeySize>, RID, GenericComparator<KeySize>>;
+  auto *tree_index = dynamic_cast<TreeIndex *>(index);
+  if (tree_index == nullptr) {
+    return false;
+  }
+  // 迭代器只pin住当前叶子, 不持有latch, 可以跨Next调用保留
+  auto iterator = std::make_shared<Iterator>(tree_index->GetLeadingColumnIterator(low, high, plan_->IsDescending()));
+  bool index_only = index_only_;
+  next_entry_ = [tree_index, iterator, index_only](RID *rid, std::vector<Value> *values) {
+    if (iterator->IsEnd()) {
+      return false;
+    }
+    *rid = (**iterator).second;
+    if (index_only) {
+      tree_index->GetEntryValues((**iterator).first, values);
+    }
+    ++(*iterator);
+    return true;
+  };
+  return true;
+}
+
+void IndexScanExecutor::Init() {
+  auto *catalog = exec_ctx_->GetCatalog();
+  index_info_ = catalog->GetIndex(plan_->GetIndexOid());
+  table_info_ = catalog->GetTable(index_info_->table_name_);
+  next_entry_ = nullptr;
+
+  // 只有索引覆盖谓词和输出用到的全部列时才跳过表
+  index_only_ = false;
+  if (plan_->IsIndexOnly()) {
+    std::vector<uint32_t> columns;
+    CollectColumns(plan_->GetPredicate(), &columns);
+    for (const auto &col : plan_->OutputSchema()->GetColumns()) {
+      CollectColumns(col.GetExpr(), &columns);
+    }
+    index_only_ = index_info_->index_->Covers(columns);
+  }
+
+  std::unique_ptr<Value> low;
+  std::unique_ptr<Value> high;
+  DeriveBounds(&low, &high);
+  Index *index = index_info_->index_.get();
+  if (!ScanBPlusTree<4>(index, low.get(), high.get()) && !ScanBPlusTree<8>(index, low.get(), high.get()) &&
+      !ScanBPlusTree<16>(index, low.get(), high.get()) && !ScanBPlusTree<32>(index, low.get(), high.get()) &&
+      !ScanBPlusTree<64>(index, low.get(), high.get())) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "index scan needs a B+ tree index");
+  }
+}
+
+auto IndexScanExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  auto predicate = plan_->GetPredicate();
+  auto output_schema = plan_->OutputSchema();
+  const Schema *table_schema = &table_info_->schema_;
+  const auto &index_attrs = index_info_->index_->GetKeyAttrs();
+  auto transaction = exec_ctx_->GetTransaction();
+  auto lockmanager = exec_ctx_->GetLockManager();
 
-void IndexScanExecutor::Init() {}
+  RID current;
+  std::vector<Value> entry;
+  while (next_entry_(&current, &entry)) {
+    // 可重复读：读到的元组都加上读锁，事务提交后再解锁
+    if (transaction->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ && !transaction->IsSharedLocked(current) &&
+        !transaction->IsExclusiveLocked(current)) {
+      lockmanager->LockShared(transaction, current);
+    }
+    Tuple table_tuple;
+    bool found = true;
+    if (index_only_) {
+      // 按表模式拼出元组, 索引里没有的列填 NULL
+      std::vector<Value> values;
+      values.reserve(table_schema->GetColumnCount());
+      for (const auto &col : table_schema->GetColumns()) {
+        values.push_back(ValueFactory::GetNullValueByType(col.GetType()));
+      }
+      for (size_t i = 0; i < index_attrs.size(); i++) {
+        values[index_attrs[i]] = entry[i];
+      }
+      table_tuple = Tuple(values, table_schema);
+    } else {
+      // 读已提交：读元组时加上读锁，读完后立即释放
+      bool lock = transaction->GetIsolationLevel() == IsolationLevel::READ_COMMITTED &&
+                  !transaction->IsSharedLocked(current) && !transaction->IsExclusiveLocked(current);
+      if (lock) {
+        lockmanager->LockShared(transaction, current);
+      }
+      found = table_info_->table_->GetTuple(current, &table_tuple, transaction);
+      if (lock) {
+        lockmanager->Unlock(transaction, current);
+      }
+    }
 
-auto IndexScanExecutor::Next(Tuple *tuple, RID *rid) -> bool { return false; }
+    if (!found || (predicate != nullptr && !predicate->Evaluate(&table_tuple, table_schema).GetAs<bool>())) {
+      continue;
+    }
+    std::vector<Value> output_values;
+    output_values.reserve(output_schema->GetColumnCount());
+    for (const auto &col : output_schema->GetColumns()) {
+      output_values.push_back(col.GetExpr()->Evaluate(&table_tuple, table_schema));
+    }
+    *tuple = Tuple(output_values, output_schema);
+    *rid = current;
+    return true;
+  }
+  return false;
+}
 
 }  // namespace bustub
@@ -21,6 +21,7 @@
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/schema.h"
 #include "container/hash/hash_function.h"
+#include "storage/index/b_plus_tree_index.h"
 #include "storage/index/extendible_hash_table_index.h"
 #include "storage/index/index.h"
 #include "storage/table/table_heap.h"
@@ -57,6 +58,9 @@ struct TableInfo {
   const table_oid_t oid_;
 };
 
+/** The structure an index is built on. */
+enum class IndexType { ExtendibleHash, BPlusTree };
+
 /**
  * The IndexInfo class maintains metadata about a index.
  */
@@ -185,12 +189,16 @@ class Catalog {
    * @param key_attrs Key attributes
    * @param keysize Size of the key
    * @param hash_function The hash function for the index
+   * @param index_type The structure of the index
+   * @param include_attrs Table columns stored in the index entries for index-only scans, B+ tree indexes only; the
+   * IndexInfo key schema of such a covering index lists the key columns, then the included ones
    * @return A (non-owning) pointer to the metadata of the new table
    */
   template <class KeyType, class ValueType, class KeyComparator>
   auto CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name, const Schema &schema,
                    const Schema &key_schema, const std::vector<uint32_t> &key_attrs, std::size_t keysize,
-                   HashFunction<KeyType> hash_function) -> IndexInfo * {
+                   const HashFunction<KeyType> &hash_function, IndexType index_type = IndexType::ExtendibleHash,
+                   const std::vector<uint32_t> &include_attrs = {}) -> IndexInfo * {
     // Reject the creation request for nonexistent table
     // 不存在要创建的index的table_name
     if (table_names_.find(table_name) == table_names_.end()) {
@@ -208,28 +216,47 @@ class Catalog {
     }
 
     // Construct index metdata
-    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs);
+    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs, include_attrs);
 
     // Construct the index, take ownership of metadata
-    // TODO(Kyle): We should update the API for CreateIndex
-    // to allow specification of the index type itself, not
-    // just the key, value, and comparator types
-    auto index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
-                                                                                               hash_function);
-
-    // Populate the index with all tuples in table heap
+    // 包含列存放在B+树叶子条目中, 哈希索引放不下
+    if (index_type != IndexType::BPlusTree && !include_attrs.empty()) {
+      throw Exception(ExceptionType::NOT_IMPLEMENTED, "only B+ tree indexes can include columns");
+    }
     auto *table_meta = GetTable(table_name);
     auto *heap = table_meta->table_.get();
-    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
-      index->InsertEntry(tuple->KeyFromTuple(schema, key_schema, key_attrs), tuple->GetRid(), txn);
+    std::unique_ptr<Index> index;
+    if (index_type == IndexType::ExtendibleHash) {
+      index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
+                                                                                             hash_function);
+    } else {
+      // 截断的长key要回表核对
+      index = std::make_unique<BPlusTreeIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_, heap,
+                                                                                  &table_meta->schema_);
     }
+    const Schema &entry_schema = include_attrs.empty() ? key_schema : *index->GetKeySchema();
+
+    // Populate the index with all tuples in table heap
+    // 整张表一次交给索引, 哈希索引直接按hash前缀建好所有bucket, B+树索引排序后自底向上建
+    auto tuple = heap->Begin(txn);
+    index->InsertEntries(
+        [&](Tuple *key, RID *rid) {
+          if (tuple == heap->End()) {
+            return false;
+          }
+          *key = tuple->KeyFromTuple(schema, entry_schema, index->GetKeyAttrs());
+          *rid = tuple->GetRid();
+          ++tuple;
+          return true;
+        },
+        txn);
 
     // Get the next OID for the new index
     const auto index_oid = next_index_oid_.fetch_add(1);
 
     // Construct index information; IndexInfo takes ownership of the Index itself
     auto index_info =
-        std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name, keysize);
+        std::make_unique<IndexInfo>(entry_schema, index_name, std::move(index), index_oid, table_name, keysize);
     auto *tmp = index_info.get();
 
     // Update internal tracking
@@ -13,10 +13,18 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define BUSTUB_HAS_CRC32_INSTRUCTION
+#endif
+
 #include "common/macros.h"
 #include "type/value.h"
 
@@ -49,6 +57,68 @@ class HashUtil {
     return (l % PRIME_FACTOR + r % PRIME_FACTOR) % PRIME_FACTOR;
   }
 
+  /**
+   * CRC32C (Castagnoli) of the bytes. Uses the SSE4.2 crc32 instruction when the CPU has it,
+   * and a table-driven software loop otherwise; both give the same result.
+   * @param crc the CRC of the preceding bytes, to continue a running checksum
+   */
+  static inline auto Crc32c(const char *bytes, size_t length, uint32_t crc = 0) -> uint32_t {
+#ifdef BUSTUB_HAS_CRC32_INSTRUCTION
+    if (HasCrc32Instruction()) {
+      return Crc32cHardware(bytes, length, crc);
+    }
+#endif
+    return Crc32cSoftware(bytes, length, crc);
+  }
+
+  /**
+   * CRC32C of count records of length bytes each, stored back to back starting at bytes.
+   * With the crc32 instruction, four records are hashed in an interleaved loop so that their
+   * independent CRC chains overlap in the pipeline instead of waiting on each other.
+   * @param[out] crcs crcs[i] receives the CRC32C of the i-th record
+   */
+  static inline void Crc32cBatch(const char *bytes, size_t length, size_t count, uint32_t *crcs) {
+#ifdef BUSTUB_HAS_CRC32_INSTRUCTION
+    if (HasCrc32Instruction()) {
+      Crc32cHardwareBatch(bytes, length, count, crcs);
+      return;
+    }
+#endif
+    for (size_t i = 0; i < count; i++) {
+      crcs[i] = Crc32cSoftware(bytes + i * length, length, 0);
+    }
+  }
+
+  /** @return 64-bit hash of the bytes in the style of wyhash: 16 bytes per step, folded by 64x64->128 multiplies */
+  static inline auto WyHash(const char *bytes, size_t length, uint64_t seed = 0) -> uint64_t {
+    auto p = reinterpret_cast<const unsigned char *>(bytes);
+    seed ^= WyMix(seed ^ WYHASH_SECRET[0], WYHASH_SECRET[1]);
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if (length <= 16) {
+      if (length >= 4) {
+        // 4..16字节: 首尾各读两个可能重叠的4字节
+        size_t step = (length >> 3) << 2;
+        a = (Read32(p) << 32) | Read32(p + step);
+        b = (Read32(p + length - 4) << 32) | Read32(p + length - 4 - step);
+      } else if (length > 0) {
+        a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[length >> 1]) << 8) | p[length - 1];
+      }
+    } else {
+      size_t remain = length;
+      for (; remain > 16; remain -= 16, p += 16) {
+        seed = WyMix(Read64(p) ^ WYHASH_SECRET[1], Read64(p + 8) ^ seed);
+      }
+      // 最后16字节, 可能和已经处理过的部分重叠
+      a = Read64(p + remain - 16);
+      b = Read64(p + remain - 8);
+    }
+    __uint128_t product = static_cast<__uint128_t>(a ^ WYHASH_SECRET[1]) * (b ^ seed);
+    a = static_cast<uint64_t>(product);
+    b = static_cast<uint64_t>(product >> 64);
+    return WyMix(a ^ WYHASH_SECRET[0] ^ length, b ^ WYHASH_SECRET[1]);
+  }
+
   template <typename T>
   static inline auto Hash(const T *ptr) -> hash_t {
     return HashBytes(reinterpret_cast<const char *>(ptr), sizeof(T));
@@ -100,6 +170,107 @@ class HashUtil {
       }
     }
   }
+
+ private:
+  static constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78;
+  static constexpr uint64_t WYHASH_SECRET[3] = {0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6dbULL};
+
+  static inline auto Read32(const unsigned char *p) -> uint64_t {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static inline auto Read64(const unsigned char *p) -> uint64_t {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static inline auto WyMix(uint64_t a, uint64_t b) -> uint64_t {
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+  }
+
+  static inline auto Crc32cSoftware(const char *bytes, size_t length, uint32_t crc) -> uint32_t {
+    static const std::array<uint32_t, 256> TABLE = [] {
+      std::array<uint32_t, 256> table{};
+      for (uint32_t i = 0; i < 256; i++) {
+        uint32_t entry = i;
+        for (int bit = 0; bit < 8; bit++) {
+          entry = (entry >> 1) ^ ((entry & 1) != 0 ? CRC32C_POLYNOMIAL : 0);
+        }
+        table[i] = entry;
+      }
+      return table;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+      crc = (crc >> 8) ^ TABLE[(crc ^ static_cast<unsigned char>(bytes[i])) & 0xFF];
+    }
+    return ~crc;
+  }
+
+#ifdef BUSTUB_HAS_CRC32_INSTRUCTION
+  static inline auto HasCrc32Instruction() -> bool {
+    static const bool SUPPORTED = __builtin_cpu_supports("sse4.2");
+    return SUPPORTED;
+  }
+
+  __attribute__((target("sse4.2"))) static inline auto Crc32cHardwareStep(uint64_t crc, const unsigned char *p,
+                                                                          size_t length) -> uint64_t {
+    for (; length >= 8; p += 8, length -= 8) {
+      crc = _mm_crc32_u64(crc, Read64(p));
+    }
+    auto c = static_cast<uint32_t>(crc);
+    if ((length & 4) != 0) {
+      c = _mm_crc32_u32(c, static_cast<uint32_t>(Read32(p)));
+      p += 4;
+    }
+    if ((length & 2) != 0) {
+      uint16_t v;
+      memcpy(&v, p, sizeof(v));
+      c = _mm_crc32_u16(c, v);
+      p += 2;
+    }
+    if ((length & 1) != 0) {
+      c = _mm_crc32_u8(c, *p);
+    }
+    return c;
+  }
+
+  __attribute__((target("sse4.2"))) static inline auto Crc32cHardware(const char *bytes, size_t length, uint32_t crc)
+      -> uint32_t {
+    return ~static_cast<uint32_t>(Crc32cHardwareStep(~crc, reinterpret_cast<const unsigned char *>(bytes), length));
+  }
+
+  __attribute__((target("sse4.2"))) static inline void Crc32cHardwareBatch(const char *bytes, size_t length,
+                                                                           size_t count, uint32_t *crcs) {
+    auto p = reinterpret_cast<const unsigned char *>(bytes);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4, p += 4 * length) {
+      // crc32指令延迟3个周期但每周期能发射一条, 四条互不依赖的链交错执行
+      uint64_t c0 = 0xFFFFFFFF;
+      uint64_t c1 = 0xFFFFFFFF;
+      uint64_t c2 = 0xFFFFFFFF;
+      uint64_t c3 = 0xFFFFFFFF;
+      size_t offset = 0;
+      for (; offset + 8 <= length; offset += 8) {
+        c0 = _mm_crc32_u64(c0, Read64(p + offset));
+        c1 = _mm_crc32_u64(c1, Read64(p + length + offset));
+        c2 = _mm_crc32_u64(c2, Read64(p + 2 * length + offset));
+        c3 = _mm_crc32_u64(c3, Read64(p + 3 * length + offset));
+      }
+      crcs[i] = ~static_cast<uint32_t>(Crc32cHardwareStep(c0, p + offset, length - offset));
+      crcs[i + 1] = ~static_cast<uint32_t>(Crc32cHardwareStep(c1, p + length + offset, length - offset));
+      crcs[i + 2] = ~static_cast<uint32_t>(Crc32cHardwareStep(c2, p + 2 * length + offset, length - offset));
+      crcs[i + 3] = ~static_cast<uint32_t>(Crc32cHardwareStep(c3, p + 3 * length + offset, length - offset));
+    }
+    for (; i < count; i++, p += length) {
+      crcs[i] = Crc32cHardware(reinterpret_cast<const char *>(p), length, 0);
+    }
+  }
+#endif
 };
 
 }  // namespace bustub
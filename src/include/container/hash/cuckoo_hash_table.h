@@ -0,0 +1,176 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// cuckoo_hash_table.h
+//
+// Identification: src/include/container/hash/cuckoo_hash_table.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction.h"
+#include "container/hash/hash_function.h"
+#include "container/hash/hash_table.h"
+#include "storage/page/hash_table_bucket_page.h"
+#include "storage/page/hash_table_header_page.h"
+#include "storage/page/hash_table_page_defs.h"
+
+namespace bustub {
+
+#define CUCKOO_HASH_TABLE_TYPE CuckooHashTable<KeyType, ValueType, KeyComparator>
+
+/** Number of entries an insert may displace before the table grows. */
+#define CUCKOO_MAX_KICKS 64
+
+/**
+ * Implementation of bucketized cuckoo hashing that is backed by a buffer pool
+ * manager. Non-unique keys are supported. Supports insert and delete. The
+ * table dynamically grows once an insert cannot find room.
+ *
+ * Every key has two candidate buckets, picked by the low and the high half of
+ * its 64-bit hash, and an entry always lives in one of them. A lookup or a
+ * remove therefore reads at most two bucket pages however full the table is
+ * and however the keys cluster. An insert goes to the emptier candidate; if
+ * both are full it moves a resident entry of one of them to that entry's
+ * other candidate, and so on for at most CUCKOO_MAX_KICKS moves, before the
+ * table is rebuilt with twice the buckets.
+ *
+ * Buckets are HashTableBucketPages, so probing a bucket compares one-byte key
+ * fingerprints first. Their page ids are listed on a chain of
+ * HashTableHeaderPages, HEADER_ARRAY_SIZE per page, so the table keeps
+ * doubling however many entries it holds. Only when both buckets of a key are
+ * full of that one key does the entry go to a chain of overflow pages hanging
+ * off its first bucket; only probes of buckets with such a chain read more
+ * than two pages.
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+class CuckooHashTable : public HashTable<KeyType, ValueType, KeyComparator> {
+ public:
+  /**
+   * Creates a new CuckooHashTable
+   *
+   * @param buffer_pool_manager buffer pool manager to be used
+   * @param comparator comparator for keys
+   * @param num_buckets initial number of buckets contained by this hash table
+   * @param hash_fn the hash function
+   */
+  explicit CuckooHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
+                           const KeyComparator &comparator, size_t num_buckets, HashFunction<KeyType> hash_fn);
+
+  /**
+   * Inserts a key-value pair into the hash table.
+   * @param transaction the current transaction
+   * @param key the key to create
+   * @param value the value to be associated with the key
+   * @return true if insert succeeded, false otherwise
+   */
+  auto Insert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool override;
+
+  /**
+   * Deletes the associated value for the given key.
+   * @param transaction the current transaction
+   * @param key the key to delete
+   * @param value the value to delete
+   * @return true if remove succeeded, false otherwise
+   */
+  auto Remove(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool override;
+
+  /**
+   * Performs a point query on the hash table.
+   * @param transaction the current transaction
+   * @param key the key to look up
+   * @param[out] result the value(s) associated with a given key
+   * @return the value(s) associated with the given key
+   */
+  auto GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool override;
+
+  /**
+   * Resizes the table to at least twice the initial size provided.
+   * @param initial_size the initial size of the hash table
+   */
+  void Resize(size_t initial_size);
+
+  /**
+   * Gets the size of the hash table
+   * @return current number of buckets of the hash table
+   */
+  auto GetSize() -> size_t;
+
+ private:
+  auto Hash(const KeyType &key) -> uint64_t;
+
+  /** @return the two candidate buckets of a hash in a table of num_buckets buckets, always different */
+  auto CandidateBuckets(uint64_t hash, size_t num_buckets) -> std::pair<size_t, size_t>;
+
+  auto FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BUCKET_TYPE *;
+
+  auto NewBucketPage(page_id_t *bucket_page_id) -> HASH_TABLE_BUCKET_TYPE *;
+
+  auto FetchHeaderPage(page_id_t header_page_id) -> HashTableHeaderPage *;
+
+  auto NewHeaderPage(page_id_t *header_page_id) -> HashTableHeaderPage *;
+
+  /** Appends the values of key in the bucket and its overflow chain to result. */
+  void CollectValues(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, std::vector<ValueType> *result);
+
+  /** Inserts an entry into the first overflow page of the bucket with room, appending a page if all are full. */
+  void InsertOverflow(page_id_t bucket_page_id, const MappingType &entry);
+
+  /**
+   * Removes a pair from the bucket's overflow chain, unlinking and deleting
+   * the overflow page if it becomes empty. The bucket must be write latched.
+   *
+   * @return true if the pair was found on the chain
+   */
+  auto RemoveOverflow(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, const ValueType &value) -> bool;
+
+  /**
+   * Inserts an entry into the table made of buckets, displacing resident
+   * entries along a path of at most CUCKOO_MAX_KICKS moves when both of its
+   * candidates are full. If no path frees a slot the moves are undone. The
+   * table write latch must be held.
+   *
+   * @return true if the entry was inserted, false if the buckets are left as they were
+   */
+  auto InsertDisplacing(const std::vector<page_id_t> &buckets, const MappingType &entry) -> bool;
+
+  /** Inserts an entry with InsertDisplacing, or onto the overflow chain of its first bucket if that fails. */
+  void Place(const std::vector<page_id_t> &buckets, const MappingType &entry);
+
+  /**
+   * Moves every entry, and extra if given, into num_buckets new buckets, then
+   * frees the old bucket and overflow pages.
+   * The table write latch must be held.
+   */
+  void Rehash(size_t num_buckets, const MappingType *extra);
+
+  /** Writes the bucket page ids to the header pages, appending pages to the chain when it is too short. */
+  void WriteHeader();
+
+  // member variable
+  page_id_t header_page_id_;
+  // bucket的page_id在内存中的缓存, 只在持有table写锁时修改
+  std::vector<page_id_t> bucket_page_ids_;
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+
+  // Readers includes inserts that find room and removes, writers are inserts that displace entries and resize
+  ReaderWriterLatch table_latch_;
+
+  // Hash function
+  HashFunction<KeyType> hash_fn_;
+
+  // 挑选被换出的槽位用的伪随机数, 只在持有table写锁时修改
+  uint32_t kick_seed_{0};
+};
+
+}  // namespace bustub
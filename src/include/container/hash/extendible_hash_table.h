@@ -11,8 +11,16 @@
 //===----------------------------------------------------------------------===//
 
 #pragma once
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
+#include <thread>  // NOLINT
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction.h"
@@ -24,10 +32,47 @@ namespace bustub {
 
 #define HASH_TABLE_TYPE ExtendibleHashTable<KeyType, ValueType, KeyComparator>
 
+/** Upper bound on the global depth, i.e. the directory holds at most 2^MAX_GLOBAL_DEPTH entries. */
+#define MAX_GLOBAL_DEPTH 24
+
+/** A remove that leaves a bucket with fewer entries than this queues it for the background merge. */
+#define MERGE_CANDIDATE_SIZE (BUCKET_ARRAY_SIZE / 4)
+
+/** The background merge joins two split images only if they hold at most this many entries together. */
+#define MERGE_MAX_SIZE (BUCKET_ARRAY_SIZE / 2)
+
 /**
  * Implementation of extendible hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table grows/shrinks dynamically as buckets become full/empty.
+ *
+ * Up to global depth MAX_BUCKET_DEPTH the directory fits in one page. Beyond
+ * that it is split into segments of DIRECTORY_ARRAY_SIZE entries chained from
+ * the first directory page; the segment page ids and the global depth are
+ * cached in memory, so a lookup only touches the one segment holding its entry.
+ * Doubling a multi-segment directory copies nothing: each new segment reads
+ * through to the segment it mirrors in the lower half until the first split
+ * or merge that rewrites it copies it out, so growth never stalls the table
+ * for a full directory copy.
+ *
+ * Splits that do not double the directory run under the shared table latch
+ * and only latch the bucket being split and the directory segments they
+ * rewrite, so lookups in other buckets proceed while a bucket splits.
+ *
+ * A full bucket whose keys all share the hash of the incoming key cannot be
+ * separated by a split; such runs of duplicate keys spill into a chain of
+ * overflow pages hanging off the bucket. Every entry on a chain has the same
+ * hash, and a split keeps the chained bucket on that hash's side.
+ *
+ * Remove merges a bucket into its split image as soon as it becomes empty.
+ * Buckets that deletes only thin out are merged by Compact instead, off the
+ * remove path: a remove that leaves a bucket below MERGE_CANDIDATE_SIZE
+ * entries queues it, once however many removes follow, and Compact merges a
+ * queued bucket with its image while the two fit in MERGE_MAX_SIZE entries,
+ * halving the directory when it can.
+ * The gap between the thresholds and a full bucket is the hysteresis: a
+ * merged bucket takes half a bucket of inserts to split again, and a split
+ * one a quarter of a bucket of removes to be queued again.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTable {
@@ -37,10 +82,12 @@ class ExtendibleHashTable {
    *
    * @param buffer_pool_manager buffer pool manager to be used
    * @param comparator comparator for keys
-   * @param hash_fn the hash function
+   * @param hash_fn the hash function, the table keeps a clone of it
    */
   explicit ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn);
+                               const KeyComparator &comparator, const HashFunction<KeyType> &hash_fn);
+
+  ~ExtendibleHashTable();
 
   /**
    * Inserts a key-value pair into the hash table.
@@ -52,6 +99,24 @@ class ExtendibleHashTable {
    */
   auto Insert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool;
 
+  /**
+   * Fills an empty hash table from a stream of distinct key-value pairs. Each
+   * key is hashed once, in batches through GetHashes, and the pairs are sorted
+   * by bit-reversed hash with an ExternalSorter, whose runs
+   * are bounded by the buffer pool size and spilled to temporary pages, and
+   * are then cut into buckets by hash prefix while looking at most one bucket
+   * ahead. Each bucket page is written once, instead of splitting buckets and
+   * doubling the directory while the pairs arrive one at a time. The whole
+   * load holds the table write latch.
+   *
+   * @param transaction the current transaction
+   * @param next hands out one pair per call, returns false at the end of the input
+   * @return false if the table was not empty, in which case next is not called
+   * @throws Exception OUT_OF_RANGE after the load if a full bucket at MAX_GLOBAL_DEPTH could not take some pairs,
+   * where Insert would have returned false; the table then holds every other pair
+   */
+  auto BulkLoad(Transaction *transaction, const std::function<bool(MappingType *)> &next) -> bool;
+
   /**
    * Deletes the associated value for the given key.
    *
@@ -72,6 +137,55 @@ class ExtendibleHashTable {
    */
   auto GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool;
 
+  /**
+   * Streams the values associated with a key, one bucket or overflow page at a
+   * time, without collecting them first. The bucket stays read latched during
+   * the scan, so fn must not call back into the hash table.
+   *
+   * @param transaction the current transaction
+   * @param key the key to look up
+   * @param fn called with each value, returns false to stop the scan
+   * @return true if the scan ran to the end, false if fn stopped it
+   */
+  auto ScanValues(Transaction *transaction, const KeyType &key, const std::function<bool(const ValueType &)> &fn)
+      -> bool;
+
+  /**
+   * Performs point queries for a batch of keys. The keys are hashed together
+   * and their bucket page ids resolved with one read of each directory
+   * segment. Keys that map to the same bucket are answered from a single
+   * fetch of that bucket. The distinct buckets are fetched a window at a
+   * time, bounded by a fraction of the buffer pool, before any of them is
+   * scanned, so their disk reads are not interleaved with probing; each
+   * window is then probed in bucket order. A window shrinks to the frames
+   * that are free; if not even one page can be fetched the lookup throws
+   * OUT_OF_MEMORY with the table latch released.
+   *
+   * @param transaction the current transaction
+   * @param keys the keys to look up
+   * @param[out] results results[i] receives the value(s) associated with keys[i]
+   * @return the number of keys that were found
+   */
+  auto GetValues(Transaction *transaction, const std::vector<KeyType> &keys,
+                 std::vector<std::vector<ValueType>> *results) -> int;
+
+  /**
+   * Merges the buckets queued by removes with their split images while the
+   * pair fits in MERGE_MAX_SIZE entries, and halves the directory while every
+   * local depth is below the global depth. The table write latch is taken for
+   * a few buckets at a time, so foreground operations interleave with a long
+   * pass.
+   *
+   * @return the number of bucket pages freed
+   */
+  auto Compact() -> int;
+
+  /** Runs Compact every compaction_interval on a background thread until StopCompaction wakes it. */
+  void StartCompaction();
+
+  /** Stops the background thread started by StartCompaction and waits for it. */
+  void StopCompaction();
+
   /**
    * Returns the global depth.  Do not touch.
    */
@@ -84,7 +198,7 @@ class ExtendibleHashTable {
 
  private:
   /**
-   * Hash - simple helper to downcast MurmurHash's 64-bit hash to 32-bit
+   * Hash - simple helper to downcast the hash function's 64-bit hash to 32-bit
    * for extendible hashing.
    *
    * @param key the key to hash
@@ -114,19 +228,23 @@ class ExtendibleHashTable {
    * representation.
    *
    * @param key the key to use for lookup
-   * @param dir_page to use for lookup of global depth
    * @return the directory index
    */
-  inline auto KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t;
+  inline auto KeyToDirectoryIndex(KeyType key) -> uint32_t;
 
   /**
-   * Get the bucket page_id corresponding to a key.
+   * Fetches and latches the bucket a key maps to. The directory entry is read
+   * again once the bucket is latched, and the lookup retried if a concurrent
+   * split moved the key to another bucket in between.
    *
    * @param key the key for lookup
-   * @param dir_page a pointer to the hash table's directory page
-   * @return the bucket page_id corresponding to the input key
+   * @param exclusive take the bucket's write latch instead of its read latch
+   * @param[out] bucket_page_id the page_id of the returned bucket
+   * @param[out] local_depth the local depth of the returned bucket
+   * @return the pinned and latched bucket page
    */
-  inline auto KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t;
+  auto LatchBucket(KeyType key, bool exclusive, page_id_t *bucket_page_id, uint32_t *local_depth)
+      -> HASH_TABLE_BUCKET_TYPE *;
 
   /**
    * Fetches the directory page from the buffer pool manager.
@@ -135,6 +253,96 @@ class ExtendibleHashTable {
    */
   auto FetchDirectoryPage() -> HashTableDirectoryPage *;
 
+  /**
+   * @param directory_idx a directory index
+   * @return the page_id of the directory segment holding directory_idx, or of the
+   * segment it still mirrors if it has not been copied out yet
+   */
+  inline auto SegmentPageId(uint32_t directory_idx) -> page_id_t;
+
+  /**
+   * Fetches the directory segment holding a directory index.
+   *
+   * @param directory_idx a directory index
+   * @return a pointer to the segment, index it with directory_idx % DIRECTORY_ARRAY_SIZE
+   */
+  auto FetchSegmentPage(uint32_t directory_idx) -> HashTableDirectoryPage *;
+
+  /**
+   * Reads one directory entry.
+   *
+   * @param directory_idx a directory index
+   * @return the bucket page_id and local depth stored at directory_idx
+   */
+  auto GetDirectoryEntry(uint32_t directory_idx) -> std::pair<page_id_t, uint32_t>;
+
+  /**
+   * Reads one directory entry unless the buffer pool has no frame for its segment.
+   *
+   * @param directory_idx a directory index
+   * @param[out] entry the bucket page_id and local depth stored at directory_idx
+   * @return false if the segment could not be fetched
+   */
+  auto TryGetDirectoryEntry(uint32_t directory_idx, std::pair<page_id_t, uint32_t> *entry) -> bool;
+
+  /**
+   * Visits the directory entries first, first + stride, ... below the directory
+   * size, fetching each segment once and holding its write latch while its
+   * entries are visited. Segments are marked dirty. Visited segments that are
+   * still mirrors are copied out first, which needs the table write latch.
+   *
+   * @param first the first directory index to visit
+   * @param stride distance between visited indexes
+   * @param fn called with the segment and the directory index of each entry
+   */
+  void ForEachEntry(uint32_t first, uint32_t stride, const std::function<void(HashTableDirectoryPage *, uint32_t)> &fn);
+
+  /**
+   * Lists the segments holding the entries first, first + stride, ... that are
+   * still mirrors of a segment in the lower half.
+   *
+   * @param first the first directory index
+   * @param stride distance between directory indexes
+   * @return the indexes of those segments in segment_page_ids_
+   */
+  auto PendingSegments(uint32_t first, uint32_t stride) -> std::vector<uint32_t>;
+
+  /**
+   * Copies a mirrored segment into its own page and links it into the segment
+   * chain. Must hold the table write latch.
+   *
+   * @param segment index of the segment in segment_page_ids_
+   */
+  void MaterializeSegment(uint32_t segment);
+
+  /**
+   * Doubles the directory. Must hold the table write latch.
+   */
+  void GrowDirectory();
+
+  /**
+   * Halves the directory. Must hold the table write latch and every local depth must be below the global depth.
+   */
+  void ShrinkDirectory();
+
+  /**
+   * @return true if every local depth is below the global depth
+   */
+  auto CanShrink() -> bool;
+
+  /**
+   * Splits a full bucket into itself and a new split image one bit deeper.
+   * The local depth must be below the global depth. Keys are moved before the
+   * directory points at the split image. Unlatches and unpins the bucket.
+   *
+   * @param directory_idx any directory index pointing at the bucket
+   * @param bucket_page_id the bucket's page_id
+   * @param local_depth the bucket's local depth
+   * @param bucket the pinned and write latched bucket page
+   */
+  void SplitBucket(uint32_t directory_idx, page_id_t bucket_page_id, uint32_t local_depth,
+                   HASH_TABLE_BUCKET_TYPE *bucket);
+
   /**
    * Fetches the a bucket page from the buffer pool manager using the bucket's page_id.
    *
@@ -143,6 +351,62 @@ class ExtendibleHashTable {
    */
   auto FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BUCKET_TYPE *;
 
+  /**
+   * Allocates and initializes a bucket page. The page is returned pinned.
+   *
+   * @param[out] bucket_page_id the page_id of the new bucket
+   * @return a pointer to the new bucket page
+   */
+  auto NewBucketPage(page_id_t *bucket_page_id) -> HASH_TABLE_BUCKET_TYPE *;
+
+  /**
+   * Calls fn on every value of the key in a bucket and its overflow chain,
+   * fetching one overflow page at a time. The bucket must be latched.
+   *
+   * @param bucket the latched bucket page
+   * @param key the key to look up
+   * @param fn called with each value, returns false to stop the scan
+   * @return true if the scan ran to the end, false if fn stopped it
+   */
+  auto ScanBucket(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, const std::function<bool(const ValueType &)> &fn)
+      -> bool;
+
+  /**
+   * Appends the values of the key in a bucket and its overflow chain to result.
+   *
+   * @return true if any value was found
+   */
+  auto CollectValues(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, std::vector<ValueType> *result) -> bool;
+
+  /**
+   * @return true if the key-value pair is stored in the bucket or its overflow chain
+   */
+  auto ContainsPair(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, const ValueType &value) -> bool;
+
+  /**
+   * Reads the hash shared by every entry on the bucket's overflow chain.
+   *
+   * @param bucket the latched bucket page
+   * @param[out] hash the hash of the chained keys
+   * @return false if the bucket has no overflow chain
+   */
+  auto GetOverflowHash(HASH_TABLE_BUCKET_TYPE *bucket, uint32_t *hash) -> bool;
+
+  /**
+   * Stores a pair in the first overflow page with a free slot, appending a new
+   * overflow page to the chain when every page is full. The bucket must be
+   * write latched and the key must share the hash of the chained keys.
+   */
+  void InsertOverflow(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, const ValueType &value);
+
+  /**
+   * Removes a pair from the bucket's overflow chain, unlinking and deleting
+   * the overflow page if it becomes empty. The bucket must be write latched.
+   *
+   * @return true if the pair was found on the chain
+   */
+  auto RemoveOverflow(HASH_TABLE_BUCKET_TYPE *bucket, const KeyType &key, const ValueType &value) -> bool;
+
   /**
    * Performs insertion with an optional bucket splitting.
    *
@@ -158,26 +422,56 @@ class ExtendibleHashTable {
    * if Remove makes a bucket empty.
    *
    * There are three conditions under which we skip the merge:
-   * 1. The bucket is no longer empty.
+   * 1. The bucket is no longer empty, or still has an overflow chain.
    * 2. The bucket has local depth 0.
    * 3. The bucket's local depth doesn't match its split image's local depth.
    *
+   * After a merge the merged bucket is checked against its own split image in
+   * the same way, and the directory is halved while every local depth is below
+   * the global depth.
+   *
    * @param transaction a pointer to the current transaction
    * @param key the key that was removed
    * @param value the value that was removed
    */
   void Merge(Transaction *transaction, const KeyType &key, const ValueType &value);
 
+  /**
+   * Merges the bucket holding hash with its split image, and the merged bucket
+   * with its own image in turn, as long as one of the pair is empty or the two
+   * have no overflow chain and hold at most max_size entries together. The
+   * table write latch must be held.
+   *
+   * @param hash the hash of a key in the bucket
+   * @param max_size the most entries a merge of two non-empty buckets may hold
+   * @param[out] shrinkable set if a bucket with local depth equal to the global depth was merged
+   * @return the number of bucket pages freed
+   */
+  auto MergeImages(uint32_t hash, uint32_t max_size, bool *shrinkable) -> int;
+
   bool ExtraMerge(Transaction *transaction, const KeyType &key, const ValueType &value);
 
   // member variables
   page_id_t directory_page_id_;
+  // 目录段的page_id和global depth在内存中的缓存, 只在持有table写锁时修改; 还没复制出来的段是INVALID_PAGE_ID
+  std::vector<page_id_t> segment_page_ids_;
+  uint32_t global_depth_{0};
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
 
-  // Readers includes inserts and removes, writers are splits and merges
+  // Readers include inserts, removes and splits that keep the directory size,
+  // writers double or shrink the directory and merge buckets
   ReaderWriterLatch table_latch_;
-  HashFunction<KeyType> hash_fn_;
+  std::unique_ptr<HashFunction<KeyType>> hash_fn_;
+
+  // remove把MERGE_CANDIDATE_SIZE以下的bucket的hash前缀放进来, 等Compact合并; 同一个bucket只放一次
+  std::mutex merge_latch_;
+  std::unordered_set<uint32_t> merge_candidates_;
+  // background compaction
+  std::atomic<bool> compaction_running_{false};
+  std::mutex compaction_latch_;
+  std::condition_variable compaction_cv_;
+  std::thread compaction_thread_;
 };
 
 }  // namespace bustub
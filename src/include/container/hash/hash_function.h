@@ -12,24 +12,143 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 
+#include "common/util/hash_util.h"
 #include "murmur3/MurmurHash3.h"
 
 namespace bustub {
 
+/** The hash algorithms a HashFunction can use. */
+enum class HashAlgorithm {
+  /** MurmurHash3 x64_128, the default */
+  MURMUR3,
+  /**
+   * CRC32C via the SSE4.2 crc32 instruction (table-driven fallback), widened to 64 bits by a multiplicative mix;
+   * Crc32cHashFunction adds an interleaved batch path
+   */
+  CRC32C,
+  /** a wyhash-style multiply-fold hash */
+  WYHASH
+};
+
 template <typename KeyType>
 class HashFunction {
  public:
+  HashFunction() = default;
+
+  /** @param algorithm the hash algorithm to use for every key */
+  explicit HashFunction(HashAlgorithm algorithm) : algorithm_(algorithm) {}
+
+  /** @return the hash algorithm in use */
+  auto GetAlgorithm() const -> HashAlgorithm { return algorithm_; }
+
   /**
    * @param key the key to be hashed
    * @return the hashed value
    */
-  virtual auto GetHash(KeyType key) -> uint64_t {
-    uint64_t hash[2];
-    murmur3::MurmurHash3_x64_128(reinterpret_cast<const void *>(&key), static_cast<int>(sizeof(KeyType)), 0,
-                                 reinterpret_cast<void *>(&hash));
-    return hash[0];
+  virtual auto GetHash(KeyType key) -> uint64_t { return HashKey(key); }
+
+  /**
+   * Hashes a batch of keys; hashes[i] equals GetHash(keys[i]). A subclass with
+   * a faster batch path overrides both, as Crc32cHashFunction does.
+   *
+   * @param keys the keys to be hashed
+   * @param count the number of keys
+   * @param[out] hashes receives the hashed values
+   */
+  virtual void GetHashes(const KeyType *keys, size_t count, uint64_t *hashes) {
+    // 每个key之间没有依赖, 乱序执行可以重叠相邻key的计算
+    for (size_t i = 0; i < count; i++) {
+      hashes[i] = GetHash(keys[i]);
+    }
+  }
+
+  /** @return a copy of this hash function of the same dynamic type, tables keep one so subclasses are not sliced */
+  virtual auto Clone() const -> std::unique_ptr<HashFunction> { return std::make_unique<HashFunction>(*this); }
+
+  virtual ~HashFunction() = default;
+
+ protected:
+  /** Spreads a 32-bit CRC over 64 bits; the low bits of the result depend on every bit of the CRC. */
+  static auto MixCrc(uint32_t crc) -> uint64_t {
+    uint64_t hash = crc * 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 32);
+  }
+
+ private:
+  auto HashKey(const KeyType &key) const -> uint64_t {
+    auto bytes = reinterpret_cast<const char *>(&key);
+    switch (algorithm_) {
+      case HashAlgorithm::CRC32C:
+        return MixCrc(HashUtil::Crc32c(bytes, sizeof(KeyType)));
+      case HashAlgorithm::WYHASH:
+        return HashUtil::WyHash(bytes, sizeof(KeyType));
+      case HashAlgorithm::MURMUR3:
+      default: {
+        uint64_t hash[2];
+        murmur3::MurmurHash3_x64_128(reinterpret_cast<const void *>(bytes), static_cast<int>(sizeof(KeyType)), 0,
+                                     reinterpret_cast<void *>(&hash));
+        return hash[0];
+      }
+    }
+  }
+
+  HashAlgorithm algorithm_{HashAlgorithm::MURMUR3};
+};
+
+/**
+ * CRC32C hashing with an interleaved batch path: GetHashes runs several
+ * independent crc32 chains at once instead of one key after another. GetHash
+ * is final so every subclass hashes a batch exactly like single keys.
+ */
+template <typename KeyType>
+class Crc32cHashFunction : public HashFunction<KeyType> {
+ public:
+  Crc32cHashFunction() : HashFunction<KeyType>(HashAlgorithm::CRC32C) {}
+
+  auto GetHash(KeyType key) -> uint64_t final { return HashFunction<KeyType>::GetHash(key); }
+
+  void GetHashes(const KeyType *keys, size_t count, uint64_t *hashes) override {
+    uint32_t crcs[BATCH_SIZE];
+    for (size_t begin = 0; begin < count; begin += BATCH_SIZE) {
+      size_t n = std::min(BATCH_SIZE, count - begin);
+      HashUtil::Crc32cBatch(reinterpret_cast<const char *>(keys + begin), sizeof(KeyType), n, crcs);
+      for (size_t i = 0; i < n; i++) {
+        hashes[begin + i] = HashFunction<KeyType>::MixCrc(crcs[i]);
+      }
+    }
+  }
+
+  auto Clone() const -> std::unique_ptr<HashFunction<KeyType>> override {
+    return std::make_unique<Crc32cHashFunction>(*this);
+  }
+
+ private:
+  static constexpr size_t BATCH_SIZE = 64;
+};
+
+/**
+ * Orders bit-reversed hashes. Keys whose hashes share their low bits, i.e.
+ * that fall under one extendible hash directory prefix, sort next to each
+ * other, so an ExternalSorter keyed by ReverseBits of each hash hands the
+ * input of ExtendibleHashTable::BulkLoad out bucket by bucket. The hashes are
+ * computed once per key before sorting, not on every comparison.
+ */
+class HashOrderComparator {
+ public:
+  auto operator()(uint32_t lhs, uint32_t rhs) const -> int { return lhs < rhs ? -1 : static_cast<int>(lhs > rhs); }
+
+  /** @return bits in reverse order, bit 0 becomes bit 31 */
+  static auto ReverseBits(uint32_t bits) -> uint32_t {
+    bits = ((bits >> 1) & 0x55555555U) | ((bits & 0x55555555U) << 1);
+    bits = ((bits >> 2) & 0x33333333U) | ((bits & 0x33333333U) << 2);
+    bits = ((bits >> 4) & 0x0F0F0F0FU) | ((bits & 0x0F0F0F0FU) << 4);
+    bits = ((bits >> 8) & 0x00FF00FFU) | ((bits & 0x00FF00FFU) << 8);
+    return (bits >> 16) | (bits << 16);
   }
 };
 
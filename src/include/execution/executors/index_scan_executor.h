@@ -12,10 +12,13 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include "common/rid.h"
 #include "execution/executor_context.h"
+#include "execution/expressions/abstract_expression.h"
 #include "execution/executors/abstract_executor.h"
 #include "execution/plans/index_scan_plan.h"
 #include "storage/table/tuple.h"
@@ -23,7 +26,13 @@
 namespace bustub {
 
 /**
- * IndexScanExecutor executes an index scan over a table.
+ * IndexScanExecutor executes an index scan over a table, in index key order
+ * or descending with a descending plan. The index has to be a B+ tree index.
+ * A predicate that compares the leading key column with a constant bounds the
+ * range of the tree that is walked. Entries are pulled from the tree one at a
+ * time as Next is called. With an index-only plan whose columns the index
+ * covers, tuples are built from the index entries and the table heap is never
+ * read.
  */
 
 class IndexScanExecutor : public AbstractExecutor {
@@ -42,7 +51,24 @@ class IndexScanExecutor : public AbstractExecutor {
   auto Next(Tuple *tuple, RID *rid) -> bool override;
 
  private:
+  // open the scan over [low, high] of the leading key column if index is a B+ tree index over GenericKey<KeySize>
+  template <size_t KeySize>
+  auto ScanBPlusTree(Index *index, const Value *low, const Value *high) -> bool;
+
+  // bounds on the leading key column implied by the predicate, nullptr where it implies none
+  void DeriveBounds(std::unique_ptr<Value> *low, std::unique_ptr<Value> *high) const;
+
+  // table columns that expr reads
+  static void CollectColumns(const AbstractExpression *expr, std::vector<uint32_t> *columns);
+
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
+
+  IndexInfo *index_info_;
+  TableInfo *table_info_;
+
+  bool index_only_;  // 计划要求且索引覆盖所有用到的列
+  // 取出下一个entry的rid, index-only时还有它的索引列值; 扫描结束时返回false
+  std::function<bool(RID *, std::vector<Value> *)> next_entry_;
 };
 }  // namespace bustub
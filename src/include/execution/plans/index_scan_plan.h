@@ -28,9 +28,17 @@ class IndexScanPlanNode : public AbstractPlanNode {
    * @param predicate the predicate to scan with, tuples are returned if predicate(tuple) == true or predicate ==
    * nullptr
    * @param table_oid the identifier of table to be scanned
+   * @param index_only answer from the index entries without reading the table, the index must cover every column
+   * the predicate and the output refer to
+   * @param descending return tuples in descending index key order
    */
-  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid)
-      : AbstractPlanNode(output, {}), predicate_{predicate}, index_oid_(index_oid) {}
+  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid,
+                    bool index_only = false, bool descending = false)
+      : AbstractPlanNode(output, {}),
+        predicate_{predicate},
+        index_oid_(index_oid),
+        index_only_(index_only),
+        descending_(descending) {}
 
   auto GetType() const -> PlanType override { return PlanType::IndexScan; }
 
@@ -40,11 +48,21 @@ class IndexScanPlanNode : public AbstractPlanNode {
   /** @return the identifier of the table that should be scanned */
   auto GetIndexOid() const -> index_oid_t { return index_oid_; }
 
+  /** @return true if the scan is answered from the index entries alone */
+  auto IsIndexOnly() const -> bool { return index_only_; }
+
+  /** @return true if tuples come back in descending index key order */
+  auto IsDescending() const -> bool { return descending_; }
+
  private:
   /** The predicate that all returned tuples must satisfy. */
   const AbstractExpression *predicate_;
   /** The table whose tuples should be scanned. */
   index_oid_t index_oid_;
+  /** Whether the table heap is skipped. */
+  bool index_only_;
+  /** Whether the index is scanned towards smaller keys. */
+  bool descending_;
 };
 
 }  // namespace bustub
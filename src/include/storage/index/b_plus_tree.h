@@ -10,14 +10,24 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <map>
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
+#include "common/rwlatch.h"
 #include "concurrency/transaction.h"
+#include "storage/index/b_plus_tree_statistics.h"
 #include "storage/index/index_iterator.h"
 #include "storage/page/b_plus_tree_internal_page.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
+#include "storage/page/b_plus_tree_message_page.h"
+#include "storage/page/b_plus_tree_overflow_page.h"
 
 namespace bustub {
 
@@ -28,19 +38,78 @@ namespace bustub {
  *
  * Implementation of simple b+ tree data structure where internal pages direct
  * the search and leaf pages contain actual data.
- * (1) We only support unique key
+ * (1) Keys are unique unless the tree is created with unique_keys = false
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
- * (4) Implement index iterator for range scan
+ * (4) Implement index iterator for range scan, in both directions
+ *
+ * Concurrency follows the B-link tree of Lehman and Yao: every node carries a
+ * right-sibling link and low/high fence keys. Readers hold at most one latch at
+ * a time and move right when a concurrent split has shifted their key into the
+ * right sibling. Writers first try the same descent and modify the leaf in place
+ * when the change cannot split or merge it; otherwise they crab down from the
+ * root with write latches, releasing ancestors as soon as a child is safe.
+ *
+ * With compress_keys the pages strip the key prefix their fences share and
+ * splits push suffix-truncated separators up, see b_plus_tree_page.h. Page
+ * capacities then follow the key layout; leaf_max_size and internal_max_size
+ * only cap them when set below a full page, as tests do.
+ *
+ * Inserts first try the leaf cached as the rightmost one: while it has no
+ * high key and the key is not below its low key it is the leaf the descent
+ * would reach, so appends of increasing keys skip the root. Splitting that
+ * leaf (or the rightmost internal node) after an append keeps 90% of its
+ * entries on the left, sequential loads fill their pages almost completely.
+ *
+ * With a message_buffer_size the tree is write-optimized in the manner of a
+ * B-epsilon tree: inserts and removes become messages in a buffer above the
+ * root instead of dirtying a random leaf each. A full buffer is flushed down
+ * as one batch in key order, so every leaf it touches is latched and dirtied
+ * once per batch rather than once per write. Point lookups apply the pending
+ * messages of their key on top of what the leaf holds; range scans and bulk
+ * loads flush the buffer first. Each message is also appended to a chain of
+ * message pages before the write returns, so acknowledged writes outlive the
+ * tree object and LoadRootPageId puts them back into the buffer. The last of
+ * those pages stays pinned until it is full, so a write-optimized tree has to
+ * be destroyed before its buffer pool.
+ *
+ * Deletes leave leaves half empty and scattered over the file. Compact walks
+ * the bottom internal nodes and rewrites a window of their leaves at a time
+ * into fewer, freshly allocated consecutive pages, then frees the old ones.
+ * A window is latched like a pessimistic write, so readers wait for one window
+ * at most; the old leaves are marked deleted and point at their replacement,
+ * which is where a reader or iterator parked on them continues.
+ *
+ * Writers keep the entry count, leaf count and height up to date as they go.
+ * Analyze scans the leaf level for the fill factor and an equi-depth key
+ * histogram and writes all of it to a page the header page records under
+ * "#" + index name, where LoadStatistics finds it again.
+ *
+ * Partition cuts a key range for parallel scans at the separators of the
+ * highest internal level that has enough of them within the range, so the
+ * sub-ranges cover about the same number of subtrees. The cuts are only a
+ * guess at balance, the iterators over the sub-ranges are exact whatever
+ * concurrent writers did to the internal levels in between.
+ *
+ * Without unique_keys a key maps to a posting list of distinct values. The
+ * list lives in consecutive slots of a single leaf, which splits and
+ * redistributes between runs only, so a lookup reads just that leaf; a list
+ * longer than the leaf allows continues on overflow pages owned by the leaf.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
   using InternalPage = BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>;
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+  using OverflowPage = BPlusTreeOverflowPage<ValueType>;
+  using MessagePage = BPlusTreeMessagePage<KeyType, ValueType>;
+  using Statistics = BPlusTreeStatistics<KeyType, KeyComparator>;
 
  public:
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     bool compress_keys = false, bool unique_keys = true, int message_buffer_size = 0);
+
+  ~BPlusTree();
 
   // Returns true if this B+ tree has no keys and values.
   auto IsEmpty() const -> bool;
@@ -48,17 +117,42 @@ class BPlusTree {
   // Insert a key-value pair into this B+ tree.
   auto Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr) -> bool;
 
-  // Remove a key and its value from this B+ tree.
+  // Remove a key and its value(s) from this B+ tree.
   void Remove(const KeyType &key, Transaction *transaction = nullptr);
 
-  // return the value associated with a given key
+  // Remove one key-value pair from this B+ tree.
+  void Remove(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
+
+  // apply the buffered messages of a write-optimized tree to the leaves
+  void FlushMessages(Transaction *transaction = nullptr);
+  // return the value(s) associated with a given key
   auto GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr) -> bool;
 
+  // batched point queries, results[i] holds the value(s) of keys[i]; returns how many keys were found
+  auto GetValues(const std::vector<KeyType> &keys, std::vector<std::vector<ValueType>> *results,
+                 Transaction *transaction = nullptr) -> int;
+
   // index iterator
   auto Begin() -> INDEXITERATOR_TYPE;
   auto Begin(const KeyType &key) -> INDEXITERATOR_TYPE;
+  // forward range scan from key that stops after end_key (before it unless end_inclusive)
+  auto Begin(const KeyType &key, const KeyType &end_key, bool end_inclusive = true) -> INDEXITERATOR_TYPE;
+  // reverse iterators, ++ moves towards smaller keys: from the last entry, from the last entry <= key, and
+  // down to end_key
+  auto RBegin() -> INDEXITERATOR_TYPE;
+  auto RBegin(const KeyType &key) -> INDEXITERATOR_TYPE;
+  auto RBegin(const KeyType &key, const KeyType &end_key, bool end_inclusive = true) -> INDEXITERATOR_TYPE;
   auto End() -> INDEXITERATOR_TYPE;
 
+  // Cut [low, high] (nullptr for an open end) into at most partitions consecutive sub-ranges of about the same
+  // size at separator keys of the internal levels. Returns the cuts in order: sub-range i runs from cut i - 1
+  // up to but excluding cut i, the first one from low and the last one up to and including high.
+  auto Partition(int partitions, const KeyType *low = nullptr, const KeyType *high = nullptr) -> std::vector<KeyType>;
+  // one forward iterator per sub-range of Partition, each can be advanced on a thread of its own; every iterator
+  // keeps a leaf pinned, so partitions should stay well below the buffer pool size
+  auto PartitionBegin(int partitions, const KeyType *low = nullptr, const KeyType *high = nullptr)
+      -> std::vector<INDEXITERATOR_TYPE>;
+
   // print the B+ tree
   void Print(BufferPoolManager *bpm);
 
@@ -70,19 +164,149 @@ class BPlusTree {
 
   // read data from file and remove one by one
   void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
+
+  // Build an empty tree bottom-up from a stream of key/value pairs. next() hands out one pair per call and
+  // returns false at the end of the input. Unsorted input is externally sorted first; sorted input of a non-unique
+  // tree orders the values of a key by their bytes too. Returns false without calling next if the tree is not empty.
+  auto BulkLoad(const std::function<bool(MappingType *)> &next, bool sorted = true, double fill_factor = 1.0)
+      -> bool;
+
+  // Rewrite sparse leaves into fewer pages at fill_factor (as in BulkLoad), one window of leaves under a bottom
+  // internal node at a time; returns the number of leaf pages freed
+  auto Compact(double fill_factor = 1.0) -> int;
+
+  // run Compact every compaction_interval on a background thread until StopCompaction wakes it
+  void StartCompaction(double fill_factor = 1.0);
+  void StopCompaction();
+
+  // entry count, leaf count and height as of now, fill factor and histogram as of the last Analyze
+  auto GetStatistics() -> BPlusTreeStatistics<KeyType, KeyComparator>;
+
+  // scan the leaf level for the fill factor and a histogram of bucket_count buckets, then persist the statistics
+  void Analyze(int bucket_count = 32);
+
+  // read the statistics the last Analyze persisted for this index name, false if there are none
+  auto LoadStatistics() -> bool;
+
+  // reopen a tree over an existing buffer pool: read the root page id recorded for this index name and the
+  // pending messages of a write-optimized tree, false if there are neither
+  auto LoadRootPageId() -> bool;
+
+  // read unsorted data from file and bulk load it
+  auto BulkLoadFromFile(const std::string &file_name, double fill_factor = 1.0) -> bool;
   // expose for test purpose
   auto FindLeafPage(const KeyType &key, bool leftMost = false) -> Page *;
 
  private:
+  enum class Operation { FIND, INSERT, REMOVE };
+  // a pending write of a write-optimized tree, value is unused for REMOVE_KEY
+  struct Message {
+    MessageType type_;
+    ValueType value_;
+  };
+  struct KeyLess {
+    auto operator()(const KeyType &lhs, const KeyType &rhs) const -> bool { return comparator_(lhs, rhs) < 0; }
+    KeyComparator comparator_;
+  };
+
+  // B-link descent: returns the pinned leaf covering key, read latched for FIND and write latched otherwise
+  auto FindLeaf(const KeyType &key, Operation op, bool left_most = false, bool right_most = false) -> Page *;
+
+  // Latch crabbing descent from the root; latched pages (nullptr for the root latch) are kept in the page set
+  auto FindLeafPessimistic(const KeyType &key, Operation op, Transaction *transaction) -> Page *;
+
+  // key: the key being inserted or removed, an insert widens the slots of a compressed leaf to it
+  auto IsSafe(BPlusTreePage *node, Operation op, const KeyType &key) const -> bool;
+
+  auto IsBelowLowKey(BPlusTreePage *node, const KeyType &key) const -> bool;
+
+  auto IsBeyondHighKey(BPlusTreePage *node, const KeyType &key) const -> bool;
+
+  void ReleaseLatches(Transaction *transaction, bool is_dirty);
+
+  // key to post in the parent between two neighbouring keys, suffix-truncated for compressed trees
+  auto Separator(const KeyType &left, const KeyType &right) const -> KeyType;
+
+  // latch leaf page_id and point its left link at prev_page_id, nothing for INVALID_PAGE_ID
+  void SetPrevLink(page_id_t page_id, page_id_t prev_page_id);
+
+  // Build one internal level over children given as (low key, page id), returns the new level in the same form
+  auto BuildInternalLevel(std::vector<std::pair<KeyType, page_id_t>> children, double fill_factor)
+      -> std::vector<std::pair<KeyType, page_id_t>>;
+
+  auto NewBulkLoadPage(page_id_t *page_id) -> Page *;
+
+  // one window of Compact starting at the leaf covering key, the first leaf for nullptr; sets *next_key to where
+  // the next window starts and returns false in has_next at the end of the tree
+  auto CompactWindow(const KeyType *key, double fill_factor, KeyType *next_key, bool *has_next) -> int;
+
   void StartNewTree(const KeyType &key, const ValueType &value);
 
+  // point queries against the leaves only, pending messages are not applied
+  auto LookupInTree(const KeyType &key, std::vector<ValueType> *result) -> bool;
+  auto LookupBatchInTree(const std::vector<KeyType> &keys, std::vector<std::vector<ValueType>> *results) -> int;
+  // the value(s) of key in a leaf that covers it
+  auto LookupInLeaf(LeafPage *leaf, const KeyType &key, std::vector<ValueType> *result) -> bool;
+
   auto InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr) -> bool;
+  // write-optimized trees: queue a write, flushing the buffer once it is full; false for an insert of a key (a pair
+  // for non-unique trees) that the tree or the buffer already holds
+  auto BufferMessage(const KeyType &key, const Message &message, Transaction *transaction) -> bool;
+  // append a queued write to the message pages, the caller holds buffer_latch_ exclusively
+  void LogMessage(const KeyType &key, const Message &message);
+  // empty the message pages after a flush, down to the first one
+  void TruncateMessageLog();
+  // read the message pages of a reopened tree back into the buffer
+  auto LoadMessageLog() -> bool;
+  // values after the pending messages of key, applied in arrival order
+  void ApplyMessages(const KeyType &key, std::vector<ValueType> *values) const;
+  // the caller holds buffer_latch_ exclusively
+  void FlushMessagesLocked(Transaction *transaction);
+  // apply one message in key order; *page is the write latched leaf the previous message ended on, or nullptr
+  void ApplyMessage(const KeyType &key, const Message &message, Page **page, Transaction *transaction);
+  // the cached rightmost leaf, pinned and write latched, if it still is the rightmost leaf and covers key
+  auto FetchRightmostLeaf(const KeyType &key) -> Page *;
+  // remember or forget the rightmost leaf, the caller holds its write latch
+  void CacheRightmostLeaf(LeafPage *leaf);
+  void ForgetRightmostLeaf(page_id_t page_id);
+
+  // unique trees look at the key only, value == nullptr matches any value
+  auto HasEntry(LeafPage *leaf, const KeyType &key, const ValueType *value) -> bool;
+
+  void InsertEntry(LeafPage *leaf, const KeyType &key, const ValueType &value);
+
+  // removes one leaf slot worth of key: the pair, or without value the key's overflow pages or last inline value
+  auto RemoveEntry(const KeyType &key, const ValueType *value, Transaction *transaction) -> bool;
+
+  void RemoveFromLeaf(LeafPage *leaf, const KeyType &key, const ValueType *value);
+
+  // forward iterator over [key, end_key], nullptr for an open end
+  auto MakeIterator(const KeyType *key, const KeyType *end_key, bool end_inclusive) -> INDEXITERATOR_TYPE;
+
+  // where a reverse iterator from key starts within the leaf covering key
+  auto LastIndexAtOrBelow(LeafPage *leaf, const KeyType &key) const -> int;
+
+  // posting list helpers of non-unique trees, see b_plus_tree_overflow_page.h
+  auto PostingListStart(LeafPage *leaf, const KeyType &key) const -> int;
+
+  void ReadPostingList(LeafPage *leaf, int start, std::vector<ValueType> *result);
+
+  auto NewOverflowPage(page_id_t *page_id) -> OverflowPage *;
+
+  void AppendToOverflow(page_id_t head, const ValueType &value);
+
+  // pop the last value of the chain, returns true if that freed the whole chain
+  auto PopFromOverflow(page_id_t head, ValueType *value) -> bool;
+
+  // returns the number of values the chain held
+  auto FreeOverflow(page_id_t head) -> int;
 
   void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
                         Transaction *transaction = nullptr);
 
+  // append: node is the rightmost node of its level and the new entry went to its end
   template <typename N>
-  auto Split(N *node) -> N *;
+  auto Split(N *node, bool append = false) -> N *;
 
   template <typename N>
   auto CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr) -> bool;
@@ -110,6 +334,38 @@ class BPlusTree {
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  bool compress_keys_;
+  bool unique_keys_;
+  // guards root_page_id_
+  ReaderWriterLatch root_latch_;
+  // rightmost leaf for the append fast path, INVALID_PAGE_ID if unknown; a cached page is fetched and forgotten
+  // under rightmost_latch_, so it cannot be freed between the two
+  std::atomic<page_id_t> rightmost_leaf_id_;
+  std::mutex rightmost_latch_;
+  // write-optimized mode: pending messages by key, flushed once there are message_buffer_size_ of them
+  int message_buffer_size_;
+  int buffered_messages_;
+  std::map<KeyType, std::vector<Message>, KeyLess> messages_;
+  // bumped by every flush, the leaves of a write-optimized tree change only then
+  uint64_t flush_epoch_;
+  // the message pages, recorded in the header page under "$" + index name; the last one stays pinned while it
+  // fills, nullptr until the first write
+  page_id_t message_log_page_id_;
+  Page *message_log_tail_;
+  // writers queue and flush under the write latch, point lookups read the tree and the buffer under the read latch
+  ReaderWriterLatch buffer_latch_;
+  // background compaction
+  std::atomic<bool> compaction_running_;
+  std::mutex compaction_latch_;
+  std::condition_variable compaction_cv_;
+  std::thread compaction_thread_;
+  // statistics: counters maintained by writers, the rest as of the last Analyze under statistics_latch_
+  std::atomic<int64_t> entry_count_;
+  std::atomic<int> leaf_count_;
+  std::atomic<int> height_;
+  Statistics statistics_;
+  page_id_t statistics_page_id_;
+  std::mutex statistics_latch_;
 };
 
 }  // namespace bustub
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -18,33 +19,111 @@
 
 #include "storage/index/b_plus_tree.h"
 #include "storage/index/index.h"
+#include "storage/table/table_heap.h"
 
 namespace bustub {
 
 #define BPLUSTREE_INDEX_TYPE BPlusTreeIndex<KeyType, ValueType, KeyComparator>
 
+/**
+ * Ordered index over normalized keys. When the metadata carries included
+ * columns the index is covering: every entry is one tree key laid out as
+ *
+ *  | KEY COLUMNS (normalized) | RID (8, big-endian) | INCLUDED COLUMNS (raw) |
+ *
+ * and only the first two parts take part in the order, so each (key, rid)
+ * pair is a distinct tree key and the included columns ride along in the
+ * leaves for index-only scans.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
-  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager);
+  /**
+   * @param table_heap the indexed table, ScanKey and ScanKeys recheck the matches of cut-off probe keys against it
+   * @param table_schema the schema of the indexed table
+   */
+  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                 TableHeap *table_heap, const Schema *table_schema);
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
+  /** An empty index is built bottom-up with BPlusTree::BulkLoad, the entries are sorted externally first. */
+  void InsertEntries(const std::function<bool(Tuple *, RID *)> &next, Transaction *transaction) override;
+
   void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
+  /**
+   * Keys longer than the normalized key width are cut off, so a probe key that does not fit matches every entry
+   * that shares its first bytes. Such matches are rechecked against the table tuple.
+   */
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                Transaction *transaction) override;
+
   auto GetBeginIterator() -> INDEXITERATOR_TYPE;
 
   auto GetBeginIterator(const KeyType &key) -> INDEXITERATOR_TYPE;
 
+  // range scan over [key, end_key], end_key itself excluded without end_inclusive
+  auto GetBeginIterator(const KeyType &key, const KeyType &end_key, bool end_inclusive = true) -> INDEXITERATOR_TYPE;
+
+  // reverse scans towards smaller keys, from the last key, from key and from key down to end_key
+  auto GetReverseBeginIterator() -> INDEXITERATOR_TYPE;
+
+  auto GetReverseBeginIterator(const KeyType &key) -> INDEXITERATOR_TYPE;
+
+  auto GetReverseBeginIterator(const KeyType &key, const KeyType &end_key, bool end_inclusive = true)
+      -> INDEXITERATOR_TYPE;
+
   auto GetEndIterator() -> INDEXITERATOR_TYPE;
 
+  /**
+   * Iterator over the entries whose leading key column lies in [low, high] (nullptr for an open end), in key
+   * order or towards smaller keys with reverse. The bounds are widened to whole normalized key prefixes, and a
+   * bound that does not convert exactly to the column type is left open, so entries just outside the range can
+   * come back too; callers recheck their predicate.
+   */
+  auto GetLeadingColumnIterator(const Value *low, const Value *high, bool reverse) -> INDEXITERATOR_TYPE;
+
+  // about equal sub-ranges of [low, high] (nullptr for an open end) for parallel scans, one iterator each
+  auto GetPartitionIterators(int partitions, const KeyType *low = nullptr, const KeyType *high = nullptr)
+      -> std::vector<INDEXITERATOR_TYPE>;
+
+  auto Covers(const std::vector<uint32_t> &column_attrs) const -> bool override;
+
+  /**
+   * Values of the indexed columns of one tree key, in key schema order (key columns, then included columns).
+   * Key columns that cannot be decoded from the normalized key come back as NULL, see Covers.
+   */
+  void GetEntryValues(const KeyType &index_key, std::vector<Value> *values) const;
+
+  // size and key distribution of the tree for selectivity estimates, see BPlusTree::Analyze
+  auto GetStatistics() -> BPlusTreeStatistics<KeyType, KeyComparator>;
+
+  void Analyze(int bucket_count = 32);
+
+ private:
+  // normalized key columns, followed by the rid and included columns in a covering index
+  void MakeIndexKey(const Tuple &key, const RID &rid, KeyType *index_key) const;
+  // number of leading key columns that decode back from the normalized key
+  auto DecodableKeyColumns() const -> uint32_t;
+  // drop the rids from result[begin, end) whose table tuple does not have the key columns of key
+  void RecheckMatches(const Tuple &key, size_t begin, std::vector<RID> *result, Transaction *transaction);
+  // smallest (largest with upper) tree key whose leading key column is value, false if value has no exact
+  // counterpart of the column type
+  auto MakeBoundKey(const Value &value, bool upper, KeyType *index_key) const -> bool;
+
  protected:
-  // comparator for key
+  // bytes of normalized key columns, the whole key unless the index is covering
+  size_t key_length_;
+  // comparator for key, index keys are normalized and compared with memcmp
   KeyComparator comparator_;
-  // container
+  // container, with a posting list of rids per key so that secondary indexes can hold duplicate keys
   BPlusTree<KeyType, ValueType, KeyComparator> container_;
+  // the indexed table, for rechecking cut-off keys
+  TableHeap *table_heap_;
+  const Schema *table_schema_;
 };
 
 }  // namespace bustub
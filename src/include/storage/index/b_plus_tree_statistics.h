@@ -0,0 +1,80 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_statistics.h
+//
+// Identification: src/include/storage/index/b_plus_tree_statistics.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+#define STATISTICS_TEMPLATE_ARGUMENTS template <typename KeyType, typename KeyComparator>
+#define BPLUSTREE_STATISTICS_TYPE BPlusTreeStatistics<KeyType, KeyComparator>
+
+/**
+ * Size and key distribution of a B+ tree for selectivity estimates, see
+ * BPlusTree::GetStatistics. The entry count, leaf count and height are kept
+ * up to date by the tree; the fill factor and the histogram are as of the
+ * last BPlusTree::Analyze.
+ *
+ * The histogram is equi-depth: bucket i holds the entries whose key is in
+ * [bounds_[i], bounds_[i + 1]), the last bucket also those equal to
+ * bounds_.back(), the largest key. Buckets take about the same number of
+ * entries, but all entries of a key fall into one bucket.
+ *
+ * Serialized format (size in byte, b buckets, k = sizeof(KeyType)):
+ *  ----------------------------------------------------------------------------------
+ * | EntryCount (8) | LeafCount (4) | Height (4) | FillFactor (8) | BucketCount (4) |
+ *  ----------------------------------------------------------------------------------
+ *  ----------------------------------------------------------------------------------
+ * | BOUND(0) (k) | ... | BOUND(b) (k) | COUNT(0) (8) | ... | DISTINCT(b - 1) (8) |
+ *  ----------------------------------------------------------------------------------
+ */
+STATISTICS_TEMPLATE_ARGUMENTS
+class BPlusTreeStatistics {
+ public:
+  // most buckets that fit on one page
+  static auto MaxBucketCount() -> int;
+
+  // estimated number of entries with this key
+  auto EstimateEqual(const KeyType &key, const KeyComparator &comparator) const -> double;
+  // estimated number of entries with low <= key <= high, nullptr for an open end; a bucket the range only
+  // partly covers counts half
+  auto EstimateRange(const KeyType *low, const KeyType *high, const KeyComparator &comparator) const -> double;
+
+  // Build the histogram from the keys in order, one call per distinct key with its number of values; a bucket
+  // is closed once it holds depth entries
+  void AddKey(const KeyType &key, int64_t count, int64_t depth);
+  void FinishHistogram();
+
+  void SerializeTo(char *storage) const;
+  void DeserializeFrom(const char *storage);
+
+  int64_t entry_count_{0};
+  int leaf_count_{0};
+  int height_{0};
+  // used leaf slots over leaf slot capacity
+  double fill_factor_{0};
+  std::vector<KeyType> bounds_;
+  std::vector<int64_t> counts_;
+  std::vector<int64_t> distinct_;
+
+ private:
+  static constexpr size_t HEADER_SIZE = 28;
+  // bucket of key, -1 if it is outside of the histogram
+  auto BucketOf(const KeyType &key, const KeyComparator &comparator) const -> int;
+  KeyType last_key_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,50 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// cuckoo_hash_table_index.h
+//
+// Identification: src/include/storage/index/cuckoo_hash_table_index.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "container/hash/cuckoo_hash_table.h"
+#include "container/hash/hash_function.h"
+#include "storage/index/index.h"
+
+namespace bustub {
+
+#define CUCKOO_HASH_TABLE_INDEX_TYPE CuckooHashTableIndex<KeyType, ValueType, KeyComparator>
+
+/** Hash index over a CuckooHashTable, for lookups that must read at most two bucket pages. */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+class CuckooHashTableIndex : public Index {
+ public:
+  CuckooHashTableIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                       size_t num_buckets, const HashFunction<KeyType> &hash_fn);
+
+  ~CuckooHashTableIndex() override = default;
+
+  void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
+
+ protected:
+  // comparator for key
+  KeyComparator comparator_;
+  // container
+  CuckooHashTable<KeyType, ValueType, KeyComparator> container_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,89 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sorter.h
+//
+// Identification: src/include/storage/index/external_sorter.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define EXTERNAL_SORTER_TYPE ExternalSorter<KeyType, ValueType, KeyComparator>
+
+/**
+ * External merge sort of key/value pairs, used to feed unsorted input to
+ * BPlusTree::BulkLoad and, ordered by hash, to ExtendibleHashTable::BulkLoad.
+ *
+ * Pairs are collected into runs of run_size entries. Each full run is sorted in
+ * memory and spilled to temporary pages through the buffer pool. After Finish(),
+ * Next() merges all runs while keeping only one page of entries per run in
+ * memory. The last run is never spilled. Equal keys come out in the order they
+ * were added, or with order_values in the byte order of their values, which a
+ * non-unique BPlusTree keeps its posting lists in. The temporary pages are
+ * deleted when the sorter is destroyed.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class ExternalSorter {
+ public:
+  ExternalSorter(BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator, size_t run_size,
+                 bool order_values = false);
+  ~ExternalSorter();
+
+  ExternalSorter(const ExternalSorter &) = delete;
+  auto operator=(const ExternalSorter &) -> ExternalSorter & = delete;
+
+  // Add a pair to the input, may spill the current run
+  void Add(const MappingType &item);
+
+  // Sort the last run and start merging, call once after the last Add()
+  void Finish();
+
+  // Pop the smallest remaining pair, returns false once all runs are drained
+  auto Next(MappingType *item) -> bool;
+
+  // Number of sorted runs, including the one kept in memory
+  auto GetRunCount() const -> size_t { return runs_.size(); }
+
+ private:
+  struct Run {
+    std::vector<page_id_t> page_ids_;
+    size_t size_{0};
+    size_t next_page_{0};
+    // entries of the page currently being merged
+    std::vector<MappingType> buffer_;
+    size_t buffer_index_{0};
+  };
+
+  void SortCurrentRun();
+  void SpillCurrentRun();
+  // refill the run's buffer from its next page, false if the run is drained
+  auto LoadNextPage(Run *run) -> bool;
+  // key order, then value bytes with order_values_
+  auto Compare(const MappingType &lhs, const MappingType &rhs) const -> int;
+  // heap order: smaller pair first, earlier run first on ties
+  auto HeapGreater(size_t lhs, size_t rhs) const -> bool;
+
+  static constexpr size_t ITEMS_PER_PAGE = PAGE_SIZE / sizeof(MappingType);
+
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  size_t run_size_;
+  bool order_values_;
+  std::vector<MappingType> current_run_;
+  std::vector<Run> runs_;
+  // min-heap of indexes of runs that still have entries
+  std::vector<size_t> heap_;
+};
+
+}  // namespace bustub
@@ -12,10 +12,14 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
+#include "common/exception.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -41,6 +45,130 @@ class GenericKey {
     memcpy(data_, &key, sizeof(int64_t));
   }
 
+  /**
+   * Binary-comparable form of the key columns: integers go big-endian with the sign bit flipped, decimals get
+   * the usual float bit flip and varchars keep their bytes followed by a zero terminator (bytes compare the way
+   * VARCHAR values do). memcmp on two such keys orders them like the schema comparator, as long as the columns
+   * fit in KeySize; whatever does not fit is cut off. NULLs encode as the smallest value of the column.
+   */
+  inline void SetNormalizedFromKey(const Tuple &tuple, const Schema *key_schema) {
+    SetNormalizedFromKey(tuple, key_schema, key_schema->GetColumnCount(), KeySize);
+  }
+
+  /**
+   * Normalized form of the first column_count columns only, cut off after length bytes. The rest of the key is
+   * zeroed and left to the caller, a covering index stores the rid and its included columns there.
+   * @return the number of bytes the columns need, more than length if they were cut off
+   */
+  inline auto SetNormalizedFromKey(const Tuple &tuple, const Schema *key_schema, uint32_t column_count,
+                                   size_t length) -> size_t {
+    memset(data_, 0, KeySize);
+    size_t offset = 0;
+    for (uint32_t i = 0; i < column_count && offset < length; i++) {
+      Value value = tuple.GetValue(key_schema, i);
+      switch (value.GetTypeId()) {
+        case TypeId::BOOLEAN:
+        case TypeId::TINYINT:
+          offset = AppendSigned(value.IsNull() ? INT8_MIN : value.GetAs<int8_t>(), 1, offset, length);
+          break;
+        case TypeId::SMALLINT:
+          offset = AppendSigned(value.IsNull() ? INT16_MIN : value.GetAs<int16_t>(), 2, offset, length);
+          break;
+        case TypeId::INTEGER:
+          offset = AppendSigned(value.IsNull() ? INT32_MIN : value.GetAs<int32_t>(), 4, offset, length);
+          break;
+        case TypeId::BIGINT:
+          offset = AppendSigned(value.IsNull() ? INT64_MIN : value.GetAs<int64_t>(), 8, offset, length);
+          break;
+        case TypeId::TIMESTAMP:
+          offset = AppendBigEndian(value.IsNull() ? 0 : value.GetAs<uint64_t>(), 8, offset, length);
+          break;
+        case TypeId::DECIMAL: {
+          uint64_t bits = 0;
+          if (!value.IsNull()) {
+            auto decimal = value.GetAs<double>();
+            memcpy(&bits, &decimal, sizeof(bits));
+            // 负数按位取反, 正数翻转符号位
+            bits = (bits >> 63) != 0 ? ~bits : bits | (1ULL << 63);
+          }
+          offset = AppendBigEndian(bits, 8, offset, length);
+          break;
+        }
+        case TypeId::VARCHAR: {
+          size_t size = value.IsNull() ? 0 : strnlen(value.GetData(), value.GetLength());
+          size_t copied = std::min(size, length - offset);
+          memcpy(data_ + offset, value.GetData(), copied);
+          offset += copied + 1;
+          break;
+        }
+        default:
+          throw Exception(ExceptionType::MISMATCH_TYPE, "cannot normalize key column");
+      }
+    }
+    return offset;
+  }
+
+  // NOTE: for test purpose only
+  // normalized form of a single bigint column
+  inline void SetNormalizedFromInteger(int64_t key) {
+    memset(data_, 0, KeySize);
+    AppendSigned(key, 8, 0, KeySize);
+  }
+
+  /**
+   * Decode the leading columns of a normalized key that were written in full within length bytes. Decoding stops
+   * at the first varchar or timestamp column, their encoding does not round-trip.
+   * @return the number of columns decoded into values
+   */
+  inline auto NormalizedToValues(const Schema *key_schema, uint32_t column_count, size_t length,
+                                 std::vector<Value> *values) const -> uint32_t {
+    size_t offset = 0;
+    uint32_t i = 0;
+    for (; i < column_count; i++) {
+      TypeId type = key_schema->GetColumn(i).GetType();
+      size_t width = Type::GetTypeSize(type);
+      if (type == TypeId::VARCHAR || type == TypeId::TIMESTAMP || offset + width > length) {
+        break;
+      }
+      uint64_t bits = 0;
+      for (size_t j = 0; j < width; j++) {
+        bits = (bits << 8) | static_cast<uint8_t>(data_[offset + j]);
+      }
+      offset += width;
+      if (type == TypeId::DECIMAL) {
+        if (bits == 0) {
+          values->push_back(ValueFactory::GetNullValueByType(type));
+          continue;
+        }
+        bits = (bits >> 63) != 0 ? bits & ~(1ULL << 63) : ~bits;
+        double decimal;
+        memcpy(&decimal, &bits, sizeof(decimal));
+        values->emplace_back(type, decimal);
+        continue;
+      }
+      // 翻回符号位再做符号扩展, 最小值即 NULL
+      bits ^= 1ULL << (width * 8 - 1);
+      int shift = 64 - static_cast<int>(width) * 8;
+      auto value = static_cast<int64_t>(bits << shift) >> shift;
+      switch (type) {
+        case TypeId::BOOLEAN:
+        case TypeId::TINYINT:
+          values->emplace_back(type, static_cast<int8_t>(value));
+          break;
+        case TypeId::SMALLINT:
+          values->emplace_back(type, static_cast<int16_t>(value));
+          break;
+        case TypeId::INTEGER:
+          values->emplace_back(type, static_cast<int32_t>(value));
+          break;
+        default:
+          values->emplace_back(type, value);
+          break;
+      }
+    }
+    return i;
+  }
+
   inline auto ToValue(Schema *schema, uint32_t column_idx) const -> Value {
     const char *data_ptr;
     const auto &col = schema->GetColumn(column_idx);
@@ -68,15 +196,34 @@ class GenericKey {
 
   // actual location of data, extends past the end.
   char data_[KeySize];
+
+ private:
+  inline auto AppendSigned(int64_t value, size_t width, size_t offset, size_t limit) -> size_t {
+    return AppendBigEndian(static_cast<uint64_t>(value) ^ (1ULL << (width * 8 - 1)), width, offset, limit);
+  }
+
+  // write the low width bytes of bits most significant first, up to limit
+  inline auto AppendBigEndian(uint64_t bits, size_t width, size_t offset, size_t limit) -> size_t {
+    for (size_t i = 0; i < width && offset + i < limit; i++) {
+      data_[offset + i] = static_cast<char>(bits >> ((width - 1 - i) * 8));
+    }
+    return offset + width;
+  }
 };
 
 /**
  * Function object returns true if lhs < rhs, used for trees
+ * Keys built with SetNormalizedFromKey are compared with memcmp, the schema-driven compare is kept for keys
+ * that hold a raw tuple image.
  */
 template <size_t KeySize>
 class GenericComparator {
  public:
   inline auto operator()(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const -> int {
+    if (normalized_keys_) {
+      int cmp = memcmp(lhs.data_, rhs.data_, compare_length_);
+      return (cmp > 0) - (cmp < 0);
+    }
     uint32_t column_count = key_schema_->GetColumnCount();
 
     for (uint32_t i = 0; i < column_count; i++) {
@@ -94,13 +241,87 @@ class GenericComparator {
     return 0;
   }
 
-  GenericComparator(const GenericComparator &other) : key_schema_{other.key_schema_} {}
+  /**
+   * Number of leading bytes lhs and rhs agree on, counted in whole columns over the leading integer columns.
+   * Columns are compared in order, so every key between lhs and rhs carries the same bytes: a B+ tree page
+   * strips this prefix from the keys inside its fences. Normalized keys share single bytes as well.
+   */
+  inline auto CommonPrefixLength(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const -> int {
+    int length = 0;
+    if (normalized_keys_) {
+      while (length < static_cast<int>(compare_length_) && lhs.data_[length] == rhs.data_[length]) {
+        length++;
+      }
+      return length;
+    }
+    uint32_t column_count = key_schema_->GetColumnCount();
+    for (uint32_t i = 0; i < column_count; i++) {
+      const auto &col = key_schema_->GetColumn(i);
+      if (!IsIntegerColumn(col) ||
+          memcmp(lhs.data_ + col.GetOffset(), rhs.data_ + col.GetOffset(), col.GetFixedLength()) != 0) {
+        break;
+      }
+      length = col.GetOffset() + col.GetFixedLength();
+    }
+    return length;
+  }
+
+  /**
+   * Shortest separator s with lhs < s <= rhs that is a prefix of rhs padded with zero bytes, so a B+ tree can
+   * push a suffix-truncated key up on a split. Only normalized keys and keys made of integer columns are cut,
+   * zeroing the offset of a raw varchar would not deserialize.
+   */
+  inline auto ShortestSeparator(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const
+      -> GenericKey<KeySize> {
+    uint32_t column_count = key_schema_->GetColumnCount();
+    for (uint32_t i = 0; i < column_count && !normalized_keys_; i++) {
+      if (!IsIntegerColumn(key_schema_->GetColumn(i))) {
+        return rhs;
+      }
+    }
+    GenericKey<KeySize> separator;
+    for (size_t length = 0; length < KeySize; length++) {
+      memset(separator.data_, 0, KeySize);
+      memcpy(separator.data_, rhs.data_, length);
+      if ((*this)(lhs, separator) < 0 && (*this)(separator, rhs) <= 0) {
+        return separator;
+      }
+    }
+    return rhs;
+  }
+
+  GenericComparator(const GenericComparator &other)
+      : key_schema_{other.key_schema_},
+        normalized_keys_{other.normalized_keys_},
+        compare_length_{other.compare_length_} {}
 
-  // constructor
-  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
+  // constructor, normalized_keys: the keys are built with SetNormalizedFromKey
+  // compare_length: normalized keys only order by their first compare_length bytes, the tail is payload
+  explicit GenericComparator(Schema *key_schema, bool normalized_keys = false, size_t compare_length = KeySize)
+      : key_schema_(key_schema), normalized_keys_(normalized_keys), compare_length_(compare_length) {}
+
+  inline auto IsNormalized() const -> bool { return normalized_keys_; }
+
+  inline auto GetCompareLength() const -> size_t { return compare_length_; }
 
  private:
+  // equal values have equal bytes, and any bytes deserialize
+  static inline auto IsIntegerColumn(const Column &col) -> bool {
+    switch (col.GetType()) {
+      case TypeId::TINYINT:
+      case TypeId::SMALLINT:
+      case TypeId::INTEGER:
+      case TypeId::BIGINT:
+      case TypeId::TIMESTAMP:
+        return true;
+      default:
+        return false;
+    }
+  }
+
   Schema *key_schema_;
+  bool normalized_keys_;
+  size_t compare_length_;
 };
 
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -43,10 +44,14 @@ class IndexMetadata {
    * @param table_name The name of the table on which the index is created
    * @param tuple_schema The schema of the indexed key
    * @param key_attrs The mapping from indexed columns to base table columns
+   * @param include_attrs Base table columns stored in the index entries next to the key, not part of the key order
    */
   IndexMetadata(std::string index_name, std::string table_name, const Schema *tuple_schema,
-                std::vector<uint32_t> key_attrs)
-      : name_(std::move(index_name)), table_name_(std::move(table_name)), key_attrs_(std::move(key_attrs)) {
+                std::vector<uint32_t> key_attrs, const std::vector<uint32_t> &include_attrs = {})
+      : name_(std::move(index_name)),
+        table_name_(std::move(table_name)),
+        key_column_count_(static_cast<uint32_t>(key_attrs.size())),
+        key_attrs_(Concat(std::move(key_attrs), include_attrs)) {
     key_schema_ = Schema::CopySchema(tuple_schema, key_attrs_);
   }
 
@@ -58,7 +63,7 @@ class IndexMetadata {
   /** @return The name of the table on which the index is created */
   inline auto GetTableName() -> const std::string & { return table_name_; }
 
-  /** @return A schema object pointer that represents the indexed key */
+  /** @return A schema object pointer that represents the indexed key, followed by the included columns */
   inline auto GetKeySchema() const -> Schema * { return key_schema_; }
 
   /**
@@ -67,9 +72,14 @@ class IndexMetadata {
    * NOTE: this must be defined inside the cpp source file because it
    * uses the member of catalog::Schema which is not known here.
    */
-  auto GetIndexColumnCount() const -> std::uint32_t { return static_cast<uint32_t>(key_attrs_.size()); }
+  auto GetIndexColumnCount() const -> std::uint32_t { return key_column_count_; }
 
-  /** @return The mapping relation between indexed columns and base table columns */
+  /** @return The number of included columns, they follow the key columns in the key schema */
+  auto GetIncludeColumnCount() const -> std::uint32_t {
+    return static_cast<uint32_t>(key_attrs_.size()) - key_column_count_;
+  }
+
+  /** @return The mapping relation between indexed columns and base table columns, included columns last */
   inline auto GetKeyAttrs() const -> const std::vector<uint32_t> & { return key_attrs_; }
 
   /** @return A string representation for debugging */
@@ -86,10 +96,18 @@ class IndexMetadata {
   }
 
  private:
+  static auto Concat(std::vector<uint32_t> &&key_attrs, const std::vector<uint32_t> &include_attrs)
+      -> std::vector<uint32_t> {
+    key_attrs.insert(key_attrs.end(), include_attrs.begin(), include_attrs.end());
+    return std::move(key_attrs);
+  }
+
   /** The name of the index */
   std::string name_;
   /** The name of the table on which the index is created */
   std::string table_name_;
+  /** The number of key columns, the leading part of key_attrs_ */
+  uint32_t key_column_count_;
   /** The mapping relation between key schema and tuple schema */
   const std::vector<uint32_t> key_attrs_;
   /** The schema of the indexed key */
@@ -139,6 +157,12 @@ class Index {
   /** @return The index key attributes */
   auto GetKeyAttrs() const -> const std::vector<uint32_t> & { return metadata_->GetKeyAttrs(); }
 
+  /**
+   * Whether an index-only scan can produce the given base table columns from the index entries alone.
+   * @param column_attrs Base table column indexes
+   */
+  virtual auto Covers(const std::vector<uint32_t> &column_attrs) const -> bool { return false; }
+
   /** @return A string representation for debugging */
   auto ToString() const -> std::string {
     std::stringstream os;
@@ -159,6 +183,21 @@ class Index {
    */
   virtual void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) = 0;
 
+  /**
+   * Populate an empty index with a stream of entries. Indexes that can lay out
+   * their pages from the whole input at once override this; the default
+   * inserts the entries one at a time.
+   * @param next Hands out one index key and RID per call, returns false at the end
+   * @param transaction The transaction context
+   */
+  virtual void InsertEntries(const std::function<bool(Tuple *, RID *)> &next, Transaction *transaction) {
+    Tuple key;
+    RID rid;
+    while (next(&key, &rid)) {
+      InsertEntry(key, rid, transaction);
+    }
+  }
+
   /**
    * Delete an index entry by key.
    * @param key The index key
@@ -175,6 +214,22 @@ class Index {
    */
   virtual void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) = 0;
 
+  /**
+   * Search the index for a batch of keys. Indexes that can share work across
+   * keys, such as a descent or a bucket fetch, override this; the default
+   * probes the keys one at a time.
+   * @param keys The index keys
+   * @param results results[i] is populated with the RIDs of keys[i]
+   * @param transaction The transaction context
+   */
+  virtual void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                        Transaction *transaction) {
+    results->assign(keys.size(), std::vector<RID>());
+    for (size_t i = 0; i < keys.size(); i++) {
+      ScanKey(keys[i], &(*results)[i], transaction);
+    }
+  }
+
  private:
   /** The Index structure owns its metadata */
   std::unique_ptr<IndexMetadata> metadata_;
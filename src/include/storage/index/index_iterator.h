@@ -13,31 +13,92 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include "buffer/buffer_pool_manager.h"
+#include <vector>
+
 #include "storage/page/b_plus_tree_leaf_page.h"
+#include "storage/page/b_plus_tree_overflow_page.h"
 
 namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+/**
+ * The iterator keeps its current leaf pinned but not latched between calls, and
+ * copies out the entry it points at. Advancing re-latches the leaf and seeks past
+ * the last returned key, following the right-sibling links, so concurrent splits
+ * and merges neither skip nor repeat entries.
+ *
+ * On non-unique leaves the seek also skips the inline values of the key up to
+ * the last returned one, which the tree keeps in byte order. The overflow
+ * pages of a posting list are read in one go while the leaf is latched and
+ * handed out from a copy.
+ *
+ * A reverse iterator walks the same order backwards: it seeks before the last
+ * returned entry and moves to the left sibling when the leaf has none. An
+ * optional end key bounds either direction; the iterator ends when the next
+ * entry passes it, or when the fence of an exhausted leaf shows that the next
+ * leaf cannot hold any entry within the bound, without fetching that leaf.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
  public:
-  // you may define your own constructor based on your member variables
-  IndexIterator();
+  /**
+   * @param page leaf page that is pinned and read latched by the caller, nullptr for the end iterator
+   * @param index position of the first entry to return within the leaf, -1 for a reverse iterator that
+   * starts in the left sibling
+   * @param reverse move towards smaller keys
+   * @param end_key last key to return in the direction of the scan, nullptr for no bound
+   * @param end_inclusive whether entries with end_key itself are returned
+   */
+  IndexIterator(BufferPoolManager *buffer_pool_manager, Page *page, int index, const KeyComparator &comparator,
+                bool reverse = false, const KeyType *end_key = nullptr, bool end_inclusive = true);
   ~IndexIterator();  // NOLINT
 
+  IndexIterator(const IndexIterator &) = delete;
+  auto operator=(const IndexIterator &) -> IndexIterator & = delete;
+  IndexIterator(IndexIterator &&other) noexcept;
+
   auto IsEnd() -> bool;
 
   auto operator*() -> const MappingType &;
 
   auto operator++() -> IndexIterator &;
 
-  auto operator==(const IndexIterator &itr) const -> bool { throw std::runtime_error("unimplemented"); }
+  auto operator==(const IndexIterator &itr) const -> bool { return page_ == itr.page_ && index_ == itr.index_; }
 
-  auto operator!=(const IndexIterator &itr) const -> bool { throw std::runtime_error("unimplemented"); }
+  auto operator!=(const IndexIterator &itr) const -> bool { return !(*this == itr); }
 
  private:
-  // add your own private member variables here
+  // page_ 已加读锁, 定位到第一个 > after 的位置(after为空时从index_开始), 返回前释放读锁;
+  // past_run表示after所在的整个posting list都已经返回过
+  void Settle(const MappingType *after, bool past_run);
+  // 反向: 定位到最后一个 < after 的位置(after为空时从index_开始), overflow_done表示after所在posting list的
+  // 溢出页都已经返回过
+  void SettleReverse(const MappingType *after, bool overflow_done);
+  // 当前叶子里index_处就是下一个entry, 读出来或者越过end_key时结束; 返回前释放读锁
+  void Land();
+  // 当前叶子已经没有要返回的entry, 它的fence说明下一个叶子也不会有时返回true
+  auto IsLastLeaf(const LeafPage *leaf) const -> bool;
+  // 释放当前叶子, 变成end迭代器
+  void Finish();
+  // 释放当前叶子并读锁page_id
+  void MoveTo(page_id_t page_id);
+
+  BufferPoolManager *buffer_pool_manager_;
+  Page *page_;
+  int index_;
+  KeyComparator comparator_;
+  MappingType item_;
+  // values of the current posting list's overflow pages, item_ holds overflow_[overflow_index_]
+  std::vector<ValueType> overflow_;
+  size_t overflow_index_{0};
+  bool reverse_;
+  bool has_end_key_;
+  KeyType end_key_;
+  bool end_inclusive_;
 };
 
 }  // namespace bustub
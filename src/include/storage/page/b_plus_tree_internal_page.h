@@ -11,14 +11,16 @@
 #pragma once
 
 #include <queue>
+#include <vector>
 
 #include "storage/page/b_plus_tree_page.h"
 
 namespace bustub {
 
 #define B_PLUS_TREE_INTERNAL_PAGE_TYPE BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>
-#define INTERNAL_PAGE_HEADER_SIZE 24
-#define INTERNAL_PAGE_SIZE ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(MappingType)))
+#define INTERNAL_PAGE_HEADER_SIZE (36 + 2 * sizeof(KeyType))
+// one slot is kept in reserve so that a full page can absorb the insert that triggers its split
+#define INTERNAL_PAGE_SIZE ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(KeyType) + sizeof(page_id_t)) - 1)
 /**
  * Store n indexed keys and n+1 child pointers (page_id) within internal page.
  * Pointer PAGE_ID(i) points to a subtree in which all keys K satisfy:
@@ -27,21 +29,59 @@ namespace bustub {
  * the first key always remains invalid. That is to say, any search/lookup
  * should ignore the first key.
  *
- * Internal page format (keys are stored in increasing order):
- *  --------------------------------------------------------------------------
- * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
- *  --------------------------------------------------------------------------
+ * Internal page format (keys are stored in increasing order, apart from the
+ * page ids; c is the slot capacity of the page):
+ *  ------------------------------------------------------------------------------
+ * | HEADER | KEY(1) | ... | KEY(c) | PAGE_ID(1) | ... | PAGE_ID(c) |
+ *  ------------------------------------------------------------------------------
+ *
+ * The header is the common BPlusTreePage header followed by the B-link low
+ * and high keys:
+ *  -------------------------------------------
+ * | BPlusTreePage (36) | LowKey (k) | HighKey (k) |
+ *  -------------------------------------------
+ *
+ * With key compression each KEY(i) only holds KeySize bytes after the prefix
+ * the fences share; the bytes past them are zero in every key of the page,
+ * which suffix-truncated separators make common. A page widens its slots when
+ * a longer key comes in, so its max size is also bounded to let both halves of
+ * a split take one more key of full width.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
  public:
   // must call initialize method after "create" a new node
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = INTERNAL_PAGE_SIZE);
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = INTERNAL_PAGE_SIZE,
+            bool compress_keys = false);
 
   auto KeyAt(int index) const -> KeyType;
   void SetKeyAt(int index, const KeyType &key);
   auto ValueIndex(const ValueType &value) const -> int;
   auto ValueAt(int index) const -> ValueType;
+  // point slot index at another child, the caller sets the child's parent
+  void SetValueAt(int index, const ValueType &value);
+
+  // B-link fences, see b_plus_tree_page.h; compressed pages re-encode their keys when a fence moves, so the
+  // caller widens the fences before moving keys in and narrows them after moving keys out
+  auto GetLowKey() const -> const KeyType & { return low_key_; }
+  void SetLowKey(const KeyType &key, const KeyComparator &comparator);
+  auto GetHighKey() const -> const KeyType & { return high_key_; }
+  void SetHighKey(const KeyType &key, const KeyComparator &comparator);
+  void ClearHighKey(const KeyComparator &comparator);
+  auto IsBelowLowKey(const KeyType &key, const KeyComparator &comparator) const -> bool;
+  auto IsBeyondHighKey(const KeyType &key, const KeyComparator &comparator) const -> bool;
+
+  // end of the bytes stored for the keys of this page, past it every key is zero
+  auto GetKeyEnd() const -> int { return GetPrefixSize() + GetKeySize(); }
+  // max size of this page once its fences are [low, high) and its keys end at key_end (or earlier)
+  auto GetMaxSizeFor(const KeyType *low, const KeyType *high, int key_end, const KeyComparator &comparator) const
+      -> int;
+  // max size that holds whatever separator gets inserted next
+  auto GetSafeMaxSize() const -> int;
+  // whether the page can store one more entry with this key without splitting first
+  auto HasRoomFor(const KeyType &key) const -> bool;
+  static auto MaxSizeFor(int prefix_size, int key_end, int max_size) -> int;
+  static auto KeyEnd(const KeyType &key) -> int;
 
   auto Lookup(const KeyType &key, const KeyComparator &comparator) const -> ValueType;
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
@@ -51,17 +91,41 @@ class BPlusTreeInternalPage : public BPlusTreePage {
 
   // Split and Merge utility methods
   void MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key, BufferPoolManager *buffer_pool_manager);
-  void MoveHalfTo(BPlusTreeInternalPage *recipient, BufferPoolManager *buffer_pool_manager);
+  // keep the first keep children, the recipient's first key is the separator to push up
+  void MoveHalfTo(BPlusTreeInternalPage *recipient, int keep, BufferPoolManager *buffer_pool_manager);
   void MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                         BufferPoolManager *buffer_pool_manager);
   void MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                          BufferPoolManager *buffer_pool_manager);
+  // append entries and adopt their children, also used to build pages bottom-up
+  void CopyNFrom(const MappingType *items, int size, BufferPoolManager *buffer_pool_manager);
 
  private:
-  void CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager);
   void CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
   void CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
+  void Adopt(const ValueType &child, BufferPoolManager *buffer_pool_manager);
+  auto SlotCapacity() const -> int {
+    return (PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (GetKeySize() + sizeof(ValueType));
+  }
+  auto KeySlotAt(int index) -> char * { return data_ + index * GetKeySize(); }
+  auto KeySlotAt(int index) const -> const char * { return data_ + index * GetKeySize(); }
+  auto ValueSlotAt(int index) -> char * {
+    return data_ + SlotCapacity() * GetKeySize() + index * sizeof(ValueType);
+  }
+  auto ValueSlotAt(int index) const -> const char * {
+    return data_ + SlotCapacity() * GetKeySize() + index * sizeof(ValueType);
+  }
+  // memmove count keys and page ids from slot src to slot dst
+  void MoveSlots(int dst, int src, int count);
+  void WriteItem(int index, const KeyType &key, const ValueType &value);
+  auto GetItems() const -> std::vector<MappingType>;
+  auto NeedsWiderSlots(const KeyType &key) const -> bool;
+  // re-encode items with the given prefix and slots just wide enough for their keys
+  void UpdateLayout(const std::vector<MappingType> &items, int prefix_size);
+  void UpdateLayout(const std::vector<MappingType> &items, const KeyComparator &comparator);
+  KeyType low_key_;
+  KeyType high_key_;
   // Flexible array member for page data.
-  MappingType array_[1];
+  char data_[1];
 };
 }  // namespace bustub
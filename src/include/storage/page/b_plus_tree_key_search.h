@@ -0,0 +1,131 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_key_search.h
+//
+// Identification: src/include/storage/page/b_plus_tree_key_search.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "storage/index/generic_key.h"
+
+namespace bustub {
+
+/**
+ * Search over the key array of a B+ tree page. The keys of a page are stored
+ * back to back, apart from the values, so a search only touches key bytes.
+ *
+ * The generic version is a binary search with the comparator. Key types whose
+ * bytes are known to compare as integers are specialized below; the choice is
+ * made at compile time from KeyType.
+ */
+template <typename KeyType, typename KeyComparator>
+struct BPlusTreeKeySearch {
+  // first index in [0, size) whose key is >= key, size if there is none
+  static auto LowerBound(const char *keys, int size, const KeyType &key, const KeyComparator &comparator) -> int {
+    return Search(keys, size, key, comparator, false);
+  }
+
+  // first index in [0, size) whose key is > key, size if there is none
+  static auto UpperBound(const char *keys, int size, const KeyType &key, const KeyComparator &comparator) -> int {
+    return Search(keys, size, key, comparator, true);
+  }
+
+  static auto Search(const char *keys, int size, const KeyType &key, const KeyComparator &comparator, bool upper)
+      -> int {
+    int left = 0;
+    int right = size;
+    while (left < right) {
+      int mid = left + (right - left) / 2;
+      int cmp = comparator(*reinterpret_cast<const KeyType *>(keys + mid * sizeof(KeyType)), key);
+      if (cmp < 0 || (upper && cmp == 0)) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    return left;
+  }
+};
+
+/**
+ * Normalized keys of 4 or 8 bytes are single big-endian unsigned integers:
+ * they are loaded as such and searched without branches, every halving step
+ * is a conditional move instead of a mispredicted jump. Other sizes, and keys
+ * that are not normalized, go through the comparator.
+ */
+template <size_t KeySize>
+struct BPlusTreeKeySearch<GenericKey<KeySize>, GenericComparator<KeySize>> {
+  static auto LowerBound(const char *keys, int size, const GenericKey<KeySize> &key,
+                         const GenericComparator<KeySize> &comparator) -> int {
+    if constexpr (KeySize == 4 || KeySize == 8) {
+      if (comparator.IsNormalized()) {
+        return BranchFreeSearch(keys, size, Load(key.data_), false);
+      }
+    }
+    return ComparatorSearch(keys, size, key, comparator, false);
+  }
+
+  static auto UpperBound(const char *keys, int size, const GenericKey<KeySize> &key,
+                         const GenericComparator<KeySize> &comparator) -> int {
+    if constexpr (KeySize == 4 || KeySize == 8) {
+      if (comparator.IsNormalized()) {
+        return BranchFreeSearch(keys, size, Load(key.data_), true);
+      }
+    }
+    return ComparatorSearch(keys, size, key, comparator, true);
+  }
+
+  static auto BranchFreeSearch(const char *keys, int size, uint64_t target, bool upper) -> int {
+    if (size == 0) {
+      return 0;
+    }
+    // 答案一直在[base, base + size]里, 每次砍掉一半
+    int base = 0;
+    while (size > 1) {
+      int half = size / 2;
+      uint64_t probe = Load(keys + (base + half) * KeySize);
+      base = (probe < target || (upper && probe == target)) ? base + half : base;
+      size -= half;
+    }
+    uint64_t probe = Load(keys + base * KeySize);
+    return base + static_cast<int>(probe < target || (upper && probe == target));
+  }
+
+  static auto ComparatorSearch(const char *keys, int size, const GenericKey<KeySize> &key,
+                               const GenericComparator<KeySize> &comparator, bool upper) -> int {
+    int left = 0;
+    int right = size;
+    while (left < right) {
+      int mid = left + (right - left) / 2;
+      int cmp = comparator(*reinterpret_cast<const GenericKey<KeySize> *>(keys + mid * KeySize), key);
+      if (cmp < 0 || (upper && cmp == 0)) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    return left;
+  }
+
+  static inline auto Load(const char *bytes) -> uint64_t {
+    if constexpr (KeySize == 4) {
+      uint32_t value;
+      memcpy(&value, bytes, sizeof(value));
+      return __builtin_bswap32(value);
+    } else {
+      uint64_t value;
+      memcpy(&value, bytes, sizeof(value));
+      return __builtin_bswap64(value);
+    }
+  }
+};
+
+}  // namespace bustub
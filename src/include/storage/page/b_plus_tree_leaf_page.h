@@ -18,57 +18,147 @@
 namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
-#define LEAF_PAGE_HEADER_SIZE 28
+#define LEAF_PAGE_HEADER_SIZE (40 + 2 * sizeof(KeyType))
 #define LEAF_PAGE_SIZE ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
 
 /**
  * Store indexed key and record id(record id = page id combined with slot id,
  * see include/common/rid.h for detailed implementation) together within leaf
- * page. Only support unique key.
+ * page. Pages of a non-unique tree keep the values of a key in consecutive
+ * slots, see b_plus_tree_overflow_page.h for posting lists that outgrow them.
  *
- * Leaf page format (keys are stored in order):
+ * Leaf page format (keys are stored in order, apart from the rids so that a
+ * search only reads key bytes; c is the slot capacity of the page):
  *  ----------------------------------------------------------------------
- * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
+ * | HEADER | KEY(1) | KEY(2) | ... | KEY(c) | RID(1) | RID(2) | ... | RID(c)
  *  ----------------------------------------------------------------------
  *
- *  Header format (size in byte, 28 bytes in total):
+ *  Header format (size in byte, 40 + 2 * sizeof(KeyType) bytes in total):
  *  ---------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
- *  -----------------------------------------------
- * | ParentPageId (4) | PageId (4) | NextPageId (4)
- *  -----------------------------------------------
+ *  ---------------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | LinkFlags (2) |
+ *  ---------------------------------------------------------------------
+ *  ---------------------------------------------------------------------
+ * | PrefixSize (1) | KeySize (1) | LayoutMaxSize (4) | PrevPageId (4) |
+ *  ---------------------------------------------------------------------
+ *  ---------------------------------------------------------------------
+ * | LowKey (k) | HighKey (k) |
+ *  ---------------------------------------------------------------------
+ *
+ * With key compression each KEY(i) only holds the bytes after the prefix the
+ * fences share, the prefix itself is read back from the low key, and up to the
+ * last non-zero byte of the widest key on the page. Normalized VARCHAR keys
+ * are zero padded, so a page of short strings packs many more slots than one
+ * of long strings; a wider key re-encodes the page before it is stored.
+ *
+ * Leaves also link to their left sibling for reverse scans. Split and merge
+ * update the link with the right neighbour latched, but a reverse reader lets
+ * go of a leaf before it latches the left one, so it checks the fences of the
+ * page it lands on and moves right again if that page has split meanwhile.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeLeafPage : public BPlusTreePage {
+  static_assert(sizeof(MappingType) == sizeof(KeyType) + sizeof(ValueType), "a slot is a key plus a value");
+
  public:
   // After creating a new leaf page from buffer pool, must call initialize
   // method to set default values
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = LEAF_PAGE_SIZE);
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = LEAF_PAGE_SIZE,
+            bool compress_keys = false, bool unique_keys = true);
   // helper methods
-  auto GetNextPageId() const -> page_id_t;
-  void SetNextPageId(page_id_t next_page_id);
   auto KeyAt(int index) const -> KeyType;
+  auto ValueAt(int index) const -> ValueType;
   auto KeyIndex(const KeyType &key, const KeyComparator &comparator) const -> int;
-  auto GetItem(int index) -> const MappingType &;
+  auto GetItem(int index) const -> MappingType;
+
+  // left sibling of the leaf level, see the comment above
+  auto GetPrevPageId() const -> page_id_t { return prev_page_id_; }
+  void SetPrevPageId(page_id_t prev_page_id) { prev_page_id_ = prev_page_id; }
+
+  // B-link fences, see b_plus_tree_page.h; compressed pages re-encode their keys when a fence moves, so the
+  // caller widens the fences before moving keys in and narrows them after moving keys out
+  auto GetLowKey() const -> const KeyType & { return low_key_; }
+  void SetLowKey(const KeyType &key, const KeyComparator &comparator);
+  auto GetHighKey() const -> const KeyType & { return high_key_; }
+  void SetHighKey(const KeyType &key, const KeyComparator &comparator);
+  void ClearHighKey(const KeyComparator &comparator);
+  auto IsBelowLowKey(const KeyType &key, const KeyComparator &comparator) const -> bool;
+  auto IsBeyondHighKey(const KeyType &key, const KeyComparator &comparator) const -> bool;
+
+  // end of the bytes stored for the keys of this page, past it every key is zero
+  auto GetKeyEnd() const -> int { return GetPrefixSize() + GetKeySize(); }
+  // max size of this page once its fences are [low, high), nullptr standing for an open end, and its keys end
+  // at key_end (or earlier)
+  auto GetMaxSizeFor(const KeyType *low, const KeyType *high, int key_end, const KeyComparator &comparator) const
+      -> int;
+  // max size once key is stored, with the slots widened for it if need be
+  auto GetMaxSizeWith(const KeyType &key) const -> int;
+  // whether the page can store one more item with this key without splitting first
+  auto HasRoomFor(const KeyType &key) const -> bool;
+  auto NeedsWiderSlots(const KeyType &key) const -> bool;
+  // max size of a compressed leaf whose keys share prefix_size bytes and end at key_end
+  static auto MaxSizeFor(int prefix_size, int key_end, int max_size) -> int;
+  static auto KeyEnd(const KeyType &key) -> int;
 
   // insert and delete methods
   auto Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator) -> int;
   auto Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const -> bool;
   auto RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator) -> int;
 
+  // posting lists of non-unique pages: a run of equal keys takes at most PostingInlineMax slots, a full run
+  // stores the first overflow page id in its last slot
+  auto PostingInlineMax() const -> int;
+  static auto PostingInlineMaxFor(int max_size) -> int;
+  // end of the run that starts at index
+  auto RunEnd(int index, const KeyComparator &comparator) const -> int;
+  auto IsOverflowSlot(int index, const KeyComparator &comparator) const -> bool;
+  auto GetOverflowPageId(int index) const -> page_id_t;
+  void InsertAt(int index, const KeyType &key, const ValueType &value);
+  void InsertOverflowAt(int index, const KeyType &key, page_id_t page_id);
+  // the value an overflow slot holds, for building pages bottom-up
+  static auto OverflowSlotValue(page_id_t page_id) -> ValueType;
+  void RemoveAt(int index);
+
   // Split and Merge utility methods
-  void MoveHalfTo(BPlusTreeLeafPage *recipient);
+  // number of items to keep on split, runs of equal keys are not cut; append: the split of the rightmost leaf
+  // after an insert at its end
+  auto SplitIndex(const KeyComparator &comparator, bool append = false) const -> int;
+  void MoveHalfTo(BPlusTreeLeafPage *recipient, int keep);
   void MoveAllTo(BPlusTreeLeafPage *recipient);
   void MoveFirstToEndOf(BPlusTreeLeafPage *recipient);
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient);
+  // append items in key order, also used to build pages bottom-up
+  void CopyNFrom(const MappingType *items, int size);
 
  private:
-  void CopyNFrom(MappingType *items, int size);
   void CopyLastFrom(const MappingType &item);
   void CopyFirstFrom(const MappingType &item);
-  page_id_t next_page_id_;
+  auto SlotCapacity() const -> int {
+    return (PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / (GetKeySize() + sizeof(ValueType));
+  }
+  auto KeySlotAt(int index) -> char * { return data_ + index * GetKeySize(); }
+  auto KeySlotAt(int index) const -> const char * { return data_ + index * GetKeySize(); }
+  auto ValueSlotAt(int index) -> char * {
+    return data_ + SlotCapacity() * GetKeySize() + index * sizeof(ValueType);
+  }
+  auto ValueSlotAt(int index) const -> const char * {
+    return data_ + SlotCapacity() * GetKeySize() + index * sizeof(ValueType);
+  }
+  // memmove count keys and values from slot src to slot dst
+  void MoveSlots(int dst, int src, int count);
+  void WriteItem(int index, const KeyType &key, const ValueType &value);
+  auto GetItems() const -> std::vector<MappingType>;
+  // pick the layout for the current fences and re-encode items with it
+  void UpdateLayout(const std::vector<MappingType> &items, const KeyComparator &comparator);
+  void UpdateLayout(const std::vector<MappingType> &items, int prefix_size);
+  // re-encode the page with slots wide enough for key
+  void WidenFor(const KeyType &key);
+  page_id_t prev_page_id_;
+  KeyType low_key_;
+  KeyType high_key_;
   // Flexible array member for page data.
-  MappingType array_[1];
+  char data_[1];
 };
 }  // namespace bustub
@@ -0,0 +1,56 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/include/page/b_plus_tree_message_page.h
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define B_PLUS_TREE_MESSAGE_PAGE_TYPE BPlusTreeMessagePage<KeyType, ValueType>
+#define MESSAGE_PAGE_HEADER_SIZE 36
+#define MESSAGE_PAGE_SIZE \
+  ((PAGE_SIZE - MESSAGE_PAGE_HEADER_SIZE) / sizeof(typename BPlusTreeMessagePage<KeyType, ValueType>::Message))
+
+/** A pending write of a write-optimized tree, the value is unused for REMOVE_KEY. */
+enum class MessageType : int32_t { INSERT, REMOVE_PAIR, REMOVE_KEY };
+
+/**
+ * Log of the message buffer of a write-optimized tree. Every write the tree
+ * acknowledges is appended here before it returns, the pages are chained
+ * through NextPageId in arrival order. The tree keeps the last page pinned
+ * until it is full or the tree goes away. A flush applies the buffer to the
+ * leaves and empties the chain down to its first page, whose id the header
+ * page records under "$" + index name.
+ *
+ * Message page format:
+ *  ---------------------------------------------------------------
+ * | HEADER (36) | MESSAGE(1) | MESSAGE(2) | ... | MESSAGE(n) |
+ *  ---------------------------------------------------------------
+ */
+template <typename KeyType, typename ValueType>
+class BPlusTreeMessagePage : public BPlusTreePage {
+ public:
+  struct Message {
+    KeyType key_;
+    ValueType value_;
+    MessageType type_;
+  };
+
+  void Init(page_id_t page_id, int max_size = MESSAGE_PAGE_SIZE);
+
+  auto MessageAt(int index) const -> const Message &;
+  void Append(const KeyType &key, MessageType type, const ValueType &value);
+
+ private:
+  Message array_[1];
+};
+
+}  // namespace bustub
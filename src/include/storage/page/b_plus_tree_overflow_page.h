@@ -0,0 +1,58 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/include/page/b_plus_tree_overflow_page.h
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <vector>
+
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define B_PLUS_TREE_OVERFLOW_PAGE_TYPE BPlusTreeOverflowPage<ValueType>
+#define OVERFLOW_PAGE_HEADER_SIZE 36
+#define OVERFLOW_PAGE_SIZE ((PAGE_SIZE - OVERFLOW_PAGE_HEADER_SIZE) / sizeof(ValueType))
+
+/**
+ * Continuation of a posting list that outgrew its leaf in a tree with
+ * non-unique keys. Such a run keeps PostingInlineMax - 1 values in the leaf
+ * and stores the id of its first overflow page in place of one more value;
+ * the overflow pages are chained through NextPageId and hold the remaining
+ * values in no particular order.
+ *
+ * Overflow pages belong to the leaf slot that points at them: they are only
+ * read or written while holding that leaf's latch, and move with the slot on
+ * split, merge and redistribute.
+ *
+ * Overflow page format:
+ *  ---------------------------------------------------------
+ * | HEADER (36) | VALUE(1) | VALUE(2) | ... | VALUE(n) |
+ *  ---------------------------------------------------------
+ */
+template <typename ValueType>
+class BPlusTreeOverflowPage : public BPlusTreePage {
+ public:
+  void Init(page_id_t page_id, int max_size = OVERFLOW_PAGE_SIZE);
+
+  auto ValueAt(int index) const -> ValueType;
+  void SetValueAt(int index, const ValueType &value);
+  // index of value on this page, -1 if it is not here
+  auto ValueIndex(const ValueType &value) const -> int;
+  void Append(const ValueType &value);
+  auto PopBack() -> ValueType;
+
+  // read every value of the chain starting at page_id
+  static void ReadChain(BufferPoolManager *buffer_pool_manager, page_id_t page_id, std::vector<ValueType> *result);
+
+ private:
+  ValueType array_[1];
+};
+
+}  // namespace bustub
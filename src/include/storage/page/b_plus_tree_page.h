@@ -25,7 +25,7 @@ namespace bustub {
 #define INDEX_TEMPLATE_ARGUMENTS template <typename KeyType, typename ValueType, typename KeyComparator>
 
 // define page type enum
-enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
+enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE, OVERFLOW_PAGE, MESSAGE_PAGE };
 
 /**
  * Both internal and leaf page are inherited from this page.
@@ -33,16 +33,40 @@ enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
  * It actually serves as a header part for each B+ tree page and
  * contains information shared by both leaf page and internal page.
  *
- * Header format (size in byte, 24 bytes in total):
+ * Header format (size in byte, 36 bytes in total):
  * ----------------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  * ----------------------------------------------------------------------------
- * | ParentPageId (4) | PageId(4) |
+ * | ParentPageId (4) | PageId(4) | NextPageId (4) | LinkFlags (2) |
  * ----------------------------------------------------------------------------
+ * | PrefixSize (1) | KeySize (1) | LayoutMaxSize (4) |
+ * ----------------------------------------------------------------------------
+ *
+ * NextPageId and LinkFlags make the tree a B-link tree (Lehman & Yao): every
+ * node, leaf or internal, points to its right sibling on the same level and
+ * carries a low key and a high key (stored by the derived page, since they
+ * depend on KeyType). A node covers the key range [LowKey, HighKey); a missing
+ * low/high key stands for -inf/+inf. A reader that reaches a node whose high
+ * key is <= the search key knows the node was split after it read the parent
+ * pointer and simply follows NextPageId, so lookups only ever hold one latch.
+ *
+ * Pages of a tree created with key compression store their keys in a smaller
+ * slot: the bytes every key inside the fences shares (PrefixSize, taken from
+ * the low key) are stripped, and so are the zero bytes every key of the page
+ * ends with (suffix-truncated separators, short normalized VARCHAR keys),
+ * keeping KeySize bytes per key. The layout and the resulting capacity
+ * (LayoutMaxSize, capped by the configured MaxSize) change when the fences
+ * move on split, merge and redistribute, and when a wider key comes in.
+ * Uncompressed pages keep full keys and LayoutMaxSize == MaxSize.
+ *
+ * Leaves of a tree with non-unique keys hold a posting list per key: its
+ * values sit in consecutive slots that repeat the key, and a list too long
+ * for the leaf continues on overflow pages, see b_plus_tree_overflow_page.h.
  */
 class BPlusTreePage {
  public:
   auto IsLeafPage() const -> bool;
+  auto IsInternalPage() const -> bool;
   auto IsRootPage() const -> bool;
   void SetPageType(IndexPageType page_type);
 
@@ -62,6 +86,42 @@ class BPlusTreePage {
 
   void SetLSN(lsn_t lsn = INVALID_LSN);
 
+  // B-link helpers, see the header comment above
+  auto GetNextPageId() const -> page_id_t;
+  void SetNextPageId(page_id_t next_page_id);
+
+  auto HasLowKey() const -> bool;
+  auto HasHighKey() const -> bool;
+
+  // a deleted node has been merged into its left sibling; readers that still
+  // hold a pin on it must restart from the root
+  auto IsDeleted() const -> bool;
+  void SetDeleted();
+
+  // key compression, see the header comment above
+  auto IsKeyCompressed() const -> bool;
+  auto GetPrefixSize() const -> int;
+  auto GetKeySize() const -> int;
+
+  // non-unique keys, see the header comment above
+  auto IsUnique() const -> bool;
+
+ protected:
+  static constexpr uint16_t LOW_KEY_FLAG = 1;
+  static constexpr uint16_t HIGH_KEY_FLAG = 2;
+  static constexpr uint16_t DELETED_FLAG = 4;
+  static constexpr uint16_t KEY_COMPRESSION_FLAG = 8;
+  static constexpr uint16_t NON_UNIQUE_FLAG = 16;
+
+  void SetLinkFlag(uint16_t flag) { link_flags_ |= flag; }
+  // the derived pages re-encode their keys whenever a fence changes
+  void ClearLowKey();
+  void ClearHighKey();
+
+  // max size as configured by the tree, the layout may only lower it
+  auto GetMaxSizeLimit() const -> int;
+  void SetKeyLayout(int prefix_size, int key_size, int max_size);
+
  private:
   // member variable, attributes that both internal and leaf page share
   IndexPageType page_type_ __attribute__((__unused__));
@@ -70,6 +130,11 @@ class BPlusTreePage {
   int max_size_ __attribute__((__unused__));
   page_id_t parent_page_id_ __attribute__((__unused__));
   page_id_t page_id_ __attribute__((__unused__));
+  page_id_t next_page_id_;
+  uint16_t link_flags_;
+  uint8_t prefix_size_;
+  uint8_t key_size_;
+  int layout_max_size_;
 };
 
 }  // namespace bustub
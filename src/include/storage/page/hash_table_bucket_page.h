@@ -33,6 +33,15 @@ namespace bustub {
  *  The above format omits the space required for the occupied_ and
  *  readable_ arrays. More information is in storage/page/hash_table_page_defs.h.
  *
+ *  overflow_page_id_ links the next overflow page of the bucket. Overflow pages
+ *  use the same format and hold the entries of a key whose run does not fit
+ *  in the bucket.
+ *
+ *  Every slot also keeps a one byte fingerprint of its key in fingerprints_.
+ *  Probes compare BUCKET_FINGERPRINT_GROUP fingerprints at a time (with SSE2
+ *  when available) and run the comparator only on readable slots whose
+ *  fingerprint matches.
+ *
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class HashTableBucketPage {
@@ -40,6 +49,23 @@ class HashTableBucketPage {
   // Delete all constructor / destructor to ensure memory safety
   HashTableBucketPage() = delete;
 
+  /**
+   * Initializes a newly allocated bucket page, which has no overflow page yet.
+   */
+  void Init();
+
+  /**
+   * @return the page id of the next overflow page, or INVALID_PAGE_ID if there is none
+   */
+  auto GetOverflowPageId() const -> page_id_t;
+
+  /**
+   * Sets the page id of the next overflow page.
+   *
+   * @param overflow_page_id the overflow page that follows this page
+   */
+  void SetOverflowPageId(page_id_t overflow_page_id);
+
   /**
    * Scan the bucket and collect values that have the matching key
    *
@@ -85,6 +111,16 @@ class HashTableBucketPage {
    */
   void RemoveAt(uint32_t bucket_idx);
 
+  /**
+   * Writes a KV pair into a free slot without looking for a duplicate pair.
+   * Used when filling a fresh bucket from pairs known to be distinct.
+   *
+   * @param bucket_idx a slot that is not readable
+   * @param key key to store
+   * @param value value to store
+   */
+  void InsertAt(uint32_t bucket_idx, const KeyType &key, const ValueType &value);
+
   /**
    * Returns whether or not an index is occupied (key/value pair or tombstone)
    *
@@ -146,11 +182,39 @@ class HashTableBucketPage {
   // std::vector<MappingType> GetAllItem();
   auto GetAllItem() -> std::vector<MappingType>;
 
+  /**
+   * @return the one byte fingerprint stored for key, derived from its bytes
+   */
+  static auto Fingerprint(const KeyType &key) -> uint8_t;
+
  private:
+  /**
+   * Collects the readable slots of one fingerprint group whose fingerprint equals fingerprint.
+   *
+   * @param group the group index, covering slots [group * BUCKET_FINGERPRINT_GROUP, ...)
+   * @param fingerprint the fingerprint to look for
+   * @return a bit mask over the slots of the group
+   */
+  auto MatchGroup(uint32_t group, uint8_t fingerprint) const -> uint32_t;
+
+  /**
+   * @return a bit mask over the slots of the group taken from bitmap (occupied_ or readable_)
+   */
+  auto GroupBits(const char *bitmap, uint32_t group) const -> uint32_t;
+
+  /**
+   * @return a bit mask with one bit set for each slot that exists in the group
+   */
+  auto GroupSlots(uint32_t group) const -> uint32_t;
+
+  page_id_t overflow_page_id_;
   //  For more on BUCKET_ARRAY_SIZE see storage/page/hash_table_page_defs.h
   char occupied_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
   // 0 if tombstone/brand new (never occupied), 1 otherwise.
   char readable_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
+  // 每个槽位key的指纹, 补齐到整组方便一次比较一组
+  uint8_t fingerprints_[(BUCKET_ARRAY_SIZE + BUCKET_FINGERPRINT_GROUP - 1) / BUCKET_FINGERPRINT_GROUP *
+                        BUCKET_FINGERPRINT_GROUP];
   // #define MappingType std::pair<KeyType, ValueType>
   MappingType array_[1];
 };
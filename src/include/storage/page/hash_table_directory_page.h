@@ -29,9 +29,13 @@ namespace bustub {
  * Directory Page for extendible hash table.
  *
  * Directory format (size in byte):
- * --------------------------------------------------------------------------------------------
- * | LSN (4) | PageId(4) | GlobalDepth(4) | LocalDepths(512) | BucketPageIds(2048) | Free(1524)
- * --------------------------------------------------------------------------------------------
+ * ----------------------------------------------------------------------------------------------------------------
+ * | LSN (4) | PageId(4) | GlobalDepth(4) | LocalDepths(512) | BucketPageIds(2048) | NextSegment(4) | Free(1520)
+ * ----------------------------------------------------------------------------------------------------------------
+ *
+ * A directory larger than DIRECTORY_ARRAY_SIZE entries is stored as a chain of
+ * segments, each one a directory page holding DIRECTORY_ARRAY_SIZE consecutive
+ * entries. Only the first segment's global depth is meaningful.
  */
 class HashTableDirectoryPage {
  public:
@@ -59,6 +63,18 @@ class HashTableDirectoryPage {
    */
   void SetLSN(lsn_t lsn);
 
+  /**
+   * @return the page ID of the next directory segment, or INVALID_PAGE_ID if this is the last one
+   */
+  auto GetNextSegmentPageId() const -> page_id_t;
+
+  /**
+   * Sets the page ID of the next directory segment
+   *
+   * @param page_id the page id of the segment that follows this one
+   */
+  void SetNextSegmentPageId(page_id_t page_id);
+
   /**
    * Lookup a bucket page using a directory index
    *
@@ -194,6 +210,7 @@ class HashTableDirectoryPage {
   uint32_t global_depth_{0};
   uint8_t local_depths_[DIRECTORY_ARRAY_SIZE];
   page_id_t bucket_page_ids_[DIRECTORY_ARRAY_SIZE];
+  page_id_t next_segment_page_id_;
 };
 
 }  // namespace bustub
@@ -26,10 +26,14 @@ namespace bustub {
  *
  * Header Page for linear probing hash table.
  *
- * Header format (size in byte, 16 bytes in total):
- * -------------------------------------------------------------
- * | LSN (4) | Size (4) | PageId(4) | NextBlockIndex(4)
- * -------------------------------------------------------------
+ * Header format (size in byte, 32 bytes in total):
+ * ------------------------------------------------------------------------------------
+ * | LSN (4) | Padding (4) | Size (8) | PageId(4) | NextPageId(4) | NextBlockIndex(8)
+ * ------------------------------------------------------------------------------------
+ *
+ * A table with more than HEADER_ARRAY_SIZE blocks lists them on a chain of
+ * header pages linked by NextPageId, each holding HEADER_ARRAY_SIZE
+ * consecutive block page ids. Only the first page's size is meaningful.
  */
 class HashTableHeaderPage {
  public:
@@ -57,6 +61,18 @@ class HashTableHeaderPage {
    */
   void SetPageId(page_id_t page_id);
 
+  /**
+   * @return the page ID of the next header page, or INVALID_PAGE_ID if this is the last one
+   */
+  auto GetNextPageId() const -> page_id_t;
+
+  /**
+   * Sets the page ID of the next header page
+   *
+   * @param page_id the page id of the header page that follows this one
+   */
+  void SetNextPageId(page_id_t page_id);
+
   /**
    * @return the lsn of this page
    */
@@ -89,13 +105,19 @@ class HashTableHeaderPage {
    */
   auto NumBlocks() -> size_t;
 
+  /**
+   * Removes all block page ids, so that the next AddBlockPageId stores the 0-th block
+   */
+  void ClearBlockPageIds();
+
  private:
-  __attribute__((unused)) lsn_t lsn_;
-  __attribute__((unused)) size_t size_;
-  __attribute__((unused)) page_id_t page_id_;
-  __attribute__((unused)) size_t next_ind_;
+  lsn_t lsn_;
+  size_t size_;
+  page_id_t page_id_;
+  page_id_t next_page_id_;
+  size_t next_ind_;
   // Flexible array member for page data.
-  __attribute__((unused)) page_id_t block_page_ids_[1];
+  page_id_t block_page_ids_[1];
 };
 
 }  // namespace bustub
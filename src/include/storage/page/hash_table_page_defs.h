@@ -28,6 +28,12 @@
  */
 #define BLOCK_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
 
+/**
+ * HEADER_ARRAY_SIZE is the number of block page ids a hash table header page can hold: the page minus the 32 bytes
+ * taken by its lsn, size, page id and block count fields and their padding.
+ */
+#define HEADER_ARRAY_SIZE ((PAGE_SIZE - 32) / sizeof(page_id_t))
+
 /**
  * Extendible Hashing Definitions
  */
@@ -37,8 +43,12 @@
 /**
  * BUCKET_ARRAY_SIZE is the number of (key, value) pairs that can be stored in an extendible hashing bucket page.
  * It is an approximate calculation based on the size of MappingType (which is a std::pair of KeyType and ValueType).
- * For each key/value pair, we need two additional bits for occupied_ and readable_. 4 * (PAGE_SIZE - 4) / (4 * sizeof
- * (MappingType) + 1) = (PAGE_SIZE - 4)/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required
- * to maintain the occupied and readable flags for a key value pair.
+ * For each key/value pair, we need two additional bits for occupied_ and readable_ and one byte for its fingerprint.
+ * 4 * (PAGE_SIZE - 32) / (4 * sizeof(MappingType) + 5) = (PAGE_SIZE - 32) / (sizeof(MappingType) + 1.25), where the
+ * 32 bytes cover the overflow page id, the padding of the fingerprint array to BUCKET_FINGERPRINT_GROUP and the
+ * alignment of the pairs.
  */
-#define BUCKET_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+#define BUCKET_ARRAY_SIZE (4 * (PAGE_SIZE - 32) / (4 * sizeof(MappingType) + 5))
+
+/** Number of fingerprints compared at once when probing a bucket page. */
+#define BUCKET_FINGERPRINT_GROUP 16
@@ -9,41 +9,200 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <numeric>
 #include <string>
+#include <type_traits>
 
 #include "common/exception.h"
 #include "common/logger.h"
 #include "common/rid.h"
 #include "storage/index/b_plus_tree.h"
+#include "storage/index/external_sorter.h"
 #include "storage/page/header_page.h"
 
 namespace bustub {
+
+namespace {
+// values of a posting list are ordered by their bytes
+template <typename ValueType>
+auto ValueLess(const ValueType &lhs, const ValueType &rhs) -> bool {
+  return memcmp(&lhs, &rhs, sizeof(ValueType)) < 0;
+}
+
+template <typename ValueType>
+auto ValueEqual(const ValueType &lhs, const ValueType &rhs) -> bool {
+  return memcmp(&lhs, &rhs, sizeof(ValueType)) == 0;
+}
+}  // namespace
+
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, bool compress_keys, bool unique_keys,
+                          int message_buffer_size)
     : index_name_(std::move(name)),
       root_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {}
+      internal_max_size_(internal_max_size),
+      compress_keys_(compress_keys),
+      unique_keys_(unique_keys),
+      rightmost_leaf_id_(INVALID_PAGE_ID),
+      message_buffer_size_(message_buffer_size),
+      buffered_messages_(0),
+      messages_(KeyLess{comparator}),
+      flush_epoch_(0),
+      message_log_page_id_(INVALID_PAGE_ID),
+      message_log_tail_(nullptr),
+      compaction_running_(false),
+      entry_count_(0),
+      leaf_count_(0),
+      height_(0),
+      statistics_page_id_(INVALID_PAGE_ID) {
+  // 叶子满了要在两个run之间分裂, 至少要放得下一个最长的run再多一项
+  if (!unique_keys_ && leaf_max_size_ < 3) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "leaves of a non-unique B+ tree need a max size of at least 3");
+  }
+  // 消息页要记在header page里, 名字得放得下
+  if (message_buffer_size_ > 0 && ("$" + index_name_).length() >= 32) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "the index name of a write-optimized B+ tree is too long");
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+BPLUSTREE_TYPE::~BPlusTree() {
+  StopCompaction();
+  // 消息页的尾页一直pin着, 写满或树销毁时才落盘
+  if (message_log_tail_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(message_log_tail_->GetPageId(), true);
+  }
+}
 
 /*
  * Helper function to decide whether current b+tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::IsEmpty() const -> bool { return true; }
+auto BPLUSTREE_TYPE::IsEmpty() const -> bool { return root_page_id_ == INVALID_PAGE_ID; }
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 /*
- * Return the only value that associated with input key
+ * Return the values associated with input key, the only one for unique trees
  * This method is used for point query
  * @return : true means key exists
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) -> bool {
-  return false;
+  if (message_buffer_size_ == 0) {
+    return LookupInTree(key, result);
+  }
+  std::vector<ValueType> values;
+  buffer_latch_.RLock();
+  LookupInTree(key, &values);
+  ApplyMessages(key, &values);
+  buffer_latch_.RUnlock();
+  result->insert(result->end(), values.begin(), values.end());
+  return !values.empty();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::LookupInTree(const KeyType &key, std::vector<ValueType> *result) -> bool {
+  Page *page = FindLeaf(key, Operation::FIND);
+  if (page == nullptr) {
+    return false;
+  }
+  bool found = LookupInLeaf(reinterpret_cast<LeafPage *>(page->GetData()), key, result);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  return found;
+}
+
+/*
+ * Batched point queries, results[i] receives the values of keys[i]. Keys are
+ * probed in sorted order so that consecutive keys of the same leaf share one
+ * descent: the read latched leaf is kept while the next key is within its
+ * fences, and a key just past its high key first tries the right sibling
+ * before going back to the root.
+ * @return : the number of keys that exist
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::GetValues(const std::vector<KeyType> &keys, std::vector<std::vector<ValueType>> *results,
+                               Transaction *transaction) -> int {
+  if (message_buffer_size_ == 0) {
+    return LookupBatchInTree(keys, results);
+  }
+  buffer_latch_.RLock();
+  LookupBatchInTree(keys, results);
+  int found = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    ApplyMessages(keys[i], &(*results)[i]);
+    found += static_cast<int>(!(*results)[i].empty());
+  }
+  buffer_latch_.RUnlock();
+  return found;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::LookupBatchInTree(const std::vector<KeyType> &keys, std::vector<std::vector<ValueType>> *results)
+    -> int {
+  results->assign(keys.size(), std::vector<ValueType>());
+  std::vector<size_t> order(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](size_t lhs, size_t rhs) { return comparator_(keys[lhs], keys[rhs]) < 0; });
+
+  int found = 0;
+  Page *page = nullptr;
+  for (size_t i : order) {
+    const KeyType &key = keys[i];
+    if (page != nullptr && reinterpret_cast<LeafPage *>(page->GetData())->IsBeyondHighKey(key, comparator_)) {
+      // 右兄弟也不包含key时才回到根重新下降
+      page_id_t next_page_id = reinterpret_cast<LeafPage *>(page->GetData())->GetNextPageId();
+      Page *next_page = next_page_id == INVALID_PAGE_ID ? nullptr : buffer_pool_manager_->FetchPage(next_page_id);
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      page = next_page;
+      if (page != nullptr) {
+        page->RLatch();
+        auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+        if (leaf->IsDeleted() || leaf->IsBelowLowKey(key, comparator_) || leaf->IsBeyondHighKey(key, comparator_)) {
+          page->RUnlatch();
+          buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+          page = nullptr;
+        }
+      }
+    }
+    if (page == nullptr && (page = FindLeaf(key, Operation::FIND)) == nullptr) {
+      return 0;
+    }
+    found += static_cast<int>(LookupInLeaf(reinterpret_cast<LeafPage *>(page->GetData()), key, &(*results)[i]));
+  }
+  if (page != nullptr) {
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
+  return found;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::LookupInLeaf(LeafPage *leaf, const KeyType &key, std::vector<ValueType> *result) -> bool {
+  if (unique_keys_) {
+    ValueType value;
+    if (!leaf->Lookup(key, &value, comparator_)) {
+      return false;
+    }
+    result->push_back(value);
+    return true;
+  }
+  int start = PostingListStart(leaf, key);
+  if (start == -1) {
+    return false;
+  }
+  ReadPostingList(leaf, start, result);
+  return true;
 }
 
 /*****************************************************************************
@@ -53,12 +212,27 @@ auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
  * Insert constant key & value pair into b+ tree
  * if current tree is empty, start new tree, update root page id and insert
  * entry, otherwise insert into leaf page.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * @return: false if the key (the pair for non-unique trees) is already there,
+ * otherwise true
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool {
-  return false;
+  if (message_buffer_size_ > 0) {
+    return BufferMessage(key, Message{MessageType::INSERT, value}, transaction);
+  }
+  root_latch_.RLock();
+  bool empty = IsEmpty();
+  root_latch_.RUnlock();
+  if (empty) {
+    root_latch_.WLock();
+    if (IsEmpty()) {
+      StartNewTree(key, value);
+      root_latch_.WUnlock();
+      return true;
+    }
+    root_latch_.WUnlock();
+  }
+  return InsertIntoLeaf(key, value, transaction);
 }
 /*
  * Insert constant key & value pair into an empty tree
@@ -67,19 +241,197 @@ auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
  * tree's root page id and insert entry directly into leaf page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {}
+void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
+  page_id_t root_page_id;
+  Page *page = buffer_pool_manager_->NewPage(&root_page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for root");
+  }
+  auto *root = reinterpret_cast<LeafPage *>(page->GetData());
+  root->Init(root_page_id, INVALID_PAGE_ID, leaf_max_size_, compress_keys_, unique_keys_);
+  root->Insert(key, value, comparator_);
+  root_page_id_ = root_page_id;
+  UpdateRootPageId(1);
+  entry_count_++;
+  leaf_count_ = 1;
+  height_ = 1;
+  buffer_pool_manager_->UnpinPage(root_page_id, true);
+}
 
 /*
  * Insert constant key & value pair into leaf page
  * User needs to first find the right leaf page as insertion target, then look
  * through leaf page to see whether insert key exist or not. If exist, return
  * immdiately, otherwise insert entry. Remember to deal with split if necessary.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * @return: false if the key (the pair for non-unique trees) is already there,
+ * otherwise true. A write-optimized non-unique tree returns true for a
+ * duplicate pair and drops it when the buffer is flushed.
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool {
-  return false;
+  const ValueType *match = unique_keys_ ? nullptr : &value;
+  // 乐观插入: 只锁叶子, 叶子不会分裂时直接插入; 追加到最右叶子时不用从根下降
+  Page *page = FetchRightmostLeaf(key);
+  if (page == nullptr) {
+    page = FindLeaf(key, Operation::INSERT);
+  }
+  if (page != nullptr) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    if (HasEntry(leaf, key, match)) {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      return false;
+    }
+    if (IsSafe(leaf, Operation::INSERT, key)) {
+      InsertEntry(leaf, key, value);
+      CacheRightmostLeaf(leaf);
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      return true;
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
+
+  // 悲观插入: 从根开始加写锁
+  Transaction local_transaction(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local_transaction;
+  }
+  page = FindLeafPessimistic(key, Operation::INSERT, transaction);
+  if (page == nullptr) {
+    StartNewTree(key, value);
+    ReleaseLatches(transaction, true);
+    return true;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  if (HasEntry(leaf, key, match)) {
+    ReleaseLatches(transaction, false);
+    return false;
+  }
+  if (!leaf->HasRoomFor(key)) {
+    // key让压缩叶子的槽变宽, 现有的item放不下了: 先分裂, 再插入覆盖key的那一半
+    LeafPage *new_leaf = Split(leaf, false);
+    InsertIntoParent(leaf, new_leaf->GetLowKey(), new_leaf, transaction);
+    InsertEntry(new_leaf->IsBelowLowKey(key, comparator_) ? leaf : new_leaf, key, value);
+    CacheRightmostLeaf(new_leaf);
+    buffer_pool_manager_->UnpinPage(new_leaf->GetPageId(), true);
+    CacheRightmostLeaf(leaf);
+    ReleaseLatches(transaction, true);
+    return true;
+  }
+  InsertEntry(leaf, key, value);
+  if (leaf->GetSize() >= leaf->GetMaxSize()) {
+    bool append = !leaf->HasHighKey() && comparator_(leaf->KeyAt(leaf->GetSize() - 1), key) == 0;
+    LeafPage *new_leaf = Split(leaf, append);
+    InsertIntoParent(leaf, new_leaf->GetLowKey(), new_leaf, transaction);
+    CacheRightmostLeaf(new_leaf);
+    buffer_pool_manager_->UnpinPage(new_leaf->GetPageId(), true);
+  }
+  CacheRightmostLeaf(leaf);
+  ReleaseLatches(transaction, true);
+  return true;
+}
+
+/*
+ * The append fast path. The cached page is pinned before rightmost_latch_ is
+ * dropped, and a leaf is forgotten under that latch before it is freed, so the
+ * page is still the leaf we cached; it is the rightmost leaf covering key as
+ * long as it was not merged away, has no high key and key is not below its
+ * low key. Anything else falls back to the descent.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FetchRightmostLeaf(const KeyType &key) -> Page * {
+  Page *page = nullptr;
+  {
+    std::scoped_lock lock(rightmost_latch_);
+    if (rightmost_leaf_id_ != INVALID_PAGE_ID) {
+      page = buffer_pool_manager_->FetchPage(rightmost_leaf_id_);
+    }
+  }
+  if (page == nullptr) {
+    return nullptr;
+  }
+  page->WLatch();
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  if (leaf->IsDeleted() || leaf->HasHighKey() || leaf->IsBelowLowKey(key, comparator_)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    return nullptr;
+  }
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::CacheRightmostLeaf(LeafPage *leaf) {
+  if (leaf->HasHighKey() || rightmost_leaf_id_ == leaf->GetPageId()) {
+    return;
+  }
+  std::scoped_lock lock(rightmost_latch_);
+  rightmost_leaf_id_ = leaf->GetPageId();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ForgetRightmostLeaf(page_id_t page_id) {
+  std::scoped_lock lock(rightmost_latch_);
+  if (rightmost_leaf_id_ == page_id) {
+    rightmost_leaf_id_ = INVALID_PAGE_ID;
+  }
+}
+
+/*
+ * Whether the leaf holds key, and for value != nullptr the pair
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::HasEntry(LeafPage *leaf, const KeyType &key, const ValueType *value) -> bool {
+  if (unique_keys_) {
+    ValueType old_value;
+    return leaf->Lookup(key, &old_value, comparator_) && (value == nullptr || ValueEqual(old_value, *value));
+  }
+  int start = PostingListStart(leaf, key);
+  if (start == -1 || value == nullptr) {
+    return start != -1;
+  }
+  std::vector<ValueType> values;
+  ReadPostingList(leaf, start, &values);
+  return std::any_of(values.begin(), values.end(), [value](const ValueType &v) { return ValueEqual(v, *value); });
+}
+
+/*
+ * Add a pair the leaf does not hold yet, taking at most one more slot. The
+ * values of a run are kept in byte order inline, which the iterator relies on
+ * to resume; once a run is full the rest go to its overflow pages unordered.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::InsertEntry(LeafPage *leaf, const KeyType &key, const ValueType &value) {
+  entry_count_++;
+  if (unique_keys_) {
+    leaf->Insert(key, value, comparator_);
+    return;
+  }
+  int start = PostingListStart(leaf, key);
+  if (start == -1) {
+    leaf->InsertAt(leaf->KeyIndex(key, comparator_), key, value);
+    return;
+  }
+  int end = leaf->RunEnd(start, comparator_);
+  if (end - start == leaf->PostingInlineMax()) {
+    AppendToOverflow(leaf->GetOverflowPageId(end - 1), value);
+    return;
+  }
+  if (end - start == leaf->PostingInlineMax() - 1) {
+    page_id_t page_id;
+    OverflowPage *overflow = NewOverflowPage(&page_id);
+    overflow->Append(value);
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    leaf->InsertOverflowAt(end, key, page_id);
+    return;
+  }
+  int index = start;
+  while (index < end && ValueLess(leaf->ValueAt(index), value)) {
+    index++;
+  }
+  leaf->InsertAt(index, key, value);
 }
 
 /*
@@ -88,11 +440,54 @@ auto BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
  * an "out of memory" exception if returned value is nullptr), then move half
  * of key & value pairs from input page to newly created page
+ * The new page is returned pinned but not latched: it is only reachable through
+ * pages the caller holds write latches on until those are released. Its low key
+ * is the separator to insert into the parent. An append split keeps 90% of the
+ * node, an internal node still leaves two children to the new one.
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-auto BPLUSTREE_TYPE::Split(N *node) -> N * {
-  return nullptr;
+auto BPLUSTREE_TYPE::Split(N *node, bool append) -> N * {
+  page_id_t new_page_id;
+  Page *new_page = buffer_pool_manager_->NewPage(&new_page_id);
+  if (new_page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for split");
+  }
+  auto *new_node = reinterpret_cast<N *>(new_page->GetData());
+  // 前keep个留在node里; 新节点先设好fence再接收key, 压缩的页才放得下
+  int keep = node->GetMinSize();
+  KeyType separator;
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    keep = node->SplitIndex(comparator_, append);
+    leaf_count_++;
+    new_node->Init(new_page_id, node->GetParentPageId(), leaf_max_size_, compress_keys_, unique_keys_);
+    separator = Separator(node->KeyAt(keep - 1), node->KeyAt(keep));
+  } else {
+    if (append) {
+      keep = std::max(keep, std::min(node->GetSize() * 9 / 10, node->GetSize() - 2));
+    }
+    new_node->Init(new_page_id, node->GetParentPageId(), internal_max_size_, compress_keys_);
+    separator = node->KeyAt(keep);
+  }
+  // B-link: 新节点挂在node右边, 接管node原来的high key
+  if (node->HasHighKey()) {
+    KeyType high_key = node->GetHighKey();
+    new_node->SetHighKey(high_key, comparator_);
+  }
+  new_node->SetLowKey(separator, comparator_);
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    node->MoveHalfTo(new_node, keep);
+  } else {
+    node->MoveHalfTo(new_node, keep, buffer_pool_manager_);
+  }
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    new_node->SetPrevPageId(node->GetPageId());
+    SetPrevLink(node->GetNextPageId(), new_page_id);
+  }
+  new_node->SetNextPageId(node->GetNextPageId());
+  node->SetNextPageId(new_page_id);
+  node->SetHighKey(separator, comparator_);
+  return new_node;
 }
 
 /*
@@ -103,23 +498,488 @@ auto BPLUSTREE_TYPE::Split(N *node) -> N * {
  * User needs to first find the parent page of old_node, parent node must be
  * adjusted to take info of new_node into account. Remember to deal with split
  * recursively if necessary.
+ * A compressed parent that would have to widen its slots past the page for the
+ * new key is split first and the key goes into the half that holds old_node.
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                                      Transaction *transaction) {}
+                                      Transaction *transaction) {
+  if (old_node->IsRootPage()) {
+    page_id_t root_page_id;
+    Page *page = buffer_pool_manager_->NewPage(&root_page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for root");
+    }
+    auto *root = reinterpret_cast<InternalPage *>(page->GetData());
+    root->Init(root_page_id, INVALID_PAGE_ID, internal_max_size_, compress_keys_);
+    root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+    old_node->SetParentPageId(root_page_id);
+    new_node->SetParentPageId(root_page_id);
+    root_page_id_ = root_page_id;
+    UpdateRootPageId(0);
+    height_++;
+    buffer_pool_manager_->UnpinPage(root_page_id, true);
+    return;
+  }
+  // 父节点不安全, 已经在page set里加了写锁
+  page_id_t parent_page_id = old_node->GetParentPageId();
+  auto *parent = reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent_page_id)->GetData());
+  if (!parent->HasRoomFor(key)) {
+    InternalPage *new_parent = Split(parent);
+    InternalPage *holder = new_parent->ValueIndex(old_node->GetPageId()) != -1 ? new_parent : parent;
+    holder->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+    new_node->SetParentPageId(holder->GetPageId());
+    InsertIntoParent(parent, new_parent->GetLowKey(), new_parent, transaction);
+    buffer_pool_manager_->UnpinPage(new_parent->GetPageId(), true);
+    buffer_pool_manager_->UnpinPage(parent_page_id, true);
+    return;
+  }
+  parent->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+  new_node->SetParentPageId(parent_page_id);
+  if (parent->GetSize() > parent->GetMaxSize()) {
+    bool append = !parent->HasHighKey() && parent->ValueAt(parent->GetSize() - 1) == new_node->GetPageId();
+    InternalPage *new_parent = Split(parent, append);
+    InsertIntoParent(parent, new_parent->GetLowKey(), new_parent, transaction);
+    buffer_pool_manager_->UnpinPage(new_parent->GetPageId(), true);
+  }
+  buffer_pool_manager_->UnpinPage(parent_page_id, true);
+}
+
+/*****************************************************************************
+ * MESSAGE BUFFER
+ *****************************************************************************/
+/*
+ * Queue a write of a write-optimized tree and append it to the message pages.
+ * Removes are blind. An insert has to report a duplicate key (pair for
+ * non-unique trees), so it reads the leaf and the pending messages under the
+ * shared latch first; only the queueing takes the write latch, and the leaf is
+ * read again there only if a flush ran in between.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::BufferMessage(const KeyType &key, const Message &message, Transaction *transaction) -> bool {
+  bool check_duplicate = message.type_ == MessageType::INSERT;
+  auto is_duplicate = [&](const std::vector<ValueType> &values) {
+    if (unique_keys_) {
+      return !values.empty();
+    }
+    return std::any_of(values.begin(), values.end(),
+                       [&](const ValueType &value) { return ValueEqual(value, message.value_); });
+  };
+  std::vector<ValueType> tree_values;
+  uint64_t flush_epoch = 0;
+  if (check_duplicate) {
+    buffer_latch_.RLock();
+    LookupInTree(key, &tree_values);
+    std::vector<ValueType> values = tree_values;
+    ApplyMessages(key, &values);
+    flush_epoch = flush_epoch_;
+    buffer_latch_.RUnlock();
+    if (is_duplicate(values)) {
+      return false;
+    }
+  }
+  buffer_latch_.WLock();
+  if (check_duplicate) {
+    // 叶子只在flush时改变, 没有flush过就不用再读一遍叶子, 只需要再看一遍buffer
+    if (flush_epoch != flush_epoch_) {
+      tree_values.clear();
+      LookupInTree(key, &tree_values);
+    }
+    ApplyMessages(key, &tree_values);
+    if (is_duplicate(tree_values)) {
+      buffer_latch_.WUnlock();
+      return false;
+    }
+  }
+  LogMessage(key, message);
+  messages_[key].push_back(message);
+  if (++buffered_messages_ >= message_buffer_size_) {
+    FlushMessagesLocked(transaction);
+  }
+  buffer_latch_.WUnlock();
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ApplyMessages(const KeyType &key, std::vector<ValueType> *values) const {
+  auto it = messages_.find(key);
+  if (it == messages_.end()) {
+    return;
+  }
+  for (const auto &message : it->second) {
+    auto match = std::find_if(values->begin(), values->end(),
+                              [&](const ValueType &value) { return ValueEqual(value, message.value_); });
+    switch (message.type_) {
+      case MessageType::INSERT:
+        if (match == values->end()) {
+          values->push_back(message.value_);
+        }
+        break;
+      case MessageType::REMOVE_PAIR:
+        if (match != values->end()) {
+          values->erase(match);
+        }
+        break;
+      case MessageType::REMOVE_KEY:
+        values->clear();
+        break;
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::FlushMessages(Transaction *transaction) {
+  if (message_buffer_size_ == 0) {
+    return;
+  }
+  buffer_latch_.WLock();
+  FlushMessagesLocked(transaction);
+  buffer_latch_.WUnlock();
+}
+
+/*
+ * Flush the whole buffer down in key order. Consecutive messages for the same
+ * leaf are applied under one write latch while they cannot split or merge it;
+ * the rest take the regular insert and remove paths.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::FlushMessagesLocked(Transaction *transaction) {
+  Page *page = nullptr;
+  for (const auto &[key, messages] : messages_) {
+    for (const auto &message : messages) {
+      ApplyMessage(key, message, &page, transaction);
+    }
+  }
+  if (page != nullptr) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  }
+  messages_.clear();
+  buffered_messages_ = 0;
+  flush_epoch_++;
+  TruncateMessageLog();
+}
+
+/*
+ * The tail page stays pinned while it fills: the buffer pool writes a page out
+ * whenever it is unpinned dirty, so each page goes to disk once when it is full
+ * rather than once per message.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogMessage(const KeyType &key, const Message &message) {
+  if (message_log_tail_ == nullptr) {
+    message_log_tail_ = buffer_pool_manager_->NewPage(&message_log_page_id_);
+    if (message_log_tail_ == nullptr) {
+      message_log_page_id_ = INVALID_PAGE_ID;
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for the message buffer");
+    }
+    reinterpret_cast<MessagePage *>(message_log_tail_->GetData())->Init(message_log_page_id_);
+    // 重开后没有LoadRootPageId的树会留下旧记录, 覆盖掉
+    std::string record_name = "$" + index_name_;
+    auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+    if (!header_page->InsertRecord(record_name, message_log_page_id_)) {
+      header_page->UpdateRecord(record_name, message_log_page_id_);
+    }
+    buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  }
+  auto *log = reinterpret_cast<MessagePage *>(message_log_tail_->GetData());
+  if (log->GetSize() == log->GetMaxSize()) {
+    page_id_t next_page_id;
+    Page *next_page = buffer_pool_manager_->NewPage(&next_page_id);
+    if (next_page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for the message buffer");
+    }
+    log->SetNextPageId(next_page_id);
+    buffer_pool_manager_->UnpinPage(message_log_tail_->GetPageId(), true);
+    message_log_tail_ = next_page;
+    log = reinterpret_cast<MessagePage *>(next_page->GetData());
+    log->Init(next_page_id);
+  }
+  log->Append(key, message.type_, message.value_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::TruncateMessageLog() {
+  if (message_log_tail_ == nullptr) {
+    return;
+  }
+  // 第一页留着接着用, 后面的页释放掉
+  if (message_log_tail_->GetPageId() != message_log_page_id_) {
+    buffer_pool_manager_->UnpinPage(message_log_tail_->GetPageId(), false);
+    message_log_tail_ = buffer_pool_manager_->FetchPage(message_log_page_id_);
+  }
+  auto *log = reinterpret_cast<MessagePage *>(message_log_tail_->GetData());
+  page_id_t page_id = log->GetNextPageId();
+  log->SetSize(0);
+  log->SetNextPageId(INVALID_PAGE_ID);
+  while (page_id != INVALID_PAGE_ID) {
+    page_id_t next_page_id =
+        reinterpret_cast<MessagePage *>(buffer_pool_manager_->FetchPage(page_id)->GetData())->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    buffer_pool_manager_->DeletePage(page_id);
+    page_id = next_page_id;
+  }
+}
+
+/*
+ * Rebuild the buffer from the message pages in arrival order. A tree that is
+ * not write-optimized, or whose buffer is already full, applies the messages
+ * to the leaves right away.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::LoadMessageLog() -> bool {
+  // 名字太长的树不可能是写优化的, 也就没有消息页
+  std::string record_name = "$" + index_name_;
+  if (record_name.length() >= 32) {
+    return false;
+  }
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  page_id_t page_id;
+  bool found = header_page->GetRootId(record_name, &page_id);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  if (!found) {
+    return false;
+  }
+  buffer_latch_.WLock();
+  if (message_log_tail_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(message_log_tail_->GetPageId(), true);
+  }
+  messages_.clear();
+  buffered_messages_ = 0;
+  message_log_page_id_ = page_id;
+  // 尾页读完后留着pin, 接着往里追加
+  for (;;) {
+    message_log_tail_ = buffer_pool_manager_->FetchPage(page_id);
+    auto *log = reinterpret_cast<MessagePage *>(message_log_tail_->GetData());
+    for (int i = 0; i < log->GetSize(); i++) {
+      const auto &message = log->MessageAt(i);
+      messages_[message.key_].push_back(Message{message.type_, message.value_});
+      buffered_messages_++;
+    }
+    if (log->GetNextPageId() == INVALID_PAGE_ID) {
+      break;
+    }
+    page_id = log->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(message_log_tail_->GetPageId(), false);
+  }
+  if (buffered_messages_ > 0 && buffered_messages_ >= message_buffer_size_) {
+    FlushMessagesLocked(nullptr);
+  }
+  // 不写消息的树不占着尾页
+  if (message_buffer_size_ == 0) {
+    buffer_pool_manager_->UnpinPage(message_log_tail_->GetPageId(), true);
+    message_log_tail_ = nullptr;
+  }
+  buffer_latch_.WUnlock();
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ApplyMessage(const KeyType &key, const Message &message, Page **page,
+                                  Transaction *transaction) {
+  const ValueType *value = message.type_ == MessageType::REMOVE_KEY ? nullptr : &message.value_;
+  Operation op = message.type_ == MessageType::INSERT ? Operation::INSERT : Operation::REMOVE;
+  // key 递增, 超出当前叶子的 high key 才换叶子
+  if (*page != nullptr && reinterpret_cast<LeafPage *>((*page)->GetData())->IsBeyondHighKey(key, comparator_)) {
+    (*page)->WUnlatch();
+    buffer_pool_manager_->UnpinPage((*page)->GetPageId(), true);
+    *page = nullptr;
+  }
+  if (*page == nullptr) {
+    *page = FindLeaf(key, op);
+  }
+  if (*page != nullptr) {
+    auto *leaf = reinterpret_cast<LeafPage *>((*page)->GetData());
+    if (op == Operation::INSERT) {
+      if (HasEntry(leaf, key, unique_keys_ ? nullptr : value)) {
+        return;
+      }
+      if (IsSafe(leaf, op, key)) {
+        InsertEntry(leaf, key, message.value_);
+        return;
+      }
+    } else {
+      while (HasEntry(leaf, key, value) && IsSafe(leaf, op, key)) {
+        RemoveFromLeaf(leaf, key, value);
+        if (value != nullptr || unique_keys_) {
+          return;
+        }
+      }
+      if (!HasEntry(leaf, key, value)) {
+        return;
+      }
+    }
+    (*page)->WUnlatch();
+    buffer_pool_manager_->UnpinPage((*page)->GetPageId(), true);
+    *page = nullptr;
+  }
+
+  // 叶子会分裂或合并, 走原来的插入删除
+  if (op == Operation::INSERT) {
+    InsertIntoLeaf(key, message.value_, transaction);
+  } else if (value != nullptr || unique_keys_) {
+    RemoveEntry(key, value, transaction);
+  } else {
+    while (RemoveEntry(key, nullptr, transaction)) {
+    }
+  }
+}
 
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
 /*
- * Delete key & value pair associated with input key
+ * Delete key & value pair associated with input key, every value of it for
+ * non-unique trees
  * If current tree is empty, return immdiately.
  * If not, User needs to first find the right leaf page as deletion target, then
  * delete entry from leaf page. Remember to deal with redistribute or merge if
  * necessary.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
+void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
+  if (message_buffer_size_ > 0) {
+    BufferMessage(key, Message{MessageType::REMOVE_KEY, ValueType()}, transaction);
+    return;
+  }
+  if (unique_keys_) {
+    RemoveEntry(key, nullptr, transaction);
+    return;
+  }
+  // 非唯一的key一次删一个槽, 每次最多让叶子少一项
+  while (RemoveEntry(key, nullptr, transaction)) {
+  }
+}
+
+/*
+ * Delete the key & value pair, unique trees only remove key if it maps to value
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Remove(const KeyType &key, const ValueType &value, Transaction *transaction) {
+  if (message_buffer_size_ > 0) {
+    BufferMessage(key, Message{MessageType::REMOVE_PAIR, value}, transaction);
+    return;
+  }
+  RemoveEntry(key, &value, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RemoveEntry(const KeyType &key, const ValueType *value, Transaction *transaction) -> bool {
+  // 乐观删除: 只锁叶子, 叶子不会合并时直接删除
+  Page *page = FindLeaf(key, Operation::REMOVE);
+  if (page == nullptr) {
+    return false;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  if (!HasEntry(leaf, key, value)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    return false;
+  }
+  if (IsSafe(leaf, Operation::REMOVE, key)) {
+    RemoveFromLeaf(leaf, key, value);
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+    return true;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+
+  // 悲观删除: 从根开始加写锁
+  Transaction local_transaction(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local_transaction;
+  }
+  page = FindLeafPessimistic(key, Operation::REMOVE, transaction);
+  if (page == nullptr) {
+    ReleaseLatches(transaction, false);
+    return false;
+  }
+  leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  if (!HasEntry(leaf, key, value)) {
+    ReleaseLatches(transaction, false);
+    return false;
+  }
+  RemoveFromLeaf(leaf, key, value);
+  CoalesceOrRedistribute(leaf, transaction);
+  ReleaseLatches(transaction, true);
+  auto deleted_page_set = transaction->GetDeletedPageSet();
+  for (page_id_t page_id : *deleted_page_set) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  deleted_page_set->clear();
+  return true;
+}
+
+/*
+ * Remove an entry HasEntry found, taking at most one slot off the leaf. An
+ * inline value of a full run is replaced by one from its overflow pages.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RemoveFromLeaf(LeafPage *leaf, const KeyType &key, const ValueType *value) {
+  entry_count_--;
+  if (unique_keys_) {
+    leaf->RemoveAndDeleteRecord(key, comparator_);
+    return;
+  }
+  int start = PostingListStart(leaf, key);
+  int end = leaf->RunEnd(start, comparator_);
+  bool overflowed = end - start == leaf->PostingInlineMax();
+  page_id_t head = overflowed ? leaf->GetOverflowPageId(end - 1) : INVALID_PAGE_ID;
+  if (value == nullptr) {
+    if (overflowed) {
+      // 溢出页上的value和指向它的槽一起删掉, 槽本身不算一个value
+      entry_count_ -= FreeOverflow(head) - 1;
+    }
+    leaf->RemoveAt(end - 1);
+    return;
+  }
+  int inline_end = overflowed ? end - 1 : end;
+  int index = start;
+  while (index < inline_end && !ValueEqual(leaf->ValueAt(index), *value)) {
+    index++;
+  }
+  if (index < inline_end) {
+    leaf->RemoveAt(index);
+    if (!overflowed) {
+      return;
+    }
+    // 从溢出页补一个回来, 溢出页空了就去掉指向它的槽
+    ValueType refill;
+    bool freed = PopFromOverflow(head, &refill);
+    index = start;
+    while (index < inline_end - 1 && ValueLess(leaf->ValueAt(index), refill)) {
+      index++;
+    }
+    leaf->InsertAt(index, key, refill);
+    if (freed) {
+      leaf->RemoveAt(end - 1);
+    }
+    return;
+  }
+  // 在溢出页上: 用链表最后一个value填上它的位置
+  page_id_t page_id = head;
+  int position = -1;
+  while (position == -1) {
+    auto *overflow = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+    position = overflow->ValueIndex(*value);
+    page_id_t next_page_id = overflow->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    if (position == -1) {
+      page_id = next_page_id;
+    }
+  }
+  ValueType last;
+  if (PopFromOverflow(head, &last)) {
+    leaf->RemoveAt(end - 1);
+    return;
+  }
+  if (!ValueEqual(last, *value)) {
+    auto *overflow = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+    overflow->SetValueAt(position, last);
+    buffer_pool_manager_->UnpinPage(page_id, true);
+  }
+}
 
 /*
  * User needs to first find the sibling of input page. If sibling's size + input
@@ -131,7 +991,51 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 auto BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) -> bool {
-  return false;
+  if (node->IsRootPage()) {
+    if (AdjustRoot(node)) {
+      transaction->AddIntoDeletedPageSet(node->GetPageId());
+      return true;
+    }
+    return false;
+  }
+  if (node->GetSize() >= node->GetMinSize()) {
+    return false;
+  }
+  page_id_t parent_page_id = node->GetParentPageId();
+  auto *parent = reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent_page_id)->GetData());
+  int index = parent->ValueIndex(node->GetPageId());
+  // 优先找左兄弟, 最左边的孩子找右兄弟
+  page_id_t neighbor_page_id = parent->ValueAt(index == 0 ? 1 : index - 1);
+  Page *neighbor_page = buffer_pool_manager_->FetchPage(neighbor_page_id);
+  neighbor_page->WLatch();
+  auto *neighbor_node = reinterpret_cast<N *>(neighbor_page->GetData());
+
+  bool node_deleted = false;
+  int total_size = neighbor_node->GetSize() + node->GetSize();
+  // 合并后的节点覆盖左右两边的范围, 压缩的页前缀可能变短、能放的key变少
+  N *left = index == 0 ? node : neighbor_node;
+  N *right = index == 0 ? neighbor_node : node;
+  const KeyType *low = left->HasLowKey() ? &left->GetLowKey() : nullptr;
+  const KeyType *high = right->HasHighKey() ? &right->GetHighKey() : nullptr;
+  bool fits;
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    // 叶子满了就分裂, 所以叶子合并后要严格小于max size
+    fits = total_size < left->GetMaxSizeFor(low, high, right->GetKeyEnd(), comparator_);
+  } else {
+    KeyType middle_key = parent->KeyAt(parent->ValueIndex(right->GetPageId()));
+    int key_end = std::max(right->GetKeyEnd(), InternalPage::KeyEnd(middle_key));
+    fits = total_size <= left->GetMaxSizeFor(low, high, key_end, comparator_);
+  }
+  if (fits) {
+    node_deleted = index != 0;
+    Coalesce(&neighbor_node, &node, &parent, index, transaction);
+  } else {
+    Redistribute(neighbor_node, node, index);
+  }
+  neighbor_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(neighbor_page_id, true);
+  buffer_pool_manager_->UnpinPage(parent_page_id, true);
+  return node_deleted;
 }
 
 /*
@@ -140,6 +1044,8 @@ auto BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) -
  * take info of deletion into account. Remember to deal with coalesce or
  * redistribute recursively if necessary.
  * Using template N to represent either internal page or leaf page.
+ * The right page is always merged into the left one, so that the right-sibling
+ * links of the level stay intact for concurrent readers.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
  * @param   parent             parent page of input "node"
@@ -151,7 +1057,36 @@ template <typename N>
 auto BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
                               BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent, int index,
                               Transaction *transaction) -> bool {
-  return false;
+  if (index == 0) {
+    std::swap(*neighbor_node, *node);
+  }
+  N *left = *neighbor_node;
+  N *right = *node;
+  int right_index = (*parent)->ValueIndex(right->GetPageId());
+  page_id_t next_page_id = right->GetNextPageId();
+  // 先放宽左节点的high key, 压缩的页按新的前缀接收右边的key
+  if (right->HasHighKey()) {
+    left->SetHighKey(right->GetHighKey(), comparator_);
+  } else {
+    left->ClearHighKey(comparator_);
+  }
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    right->MoveAllTo(left);
+  } else {
+    right->MoveAllTo(left, (*parent)->KeyAt(right_index), buffer_pool_manager_);
+  }
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    SetPrevLink(next_page_id, left->GetPageId());
+    ForgetRightmostLeaf(right->GetPageId());
+    leaf_count_--;
+  }
+  left->SetNextPageId(next_page_id);
+  // 被删除的节点指向合并后的左节点, 停在它上面的迭代器可以接着往右走
+  right->SetNextPageId(left->GetPageId());
+  right->SetDeleted();
+  transaction->AddIntoDeletedPageSet(right->GetPageId());
+  (*parent)->Remove(right_index);
+  return CoalesceOrRedistribute(*parent, transaction);
 }
 
 /*
@@ -160,13 +1095,73 @@ auto BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
  * otherwise move sibling page's last key & value pair into head of input
  * "node".
  * Using template N to represent either internal page or leaf page.
+ * Fences are widened before a key moves in and narrowed after it moved out.
+ * A compressed node whose wider range no longer takes the key, a parent
+ * without room for the new separator, or a move that would cut a run of a
+ * non-unique key, leave the node under-full instead, which the B-link search
+ * tolerates.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
-/*
+void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
+  page_id_t parent_page_id = node->GetParentPageId();
+  auto *parent = reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent_page_id)->GetData());
+  const KeyType *low = node->HasLowKey() ? &node->GetLowKey() : nullptr;
+  const KeyType *high = node->HasHighKey() ? &node->GetHighKey() : nullptr;
+  int last = neighbor_node->GetSize() - 1;
+  bool fits;
+  KeyType separator;
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    // 非唯一的key不能拆到两个叶子上
+    int moved = index == 0 ? 0 : last;
+    int remaining = index == 0 ? 1 : last - 1;
+    if (!unique_keys_ && comparator_(neighbor_node->KeyAt(moved), neighbor_node->KeyAt(remaining)) == 0) {
+      buffer_pool_manager_->UnpinPage(parent_page_id, false);
+      return;
+    }
+    separator = index == 0 ? Separator(neighbor_node->KeyAt(0), neighbor_node->KeyAt(1))
+                           : Separator(neighbor_node->KeyAt(last - 1), neighbor_node->KeyAt(last));
+    int key_end = LeafPage::KeyEnd(neighbor_node->KeyAt(moved));
+    int max_size = index == 0 ? node->GetMaxSizeFor(low, &separator, key_end, comparator_)
+                              : node->GetMaxSizeFor(&separator, high, key_end, comparator_);
+    fits = node->GetSize() + 1 < max_size;
+  } else {
+    // 内部节点的分隔key就是孩子的fence, 不能截断
+    separator = neighbor_node->KeyAt(index == 0 ? 1 : last);
+    KeyType middle_key = parent->KeyAt(index == 0 ? 1 : index);
+    int key_end = std::max(InternalPage::KeyEnd(middle_key), InternalPage::KeyEnd(separator));
+    int max_size = index == 0 ? node->GetMaxSizeFor(low, &separator, key_end, comparator_)
+                              : node->GetMaxSizeFor(&separator, high, key_end, comparator_);
+    fits = node->GetSize() + 1 <= max_size;
+  }
+  if (!fits || !parent->HasRoomFor(separator)) {
+    buffer_pool_manager_->UnpinPage(parent_page_id, false);
+    return;
+  }
+  if (index == 0) {
+    node->SetHighKey(separator, comparator_);
+    if constexpr (std::is_same_v<N, LeafPage>) {
+      neighbor_node->MoveFirstToEndOf(node);
+    } else {
+      neighbor_node->MoveFirstToEndOf(node, parent->KeyAt(1), buffer_pool_manager_);
+    }
+    neighbor_node->SetLowKey(separator, comparator_);
+    parent->SetKeyAt(1, separator);
+  } else {
+    node->SetLowKey(separator, comparator_);
+    if constexpr (std::is_same_v<N, LeafPage>) {
+      neighbor_node->MoveLastToFrontOf(node);
+    } else {
+      neighbor_node->MoveLastToFrontOf(node, parent->KeyAt(index), buffer_pool_manager_);
+    }
+    neighbor_node->SetHighKey(separator, comparator_);
+    parent->SetKeyAt(index, separator);
+  }
+  buffer_pool_manager_->UnpinPage(parent_page_id, true);
+}
+/*
  * Update root page if necessary
  * NOTE: size of root page can be less than min size and this method is only
  * called within coalesceOrRedistribute() method
@@ -177,18 +1172,846 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
  * happend
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) -> bool { return false; }
+auto BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) -> bool {
+  if (old_root_node->IsLeafPage()) {
+    if (old_root_node->GetSize() > 0) {
+      return false;
+    }
+    root_page_id_ = INVALID_PAGE_ID;
+    UpdateRootPageId(0);
+    ForgetRightmostLeaf(old_root_node->GetPageId());
+    leaf_count_ = 0;
+    height_ = 0;
+    old_root_node->SetDeleted();
+    return true;
+  }
+  if (old_root_node->GetSize() > 1) {
+    return false;
+  }
+  page_id_t child_page_id = reinterpret_cast<InternalPage *>(old_root_node)->RemoveAndReturnOnlyChild();
+  auto *child = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(child_page_id)->GetData());
+  child->SetParentPageId(INVALID_PAGE_ID);
+  buffer_pool_manager_->UnpinPage(child_page_id, true);
+  root_page_id_ = child_page_id;
+  UpdateRootPageId(0);
+  height_--;
+  old_root_node->SetDeleted();
+  return true;
+}
+
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+/*
+ * Build the tree bottom-up instead of inserting pair by pair: leaves are packed
+ * left to right, then each internal level is built over the one below, so
+ * every level ends up on consecutively allocated pages and no page is ever
+ * split. Unsorted input is run through an external merge sort first, spilling
+ * runs of one buffer pool's worth of entries.
+ * Duplicate keys keep their first value. A non-unique tree keeps each distinct
+ * pair once: it needs the values of a key in byte order as well, which the
+ * external sort provides, and writes each posting list's first
+ * PostingInlineMax - 1 values into the leaf and the rest straight into its
+ * overflow chain.
+ * @param   fill_factor   fraction of a page to fill, clamped so that every
+ * page is at least half full and a leaf does not split on its next insert
+ * @return: false if the tree is not empty, in which case next is not called
+ * when the load starts, or if sorted input turns out to be out of order; the
+ * tree is left empty in that case
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::BulkLoad(const std::function<bool(MappingType *)> &next, bool sorted, double fill_factor)
+    -> bool {
+  FlushMessages();
+  // 树不空时不读输入, 调用者还可以把它逐条插入
+  root_latch_.RLock();
+  bool empty = IsEmpty();
+  root_latch_.RUnlock();
+  if (!empty) {
+    return false;
+  }
+  std::function<bool(MappingType *)> source = next;
+  std::unique_ptr<ExternalSorter<KeyType, ValueType, KeyComparator>> sorter;
+  if (!sorted) {
+    size_t run_size = buffer_pool_manager_->GetPoolSize() * (PAGE_SIZE / sizeof(MappingType));
+    sorter = std::make_unique<ExternalSorter<KeyType, ValueType, KeyComparator>>(buffer_pool_manager_, comparator_,
+                                                                                 run_size, !unique_keys_);
+    MappingType item;
+    while (next(&item)) {
+      sorter->Add(item);
+    }
+    sorter->Finish();
+    source = [&sorter](MappingType *item) { return sorter->Next(item); };
+  }
+
+  root_latch_.WLock();
+  if (!IsEmpty()) {
+    root_latch_.WUnlock();
+    return false;
+  }
+  // leaf level: (low key, page id) of every leaf
+  std::vector<std::pair<KeyType, page_id_t>> level;
+  Page *prev_page = nullptr;
+  Page *cur_page = nullptr;
+  LeafPage *prev = nullptr;
+  LeafPage *cur = nullptr;
+  // 攒够一页再建叶子, 压缩时叶子的容量要等知道它的fence才能算出来
+  std::vector<MappingType> pending;
+  int64_t loaded = 0;
+  KeyType low;
+  bool has_low = false;
+  // 非唯一的树: 一个key的值按字节序来, 前PostingInlineMax-1个进叶子, 其余的直接写进它的溢出页链
+  int posting_max = LeafPage::PostingInlineMaxFor(leaf_max_size_);
+  int run_length = 0;
+  ValueType last_value;
+  OverflowPage *overflow = nullptr;
+  std::vector<page_id_t> overflow_page_ids;
+  auto append_overflow = [&](const KeyType &key, const ValueType &value) {
+    if (overflow == nullptr || overflow->GetSize() == overflow->GetMaxSize()) {
+      page_id_t page_id;
+      auto *page = reinterpret_cast<OverflowPage *>(NewBulkLoadPage(&page_id)->GetData());
+      page->Init(page_id);
+      if (overflow == nullptr) {
+        pending.emplace_back(key, LeafPage::OverflowSlotValue(page_id));
+      } else {
+        overflow->SetNextPageId(page_id);
+        buffer_pool_manager_->UnpinPage(overflow_page_ids.back(), true);
+      }
+      overflow = page;
+      overflow_page_ids.push_back(page_id);
+    }
+    overflow->Append(value);
+  };
+  auto close_overflow = [&]() {
+    if (overflow != nullptr) {
+      buffer_pool_manager_->UnpinPage(overflow_page_ids.back(), true);
+      overflow = nullptr;
+    }
+  };
+  // 压缩时叶子的槽宽取决于最宽的key, pending_key_end是pending里最宽的key的结尾
+  int pending_key_end = 0;
+  auto key_end_of = [&](int size) {
+    int key_end = 0;
+    for (int i = 0; compress_keys_ && i < size; i++) {
+      key_end = std::max(key_end, LeafPage::KeyEnd(pending[i].first));
+    }
+    return key_end;
+  };
+  auto leaf_max_size = [&](const KeyType *high, int key_end) {
+    if (!compress_keys_) {
+      return leaf_max_size_;
+    }
+    int prefix_size = has_low && high != nullptr ? comparator_.CommonPrefixLength(low, *high) : 0;
+    return LeafPage::MaxSizeFor(prefix_size, key_end, leaf_max_size_);
+  };
+  auto leaf_target = [&](const KeyType *high, int key_end) {
+    int max_size = leaf_max_size(high, key_end);
+    return std::clamp(static_cast<int>(fill_factor * (max_size - 1)), std::max(1, max_size / 2), max_size - 1);
+  };
+  // 非唯一的树不把一个key的posting list拆到两个叶子: size退到它所在的run的开头
+  auto run_start = [&](int size) {
+    while (size > 0 && size < static_cast<int>(pending.size()) &&
+           comparator_(pending[size - 1].first, pending[size].first) == 0) {
+      size--;
+    }
+    return size;
+  };
+  // 用pending的前size个建一个叶子, high为nullptr表示最后一个叶子
+  auto emit = [&](int size, const KeyType *high) {
+    page_id_t page_id;
+    Page *page = NewBulkLoadPage(&page_id);
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    leaf->Init(page_id, INVALID_PAGE_ID, leaf_max_size_, compress_keys_, unique_keys_);
+    if (has_low) {
+      leaf->SetLowKey(low, comparator_);
+    }
+    if (high != nullptr) {
+      leaf->SetHighKey(*high, comparator_);
+    }
+    leaf->CopyNFrom(pending.data(), size);
+    level.emplace_back(has_low ? low : pending[0].first, page_id);
+    if (cur != nullptr) {
+      cur->SetNextPageId(page_id);
+      leaf->SetPrevPageId(cur->GetPageId());
+      if (prev_page != nullptr) {
+        buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+      }
+      prev_page = cur_page;
+      prev = cur;
+    }
+    cur_page = page;
+    cur = leaf;
+    pending.erase(pending.begin(), pending.begin() + size);
+    pending_key_end = key_end_of(pending.size());
+    if (high != nullptr) {
+      low = *high;
+      has_low = true;
+    }
+  };
+  // 用pending的前size个建叶子, 下一个key是next; 截断后的分隔key让前缀变短、宽的key让槽变宽时少放几个
+  auto emit_fitting = [&](int size, const KeyType &next) {
+    KeyType high = Separator(pending[size - 1].first, next);
+    while (size >= leaf_max_size(&high, key_end_of(size))) {
+      size = run_start(size - 1);
+      high = Separator(pending[size - 1].first, pending[size].first);
+    }
+    emit(size, &high);
+  };
+  MappingType item;
+  while (source(&item)) {
+    if (!pending.empty()) {
+      int cmp = comparator_(item.first, pending.back().first);
+      bool new_key = cmp != 0;
+      if (!new_key && !unique_keys_) {
+        cmp = ValueEqual(item.second, last_value) ? 0 : (ValueLess(item.second, last_value) ? -1 : 1);
+      }
+      if (cmp == 0) {
+        continue;
+      }
+      if (cmp < 0) {
+        // 输入没有排好序, 丢掉已经建好的页
+        if (prev_page != nullptr) {
+          buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), false);
+        }
+        if (cur_page != nullptr) {
+          buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+        }
+        close_overflow();
+        for (const auto &leaf : level) {
+          buffer_pool_manager_->DeletePage(leaf.second);
+        }
+        for (auto page_id : overflow_page_ids) {
+          buffer_pool_manager_->DeletePage(page_id);
+        }
+        root_latch_.WUnlock();
+        return false;
+      }
+      if (new_key) {
+        close_overflow();
+        run_length = 0;
+        if (static_cast<int>(pending.size()) >= leaf_target(&item.first, pending_key_end)) {
+          emit_fitting(pending.size(), item.first);
+        }
+      }
+    }
+    loaded++;
+    last_value = item.second;
+    if (!unique_keys_ && ++run_length >= posting_max) {
+      append_overflow(item.first, item.second);
+    } else {
+      pending.push_back(item);
+    }
+    if (compress_keys_) {
+      pending_key_end = std::max(pending_key_end, LeafPage::KeyEnd(item.first));
+    }
+  }
+  close_overflow();
+  while (!pending.empty() && static_cast<int>(pending.size()) >= leaf_max_size(nullptr, pending_key_end)) {
+    int size = run_start(pending.size() - leaf_target(nullptr, pending_key_end));
+    if (size == 0) {
+      // 第一个run就跨过了切分点, 切在它后面
+      size = 1;
+      while (comparator_(pending[size - 1].first, pending[size].first) == 0) {
+        size++;
+      }
+    }
+    emit_fitting(size, pending[size].first);
+  }
+  if (!pending.empty()) {
+    emit(pending.size(), nullptr);
+  }
+  if (cur == nullptr) {
+    root_latch_.WUnlock();
+    return true;
+  }
+
+  // 最后一个叶子不够半满时, 和前一个叶子合并或者平分
+  if (prev != nullptr && cur->GetSize() < cur->GetMinSize()) {
+    int total = prev->GetSize() + cur->GetSize();
+    const KeyType *prev_low = prev->HasLowKey() ? &prev->GetLowKey() : nullptr;
+    // 最后一个叶子没有high key, 没有前缀
+    int cur_max_size = cur->GetMaxSizeFor(nullptr, nullptr, prev->GetKeyEnd(), comparator_);
+    if (total < prev->GetMaxSizeFor(prev_low, nullptr, cur->GetKeyEnd(), comparator_)) {
+      prev->ClearHighKey(comparator_);
+      cur->MoveAllTo(prev);
+      buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
+      buffer_pool_manager_->DeletePage(cur_page->GetPageId());
+      level.pop_back();
+      cur_page = nullptr;
+    } else if (int move = std::min(total / 2, cur_max_size - 1) - cur->GetSize(); move > 0) {
+      // 非唯一的树从posting list的开头切, 最后一个叶子放不下时切在它的结尾
+      int keep = prev->GetSize() - move;
+      int start = keep;
+      while (start > 0 && comparator_(prev->KeyAt(start - 1), prev->KeyAt(start)) == 0) {
+        start--;
+      }
+      bool fits = start > 0 && cur->GetSize() + prev->GetSize() - start < cur_max_size;
+      keep = fits ? start : prev->RunEnd(keep, comparator_);
+      if (keep < prev->GetSize()) {
+        KeyType separator = Separator(prev->KeyAt(keep - 1), prev->KeyAt(keep));
+        cur->SetLowKey(separator, comparator_);
+        while (prev->GetSize() > keep) {
+          prev->MoveLastToFrontOf(cur);
+        }
+        prev->SetHighKey(separator, comparator_);
+        level.back().first = separator;
+      }
+    }
+  }
+  if (prev_page != nullptr) {
+    buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+  }
+  if (cur_page != nullptr) {
+    buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
+  }
+
+  entry_count_ = loaded;
+  leaf_count_ = level.size();
+  height_ = 1;
+  while (level.size() > 1) {
+    level = BuildInternalLevel(std::move(level), fill_factor);
+    height_++;
+  }
+  root_page_id_ = level[0].second;
+  UpdateRootPageId(1);
+  root_latch_.WUnlock();
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::BuildInternalLevel(std::vector<std::pair<KeyType, page_id_t>> children, double fill_factor)
+    -> std::vector<std::pair<KeyType, page_id_t>> {
+  // 先算好每个节点的孩子数, 最后一个节点不够半满时和前一个合并或者平分
+  // 压缩的内部节点按整宽的key装, 设好fence后前缀只会让它更空
+  int max_size = compress_keys_ ? InternalPage::MaxSizeFor(0, sizeof(KeyType), internal_max_size_) : internal_max_size_;
+  int min_size = (max_size + 1) / 2;
+  int target = std::clamp(static_cast<int>(fill_factor * max_size), std::max(2, min_size), max_size);
+  std::vector<int> sizes;
+  for (int remaining = static_cast<int>(children.size()); remaining > 0; remaining -= sizes.back()) {
+    sizes.push_back(std::min(target, remaining));
+  }
+  if (sizes.size() > 1 && sizes.back() < min_size) {
+    int total = sizes[sizes.size() - 2] + sizes.back();
+    sizes.pop_back();
+    if (total <= max_size) {
+      sizes.back() = total;
+    } else {
+      sizes.back() = total - total / 2;
+      sizes.push_back(total / 2);
+    }
+  }
+
+  std::vector<std::pair<KeyType, page_id_t>> level;
+  InternalPage *prev = nullptr;
+  int offset = 0;
+  for (int size : sizes) {
+    page_id_t page_id;
+    auto *node = reinterpret_cast<InternalPage *>(NewBulkLoadPage(&page_id)->GetData());
+    node->Init(page_id, INVALID_PAGE_ID, internal_max_size_, compress_keys_);
+    node->CopyNFrom(children.data() + offset, size, buffer_pool_manager_);
+    if (prev != nullptr) {
+      prev->SetNextPageId(page_id);
+      prev->SetHighKey(children[offset].first, comparator_);
+      node->SetLowKey(children[offset].first, comparator_);
+      buffer_pool_manager_->UnpinPage(prev->GetPageId(), true);
+    }
+    level.emplace_back(children[offset].first, page_id);
+    prev = node;
+    offset += size;
+  }
+  buffer_pool_manager_->UnpinPage(prev->GetPageId(), true);
+  return level;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::NewBulkLoadPage(page_id_t *page_id) -> Page * {
+  Page *page = buffer_pool_manager_->NewPage(page_id);
+  if (page == nullptr) {
+    root_latch_.WUnlock();
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for bulk load");
+  }
+  return page;
+}
+
+/*****************************************************************************
+ * COMPACTION
+ *****************************************************************************/
+/*
+ * Walk the tree left to right one window of leaves at a time, see
+ * CompactWindow. Concurrent inserts and removes go on meanwhile; a window
+ * that changed since it was passed is simply not revisited.
+ * @return: number of leaf pages freed
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::Compact(double fill_factor) -> int {
+  int freed = 0;
+  KeyType key;
+  bool has_key = false;
+  do {
+    freed += CompactWindow(has_key ? &key : nullptr, fill_factor, &key, &has_key);
+  } while (has_key);
+  return freed;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::StartCompaction(double fill_factor) {
+  if (compaction_running_.exchange(true)) {
+    return;
+  }
+  compaction_thread_ = std::thread([this, fill_factor]() {
+    std::unique_lock<std::mutex> lock(compaction_latch_);
+    while (!compaction_cv_.wait_for(lock, compaction_interval, [this]() { return !compaction_running_; })) {
+      lock.unlock();
+      Compact(fill_factor);
+      lock.lock();
+    }
+  });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::StopCompaction() {
+  {
+    std::lock_guard<std::mutex> guard(compaction_latch_);
+    compaction_running_ = false;
+  }
+  compaction_cv_.notify_all();
+  if (compaction_thread_.joinable()) {
+    compaction_thread_.join();
+  }
+}
+
+/*
+ * Rewrite the leaves from the one covering key to the right, at most a quarter
+ * of the buffer pool of them and all under one bottom internal node, into as
+ * few new pages as fill_factor allows. The path from the root is write
+ * latched like a pessimistic write until the window, its left and right
+ * neighbours are latched, so a writer that is restructuring next to the window
+ * cannot wait on it while holding what we wait for; only the bottom internal
+ * node stays latched while the pages are rewritten.
+ * The window keeps its fences and posting lists stay in one leaf, so the
+ * parent just swaps the old children for the new ones. A window is left alone
+ * unless it saves a page, or if the parent would drop below its min size.
+ * @return: number of leaf pages freed
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::CompactWindow(const KeyType *key, double fill_factor, KeyType *next_key, bool *has_next)
+    -> int {
+  *has_next = false;
+  std::vector<Page *> path;
+  root_latch_.WLock();
+  if (IsEmpty()) {
+    root_latch_.WUnlock();
+    return 0;
+  }
+  auto release_path = [&]() {
+    root_latch_.WUnlock();
+    for (Page *page : path) {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    }
+    path.clear();
+  };
+  Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+  page->WLatch();
+  path.push_back(page);
+  InternalPage *parent = nullptr;
+  int start = 0;
+  while (parent == nullptr) {
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (node->IsLeafPage()) {
+      release_path();
+      return 0;
+    }
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    page_id_t child_page_id = key == nullptr ? internal->ValueAt(0) : internal->Lookup(*key, comparator_);
+    Page *child = buffer_pool_manager_->FetchPage(child_page_id);
+    if (reinterpret_cast<BPlusTreePage *>(child->GetData())->IsLeafPage()) {
+      buffer_pool_manager_->UnpinPage(child_page_id, false);
+      parent = internal;
+      start = internal->ValueIndex(child_page_id);
+    } else {
+      child->WLatch();
+      path.push_back(child);
+      page = child;
+    }
+  }
+  // 父节点里窗口后面的分隔key就是窗口最后一个叶子的high key
+  int max_window = std::max(2, static_cast<int>(buffer_pool_manager_->GetPoolSize()) / 4);
+  int window = std::min(parent->GetSize() - start, max_window);
+  if (start + window < parent->GetSize()) {
+    *next_key = parent->KeyAt(start + window);
+    *has_next = true;
+  } else if (parent->HasHighKey()) {
+    *next_key = parent->GetHighKey();
+    *has_next = true;
+  }
+  if (window < 2) {
+    release_path();
+    return 0;
+  }
+
+  // 先锁左邻居再锁窗口: 左邻居分裂或合并时会带着它的锁来改窗口第一个叶子的prev
+  Page *prev_page = nullptr;
+  page_id_t first_page_id = parent->ValueAt(start);
+  Page *first_page = buffer_pool_manager_->FetchPage(first_page_id);
+  while (true) {
+    first_page->RLatch();
+    page_id_t prev_page_id = reinterpret_cast<LeafPage *>(first_page->GetData())->GetPrevPageId();
+    first_page->RUnlatch();
+    if (prev_page_id != INVALID_PAGE_ID) {
+      prev_page = buffer_pool_manager_->FetchPage(prev_page_id);
+      prev_page->WLatch();
+    }
+    first_page->WLatch();
+    if (reinterpret_cast<LeafPage *>(first_page->GetData())->GetPrevPageId() == prev_page_id) {
+      break;
+    }
+    first_page->WUnlatch();
+    if (prev_page != nullptr) {
+      prev_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(prev_page_id, false);
+      prev_page = nullptr;
+    }
+  }
+  std::vector<Page *> old_pages{first_page};
+  for (int i = 1; i < window; i++) {
+    old_pages.push_back(buffer_pool_manager_->FetchPage(parent->ValueAt(start + i)));
+    old_pages.back()->WLatch();
+  }
+  auto *last = reinterpret_cast<LeafPage *>(old_pages.back()->GetData());
+  Page *next_page = nullptr;
+  if (last->GetNextPageId() != INVALID_PAGE_ID) {
+    next_page = buffer_pool_manager_->FetchPage(last->GetNextPageId());
+    next_page->WLatch();
+  }
+  // 父节点以上的路径不用再留着, 读者只会在这个窗口上等
+  Page *parent_page = path.back();
+  path.pop_back();
+  release_path();
+  auto release_window = [&](bool is_dirty) {
+    for (Page *leaf_page : {prev_page, next_page}) {
+      if (leaf_page != nullptr) {
+        leaf_page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), is_dirty);
+      }
+    }
+    for (Page *old_page : old_pages) {
+      old_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(old_page->GetPageId(), is_dirty);
+      if (is_dirty) {
+        buffer_pool_manager_->DeletePage(old_page->GetPageId());
+      }
+    }
+    parent_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), is_dirty);
+  };
+
+  std::vector<MappingType> items;
+  for (Page *old_page : old_pages) {
+    auto *leaf = reinterpret_cast<LeafPage *>(old_page->GetData());
+    for (int i = 0; i < leaf->GetSize(); i++) {
+      items.push_back(leaf->GetItem(i));
+    }
+  }
+  auto *first = reinterpret_cast<LeafPage *>(first_page->GetData());
+  const KeyType *low = first->HasLowKey() ? &first->GetLowKey() : nullptr;
+  const KeyType *high = last->HasHighKey() ? &last->GetHighKey() : nullptr;
+  // items[begin, end)放进fence为[leaf_low, leaf_high)的叶子时的max size
+  auto leaf_max_size = [&](const KeyType *leaf_low, const KeyType *leaf_high, int begin, int end) {
+    if (!compress_keys_) {
+      return leaf_max_size_;
+    }
+    int prefix_size =
+        leaf_low != nullptr && leaf_high != nullptr ? comparator_.CommonPrefixLength(*leaf_low, *leaf_high) : 0;
+    int key_end = 0;
+    for (int i = begin; i < end; i++) {
+      key_end = std::max(key_end, LeafPage::KeyEnd(items[i].first));
+    }
+    return LeafPage::MaxSizeFor(prefix_size, key_end, leaf_max_size_);
+  };
+  int total = items.size();
+  int max_size = leaf_max_size(low, high, 0, total);
+  int target = std::clamp(static_cast<int>(fill_factor * (max_size - 1)), std::max(1, max_size / 2), max_size - 1);
+  // 父节点不能因此低于min size
+  int others = parent->GetSize() - window;
+  int min_children = (parent->IsRootPage() ? 2 : parent->GetMinSize()) - others;
+
+  // 平均切成count份, 切点挪到run的边界上; 压缩的叶子按各自的fence检查放不放得下
+  std::vector<int> cuts;
+  std::vector<KeyType> separators;
+  auto plan = [&](int count) {
+    cuts.clear();
+    separators.clear();
+    int begin = 0;
+    for (int i = 1; i <= count; i++) {
+      int end = total;
+      if (i < count) {
+        end = std::max(static_cast<int>(static_cast<int64_t>(total) * i / count), begin + 1);
+        while (end < total && comparator_(items[end - 1].first, items[end].first) == 0) {
+          end++;
+        }
+        if (end >= total) {
+          return false;
+        }
+        separators.push_back(Separator(items[end - 1].first, items[end].first));
+      }
+      const KeyType *leaf_low = i == 1 ? low : &separators[i - 2];
+      const KeyType *leaf_high = i == count ? high : &separators[i - 1];
+      if (end - begin >= leaf_max_size(leaf_low, leaf_high, begin, end)) {
+        return false;
+      }
+      cuts.push_back(end);
+      begin = end;
+    }
+    if (compress_keys_) {
+      int key_end = parent->GetKeyEnd();
+      for (const auto &separator : separators) {
+        key_end = std::max(key_end, InternalPage::KeyEnd(separator));
+      }
+      const KeyType *parent_low = parent->HasLowKey() ? &parent->GetLowKey() : nullptr;
+      const KeyType *parent_high = parent->HasHighKey() ? &parent->GetHighKey() : nullptr;
+      return others + count <= parent->GetMaxSizeFor(parent_low, parent_high, key_end, comparator_);
+    }
+    return true;
+  };
+  int count = std::max({(total + target - 1) / target, min_children, 1});
+  while (count < window && !plan(count)) {
+    count++;
+  }
+  if (count >= window) {
+    release_window(false);
+    return 0;
+  }
+
+  std::vector<Page *> new_pages;
+  for (int i = 0; i < count; i++) {
+    page_id_t page_id;
+    Page *new_page = buffer_pool_manager_->NewPage(&page_id);
+    if (new_page == nullptr) {
+      for (Page *allocated : new_pages) {
+        buffer_pool_manager_->UnpinPage(allocated->GetPageId(), false);
+        buffer_pool_manager_->DeletePage(allocated->GetPageId());
+      }
+      release_window(false);
+      return 0;
+    }
+    new_pages.push_back(new_page);
+  }
+  int begin = 0;
+  for (int i = 0; i < count; i++) {
+    auto *leaf = reinterpret_cast<LeafPage *>(new_pages[i]->GetData());
+    leaf->Init(new_pages[i]->GetPageId(), parent->GetPageId(), leaf_max_size_, compress_keys_, unique_keys_);
+    const KeyType *leaf_low = i == 0 ? low : &separators[i - 1];
+    const KeyType *leaf_high = i == count - 1 ? high : &separators[i];
+    if (leaf_low != nullptr) {
+      leaf->SetLowKey(*leaf_low, comparator_);
+    }
+    if (leaf_high != nullptr) {
+      leaf->SetHighKey(*leaf_high, comparator_);
+    }
+    leaf->CopyNFrom(items.data() + begin, cuts[i] - begin);
+    leaf->SetPrevPageId(i == 0 ? first->GetPrevPageId() : new_pages[i - 1]->GetPageId());
+    leaf->SetNextPageId(i == count - 1 ? last->GetNextPageId() : new_pages[i + 1]->GetPageId());
+    begin = cuts[i];
+  }
+  if (prev_page != nullptr) {
+    reinterpret_cast<LeafPage *>(prev_page->GetData())->SetNextPageId(new_pages[0]->GetPageId());
+  }
+  if (next_page != nullptr) {
+    reinterpret_cast<LeafPage *>(next_page->GetData())->SetPrevPageId(new_pages.back()->GetPageId());
+  }
+  // 旧叶子指向覆盖它low key的新叶子, 停在上面的读者和迭代器从那里接着走
+  for (size_t i = 0; i < old_pages.size(); i++) {
+    auto *leaf = reinterpret_cast<LeafPage *>(old_pages[i]->GetData());
+    int target_index = 0;
+    while (i > 0 && target_index + 1 < count && comparator_(separators[target_index], leaf->GetLowKey()) <= 0) {
+      target_index++;
+    }
+    ForgetRightmostLeaf(leaf->GetPageId());
+    leaf->SetNextPageId(new_pages[target_index]->GetPageId());
+    leaf->SetDeleted();
+  }
+  parent->SetValueAt(start, new_pages[0]->GetPageId());
+  for (int i = 1; i < window; i++) {
+    parent->Remove(start + 1);
+  }
+  for (int i = 1; i < count; i++) {
+    parent->InsertNodeAfter(new_pages[i - 1]->GetPageId(), separators[i - 1], new_pages[i]->GetPageId());
+  }
+  for (Page *new_page : new_pages) {
+    buffer_pool_manager_->UnpinPage(new_page->GetPageId(), true);
+  }
+  release_window(true);
+  leaf_count_ -= window - count;
+  return window - count;
+}
+
+/*****************************************************************************
+ * STATISTICS
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::GetStatistics() -> BPlusTreeStatistics<KeyType, KeyComparator> {
+  std::scoped_lock lock(statistics_latch_);
+  Statistics statistics = statistics_;
+  statistics.entry_count_ = entry_count_;
+  statistics.leaf_count_ = leaf_count_;
+  statistics.height_ = height_;
+  return statistics;
+}
+
+/*
+ * Walk the leaf level left to right like a forward iterator, one read latch
+ * at a time. Buckets get entry_count / bucket_count entries; a key the walk
+ * already passed is skipped, in case it follows a merged leaf back to its
+ * left neighbour.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Analyze(int bucket_count) {
+  FlushMessages();
+  bucket_count = std::clamp(bucket_count, 1, Statistics::MaxBucketCount());
+  int64_t depth = std::max<int64_t>(1, (entry_count_ + bucket_count - 1) / bucket_count);
+  Statistics statistics;
+  int64_t used_slots = 0;
+  int64_t slot_capacity = 0;
+  KeyType last_key{};
+  bool has_last = false;
+  std::vector<ValueType> overflow;
+  Page *page = FindLeaf(last_key, Operation::FIND, true);
+  while (page != nullptr) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    if (!leaf->IsDeleted()) {
+      used_slots += leaf->GetSize();
+      slot_capacity += leaf->GetMaxSize();
+      for (int i = 0; i < leaf->GetSize();) {
+        int end = unique_keys_ ? i + 1 : leaf->RunEnd(i, comparator_);
+        KeyType key = leaf->KeyAt(i);
+        if (!has_last || comparator_(key, last_key) > 0) {
+          int64_t count = end - i;
+          if (leaf->IsOverflowSlot(end - 1, comparator_)) {
+            overflow.clear();
+            OverflowPage::ReadChain(buffer_pool_manager_, leaf->GetOverflowPageId(end - 1), &overflow);
+            count += static_cast<int64_t>(overflow.size()) - 1;
+          }
+          statistics.AddKey(key, count, depth);
+          last_key = key;
+          has_last = true;
+        }
+        i = end;
+      }
+    }
+    page_id_t next_page_id = leaf->GetNextPageId();
+    Page *next_page = next_page_id == INVALID_PAGE_ID ? nullptr : buffer_pool_manager_->FetchPage(next_page_id);
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    if (next_page != nullptr) {
+      next_page->RLatch();
+    }
+    page = next_page;
+  }
+  statistics.FinishHistogram();
+  statistics.fill_factor_ = slot_capacity == 0 ? 0 : static_cast<double>(used_slots) / slot_capacity;
+
+  std::scoped_lock lock(statistics_latch_);
+  statistics_ = statistics;
+  statistics.entry_count_ = entry_count_;
+  statistics.leaf_count_ = leaf_count_;
+  statistics.height_ = height_;
+  // 名字放不进header page的记录时不落盘
+  std::string record_name = "#" + index_name_;
+  if (record_name.length() >= 32) {
+    return;
+  }
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (statistics_page_id_ == INVALID_PAGE_ID && !header_page->GetRootId(record_name, &statistics_page_id_)) {
+    if (buffer_pool_manager_->NewPage(&statistics_page_id_) == nullptr) {
+      statistics_page_id_ = INVALID_PAGE_ID;
+      buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for index statistics");
+    }
+    header_page->InsertRecord(record_name, statistics_page_id_);
+    buffer_pool_manager_->UnpinPage(statistics_page_id_, false);
+    buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  } else {
+    buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  }
+  Page *statistics_page = buffer_pool_manager_->FetchPage(statistics_page_id_);
+  statistics.SerializeTo(statistics_page->GetData());
+  buffer_pool_manager_->UnpinPage(statistics_page_id_, true);
+}
+
+/*
+ * Restores the counters too, a tree reopened over an existing file starts
+ * from the persisted ones.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::LoadStatistics() -> bool {
+  std::string record_name = "#" + index_name_;
+  if (record_name.length() >= 32) {
+    return false;
+  }
+  std::scoped_lock lock(statistics_latch_);
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  page_id_t page_id;
+  bool found = header_page->GetRootId(record_name, &page_id);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  if (!found) {
+    return false;
+  }
+  statistics_page_id_ = page_id;
+  Page *statistics_page = buffer_pool_manager_->FetchPage(page_id);
+  statistics_.DeserializeFrom(statistics_page->GetData());
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  entry_count_ = statistics_.entry_count_;
+  leaf_count_ = statistics_.leaf_count_;
+  height_ = statistics_.height_;
+  return true;
+}
+
+/*
+ * Pick up the root page id that UpdateRootPageId recorded in the header page
+ * under this index name, for a tree constructed over a buffer pool that
+ * already holds it, then the messages that were still pending.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::LoadRootPageId() -> bool {
+  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  page_id_t page_id;
+  bool found = header_page->GetRootId(index_name_, &page_id);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+  if (found) {
+    root_latch_.WLock();
+    root_page_id_ = page_id;
+    root_latch_.WUnlock();
+  }
+  bool found_messages = LoadMessageLog();
+  return found || found_messages;
+}
 
 /*****************************************************************************
  * INDEX ITERATOR
  *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::MakeIterator(const KeyType *key, const KeyType *end_key, bool end_inclusive)
+    -> INDEXITERATOR_TYPE {
+  Page *page = key == nullptr ? FindLeaf(KeyType(), Operation::FIND, true) : FindLeaf(*key, Operation::FIND);
+  if (page == nullptr) {
+    return End();
+  }
+  int index = key == nullptr ? 0 : reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(*key, comparator_);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, index, comparator_, false, end_key, end_inclusive);
+}
+
 /*
  * Input parameter is void, find the leaftmost leaf page first, then construct
  * index iterator
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE(); }
+auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE {
+  FlushMessages();
+  Page *page = FindLeaf(KeyType(), Operation::FIND, true);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, 0, comparator_);
+}
 
 /*
  * Input parameter is low key, find the leaf page that contains the input key
@@ -196,7 +2019,79 @@ auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE()
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE(); }
+auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
+  FlushMessages();
+  Page *page = FindLeaf(key, Operation::FIND);
+  if (page == nullptr) {
+    return End();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(key, comparator_);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, index, comparator_);
+}
+
+/*
+ * Range scan over [key, end_key], or [key, end_key) without end_inclusive. The
+ * iterator ends at the first entry past end_key, and at a leaf whose high key
+ * already lies past end_key without reading its right sibling.
+ * @return : index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::Begin(const KeyType &key, const KeyType &end_key, bool end_inclusive) -> INDEXITERATOR_TYPE {
+  FlushMessages();
+  Page *page = FindLeaf(key, Operation::FIND);
+  if (page == nullptr) {
+    return End();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(key, comparator_);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, index, comparator_, false, &end_key, end_inclusive);
+}
+
+/*
+ * Reverse iterator from the last entry of the tree, ++ moves towards smaller
+ * keys through the left-sibling links of the leaves
+ * @return : index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RBegin() -> INDEXITERATOR_TYPE {
+  FlushMessages();
+  Page *page = FindLeaf(KeyType(), Operation::FIND, false, true);
+  if (page == nullptr) {
+    return End();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->GetSize() - 1;
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, index, comparator_, true);
+}
+
+/*
+ * Reverse iterator from the last entry whose key is <= key
+ * @return : index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RBegin(const KeyType &key) -> INDEXITERATOR_TYPE {
+  FlushMessages();
+  Page *page = FindLeaf(key, Operation::FIND);
+  if (page == nullptr) {
+    return End();
+  }
+  int index = LastIndexAtOrBelow(reinterpret_cast<LeafPage *>(page->GetData()), key);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, index, comparator_, true);
+}
+
+/*
+ * Reverse range scan over [end_key, key], or (end_key, key] without
+ * end_inclusive; it stops at a leaf whose low key is <= end_key
+ * @return : index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::RBegin(const KeyType &key, const KeyType &end_key, bool end_inclusive) -> INDEXITERATOR_TYPE {
+  FlushMessages();
+  Page *page = FindLeaf(key, Operation::FIND);
+  if (page == nullptr) {
+    return End();
+  }
+  int index = LastIndexAtOrBelow(reinterpret_cast<LeafPage *>(page->GetData()), key);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, index, comparator_, true, &end_key, end_inclusive);
+}
 
 /*
  * Input parameter is void, construct an index iterator representing the end
@@ -204,7 +2099,97 @@ auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE { return IN
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::End() -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE(); }
+auto BPLUSTREE_TYPE::End() -> INDEXITERATOR_TYPE {
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, nullptr, 0, comparator_);
+}
+
+/*
+ * Go down one internal level at a time, reading every node of the level that
+ * overlaps [low, high] under its own read latch, and stop at the first level
+ * with at least partitions - 1 separators inside the range, or above the
+ * leaves. Pages remembered from the level above may have been merged away or
+ * reused in the meantime; those are skipped, they only cost some balance.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::Partition(int partitions, const KeyType *low, const KeyType *high) -> std::vector<KeyType> {
+  std::vector<KeyType> cuts;
+  root_latch_.RLock();
+  std::vector<page_id_t> nodes;
+  if (!IsEmpty()) {
+    nodes.push_back(root_page_id_);
+  }
+  root_latch_.RUnlock();
+  auto above_low = [&](const KeyType &key) { return low == nullptr || comparator_(key, *low) > 0; };
+  auto below_high = [&](const KeyType &key) { return high == nullptr || comparator_(key, *high) < 0; };
+
+  for (int depth = 0; !nodes.empty() && static_cast<int>(cuts.size()) + 1 < partitions; depth++) {
+    std::vector<page_id_t> children;
+    std::vector<KeyType> level_cuts;
+    for (page_id_t page_id : nodes) {
+      Page *page = buffer_pool_manager_->FetchPage(page_id);
+      if (page == nullptr) {
+        continue;
+      }
+      page->RLatch();
+      auto *node = reinterpret_cast<InternalPage *>(page->GetData());
+      if (!node->IsDeleted() && node->IsInternalPage()) {
+        // 子节点i覆盖[KeyAt(i), KeyAt(i + 1)), 两头不确定时当作与区间重叠
+        for (int i = 0; i < node->GetSize(); i++) {
+          if (i + 1 < node->GetSize() && !above_low(node->KeyAt(i + 1))) {
+            continue;
+          }
+          if (i > 0 && !below_high(node->KeyAt(i))) {
+            break;
+          }
+          if (i > 0 && above_low(node->KeyAt(i))) {
+            level_cuts.push_back(node->KeyAt(i));
+          }
+          children.push_back(node->ValueAt(i));
+        }
+      }
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+    }
+    // 上一层的分隔键是这一层节点之间的边界
+    level_cuts.insert(level_cuts.end(), cuts.begin(), cuts.end());
+    std::sort(level_cuts.begin(), level_cuts.end(), KeyLess{comparator_});
+    level_cuts.erase(std::unique(level_cuts.begin(), level_cuts.end(),
+                                 [&](const KeyType &lhs, const KeyType &rhs) { return comparator_(lhs, rhs) == 0; }),
+                     level_cuts.end());
+    cuts = std::move(level_cuts);
+    // 下一层是叶子时停下
+    nodes = depth + 2 < height_ ? std::move(children) : std::vector<page_id_t>();
+  }
+
+  // 均匀地挑partitions - 1个
+  if (static_cast<int>(cuts.size()) + 1 <= partitions) {
+    return cuts;
+  }
+  std::vector<KeyType> result;
+  auto slots = static_cast<int64_t>(cuts.size()) + 1;
+  for (int i = 1; i < partitions; i++) {
+    result.push_back(cuts[i * slots / partitions - 1]);
+  }
+  return result;
+}
+
+/*
+ * The iterators keep their first leaf pinned until they are advanced or
+ * destroyed, but hold no latch.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::PartitionBegin(int partitions, const KeyType *low, const KeyType *high)
+    -> std::vector<INDEXITERATOR_TYPE> {
+  FlushMessages();
+  std::vector<KeyType> cuts = Partition(partitions, low, high);
+  std::vector<INDEXITERATOR_TYPE> iterators;
+  for (size_t i = 0; i <= cuts.size(); i++) {
+    const KeyType *key = i == 0 ? low : &cuts[i - 1];
+    const KeyType *end_key = i == cuts.size() ? high : &cuts[i];
+    iterators.push_back(MakeIterator(key, end_key, i == cuts.size()));
+  }
+  return iterators;
+}
 
 /*****************************************************************************
  * UTILITIES AND DEBUG
@@ -212,10 +2197,295 @@ auto BPLUSTREE_TYPE::End() -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE();
 /*
  * Find leaf page containing particular key, if leftMost flag == true, find
  * the left most leaf page
+ * The returned page is pinned but not latched.
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) -> Page * {
-  throw Exception(ExceptionType::NOT_IMPLEMENTED, "Implement this for test");
+  Page *page = FindLeaf(key, Operation::FIND, leftMost);
+  if (page != nullptr) {
+    page->RUnlatch();
+  }
+  return page;
+}
+
+/*
+ * B-link descent holding one latch at a time. The child is pinned before the
+ * parent latch is dropped, so it cannot be deleted underneath us; a node that
+ * was merged away or no longer covers the key sends us back to the root, and a
+ * key at or beyond the high key means a split moved it into the right sibling.
+ * Leaves are returned read latched for FIND and write latched for INSERT/REMOVE.
+ * With left_most or right_most the key is ignored and the descent ends at the
+ * first or the last leaf.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FindLeaf(const KeyType &key, Operation op, bool left_most, bool right_most) -> Page * {
+  while (true) {
+    root_latch_.RLock();
+    if (IsEmpty()) {
+      root_latch_.RUnlock();
+      return nullptr;
+    }
+    Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+    root_latch_.RUnlock();
+    page->RLatch();
+    bool exclusive = false;
+    while (page != nullptr) {
+      auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      if (!exclusive && op != Operation::FIND && node->IsLeafPage()) {
+        // 写操作在叶子上换成写锁, 换锁期间叶子可能变化, 重新检查
+        page->RUnlatch();
+        page->WLatch();
+        exclusive = true;
+        continue;
+      }
+      bool by_key = !left_most && !right_most;
+      if (node->IsDeleted() || (by_key && IsBelowLowKey(node, key))) {
+        exclusive ? page->WUnlatch() : page->RUnlatch();
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+        page = nullptr;
+        continue;
+      }
+      page_id_t next_page_id;
+      if ((by_key && IsBeyondHighKey(node, key)) || (right_most && node->HasHighKey())) {
+        next_page_id = node->GetNextPageId();
+      } else if (node->IsLeafPage()) {
+        return page;
+      } else {
+        auto *internal = reinterpret_cast<InternalPage *>(node);
+        if (by_key) {
+          next_page_id = internal->Lookup(key, comparator_);
+        } else {
+          next_page_id = internal->ValueAt(left_most ? 0 : internal->GetSize() - 1);
+        }
+      }
+      Page *next_page = buffer_pool_manager_->FetchPage(next_page_id);
+      exclusive ? page->WUnlatch() : page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      exclusive ? next_page->WLatch() : next_page->RLatch();
+      page = next_page;
+    }
+  }
+}
+
+/*
+ * Latch crabbing with write latches from the root. The root latch and every
+ * latched page stay in the transaction's page set until a safe child lets us
+ * release its ancestors. Returns nullptr (with the root latch held) if the tree
+ * is empty.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FindLeafPessimistic(const KeyType &key, Operation op, Transaction *transaction) -> Page * {
+  root_latch_.WLock();
+  transaction->AddIntoPageSet(nullptr);
+  if (IsEmpty()) {
+    return nullptr;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+  page->WLatch();
+  while (true) {
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (IsSafe(node, op, key)) {
+      ReleaseLatches(transaction, false);
+    }
+    transaction->AddIntoPageSet(page);
+    if (node->IsLeafPage()) {
+      return page;
+    }
+    page = buffer_pool_manager_->FetchPage(reinterpret_cast<InternalPage *>(node)->Lookup(key, comparator_));
+    page->WLatch();
+  }
+}
+
+/*
+ * A node is safe if the operation cannot propagate a split or merge past it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op, const KeyType &key) const -> bool {
+  if (op == Operation::INSERT) {
+    // 叶子插入后达到max size就分裂, 内部节点超过max size才分裂;
+    // 压缩的叶子按插入这个key之后的槽宽算, 内部节点按最宽的key算
+    if (node->IsLeafPage()) {
+      return node->GetSize() + 1 < reinterpret_cast<LeafPage *>(node)->GetMaxSizeWith(key);
+    }
+    return node->GetSize() < reinterpret_cast<InternalPage *>(node)->GetSafeMaxSize();
+  }
+  if (op == Operation::REMOVE) {
+    if (node->IsRootPage()) {
+      return node->IsLeafPage() ? node->GetSize() > 1 : node->GetSize() > 2;
+    }
+    return node->GetSize() > node->GetMinSize();
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::IsBelowLowKey(BPlusTreePage *node, const KeyType &key) const -> bool {
+  if (node->IsLeafPage()) {
+    return reinterpret_cast<LeafPage *>(node)->IsBelowLowKey(key, comparator_);
+  }
+  return reinterpret_cast<InternalPage *>(node)->IsBelowLowKey(key, comparator_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::IsBeyondHighKey(BPlusTreePage *node, const KeyType &key) const -> bool {
+  if (node->IsLeafPage()) {
+    return reinterpret_cast<LeafPage *>(node)->IsBeyondHighKey(key, comparator_);
+  }
+  return reinterpret_cast<InternalPage *>(node)->IsBeyondHighKey(key, comparator_);
+}
+
+/*
+ * Index of the last slot whose key is <= key, the end of key's run for
+ * non-unique leaves; -1 if every key of the leaf is larger
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::LastIndexAtOrBelow(LeafPage *leaf, const KeyType &key) const -> int {
+  int index = leaf->KeyIndex(key, comparator_);
+  if (index < leaf->GetSize() && comparator_(leaf->KeyAt(index), key) == 0) {
+    index = unique_keys_ ? index + 1 : leaf->RunEnd(index, comparator_);
+  }
+  return index - 1;
+}
+
+/*
+ * Index of the first slot of key's run, -1 if the leaf does not hold key
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::PostingListStart(LeafPage *leaf, const KeyType &key) const -> int {
+  int index = leaf->KeyIndex(key, comparator_);
+  return index < leaf->GetSize() && comparator_(leaf->KeyAt(index), key) == 0 ? index : -1;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReadPostingList(LeafPage *leaf, int start, std::vector<ValueType> *result) {
+  int end = leaf->RunEnd(start, comparator_);
+  bool overflowed = end - start == leaf->PostingInlineMax();
+  for (int i = start; i < (overflowed ? end - 1 : end); i++) {
+    result->push_back(leaf->ValueAt(i));
+  }
+  if (overflowed) {
+    OverflowPage::ReadChain(buffer_pool_manager_, leaf->GetOverflowPageId(end - 1), result);
+  }
+}
+
+/*
+ * The returned overflow page is pinned; like the rest of its chain it is only
+ * reached through a leaf the caller holds the write latch of
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::NewOverflowPage(page_id_t *page_id) -> OverflowPage * {
+  Page *page = buffer_pool_manager_->NewPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for posting list");
+  }
+  auto *overflow = reinterpret_cast<OverflowPage *>(page->GetData());
+  overflow->Init(*page_id);
+  return overflow;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::AppendToOverflow(page_id_t head, const ValueType &value) {
+  page_id_t page_id = head;
+  auto *overflow = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+  while (overflow->GetNextPageId() != INVALID_PAGE_ID) {
+    page_id_t next_page_id = overflow->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+    overflow = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+  }
+  if (overflow->GetSize() == overflow->GetMaxSize()) {
+    page_id_t tail_page_id;
+    OverflowPage *tail = NewOverflowPage(&tail_page_id);
+    overflow->SetNextPageId(tail_page_id);
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    page_id = tail_page_id;
+    overflow = tail;
+  }
+  overflow->Append(value);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::PopFromOverflow(page_id_t head, ValueType *value) -> bool {
+  std::vector<page_id_t> chain;
+  for (page_id_t page_id = head; page_id != INVALID_PAGE_ID;) {
+    chain.push_back(page_id);
+    auto *overflow = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+    page_id = overflow->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(chain.back(), false);
+  }
+  auto *tail = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(chain.back())->GetData());
+  *value = tail->PopBack();
+  bool empty = tail->GetSize() == 0;
+  buffer_pool_manager_->UnpinPage(chain.back(), true);
+  if (!empty) {
+    return false;
+  }
+  buffer_pool_manager_->DeletePage(chain.back());
+  chain.pop_back();
+  if (chain.empty()) {
+    return true;
+  }
+  auto *overflow = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(chain.back())->GetData());
+  overflow->SetNextPageId(INVALID_PAGE_ID);
+  buffer_pool_manager_->UnpinPage(chain.back(), true);
+  return false;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FreeOverflow(page_id_t head) -> int {
+  int count = 0;
+  for (page_id_t page_id = head; page_id != INVALID_PAGE_ID;) {
+    auto *overflow = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(page_id)->GetData());
+    page_id_t next_page_id = overflow->GetNextPageId();
+    count += overflow->GetSize();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    buffer_pool_manager_->DeletePage(page_id);
+    page_id = next_page_id;
+  }
+  return count;
+}
+
+/*
+ * Point the left link of leaf page_id at prev_page_id. Apart from siblings
+ * latched under their common parent, writers latch leaves left to right, so
+ * latching the right neighbour of a latched leaf here cannot deadlock; readers
+ * never wait for a leaf while holding another.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SetPrevLink(page_id_t page_id, page_id_t prev_page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  page->WLatch();
+  reinterpret_cast<LeafPage *>(page->GetData())->SetPrevPageId(prev_page_id);
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::Separator(const KeyType &left, const KeyType &right) const -> KeyType {
+  return compress_keys_ ? comparator_.ShortestSeparator(left, right) : right;
+}
+
+/*
+ * Release every latch in the transaction's page set in root to leaf order,
+ * nullptr stands for the root latch.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseLatches(Transaction *transaction, bool is_dirty) {
+  auto page_set = transaction->GetPageSet();
+  while (!page_set->empty()) {
+    Page *page = page_set->front();
+    page_set->pop_front();
+    if (page == nullptr) {
+      root_latch_.WUnlock();
+    } else {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), is_dirty);
+    }
+  }
 }
 
 /*
@@ -224,16 +2494,15 @@ auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) -> Page * {
  * Call this method everytime root page id is changed.
  * @parameter: insert_record      defualt value is false. When set to true,
  * insert a record <index_name, root_page_id> into header page instead of
- * updating it.
+ * updating it. A tree that was emptied and started again already has its
+ * record, so a failed insert falls back to an update.
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
-  if (insert_record != 0) {
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
-  } else {
-    // update root_page_id in header_page
+  // create a new record<index_name + root_page_id> in header_page, or update
+  // root_page_id in header_page
+  if (insert_record == 0 || !header_page->InsertRecord(index_name_, root_page_id_)) {
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
@@ -272,6 +2541,25 @@ void BPLUSTREE_TYPE::RemoveFromFile(const std::string &file_name, Transaction *t
   }
 }
 
+/*
+ * This method is used for test only
+ * Read unsorted data from file and bulk load it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::BulkLoadFromFile(const std::string &file_name, double fill_factor) -> bool {
+  std::ifstream input(file_name);
+  auto next = [&input](MappingType *item) {
+    int64_t key;
+    if (!(input >> key)) {
+      return false;
+    }
+    item->first.SetFromInteger(key);
+    item->second = RID(key);
+    return true;
+  };
+  return BulkLoad(next, false, fill_factor);
+}
+
 /**
  * This method is used for debug only, You don't need to modify
  */
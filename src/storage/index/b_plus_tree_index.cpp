@@ -11,41 +11,200 @@
 
 #include "storage/index/b_plus_tree_index.h"
 
+#include <algorithm>
+
+#include "common/macros.h"
+
 namespace bustub {
+
+namespace {
+
+constexpr size_t RID_BYTES = 8;
+
+// bytes left for the normalized key columns of an index with keys of key_size bytes
+auto NormalizedKeyLength(const IndexMetadata *metadata, size_t key_size) -> size_t {
+  if (metadata->GetIncludeColumnCount() == 0) {
+    return key_size;
+  }
+  const Schema *schema = metadata->GetKeySchema();
+  size_t payload = RID_BYTES;
+  for (uint32_t i = metadata->GetIndexColumnCount(); i < schema->GetColumnCount(); i++) {
+    if (!schema->GetColumn(i).IsInlined()) {
+      throw Exception(ExceptionType::MISMATCH_TYPE, "included columns must be fixed-length");
+    }
+    payload += schema->GetColumn(i).GetFixedLength();
+  }
+  if (payload >= key_size) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "included columns do not fit in the index key");
+  }
+  return key_size - payload;
+}
+
+// normalized VARCHAR columns are zero padded, compressed pages drop the padding, see b_plus_tree_page.h
+auto HasVarcharKey(const IndexMetadata *metadata) -> bool {
+  const Schema *schema = metadata->GetKeySchema();
+  for (uint32_t i = 0; i < metadata->GetIndexColumnCount(); i++) {
+    if (schema->GetColumn(i).GetType() == TypeId::VARCHAR) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
 /*
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
-BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager)
+BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                                     TableHeap *table_heap, const Schema *table_schema)
     : Index(std::move(metadata)),
-      comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_) {}
+      key_length_(NormalizedKeyLength(GetMetadata(), sizeof(KeyType))),
+      comparator_(GetMetadata()->GetKeySchema(), true,
+                  key_length_ == sizeof(KeyType) ? sizeof(KeyType) : key_length_ + RID_BYTES),
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE,
+                 HasVarcharKey(GetMetadata()), key_length_ != sizeof(KeyType)),
+      table_heap_(table_heap),
+      table_schema_(table_schema) {
+  BUSTUB_ASSERT(table_heap_ != nullptr && table_schema_ != nullptr, "a B+ tree index needs its table to recheck keys");
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::MakeIndexKey(const Tuple &key, const RID &rid, KeyType *index_key) const {
+  const Schema *key_schema = GetKeySchema();
+  index_key->SetNormalizedFromKey(key, key_schema, GetIndexColumnCount(), key_length_);
+  if (key_length_ == sizeof(KeyType)) {
+    return;
+  }
+  // rid 按大端写入, 同一 key 的条目按 rid 排序
+  char *data = index_key->data_ + key_length_;
+  auto page_id = static_cast<uint32_t>(rid.GetPageId());
+  uint32_t slot_num = rid.GetSlotNum();
+  for (size_t i = 0; i < 4; i++) {
+    data[i] = static_cast<char>(page_id >> ((3 - i) * 8));
+    data[4 + i] = static_cast<char>(slot_num >> ((3 - i) * 8));
+  }
+  data += RID_BYTES;
+  for (uint32_t i = GetIndexColumnCount(); i < key_schema->GetColumnCount(); i++) {
+    key.GetValue(key_schema, i).SerializeTo(data);
+    data += key_schema->GetColumn(i).GetFixedLength();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::DecodableKeyColumns() const -> uint32_t {
+  KeyType index_key;
+  memset(index_key.data_, 0, sizeof(KeyType));
+  std::vector<Value> values;
+  return index_key.NormalizedToValues(GetKeySchema(), GetIndexColumnCount(), key_length_, &values);
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct insert index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  MakeIndexKey(key, rid, &index_key);
 
   container_.Insert(index_key, rid, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::InsertEntries(const std::function<bool(Tuple *, RID *)> &next, Transaction *transaction) {
+  // 树为空时外部排序后自底向上一次建好, 否则逐条插入
+  Tuple key;
+  auto loaded = container_.BulkLoad(
+      [&](MappingType *entry) {
+        if (!next(&key, &entry->second)) {
+          return false;
+        }
+        MakeIndexKey(key, entry->second, &entry->first);
+        return true;
+      },
+      false);
+  if (!loaded) {
+    Index::InsertEntries(next, transaction);
+  }
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct delete index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  MakeIndexKey(key, rid, &index_key);
 
-  container_.Remove(index_key, transaction);
+  if (key_length_ != sizeof(KeyType)) {
+    container_.Remove(index_key, transaction);
+    return;
+  }
+  container_.Remove(index_key, rid, transaction);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
   // construct scan index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  size_t length = index_key.SetNormalizedFromKey(key, GetKeySchema(), GetIndexColumnCount(), key_length_);
+  size_t begin = result->size();
 
-  container_.GetValue(index_key, result, transaction);
+  if (key_length_ == sizeof(KeyType)) {
+    container_.GetValue(index_key, result, transaction);
+  } else {
+    // 覆盖索引: rid 与包含列全为 0 的 key 是该 key 的第一个条目, 向后扫到 key 部分不同为止
+    for (auto iterator = container_.Begin(index_key); !iterator.IsEnd(); ++iterator) {
+      if (memcmp((*iterator).first.data_, index_key.data_, key_length_) != 0) {
+        break;
+      }
+      result->push_back((*iterator).second);
+    }
+  }
+  if (length > key_length_) {
+    RecheckMatches(key, begin, result, transaction);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                                    Transaction *transaction) {
+  if (key_length_ != sizeof(KeyType)) {
+    Index::ScanKeys(keys, results, transaction);
+    return;
+  }
+  // construct all scan index keys, the container probes them as one batch
+  std::vector<KeyType> index_keys(keys.size());
+  std::vector<size_t> cut_off;
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (index_keys[i].SetNormalizedFromKey(keys[i], GetKeySchema(), GetIndexColumnCount(), key_length_) >
+        key_length_) {
+      cut_off.push_back(i);
+    }
+  }
+
+  container_.GetValues(index_keys, results, transaction);
+  for (size_t i : cut_off) {
+    RecheckMatches(keys[i], 0, &(*results)[i], transaction);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::RecheckMatches(const Tuple &key, size_t begin, std::vector<RID> *result,
+                                          Transaction *transaction) {
+  const Schema *key_schema = GetKeySchema();
+  // 读不到的元组留给调用者处理, 只去掉确实不匹配的
+  auto mismatch = [&](const RID &rid) {
+    Tuple tuple;
+    if (!table_heap_->GetTuple(rid, &tuple, transaction)) {
+      return false;
+    }
+    Tuple tuple_key = tuple.KeyFromTuple(*table_schema_, *key_schema, GetKeyAttrs());
+    for (uint32_t i = 0; i < GetIndexColumnCount(); i++) {
+      if (tuple_key.GetValue(key_schema, i).CompareEquals(key.GetValue(key_schema, i)) != CmpBool::CmpTrue) {
+        return true;
+      }
+    }
+    return false;
+  };
+  result->erase(std::remove_if(result->begin() + begin, result->end(), mismatch), result->end());
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -54,9 +213,131 @@ auto BPLUSTREE_INDEX_TYPE::GetBeginIterator() -> INDEXITERATOR_TYPE { return con
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &key) -> INDEXITERATOR_TYPE { return container_.Begin(key); }
 
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &key, const KeyType &end_key, bool end_inclusive)
+    -> INDEXITERATOR_TYPE {
+  return container_.Begin(key, end_key, end_inclusive);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetReverseBeginIterator() -> INDEXITERATOR_TYPE { return container_.RBegin(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetReverseBeginIterator(const KeyType &key) -> INDEXITERATOR_TYPE {
+  return container_.RBegin(key);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetReverseBeginIterator(const KeyType &key, const KeyType &end_key, bool end_inclusive)
+    -> INDEXITERATOR_TYPE {
+  return container_.RBegin(key, end_key, end_inclusive);
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_INDEX_TYPE::GetEndIterator() -> INDEXITERATOR_TYPE { return container_.End(); }
 
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::MakeBoundKey(const Value &value, bool upper, KeyType *index_key) const -> bool {
+  const Schema *key_schema = GetKeySchema();
+  TypeId type = key_schema->GetColumn(0).GetType();
+  if (value.IsNull()) {
+    return false;
+  }
+  Value bound = value;
+  if (value.GetTypeId() != type) {
+    // 只做不丢精度的数值转换, 超出列的范围时转换会抛异常, 这一端就不设边界
+    bool numeric = value.GetTypeId() >= TypeId::TINYINT && value.GetTypeId() <= TypeId::DECIMAL &&
+                   type >= TypeId::TINYINT && type <= TypeId::DECIMAL;
+    if (!numeric || value.GetTypeId() == TypeId::DECIMAL) {
+      return false;
+    }
+    try {
+      bound = value.CastAs(type);
+    } catch (Exception &e) {
+      return false;
+    }
+  }
+  std::vector<Value> values{bound};
+  for (uint32_t i = 1; i < key_schema->GetColumnCount(); i++) {
+    values.push_back(ValueFactory::GetNullValueByType(key_schema->GetColumn(i).GetType()));
+  }
+  size_t length =
+      std::min(index_key->SetNormalizedFromKey(Tuple(values, key_schema), key_schema, 1, key_length_), key_length_);
+  if (upper) {
+    memset(index_key->data_ + length, 0xFF, sizeof(KeyType) - length);
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetLeadingColumnIterator(const Value *low, const Value *high, bool reverse)
+    -> INDEXITERATOR_TYPE {
+  // 空缺的一端用最小(全0)或最大(全0xFF)的key代替
+  KeyType low_key;
+  KeyType high_key;
+  bool has_low = low != nullptr && MakeBoundKey(*low, false, &low_key);
+  bool has_high = high != nullptr && MakeBoundKey(*high, true, &high_key);
+  if (!has_low) {
+    memset(low_key.data_, 0, sizeof(KeyType));
+  }
+  if (!has_high) {
+    memset(high_key.data_, 0xFF, sizeof(KeyType));
+  }
+  if (reverse) {
+    return has_high || has_low ? container_.RBegin(high_key, low_key) : container_.RBegin();
+  }
+  return has_high || has_low ? container_.Begin(low_key, high_key) : container_.Begin();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetPartitionIterators(int partitions, const KeyType *low, const KeyType *high)
+    -> std::vector<INDEXITERATOR_TYPE> {
+  return container_.PartitionBegin(partitions, low, high);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetStatistics() -> BPlusTreeStatistics<KeyType, KeyComparator> {
+  return container_.GetStatistics();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::Analyze(int bucket_count) { container_.Analyze(bucket_count); }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::Covers(const std::vector<uint32_t> &column_attrs) const -> bool {
+  const auto &key_attrs = GetKeyAttrs();
+  uint32_t decodable = DecodableKeyColumns();
+  for (uint32_t attr : column_attrs) {
+    bool covered = false;
+    for (uint32_t i = 0; i < key_attrs.size() && !covered; i++) {
+      covered = key_attrs[i] == attr && (i < decodable || i >= GetIndexColumnCount());
+    }
+    if (!covered) {
+      return false;
+    }
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::GetEntryValues(const KeyType &index_key, std::vector<Value> *values) const {
+  const Schema *key_schema = GetKeySchema();
+  values->clear();
+  uint32_t decoded = index_key.NormalizedToValues(key_schema, GetIndexColumnCount(), key_length_, values);
+  for (uint32_t i = decoded; i < GetIndexColumnCount(); i++) {
+    values->push_back(ValueFactory::GetNullValueByType(key_schema->GetColumn(i).GetType()));
+  }
+  if (key_length_ == sizeof(KeyType)) {
+    return;
+  }
+  const char *data = index_key.data_ + key_length_ + RID_BYTES;
+  for (uint32_t i = GetIndexColumnCount(); i < key_schema->GetColumnCount(); i++) {
+    TypeId type = key_schema->GetColumn(i).GetType();
+    values->push_back(Value::DeserializeFrom(data, type));
+    data += key_schema->GetColumn(i).GetFixedLength();
+  }
+}
+
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
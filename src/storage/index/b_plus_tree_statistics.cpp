@@ -0,0 +1,139 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_statistics.cpp
+//
+// Identification: src/storage/index/b_plus_tree_statistics.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+
+#include "storage/index/b_plus_tree_statistics.h"
+#include "storage/index/generic_key.h"
+
+namespace bustub {
+
+STATISTICS_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_STATISTICS_TYPE::MaxBucketCount() -> int {
+  return (PAGE_SIZE - HEADER_SIZE - sizeof(KeyType)) / (sizeof(KeyType) + 2 * sizeof(int64_t));
+}
+
+STATISTICS_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_STATISTICS_TYPE::BucketOf(const KeyType &key, const KeyComparator &comparator) const -> int {
+  if (counts_.empty() || comparator(key, bounds_[0]) < 0 || comparator(key, bounds_.back()) > 0) {
+    return -1;
+  }
+  // 最后一个下界 <= key 的桶
+  int low = 0;
+  int high = counts_.size() - 1;
+  while (low < high) {
+    int mid = (low + high + 1) / 2;
+    if (comparator(bounds_[mid], key) <= 0) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return low;
+}
+
+STATISTICS_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_STATISTICS_TYPE::EstimateEqual(const KeyType &key, const KeyComparator &comparator) const -> double {
+  int bucket = BucketOf(key, comparator);
+  if (bucket == -1) {
+    return 0;
+  }
+  return static_cast<double>(counts_[bucket]) / distinct_[bucket];
+}
+
+STATISTICS_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_STATISTICS_TYPE::EstimateRange(const KeyType *low, const KeyType *high,
+                                              const KeyComparator &comparator) const -> double {
+  double estimate = 0;
+  int bucket_count = counts_.size();
+  for (int i = 0; i < bucket_count; i++) {
+    bool last = i == bucket_count - 1;
+    const KeyType &lower = bounds_[i];
+    const KeyType &upper = bounds_[i + 1];
+    // 桶的key在[lower, upper), 最后一个桶是[lower, upper]
+    bool disjoint = (high != nullptr && comparator(*high, lower) < 0) ||
+                    (low != nullptr && (last ? comparator(*low, upper) > 0 : comparator(*low, upper) >= 0));
+    if (disjoint) {
+      continue;
+    }
+    bool inside = (low == nullptr || comparator(*low, lower) <= 0) &&
+                  (high == nullptr || comparator(*high, upper) >= 0);
+    estimate += inside ? counts_[i] : counts_[i] / 2.0;
+  }
+  return estimate;
+}
+
+STATISTICS_TEMPLATE_ARGUMENTS
+void BPLUSTREE_STATISTICS_TYPE::AddKey(const KeyType &key, int64_t count, int64_t depth) {
+  if (counts_.empty() || counts_.back() >= depth) {
+    bounds_.push_back(key);
+    counts_.push_back(0);
+    distinct_.push_back(0);
+  }
+  counts_.back() += count;
+  distinct_.back()++;
+  last_key_ = key;
+}
+
+STATISTICS_TEMPLATE_ARGUMENTS
+void BPLUSTREE_STATISTICS_TYPE::FinishHistogram() {
+  if (!counts_.empty()) {
+    bounds_.push_back(last_key_);
+  }
+}
+
+STATISTICS_TEMPLATE_ARGUMENTS
+void BPLUSTREE_STATISTICS_TYPE::SerializeTo(char *storage) const {
+  int bucket_count = counts_.size();
+  memcpy(storage, &entry_count_, sizeof(int64_t));
+  memcpy(storage + 8, &leaf_count_, sizeof(int));
+  memcpy(storage + 12, &height_, sizeof(int));
+  memcpy(storage + 16, &fill_factor_, sizeof(double));
+  memcpy(storage + 24, &bucket_count, sizeof(int));
+  char *data = storage + HEADER_SIZE;
+  if (bucket_count > 0) {
+    memcpy(data, bounds_.data(), (bucket_count + 1) * sizeof(KeyType));
+    data += (bucket_count + 1) * sizeof(KeyType);
+    memcpy(data, counts_.data(), bucket_count * sizeof(int64_t));
+    memcpy(data + bucket_count * sizeof(int64_t), distinct_.data(), bucket_count * sizeof(int64_t));
+  }
+}
+
+STATISTICS_TEMPLATE_ARGUMENTS
+void BPLUSTREE_STATISTICS_TYPE::DeserializeFrom(const char *storage) {
+  int bucket_count;
+  memcpy(&entry_count_, storage, sizeof(int64_t));
+  memcpy(&leaf_count_, storage + 8, sizeof(int));
+  memcpy(&height_, storage + 12, sizeof(int));
+  memcpy(&fill_factor_, storage + 16, sizeof(double));
+  memcpy(&bucket_count, storage + 24, sizeof(int));
+  bounds_.clear();
+  counts_.assign(bucket_count, 0);
+  distinct_.assign(bucket_count, 0);
+  const char *data = storage + HEADER_SIZE;
+  if (bucket_count > 0) {
+    bounds_.resize(bucket_count + 1);
+    memcpy(bounds_.data(), data, (bucket_count + 1) * sizeof(KeyType));
+    data += (bucket_count + 1) * sizeof(KeyType);
+    memcpy(counts_.data(), data, bucket_count * sizeof(int64_t));
+    memcpy(distinct_.data(), data + bucket_count * sizeof(int64_t), bucket_count * sizeof(int64_t));
+    last_key_ = bounds_.back();
+  }
+}
+
+template class BPlusTreeStatistics<GenericKey<4>, GenericComparator<4>>;
+template class BPlusTreeStatistics<GenericKey<8>, GenericComparator<8>>;
+template class BPlusTreeStatistics<GenericKey<16>, GenericComparator<16>>;
+template class BPlusTreeStatistics<GenericKey<32>, GenericComparator<32>>;
+template class BPlusTreeStatistics<GenericKey<64>, GenericComparator<64>>;
+
+}  // namespace bustub
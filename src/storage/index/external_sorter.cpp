@@ -0,0 +1,162 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sorter.cpp
+//
+// Identification: src/storage/index/external_sorter.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "container/hash/hash_function.h"
+#include "storage/index/external_sorter.h"
+
+namespace bustub {
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNAL_SORTER_TYPE::ExternalSorter(BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+                                     size_t run_size, bool order_values)
+    : buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      run_size_(std::max<size_t>(run_size, 1)),
+      order_values_(order_values) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNAL_SORTER_TYPE::~ExternalSorter() {
+  for (auto &run : runs_) {
+    for (page_id_t page_id : run.page_ids_) {
+      buffer_pool_manager_->DeletePage(page_id);
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::Add(const MappingType &item) {
+  current_run_.push_back(item);
+  if (current_run_.size() >= run_size_) {
+    SpillCurrentRun();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::Finish() {
+  if (!current_run_.empty()) {
+    // 最后一个run不落盘, 直接留在内存里参与归并
+    SortCurrentRun();
+    Run run;
+    run.size_ = current_run_.size();
+    run.buffer_ = std::move(current_run_);
+    runs_.push_back(std::move(run));
+    current_run_.clear();
+  }
+  for (size_t i = 0; i < runs_.size(); i++) {
+    if (runs_[i].buffer_index_ < runs_[i].buffer_.size() || LoadNextPage(&runs_[i])) {
+      heap_.push_back(i);
+    }
+  }
+  std::make_heap(heap_.begin(), heap_.end(), [this](size_t lhs, size_t rhs) { return HeapGreater(lhs, rhs); });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto EXTERNAL_SORTER_TYPE::Next(MappingType *item) -> bool {
+  if (heap_.empty()) {
+    return false;
+  }
+  auto greater = [this](size_t lhs, size_t rhs) { return HeapGreater(lhs, rhs); };
+  std::pop_heap(heap_.begin(), heap_.end(), greater);
+  Run &run = runs_[heap_.back()];
+  *item = run.buffer_[run.buffer_index_++];
+  if (run.buffer_index_ < run.buffer_.size() || LoadNextPage(&run)) {
+    std::push_heap(heap_.begin(), heap_.end(), greater);
+  } else {
+    heap_.pop_back();
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::SortCurrentRun() {
+  std::stable_sort(current_run_.begin(), current_run_.end(),
+                   [this](const MappingType &lhs, const MappingType &rhs) { return Compare(lhs, rhs) < 0; });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::SpillCurrentRun() {
+  SortCurrentRun();
+  Run run;
+  run.size_ = current_run_.size();
+  for (size_t offset = 0; offset < current_run_.size(); offset += ITEMS_PER_PAGE) {
+    page_id_t page_id;
+    Page *page = buffer_pool_manager_->NewPage(&page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for sort run");
+    }
+    size_t count = std::min(ITEMS_PER_PAGE, current_run_.size() - offset);
+    std::copy(current_run_.begin() + offset, current_run_.begin() + offset + count,
+              reinterpret_cast<MappingType *>(page->GetData()));
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    run.page_ids_.push_back(page_id);
+  }
+  runs_.push_back(std::move(run));
+  current_run_.clear();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto EXTERNAL_SORTER_TYPE::LoadNextPage(Run *run) -> bool {
+  if (run->next_page_ >= run->page_ids_.size()) {
+    return false;
+  }
+  page_id_t page_id = run->page_ids_[run->next_page_];
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch sort run page");
+  }
+  size_t count = std::min(ITEMS_PER_PAGE, run->size_ - run->next_page_ * ITEMS_PER_PAGE);
+  auto *items = reinterpret_cast<MappingType *>(page->GetData());
+  run->buffer_.assign(items, items + count);
+  run->buffer_index_ = 0;
+  run->next_page_++;
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto EXTERNAL_SORTER_TYPE::HeapGreater(size_t lhs, size_t rhs) const -> bool {
+  const Run &left = runs_[lhs];
+  const Run &right = runs_[rhs];
+  int cmp = Compare(left.buffer_[left.buffer_index_], right.buffer_[right.buffer_index_]);
+  return cmp > 0 || (cmp == 0 && lhs > rhs);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto EXTERNAL_SORTER_TYPE::Compare(const MappingType &lhs, const MappingType &rhs) const -> int {
+  int cmp = comparator_(lhs.first, rhs.first);
+  if (cmp != 0 || !order_values_) {
+    return cmp;
+  }
+  return memcmp(&lhs.second, &rhs.second, sizeof(ValueType));
+}
+
+template class ExternalSorter<GenericKey<4>, RID, GenericComparator<4>>;
+template class ExternalSorter<GenericKey<8>, RID, GenericComparator<8>>;
+template class ExternalSorter<GenericKey<16>, RID, GenericComparator<16>>;
+template class ExternalSorter<GenericKey<32>, RID, GenericComparator<32>>;
+template class ExternalSorter<GenericKey<64>, RID, GenericComparator<64>>;
+
+// ExtendibleHashTable::BulkLoad sorts its input by bit-reversed hash
+template class ExternalSorter<uint32_t, std::pair<int, int>, HashOrderComparator>;
+template class ExternalSorter<uint32_t, std::pair<GenericKey<4>, RID>, HashOrderComparator>;
+template class ExternalSorter<uint32_t, std::pair<GenericKey<8>, RID>, HashOrderComparator>;
+template class ExternalSorter<uint32_t, std::pair<GenericKey<16>, RID>, HashOrderComparator>;
+template class ExternalSorter<uint32_t, std::pair<GenericKey<32>, RID>, HashOrderComparator>;
+template class ExternalSorter<uint32_t, std::pair<GenericKey<64>, RID>, HashOrderComparator>;
+
+}  // namespace bustub
@@ -2,6 +2,7 @@
  * index_iterator.cpp
  */
 #include <cassert>
+#include <cstring>
 
 #include "storage/index/index_iterator.h"
 
@@ -12,19 +13,222 @@ namespace bustub {
  * set your own input parameters
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator() = default;
+INDEXITERATOR_TYPE::IndexIterator(BufferPoolManager *buffer_pool_manager, Page *page, int index,
+                                  const KeyComparator &comparator, bool reverse, const KeyType *end_key,
+                                  bool end_inclusive)
+    : buffer_pool_manager_(buffer_pool_manager),
+      page_(page),
+      index_(index),
+      comparator_(comparator),
+      reverse_(reverse),
+      has_end_key_(end_key != nullptr),
+      end_inclusive_(end_inclusive) {
+  if (end_key != nullptr) {
+    end_key_ = *end_key;
+  }
+  if (page_ != nullptr) {
+    reverse_ ? SettleReverse(nullptr, false) : Settle(nullptr, false);
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() = default;  // NOLINT
+INDEXITERATOR_TYPE::~IndexIterator() {  // NOLINT
+  if (page_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-auto INDEXITERATOR_TYPE::IsEnd() -> bool { throw std::runtime_error("unimplemented"); }
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other) noexcept
+    : buffer_pool_manager_(other.buffer_pool_manager_),
+      page_(other.page_),
+      index_(other.index_),
+      comparator_(other.comparator_),
+      item_(other.item_),
+      overflow_(std::move(other.overflow_)),
+      overflow_index_(other.overflow_index_),
+      reverse_(other.reverse_),
+      has_end_key_(other.has_end_key_),
+      end_key_(other.end_key_),
+      end_inclusive_(other.end_inclusive_) {
+  other.page_ = nullptr;
+  other.index_ = 0;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-auto INDEXITERATOR_TYPE::operator*() -> const MappingType & { throw std::runtime_error("unimplemented"); }
+auto INDEXITERATOR_TYPE::IsEnd() -> bool { return page_ == nullptr; }
 
 INDEX_TEMPLATE_ARGUMENTS
-auto INDEXITERATOR_TYPE::operator++() -> INDEXITERATOR_TYPE & { throw std::runtime_error("unimplemented"); }
+auto INDEXITERATOR_TYPE::operator*() -> const MappingType & { return item_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::operator++() -> INDEXITERATOR_TYPE & {
+  if (page_ == nullptr) {
+    return *this;
+  }
+  if (reverse_ && overflow_index_ > 0) {
+    item_.second = overflow_[--overflow_index_];
+    return *this;
+  }
+  if (!reverse_ && overflow_index_ + 1 < overflow_.size()) {
+    item_.second = overflow_[++overflow_index_];
+    return *this;
+  }
+  bool run_done = !overflow_.empty();
+  overflow_.clear();
+  overflow_index_ = 0;
+  MappingType last = item_;
+  page_->RLatch();
+  reverse_ ? SettleReverse(&last, run_done) : Settle(&last, run_done);
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Settle(const MappingType *after, bool past_run) {
+  while (true) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page_->GetData());
+    // 被合并删除的叶子的next指向合并后的左兄弟, 直接跟过去重新定位
+    if (!leaf->IsDeleted()) {
+      if (after != nullptr) {
+        index_ = leaf->KeyIndex(after->first, comparator_);
+        if (index_ < leaf->GetSize() && comparator_(leaf->KeyAt(index_), after->first) == 0) {
+          if (leaf->IsUnique()) {
+            index_++;
+          } else {
+            // 跳过posting list里字节序不大于after的行内value, 溢出页总在最后
+            int end = leaf->RunEnd(index_, comparator_);
+            index_ = past_run ? end : index_;
+            while (index_ < end && !leaf->IsOverflowSlot(index_, comparator_)) {
+              ValueType value = leaf->ValueAt(index_);
+              if (memcmp(&value, &after->second, sizeof(ValueType)) > 0) {
+                break;
+              }
+              index_++;
+            }
+          }
+        }
+      }
+      if (index_ < leaf->GetSize()) {
+        Land();
+        return;
+      }
+    }
+    page_id_t next_page_id = leaf->GetNextPageId();
+    if (next_page_id == INVALID_PAGE_ID || (!leaf->IsDeleted() && IsLastLeaf(leaf))) {
+      Finish();
+      return;
+    }
+    MoveTo(next_page_id);
+    index_ = 0;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SettleReverse(const MappingType *after, bool overflow_done) {
+  // 沿prev走过来之后, 要找的是 < hop_key 的最后一个entry, hop_key是离开的那个叶子的low key
+  bool hopped = false;
+  KeyType hop_key;
+  while (true) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page_->GetData());
+    // 被合并删除的叶子的next指向合并后的左兄弟; high key没到目标说明松开锁之后它分裂了, 往右找回来
+    bool split_away = false;
+    if (!leaf->IsDeleted() && leaf->HasHighKey()) {
+      if (hopped) {
+        split_away = comparator_(leaf->GetHighKey(), hop_key) < 0;
+      } else if (after != nullptr) {
+        split_away = comparator_(leaf->GetHighKey(), after->first) <= 0;
+      }
+    }
+    if (leaf->IsDeleted() || split_away) {
+      MoveTo(leaf->GetNextPageId());
+      continue;
+    }
+    if (after != nullptr) {
+      index_ = leaf->KeyIndex(after->first, comparator_);
+      if (!leaf->IsUnique() && index_ < leaf->GetSize() && comparator_(leaf->KeyAt(index_), after->first) == 0) {
+        // posting list倒着走: 先是溢出页, 再是字节序从大到小的行内value
+        int start = index_;
+        int end = leaf->RunEnd(start, comparator_);
+        int inline_end = leaf->IsOverflowSlot(end - 1, comparator_) ? end - 1 : end;
+        for (index_ = inline_end - 1; !overflow_done && index_ >= start; index_--) {
+          ValueType value = leaf->ValueAt(index_);
+          if (memcmp(&value, &after->second, sizeof(ValueType)) < 0) {
+            break;
+          }
+        }
+      } else {
+        index_--;
+      }
+    } else if (hopped) {
+      index_ = leaf->KeyIndex(hop_key, comparator_) - 1;
+    }
+    if (index_ >= 0) {
+      Land();
+      return;
+    }
+    page_id_t prev_page_id = leaf->GetPrevPageId();
+    if (prev_page_id == INVALID_PAGE_ID || IsLastLeaf(leaf)) {
+      Finish();
+      return;
+    }
+    hop_key = leaf->GetLowKey();
+    hopped = true;
+    MoveTo(prev_page_id);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Land() {
+  auto *leaf = reinterpret_cast<LeafPage *>(page_->GetData());
+  KeyType key = leaf->KeyAt(index_);
+  if (has_end_key_) {
+    int cmp = reverse_ ? comparator_(end_key_, key) : comparator_(key, end_key_);
+    if (cmp > 0 || (cmp == 0 && !end_inclusive_)) {
+      Finish();
+      return;
+    }
+  }
+  if (leaf->IsOverflowSlot(index_, comparator_)) {
+    BPlusTreeOverflowPage<ValueType>::ReadChain(buffer_pool_manager_, leaf->GetOverflowPageId(index_), &overflow_);
+    overflow_index_ = reverse_ ? overflow_.size() - 1 : 0;
+    item_ = MappingType(key, overflow_[overflow_index_]);
+  } else {
+    item_ = MappingType(key, leaf->ValueAt(index_));
+  }
+  page_->RUnlatch();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto INDEXITERATOR_TYPE::IsLastLeaf(const LeafPage *leaf) const -> bool {
+  // 反向时左边的key都 < low key; 正向时右边的key都 >= high key
+  if (reverse_) {
+    return !leaf->HasLowKey() || (has_end_key_ && comparator_(leaf->GetLowKey(), end_key_) <= 0);
+  }
+  if (!has_end_key_ || !leaf->HasHighKey()) {
+    return false;
+  }
+  int cmp = comparator_(leaf->GetHighKey(), end_key_);
+  return cmp > 0 || (cmp == 0 && !end_inclusive_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Finish() {
+  page_->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+  page_ = nullptr;
+  index_ = 0;
+  overflow_.clear();
+  overflow_index_ = 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::MoveTo(page_id_t page_id) {
+  Page *next_page = buffer_pool_manager_->FetchPage(page_id);
+  page_->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+  next_page->RLatch();
+  page_ = next_page;
+}
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
@@ -9,11 +9,15 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
 #include "common/exception.h"
+#include "common/macros.h"
 #include "storage/page/b_plus_tree_internal_page.h"
+#include "storage/page/b_plus_tree_key_search.h"
 
 namespace bustub {
 /*****************************************************************************
@@ -25,34 +29,232 @@ namespace bustub {
  * max page size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size, bool compress_keys) {
+  SetPageType(IndexPageType::INTERNAL_PAGE);
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(parent_id);
+  SetNextPageId(INVALID_PAGE_ID);
+  SetMaxSize(max_size);
+  ClearLowKey();
+  BPlusTreePage::ClearHighKey();
+  if (compress_keys) {
+    SetLinkFlag(KEY_COMPRESSION_FLAG);
+  }
+  SetKeyLayout(0, sizeof(KeyType), compress_keys ? MaxSizeFor(0, sizeof(KeyType), max_size) : max_size);
+}
 /*
  * Helper method to get/set the key associated with input "index"(a.k.a
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const -> KeyType {
-  // replace with your own code
-  KeyType key{};
+  KeyType key;
+  auto *bytes = reinterpret_cast<char *>(&key);
+  memcpy(bytes, &low_key_, GetPrefixSize());
+  memcpy(bytes + GetPrefixSize(), KeySlotAt(index), GetKeySize());
+  memset(bytes + GetKeyEnd(), 0, sizeof(KeyType) - GetKeyEnd());
   return key;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {
+  if (NeedsWiderSlots(key)) {
+    auto items = GetItems();
+    items[index].first = key;
+    UpdateLayout(items, GetPrefixSize());
+    return;
+  }
+  WriteItem(index, key, ValueAt(index));
+}
 
 /*
  * Helper method to find and return array index(or offset), so that its value
  * equals to input "value"
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const -> int { return 0; }
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const -> int {
+  for (int i = 0; i < GetSize(); i++) {
+    if (ValueAt(i) == value) {
+      return i;
+    }
+  }
+  return -1;
+}
 
 /*
  * Helper method to get the value associated with input "index"(a.k.a array
  * offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const -> ValueType { return 0; }
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const -> ValueType {
+  ValueType value;
+  memcpy(&value, ValueSlotAt(index), sizeof(ValueType));
+  return value;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index, const ValueType &value) {
+  memcpy(ValueSlotAt(index), &value, sizeof(ValueType));
+}
+
+/*
+ * Encode key & value into slot "index", the key must share the page prefix
+ * and fit in the slot
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::WriteItem(int index, const KeyType &key, const ValueType &value) {
+  memcpy(KeySlotAt(index), reinterpret_cast<const char *>(&key) + GetPrefixSize(), GetKeySize());
+  memcpy(ValueSlotAt(index), &value, sizeof(ValueType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveSlots(int dst, int src, int count) {
+  memmove(KeySlotAt(dst), KeySlotAt(src), count * GetKeySize());
+  memmove(ValueSlotAt(dst), ValueSlotAt(src), count * sizeof(ValueType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetItems() const -> std::vector<MappingType> {
+  std::vector<MappingType> items;
+  items.reserve(GetSize());
+  for (int i = 0; i < GetSize(); i++) {
+    items.emplace_back(KeyAt(i), ValueAt(i));
+  }
+  return items;
+}
+
+/*
+ * Helper methods to set the B-link fences of this page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetLowKey(const KeyType &key, const KeyComparator &comparator) {
+  if (!IsKeyCompressed()) {
+    low_key_ = key;
+    SetLinkFlag(LOW_KEY_FLAG);
+    return;
+  }
+  auto items = GetItems();
+  low_key_ = key;
+  SetLinkFlag(LOW_KEY_FLAG);
+  UpdateLayout(items, comparator);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetHighKey(const KeyType &key, const KeyComparator &comparator) {
+  if (!IsKeyCompressed()) {
+    high_key_ = key;
+    SetLinkFlag(HIGH_KEY_FLAG);
+    return;
+  }
+  auto items = GetItems();
+  high_key_ = key;
+  SetLinkFlag(HIGH_KEY_FLAG);
+  UpdateLayout(items, comparator);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::ClearHighKey(const KeyComparator &comparator) {
+  if (!IsKeyCompressed()) {
+    BPlusTreePage::ClearHighKey();
+    return;
+  }
+  auto items = GetItems();
+  BPlusTreePage::ClearHighKey();
+  UpdateLayout(items, comparator);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsBelowLowKey(const KeyType &key, const KeyComparator &comparator) const
+    -> bool {
+  return HasLowKey() && comparator(key, low_key_) < 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsBeyondHighKey(const KeyType &key, const KeyComparator &comparator) const
+    -> bool {
+  return HasHighKey() && comparator(key, high_key_) >= 0;
+}
+
+/*****************************************************************************
+ * KEY LAYOUT
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetMaxSizeFor(const KeyType *low, const KeyType *high, int key_end,
+                                                   const KeyComparator &comparator) const -> int {
+  if (!IsKeyCompressed()) {
+    return GetMaxSize();
+  }
+  int prefix_size = low != nullptr && high != nullptr ? comparator.CommonPrefixLength(*low, *high) : 0;
+  return MaxSizeFor(prefix_size, std::max(GetKeyEnd(), key_end), GetMaxSizeLimit());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetSafeMaxSize() const -> int {
+  if (!IsKeyCompressed()) {
+    return GetMaxSize();
+  }
+  return MaxSizeFor(GetPrefixSize(), sizeof(KeyType), GetMaxSizeLimit());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::HasRoomFor(const KeyType &key) const -> bool {
+  int key_end = std::max(GetKeyEnd(), KeyEnd(key));
+  int slots = (PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (key_end - GetPrefixSize() + sizeof(ValueType));
+  return GetSize() + 1 <= slots;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::MaxSizeFor(int prefix_size, int key_end, int max_size) -> int {
+  int page_size = PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE;
+  int slots = page_size / (std::max(key_end - prefix_size, 0) + sizeof(ValueType));
+  int full_slots = page_size / (sizeof(KeyType) - prefix_size + sizeof(ValueType));
+  // 留一个槽给触发分裂的插入; 分裂出的两半各自还要能放下一个最宽的key
+  int size = std::min(slots - 1, 2 * full_slots - 3);
+  return max_size < static_cast<int>(INTERNAL_PAGE_SIZE) ? std::min(max_size, size) : size;
+}
+
+/*
+ * Number of leading bytes up to the last non-zero one
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyEnd(const KeyType &key) -> int {
+  const auto *bytes = reinterpret_cast<const char *>(&key);
+  int end = sizeof(KeyType);
+  while (end > 0 && bytes[end - 1] == 0) {
+    end--;
+  }
+  return end;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::NeedsWiderSlots(const KeyType &key) const -> bool {
+  return IsKeyCompressed() && KeyEnd(key) > GetKeyEnd();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::UpdateLayout(const std::vector<MappingType> &items,
+                                                  const KeyComparator &comparator) {
+  UpdateLayout(items, HasLowKey() && HasHighKey() ? comparator.CommonPrefixLength(low_key_, high_key_) : 0);
+}
+
+/*
+ * Only called on compressed pages: the slots shrink to the widest key, the
+ * callers make sure the items still fit the page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::UpdateLayout(const std::vector<MappingType> &items, int prefix_size) {
+  int key_end = prefix_size;
+  for (const auto &item : items) {
+    key_end = std::max(key_end, KeyEnd(item.first));
+  }
+  SetKeyLayout(prefix_size, key_end - prefix_size, MaxSizeFor(prefix_size, key_end, GetMaxSizeLimit()));
+  BUSTUB_ASSERT(static_cast<int>(items.size()) <= SlotCapacity(), "internal page overflow");
+  SetSize(items.size());
+  for (int i = 0; i < GetSize(); i++) {
+    WriteItem(i, items[i].first, items[i].second);
+  }
+}
 
 /*****************************************************************************
  * LOOKUP
@@ -64,7 +266,23 @@ auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const -> ValueType { ret
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &comparator) const -> ValueType {
-  return INVALID_PAGE_ID;
+  // key没有压缩时直接在页里的key数组上查找: 第一个 > key 的位置减一
+  if (GetPrefixSize() == 0 && GetKeySize() == static_cast<int>(sizeof(KeyType))) {
+    int index = BPlusTreeKeySearch<KeyType, KeyComparator>::UpperBound(KeySlotAt(1), GetSize() - 1, key, comparator);
+    return ValueAt(index);
+  }
+  // 二分查找最后一个 <= key 的位置, 找不到就是第0个孩子
+  int left = 1;
+  int right = GetSize();
+  while (left < right) {
+    int mid = left + (right - left) / 2;
+    if (comparator(KeyAt(mid), key) <= 0) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return ValueAt(left - 1);
 }
 
 /*****************************************************************************
@@ -78,7 +296,13 @@ auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyCompara
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value, const KeyType &new_key,
-                                                     const ValueType &new_value) {}
+                                                     const ValueType &new_value) {
+  KeyType invalid_key;
+  memset(&invalid_key, 0, sizeof(KeyType));
+  WriteItem(0, invalid_key, old_value);
+  WriteItem(1, new_key, new_value);
+  SetSize(2);
+}
 /*
  * Insert new_key & new_value pair right after the pair with its value ==
  * old_value
@@ -87,25 +311,72 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value,
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value, const KeyType &new_key,
                                                      const ValueType &new_value) -> int {
-  return 0;
+  int index = ValueIndex(old_value) + 1;
+  if (NeedsWiderSlots(new_key)) {
+    auto items = GetItems();
+    items.insert(items.begin() + index, MappingType(new_key, new_value));
+    UpdateLayout(items, GetPrefixSize());
+    return GetSize();
+  }
+  MoveSlots(index + 1, index, GetSize() - index);
+  WriteItem(index, new_key, new_value);
+  IncreaseSize(1);
+  return GetSize();
 }
 
 /*****************************************************************************
  * SPLIT
  *****************************************************************************/
 /*
- * Remove half of key & value pairs from this page to "recipient" page
+ * Remove the pairs after the first keep ones (usually half) from this page to "recipient" page
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient,
-                                                BufferPoolManager *buffer_pool_manager) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient, int keep,
+                                                BufferPoolManager *buffer_pool_manager) {
+  // recipient的第0个key就是要推到父节点的分隔key
+  auto items = GetItems();
+  recipient->CopyNFrom(items.data() + keep, GetSize() - keep, buffer_pool_manager);
+  SetSize(keep);
+}
 
 /* Copy entries into me, starting from {items} and copy {size} entries.
  * Since it is an internal page, for all entries (pages) moved, their parents page now changes to me.
  * So I need to 'adopt' them by changing their parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(const MappingType *items, int size,
+                                               BufferPoolManager *buffer_pool_manager) {
+  bool wider = false;
+  for (int i = 0; i < size; i++) {
+    wider = wider || NeedsWiderSlots(items[i].first);
+  }
+  if (wider) {
+    auto all_items = GetItems();
+    all_items.insert(all_items.end(), items, items + size);
+    UpdateLayout(all_items, GetPrefixSize());
+  } else {
+    for (int i = 0; i < size; i++) {
+      WriteItem(GetSize() + i, items[i].first, items[i].second);
+    }
+    IncreaseSize(size);
+  }
+  for (int i = 0; i < size; i++) {
+    Adopt(items[i].second, buffer_pool_manager);
+  }
+}
+
+/*
+ * Point the parent page id of the given child page at me
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Adopt(const ValueType &child, BufferPoolManager *buffer_pool_manager) {
+  auto *page = buffer_pool_manager->FetchPage(child);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch child page to adopt");
+  }
+  reinterpret_cast<BPlusTreePage *>(page->GetData())->SetParentPageId(GetPageId());
+  buffer_pool_manager->UnpinPage(child, true);
+}
 
 /*****************************************************************************
  * REMOVE
@@ -116,14 +387,21 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, Buf
  * NOTE: store key&value pair continuously after deletion
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
+  MoveSlots(index, index + 1, GetSize() - index - 1);
+  IncreaseSize(-1);
+}
 
 /*
  * Remove the only key & value pair in internal page and return the value
  * NOTE: only call this method within AdjustRoot()(in b_plus_tree.cpp)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() -> ValueType { return INVALID_PAGE_ID; }
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() -> ValueType {
+  ValueType only_child = ValueAt(0);
+  SetSize(0);
+  return only_child;
+}
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
@@ -136,7 +414,12 @@ auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() -> ValueType { r
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                               BufferPoolManager *buffer_pool_manager) {}
+                                               BufferPoolManager *buffer_pool_manager) {
+  auto items = GetItems();
+  items[0].first = middle_key;
+  recipient->CopyNFrom(items.data(), GetSize(), buffer_pool_manager);
+  SetSize(0);
+}
 
 /*****************************************************************************
  * REDISTRIBUTE
@@ -151,14 +434,19 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient,
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                                      BufferPoolManager *buffer_pool_manager) {}
+                                                      BufferPoolManager *buffer_pool_manager) {
+  recipient->CopyLastFrom(MappingType(middle_key, ValueAt(0)), buffer_pool_manager);
+  Remove(0);
+}
 
 /* Append an entry at the end.
  * Since it is an internal page, the moved entry(page)'s parent needs to be updated.
  * So I need to 'adopt' it by changing its parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
+  CopyNFrom(&pair, 1, buffer_pool_manager);
+}
 
 /*
  * Remove the last key & value pair from this page to head of "recipient" page.
@@ -169,14 +457,30 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, Buffe
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                                       BufferPoolManager *buffer_pool_manager) {}
+                                                       BufferPoolManager *buffer_pool_manager) {
+  // 原来无效的第0个key变成middle_key, 移过去的最后一项成为新的第0项
+  recipient->SetKeyAt(0, middle_key);
+  recipient->CopyFirstFrom(MappingType(KeyAt(GetSize() - 1), ValueAt(GetSize() - 1)), buffer_pool_manager);
+  IncreaseSize(-1);
+}
 
 /* Append an entry at the beginning.
  * Since it is an internal page, the moved entry(page)'s parent needs to be updated.
  * So I need to 'adopt' it by changing its parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
+  if (NeedsWiderSlots(pair.first)) {
+    auto items = GetItems();
+    items.insert(items.begin(), pair);
+    UpdateLayout(items, GetPrefixSize());
+  } else {
+    MoveSlots(1, 0, GetSize());
+    WriteItem(0, pair.first, pair.second);
+    IncreaseSize(1);
+  }
+  Adopt(pair.second, buffer_pool_manager);
+}
 
 // valuetype for internalNode should be page id_t
 template class BPlusTreeInternalPage<GenericKey<4>, page_id_t, GenericComparator<4>>;
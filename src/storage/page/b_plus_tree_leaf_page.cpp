@@ -9,10 +9,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "common/exception.h"
+#include "common/macros.h"
 #include "common/rid.h"
+#include "storage/page/b_plus_tree_key_search.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
@@ -24,19 +28,159 @@ namespace bustub {
 /**
  * Init method after creating a new leaf page
  * Including set page type, set current size to zero, set page id/parent id, set
- * next page id and set max size
+ * next/prev page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size, bool compress_keys,
+                                      bool unique_keys) {
+  SetPageType(IndexPageType::LEAF_PAGE);
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(parent_id);
+  SetNextPageId(INVALID_PAGE_ID);
+  SetPrevPageId(INVALID_PAGE_ID);
+  SetMaxSize(max_size);
+  // 新节点覆盖(-inf, +inf), 分裂时再由调用者收紧
+  ClearLowKey();
+  BPlusTreePage::ClearHighKey();
+  if (compress_keys) {
+    SetLinkFlag(KEY_COMPRESSION_FLAG);
+  }
+  if (!unique_keys) {
+    SetLinkFlag(NON_UNIQUE_FLAG);
+  }
+  // 压缩的空页从零宽的槽开始, 随插入的key变宽
+  if (compress_keys) {
+    SetKeyLayout(0, 0, MaxSizeFor(0, 0, max_size));
+  } else {
+    SetKeyLayout(0, sizeof(KeyType), max_size);
+  }
+}
 
 /**
- * Helper methods to set/get next page id
+ * Helper methods to set the B-link fences of this page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetLowKey(const KeyType &key, const KeyComparator &comparator) {
+  if (!IsKeyCompressed()) {
+    low_key_ = key;
+    SetLinkFlag(LOW_KEY_FLAG);
+    return;
+  }
+  auto items = GetItems();
+  low_key_ = key;
+  SetLinkFlag(LOW_KEY_FLAG);
+  UpdateLayout(items, comparator);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetHighKey(const KeyType &key, const KeyComparator &comparator) {
+  if (!IsKeyCompressed()) {
+    high_key_ = key;
+    SetLinkFlag(HIGH_KEY_FLAG);
+    return;
+  }
+  auto items = GetItems();
+  high_key_ = key;
+  SetLinkFlag(HIGH_KEY_FLAG);
+  UpdateLayout(items, comparator);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::ClearHighKey(const KeyComparator &comparator) {
+  if (!IsKeyCompressed()) {
+    BPlusTreePage::ClearHighKey();
+    return;
+  }
+  auto items = GetItems();
+  BPlusTreePage::ClearHighKey();
+  UpdateLayout(items, comparator);
+}
+
+/*
+ * key < low key: the key moved to a left sibling after the caller read the
+ * pointer to this page, the caller has to restart from the root
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::IsBelowLowKey(const KeyType &key, const KeyComparator &comparator) const -> bool {
+  return HasLowKey() && comparator(key, low_key_) < 0;
+}
+
+/*
+ * key >= high key: this page was split after the caller read the pointer to
+ * it, the caller should move right through the next page id
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::IsBeyondHighKey(const KeyType &key, const KeyComparator &comparator) const -> bool {
+  return HasHighKey() && comparator(key, high_key_) >= 0;
+}
+
+/*****************************************************************************
+ * KEY LAYOUT
+ *****************************************************************************/
+/*
+ * The keys of a compressed leaf share the prefix of its fences and end with
+ * zero bytes past the widest of them, so the page can hold more of them the
+ * narrower its key range and the shorter its keys are
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetNextPageId() const -> page_id_t { return INVALID_PAGE_ID; }
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetMaxSizeFor(const KeyType *low, const KeyType *high, int key_end,
+                                               const KeyComparator &comparator) const -> int {
+  if (!IsKeyCompressed()) {
+    return GetMaxSize();
+  }
+  int prefix_size = low != nullptr && high != nullptr ? comparator.CommonPrefixLength(*low, *high) : 0;
+  return MaxSizeFor(prefix_size, std::max(GetKeyEnd(), key_end), GetMaxSizeLimit());
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) {}
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetMaxSizeWith(const KeyType &key) const -> int {
+  if (!NeedsWiderSlots(key)) {
+    return GetMaxSize();
+  }
+  return MaxSizeFor(GetPrefixSize(), KeyEnd(key), GetMaxSizeLimit());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::HasRoomFor(const KeyType &key) const -> bool {
+  int key_end = std::max(GetKeyEnd(), KeyEnd(key));
+  int slots = (PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / (key_end - GetPrefixSize() + sizeof(ValueType));
+  return GetSize() + 1 <= slots;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::NeedsWiderSlots(const KeyType &key) const -> bool {
+  return IsKeyCompressed() && KeyEnd(key) > GetKeyEnd();
+}
+
+/*
+ * A page of short keys holds more items than fit at full width. When a full
+ * width key comes in, the page splits before storing it: the half it goes to
+ * (up to a run of equal keys past the middle) must still take it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::MaxSizeFor(int prefix_size, int key_end, int max_size) -> int {
+  int page_size = PAGE_SIZE - LEAF_PAGE_HEADER_SIZE;
+  int slots = page_size / (std::max(key_end - prefix_size, 0) + sizeof(ValueType));
+  int full_slots = page_size / (sizeof(KeyType) - prefix_size + sizeof(ValueType));
+  int slack = std::max(2, std::min(max_size, full_slots) / 8);
+  int size = std::min(slots, 2 * (full_slots - slack) - 3);
+  // 配置的max size比整页小(测试里常见)时仍然生效
+  return max_size < static_cast<int>(LEAF_PAGE_SIZE) ? std::min(max_size, size) : size;
+}
+
+/*
+ * Number of leading bytes up to the last non-zero one
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyEnd(const KeyType &key) -> int {
+  const auto *bytes = reinterpret_cast<const char *>(&key);
+  int end = sizeof(KeyType);
+  while (end > 0 && bytes[end - 1] == 0) {
+    end--;
+  }
+  return end;
+}
 
 /**
  * Helper method to find the first index i so that array[i].first >= key
@@ -44,7 +188,22 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) {}
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const -> int {
-  return 0;
+  // 页里存的是完整的key时直接在key数组上查找
+  if (GetPrefixSize() == 0 && GetKeySize() == static_cast<int>(sizeof(KeyType))) {
+    return BPlusTreeKeySearch<KeyType, KeyComparator>::LowerBound(KeySlotAt(0), GetSize(), key, comparator);
+  }
+  // 二分查找第一个 >= key 的位置
+  int left = 0;
+  int right = GetSize();
+  while (left < right) {
+    int mid = left + (right - left) / 2;
+    if (comparator(KeyAt(mid), key) < 0) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return left;
 }
 
 /*
@@ -53,19 +212,94 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparato
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const -> KeyType {
-  // replace with your own code
-  KeyType key{};
+  KeyType key;
+  auto *bytes = reinterpret_cast<char *>(&key);
+  memcpy(bytes, &low_key_, GetPrefixSize());
+  memcpy(bytes + GetPrefixSize(), KeySlotAt(index), GetKeySize());
+  memset(bytes + GetKeyEnd(), 0, sizeof(KeyType) - GetKeyEnd());
   return key;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const -> ValueType {
+  ValueType value;
+  memcpy(&value, ValueSlotAt(index), sizeof(ValueType));
+  return value;
+}
+
 /*
  * Helper method to find and return the key & value pair associated with input
  * "index"(a.k.a array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) -> const MappingType & {
-  // replace with your own code
-  return array_[0];
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) const -> MappingType {
+  return MappingType(KeyAt(index), ValueAt(index));
+}
+
+/*
+ * Encode key & value into slot "index", the key must share the page prefix
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::WriteItem(int index, const KeyType &key, const ValueType &value) {
+  memcpy(KeySlotAt(index), reinterpret_cast<const char *>(&key) + GetPrefixSize(), GetKeySize());
+  memcpy(ValueSlotAt(index), &value, sizeof(ValueType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveSlots(int dst, int src, int count) {
+  memmove(KeySlotAt(dst), KeySlotAt(src), count * GetKeySize());
+  memmove(ValueSlotAt(dst), ValueSlotAt(src), count * sizeof(ValueType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetItems() const -> std::vector<MappingType> {
+  std::vector<MappingType> items;
+  items.reserve(GetSize());
+  for (int i = 0; i < GetSize(); i++) {
+    items.push_back(GetItem(i));
+  }
+  return items;
+}
+
+/*
+ * Strip the prefix the fences share from every key. Only called on compressed
+ * pages, with the items decoded before the fences changed.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::UpdateLayout(const std::vector<MappingType> &items, const KeyComparator &comparator) {
+  UpdateLayout(items, HasLowKey() && HasHighKey() ? comparator.CommonPrefixLength(low_key_, high_key_) : 0);
+}
+
+/*
+ * The slots shrink to the widest key, the callers make sure the items still
+ * fit the page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::UpdateLayout(const std::vector<MappingType> &items, int prefix_size) {
+  int key_end = prefix_size;
+  for (const auto &item : items) {
+    key_end = std::max(key_end, KeyEnd(item.first));
+  }
+  SetKeyLayout(prefix_size, key_end - prefix_size, MaxSizeFor(prefix_size, key_end, GetMaxSizeLimit()));
+  BUSTUB_ASSERT(static_cast<int>(items.size()) <= SlotCapacity(), "leaf page overflow");
+  SetSize(items.size());
+  for (int i = 0; i < GetSize(); i++) {
+    WriteItem(i, items[i].first, items[i].second);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::WidenFor(const KeyType &key) {
+  if (!NeedsWiderSlots(key)) {
+    return;
+  }
+  auto items = GetItems();
+  int key_end = KeyEnd(key);
+  SetKeyLayout(GetPrefixSize(), key_end - GetPrefixSize(), MaxSizeFor(GetPrefixSize(), key_end, GetMaxSizeLimit()));
+  BUSTUB_ASSERT(GetSize() < SlotCapacity(), "leaf page overflow");
+  for (int i = 0; i < GetSize(); i++) {
+    WriteItem(i, items[i].first, items[i].second);
+  }
 }
 
 /*****************************************************************************
@@ -78,23 +312,132 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) -> const MappingType & {
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator)
     -> int {
-  return 0;
+  int index = KeyIndex(key, comparator);
+  // 重复的key不插入
+  if (index < GetSize() && comparator(KeyAt(index), key) == 0) {
+    return GetSize();
+  }
+  WidenFor(key);
+  MoveSlots(index + 1, index, GetSize() - index);
+  WriteItem(index, key, value);
+  IncreaseSize(1);
+  return GetSize();
+}
+
+/*****************************************************************************
+ * POSTING LISTS
+ *****************************************************************************/
+/*
+ * A run may take an eighth of the configured page, so that a full page always
+ * has a run boundary near its middle to split at
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::PostingInlineMax() const -> int { return PostingInlineMaxFor(GetMaxSizeLimit()); }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::PostingInlineMaxFor(int max_size) -> int { return std::max(2, max_size / 8); }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::RunEnd(int index, const KeyComparator &comparator) const -> int {
+  KeyType key = KeyAt(index);
+  int end = index + 1;
+  while (end < GetSize() && comparator(KeyAt(end), key) == 0) {
+    end++;
+  }
+  return end;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::IsOverflowSlot(int index, const KeyComparator &comparator) const -> bool {
+  if (IsUnique()) {
+    return false;
+  }
+  int start = KeyIndex(KeyAt(index), comparator);
+  int end = RunEnd(start, comparator);
+  return end - start == PostingInlineMax() && index == end - 1;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetOverflowPageId(int index) const -> page_id_t {
+  page_id_t page_id;
+  memcpy(&page_id, ValueSlotAt(index), sizeof(page_id_t));
+  return page_id;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::InsertAt(int index, const KeyType &key, const ValueType &value) {
+  WidenFor(key);
+  MoveSlots(index + 1, index, GetSize() - index);
+  WriteItem(index, key, value);
+  IncreaseSize(1);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::InsertOverflowAt(int index, const KeyType &key, page_id_t page_id) {
+  InsertAt(index, key, OverflowSlotValue(page_id));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::OverflowSlotValue(page_id_t page_id) -> ValueType {
+  static_assert(sizeof(ValueType) >= sizeof(page_id_t), "a value slot must hold an overflow page id");
+  ValueType value;
+  memset(static_cast<void *>(&value), 0, sizeof(ValueType));
+  memcpy(static_cast<void *>(&value), &page_id, sizeof(page_id_t));
+  return value;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAt(int index) {
+  MoveSlots(index, index + 1, GetSize() - index - 1);
+  IncreaseSize(-1);
 }
 
 /*****************************************************************************
  * SPLIT
  *****************************************************************************/
 /*
- * Remove half of key & value pairs from this page to "recipient" page
+ * Half of the items stay, or for non-unique pages the run boundary closest to
+ * half; a full page holds more items than the longest run, so there is one.
+ * An append split of the rightmost leaf keeps 90% instead, keys arriving in
+ * order then leave nearly full leaves behind.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient) {}
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::SplitIndex(const KeyComparator &comparator, bool append) const -> int {
+  int keep = append ? std::max(GetMinSize(), std::min(GetSize() * 9 / 10, GetSize() - 1)) : GetMinSize();
+  if (IsUnique()) {
+    return keep;
+  }
+  for (int distance = 0; distance < GetSize(); distance++) {
+    for (int index : {keep - distance, keep + distance}) {
+      if (index > 0 && index < GetSize() && comparator(KeyAt(index - 1), KeyAt(index)) != 0) {
+        return index;
+      }
+    }
+  }
+  return keep;
+}
+
+/*
+ * Remove the items after the first keep ones from this page to "recipient" page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient, int keep) {
+  auto items = GetItems();
+  recipient->CopyNFrom(items.data() + keep, GetSize() - keep);
+  SetSize(keep);
+}
 
 /*
  * Copy starting from items, and copy {size} number of elements into me.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(const MappingType *items, int size) {
+  for (int i = 0; i < size; i++) {
+    WidenFor(items[i].first);
+    WriteItem(GetSize(), items[i].first, items[i].second);
+    IncreaseSize(1);
+  }
+}
 
 /*****************************************************************************
  * LOOKUP
@@ -107,6 +450,11 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {}
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const
     -> bool {
+  int index = KeyIndex(key, comparator);
+  if (index < GetSize() && comparator(KeyAt(index), key) == 0) {
+    *value = ValueAt(index);
+    return true;
+  }
   return false;
 }
 
@@ -121,7 +469,13 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, co
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator) -> int {
-  return 0;
+  int index = KeyIndex(key, comparator);
+  if (index >= GetSize() || comparator(KeyAt(index), key) != 0) {
+    return GetSize();
+  }
+  MoveSlots(index, index + 1, GetSize() - index - 1);
+  IncreaseSize(-1);
+  return GetSize();
 }
 
 /*****************************************************************************
@@ -132,7 +486,12 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const
  * to update the next_page id in the sibling page
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {
+  auto items = GetItems();
+  recipient->CopyNFrom(items.data(), GetSize());
+  recipient->SetNextPageId(GetNextPageId());
+  SetSize(0);
+}
 
 /*****************************************************************************
  * REDISTRIBUTE
@@ -141,25 +500,41 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {}
  * Remove the first key & value pair from this page to "recipient" page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {
+  recipient->CopyLastFrom(GetItem(0));
+  MoveSlots(0, 1, GetSize() - 1);
+  IncreaseSize(-1);
+}
 
 /*
  * Copy the item into the end of my item list. (Append item to my array)
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {
+  WidenFor(item.first);
+  WriteItem(GetSize(), item.first, item.second);
+  IncreaseSize(1);
+}
 
 /*
  * Remove the last key & value pair from this page to "recipient" page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {
+  recipient->CopyFirstFrom(GetItem(GetSize() - 1));
+  IncreaseSize(-1);
+}
 
 /*
  * Insert item at the front of my items. Move items accordingly.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(const MappingType &item) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(const MappingType &item) {
+  WidenFor(item.first);
+  MoveSlots(1, 0, GetSize());
+  WriteItem(0, item.first, item.second);
+  IncreaseSize(1);
+}
 
 template class BPlusTreeLeafPage<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
@@ -0,0 +1,47 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/page/b_plus_tree_message_page.cpp
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/rid.h"
+#include "storage/page/b_plus_tree_message_page.h"
+
+namespace bustub {
+
+/**
+ * Init method after creating a new message page
+ */
+template <typename KeyType, typename ValueType>
+void B_PLUS_TREE_MESSAGE_PAGE_TYPE::Init(page_id_t page_id, int max_size) {
+  SetPageType(IndexPageType::MESSAGE_PAGE);
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(INVALID_PAGE_ID);
+  SetNextPageId(INVALID_PAGE_ID);
+  SetMaxSize(max_size);
+}
+
+template <typename KeyType, typename ValueType>
+auto B_PLUS_TREE_MESSAGE_PAGE_TYPE::MessageAt(int index) const -> const Message & {
+  return array_[index];
+}
+
+template <typename KeyType, typename ValueType>
+void B_PLUS_TREE_MESSAGE_PAGE_TYPE::Append(const KeyType &key, MessageType type, const ValueType &value) {
+  array_[GetSize()] = Message{key, value, type};
+  IncreaseSize(1);
+}
+
+template class BPlusTreeMessagePage<GenericKey<4>, RID>;
+template class BPlusTreeMessagePage<GenericKey<8>, RID>;
+template class BPlusTreeMessagePage<GenericKey<16>, RID>;
+template class BPlusTreeMessagePage<GenericKey<32>, RID>;
+template class BPlusTreeMessagePage<GenericKey<64>, RID>;
+
+}  // namespace bustub
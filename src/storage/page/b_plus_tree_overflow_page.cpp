@@ -0,0 +1,78 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/page/b_plus_tree_overflow_page.cpp
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+
+#include "common/rid.h"
+#include "storage/page/b_plus_tree_overflow_page.h"
+
+namespace bustub {
+
+/**
+ * Init method after creating a new overflow page
+ */
+template <typename ValueType>
+void B_PLUS_TREE_OVERFLOW_PAGE_TYPE::Init(page_id_t page_id, int max_size) {
+  SetPageType(IndexPageType::OVERFLOW_PAGE);
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(INVALID_PAGE_ID);
+  SetNextPageId(INVALID_PAGE_ID);
+  SetMaxSize(max_size);
+}
+
+template <typename ValueType>
+auto B_PLUS_TREE_OVERFLOW_PAGE_TYPE::ValueAt(int index) const -> ValueType {
+  return array_[index];
+}
+
+template <typename ValueType>
+void B_PLUS_TREE_OVERFLOW_PAGE_TYPE::SetValueAt(int index, const ValueType &value) {
+  array_[index] = value;
+}
+
+template <typename ValueType>
+auto B_PLUS_TREE_OVERFLOW_PAGE_TYPE::ValueIndex(const ValueType &value) const -> int {
+  for (int i = 0; i < GetSize(); i++) {
+    if (memcmp(&array_[i], &value, sizeof(ValueType)) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+template <typename ValueType>
+void B_PLUS_TREE_OVERFLOW_PAGE_TYPE::Append(const ValueType &value) {
+  array_[GetSize()] = value;
+  IncreaseSize(1);
+}
+
+template <typename ValueType>
+auto B_PLUS_TREE_OVERFLOW_PAGE_TYPE::PopBack() -> ValueType {
+  IncreaseSize(-1);
+  return array_[GetSize()];
+}
+
+template <typename ValueType>
+void B_PLUS_TREE_OVERFLOW_PAGE_TYPE::ReadChain(BufferPoolManager *buffer_pool_manager, page_id_t page_id,
+                                               std::vector<ValueType> *result) {
+  while (page_id != INVALID_PAGE_ID) {
+    auto *page = reinterpret_cast<BPlusTreeOverflowPage *>(buffer_pool_manager->FetchPage(page_id)->GetData());
+    result->insert(result->end(), page->array_, page->array_ + page->GetSize());
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+template class BPlusTreeOverflowPage<RID>;
+
+}  // namespace bustub
@@ -17,45 +17,88 @@ namespace bustub {
  * Helper methods to get/set page type
  * Page type enum class is defined in b_plus_tree_page.h
  */
-auto BPlusTreePage::IsLeafPage() const -> bool { return false; }
-auto BPlusTreePage::IsRootPage() const -> bool { return false; }
-void BPlusTreePage::SetPageType(IndexPageType page_type) {}
+auto BPlusTreePage::IsLeafPage() const -> bool { return page_type_ == IndexPageType::LEAF_PAGE; }
+auto BPlusTreePage::IsInternalPage() const -> bool { return page_type_ == IndexPageType::INTERNAL_PAGE; }
+auto BPlusTreePage::IsRootPage() const -> bool { return parent_page_id_ == INVALID_PAGE_ID; }
+void BPlusTreePage::SetPageType(IndexPageType page_type) { page_type_ = page_type; }
 
 /*
  * Helper methods to get/set size (number of key/value pairs stored in that
  * page)
  */
-auto BPlusTreePage::GetSize() const -> int { return 0; }
-void BPlusTreePage::SetSize(int size) {}
-void BPlusTreePage::IncreaseSize(int amount) {}
+auto BPlusTreePage::GetSize() const -> int { return size_; }
+void BPlusTreePage::SetSize(int size) { size_ = size; }
+void BPlusTreePage::IncreaseSize(int amount) { size_ += amount; }
 
 /*
  * Helper methods to get/set max size (capacity) of the page
  */
-auto BPlusTreePage::GetMaxSize() const -> int { return 0; }
-void BPlusTreePage::SetMaxSize(int size) {}
+auto BPlusTreePage::GetMaxSize() const -> int { return layout_max_size_; }
+void BPlusTreePage::SetMaxSize(int size) {
+  max_size_ = size;
+  layout_max_size_ = size;
+}
+auto BPlusTreePage::GetMaxSizeLimit() const -> int { return max_size_; }
 
 /*
  * Helper method to get min page size
  * Generally, min page size == max page size / 2
+ * 叶子在size == max_size时分裂, 内部节点在size > max_size时分裂, 两者取整方式不同
  */
-auto BPlusTreePage::GetMinSize() const -> int { return 0; }
+auto BPlusTreePage::GetMinSize() const -> int {
+  if (IsLeafPage()) {
+    return GetMaxSize() / 2;
+  }
+  return (GetMaxSize() + 1) / 2;
+}
 
 /*
  * Helper methods to get/set parent page id
  */
-auto BPlusTreePage::GetParentPageId() const -> page_id_t { return 0; }
-void BPlusTreePage::SetParentPageId(page_id_t parent_page_id) {}
+auto BPlusTreePage::GetParentPageId() const -> page_id_t { return parent_page_id_; }
+void BPlusTreePage::SetParentPageId(page_id_t parent_page_id) { parent_page_id_ = parent_page_id; }
 
 /*
  * Helper methods to get/set self page id
  */
-auto BPlusTreePage::GetPageId() const -> page_id_t { return 0; }
-void BPlusTreePage::SetPageId(page_id_t page_id) {}
+auto BPlusTreePage::GetPageId() const -> page_id_t { return page_id_; }
+void BPlusTreePage::SetPageId(page_id_t page_id) { page_id_ = page_id; }
 
 /*
  * Helper methods to set lsn
  */
 void BPlusTreePage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
 
+/*
+ * Helper methods to get/set the right sibling (B-link pointer)
+ */
+auto BPlusTreePage::GetNextPageId() const -> page_id_t { return next_page_id_; }
+void BPlusTreePage::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+/*
+ * Helper methods for the low/high key fences. The keys themselves live in the
+ * derived pages, here we only track whether they are finite.
+ */
+auto BPlusTreePage::HasLowKey() const -> bool { return (link_flags_ & LOW_KEY_FLAG) != 0; }
+auto BPlusTreePage::HasHighKey() const -> bool { return (link_flags_ & HIGH_KEY_FLAG) != 0; }
+void BPlusTreePage::ClearLowKey() { link_flags_ &= ~LOW_KEY_FLAG; }
+void BPlusTreePage::ClearHighKey() { link_flags_ &= ~HIGH_KEY_FLAG; }
+
+auto BPlusTreePage::IsDeleted() const -> bool { return (link_flags_ & DELETED_FLAG) != 0; }
+void BPlusTreePage::SetDeleted() { link_flags_ |= DELETED_FLAG; }
+
+/*
+ * Helper methods for the key layout of compressed pages
+ */
+auto BPlusTreePage::IsKeyCompressed() const -> bool { return (link_flags_ & KEY_COMPRESSION_FLAG) != 0; }
+auto BPlusTreePage::GetPrefixSize() const -> int { return prefix_size_; }
+auto BPlusTreePage::GetKeySize() const -> int { return key_size_; }
+void BPlusTreePage::SetKeyLayout(int prefix_size, int key_size, int max_size) {
+  prefix_size_ = prefix_size;
+  key_size_ = key_size;
+  layout_max_size_ = max_size;
+}
+
+auto BPlusTreePage::IsUnique() const -> bool { return (link_flags_ & NON_UNIQUE_FLAG) == 0; }
+
 }  // namespace bustub
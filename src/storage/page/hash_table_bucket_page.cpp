@@ -11,6 +11,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "storage/page/hash_table_bucket_page.h"
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "common/logger.h"
 #include "common/util/hash_util.h"
 #include "storage/index/generic_key.h"
@@ -20,15 +24,33 @@
 namespace bustub {
 
 //  private:
+//   page_id_t overflow_page_id_;  // 同一个key放不下时接出去的溢出页
 //   //  For more on BUCKET_ARRAY_SIZE see storage/page/hash_table_page_defs.h
 //   // 总共可以存下的bucket_idx数目就是BUCKET_ARRAY_SIZE
 //   char occupied_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
 //   // 0 if tombstone/brand new (never occupied), 1 otherwise.
 //   char readable_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
+//   // 每个槽位key的指纹, 补齐到整组方便一次比较一组
+//   uint8_t fingerprints_[...];
 //   // #define MappingType std::pair<KeyType, ValueType>
 //   MappingType array_[1];
 
 // #define HASH_TABLE_BUCKET_TYPE HashTableBucketPage<KeyType, ValueType, KeyComparator>
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_BUCKET_TYPE::Init() {
+  overflow_page_id_ = INVALID_PAGE_ID;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::GetOverflowPageId() const -> page_id_t {
+  return overflow_page_id_;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_BUCKET_TYPE::SetOverflowPageId(page_id_t overflow_page_id) {
+  overflow_page_id_ = overflow_page_id;
+}
+
 /**
  * Scan the bucket and collect values that have the matching key
  *
@@ -37,13 +59,17 @@ namespace bustub {
 // 同样的key可以对应不同的value
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) -> bool {
-  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    // LOG_INFO("judge page %d", i);
-    if (IsReadable(i) && cmp(key, array_[i].first) == 0) {
-      result->push_back(array_[i].second);
+  auto fingerprint = Fingerprint(key);
+  for (uint32_t group = 0; group * BUCKET_FINGERPRINT_GROUP < BUCKET_ARRAY_SIZE; group++) {
+    // 只对指纹相同的可读槽位调用比较器
+    for (uint32_t match = MatchGroup(group, fingerprint); match != 0; match &= match - 1) {
+      uint32_t i = group * BUCKET_FINGERPRINT_GROUP + __builtin_ctz(match);
+      if (cmp(key, array_[i].first) == 0) {
+        result->push_back(array_[i].second);
+      }
     }
     // 因为插入是顺序插入，所以一旦遇到没有用过的就可以直接结束了
-    if (!IsOccupied(i)) {
+    if (GroupBits(occupied_, group) != GroupSlots(group)) {
       break;
     }
   }
@@ -57,47 +83,103 @@ auto HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator
   if (IsFull()) {
     return false;
   }
-  // 过程中判断有没有同样的k v 对, 找到相同的k和v不插入
-  std::vector<ValueType> res;
-  GetValue(key, cmp, &res);
-  if (std::find(res.begin(), res.end(), value) != res.end()) {
-    return false;
-  }
-
-  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (!IsReadable(i)) {  // 只用判断isreadable remove之后的地方也可以插入
-      SetOccupied(i);
-      SetReadable(i);
-      // #define MappingType std::pair<KeyType, ValueType>
-      // array_[i] = std::make_pair(key, value);
-      array_[i] = MappingType(key, value);  // 自定义和上面一样
-      return true;
+  // 过程中判断有没有同样的k v 对, 找到相同的k和v不插入, 顺便记下第一个不可读的槽位
+  auto fingerprint = Fingerprint(key);
+  uint32_t free_slot = BUCKET_ARRAY_SIZE;
+  for (uint32_t group = 0; group * BUCKET_FINGERPRINT_GROUP < BUCKET_ARRAY_SIZE; group++) {
+    for (uint32_t match = MatchGroup(group, fingerprint); match != 0; match &= match - 1) {
+      uint32_t i = group * BUCKET_FINGERPRINT_GROUP + __builtin_ctz(match);
+      if (cmp(key, array_[i].first) == 0 && array_[i].second == value) {
+        return false;
+      }
+    }
+    // 只用判断isreadable remove之后的地方也可以插入
+    uint32_t free = GroupBits(readable_, group) ^ GroupSlots(group);
+    if (free_slot == BUCKET_ARRAY_SIZE && free != 0) {
+      free_slot = group * BUCKET_FINGERPRINT_GROUP + __builtin_ctz(free);
+    }
+    if (GroupBits(occupied_, group) != GroupSlots(group)) {
+      break;
     }
   }
-  return false;
+
+  SetOccupied(free_slot);
+  SetReadable(free_slot);
+  fingerprints_[free_slot] = fingerprint;
+  array_[free_slot] = MappingType(key, value);
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_BUCKET_TYPE::InsertAt(uint32_t bucket_idx, const KeyType &key, const ValueType &value) {
+  SetOccupied(bucket_idx);
+  SetReadable(bucket_idx);
+  fingerprints_[bucket_idx] = Fingerprint(key);
+  array_[bucket_idx] = MappingType(key, value);
 }
 
 // task2
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator cmp) -> bool {
-  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    // 删除一个条目之后,IsOccupied仍然显示占据状态,删除只修改readable
-    if (IsReadable(i) && cmp(key, KeyAt(i)) == 0 && value == ValueAt(i)) {
-      // uint32_t mask = 1 << (i % 8);
-      // // occupied_[i / 8] &= ~mask;  // 设置为0
-      // readable_[i / 8] &= ~mask;  // mask取反 01111
-      // return true;
-      RemoveAt(i);
-      return true;
+  auto fingerprint = Fingerprint(key);
+  for (uint32_t group = 0; group * BUCKET_FINGERPRINT_GROUP < BUCKET_ARRAY_SIZE; group++) {
+    for (uint32_t match = MatchGroup(group, fingerprint); match != 0; match &= match - 1) {
+      uint32_t i = group * BUCKET_FINGERPRINT_GROUP + __builtin_ctz(match);
+      // 删除一个条目之后,IsOccupied仍然显示占据状态,删除只修改readable
+      if (cmp(key, KeyAt(i)) == 0 && value == ValueAt(i)) {
+        RemoveAt(i);
+        return true;
+      }
     }
     // 因为插入是顺序插入，所以一旦遇到没有用过的就可以直接结束了
-    if (!IsOccupied(i)) {
+    if (GroupBits(occupied_, group) != GroupSlots(group)) {
       break;
     }
   }
   return false;
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::Fingerprint(const KeyType &key) -> uint8_t {
+  // 不能用目录的murmur hash, 同一个bucket里key的hash低位都相同
+  auto hash = HashUtil::HashBytes(reinterpret_cast<const char *>(&key), sizeof(KeyType));
+  return static_cast<uint8_t>((hash * 0x9E3779B97F4A7C15ULL) >> 56);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::MatchGroup(uint32_t group, uint8_t fingerprint) const -> uint32_t {
+  const uint8_t *fingerprints = fingerprints_ + group * BUCKET_FINGERPRINT_GROUP;
+#if defined(__SSE2__)
+  static_assert(BUCKET_FINGERPRINT_GROUP == sizeof(__m128i));
+  __m128i group_fingerprints = _mm_loadu_si128(reinterpret_cast<const __m128i *>(fingerprints));
+  __m128i equal = _mm_cmpeq_epi8(group_fingerprints, _mm_set1_epi8(static_cast<char>(fingerprint)));
+  auto match = static_cast<uint32_t>(_mm_movemask_epi8(equal));
+#else
+  uint32_t match = 0;
+  for (uint32_t i = 0; i < BUCKET_FINGERPRINT_GROUP; i++) {
+    match |= static_cast<uint32_t>(fingerprints[i] == fingerprint) << i;
+  }
+#endif
+  return match & GroupBits(readable_, group);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::GroupBits(const char *bitmap, uint32_t group) const -> uint32_t {
+  uint32_t bits = 0;
+  uint32_t first_byte = group * BUCKET_FINGERPRINT_GROUP / 8;
+  for (uint32_t i = 0; i < BUCKET_FINGERPRINT_GROUP / 8 && first_byte + i < GetOccupiedSize(); i++) {
+    bits |= static_cast<uint32_t>(static_cast<uint8_t>(bitmap[first_byte + i])) << (8 * i);
+  }
+  return bits & GroupSlots(group);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::GroupSlots(uint32_t group) const -> uint32_t {
+  // 最后一组可能不满, BUCKET_ARRAY_SIZE之后的槽位不存在
+  uint32_t slots = std::min<uint32_t>(BUCKET_ARRAY_SIZE - group * BUCKET_FINGERPRINT_GROUP, BUCKET_FINGERPRINT_GROUP);
+  return (1U << slots) - 1;
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_BUCKET_TYPE::KeyAt(uint32_t bucket_idx) const -> KeyType {
   return array_[bucket_idx].first;
@@ -22,6 +22,7 @@
 //   uint32_t global_depth_{0};  // 全局位置编码
 //   uint8_t local_depths_[DIRECTORY_ARRAY_SIZE];  // 局部位置编码, 表示在槽slot中找到对应的桶所需要的位数(深度)
 //   page_id_t bucket_page_ids_[DIRECTORY_ARRAY_SIZE];  // 这是一个数组存储每个bucket_id对应的page_id
+//   page_id_t next_segment_page_id_;  // 目录超过一页时下一段的page_id
 
 namespace bustub {
 auto HashTableDirectoryPage::GetPageId() const -> page_id_t { return page_id_; }
@@ -32,6 +33,10 @@ auto HashTableDirectoryPage::GetLSN() const -> lsn_t { return lsn_; }
 
 void HashTableDirectoryPage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
 
+auto HashTableDirectoryPage::GetNextSegmentPageId() const -> page_id_t { return next_segment_page_id_; }
+
+void HashTableDirectoryPage::SetNextSegmentPageId(page_id_t page_id) { next_segment_page_id_ = page_id; }
+
 auto HashTableDirectoryPage::GetGlobalDepth() -> uint32_t { return global_depth_; }
 
 // 和全局深度相同的mask,其实就是取全局深度,和全局深度相同长度的掩码的意思
@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -688,4 +689,117 @@ TEST(CatalogTest, IndexInteraction3) {
   remove("catalog_test.log");
 }
 
+// A B+ tree index without included columns, built bottom-up over the rows already in the table
+TEST(CatalogTest, BPlusTreeIndexBulkBuild) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(64, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+  // B+树索引的 header page 必须是 page 0
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  std::vector<Column> columns{{"A", TypeId::BIGINT}};
+  Schema table_schema{columns};
+  auto *table_info = catalog->CreateTable(txn.get(), "foobar", table_schema);
+  const int64_t key_count = 100;
+  std::vector<std::vector<RID>> rids(key_count);
+  for (int64_t i = 0; i < 2000; i++) {
+    Tuple tuple{{ValueFactory::GetBigIntValue((i * 37) % key_count)}, &table_schema};
+    RID rid;
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rid, txn.get()));
+    rids[(i * 37) % key_count].push_back(rid);
+  }
+
+  Schema key_schema{std::vector<Column>{{"A", TypeId::BIGINT}}};
+  auto *index_info = catalog->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      txn.get(), "index1", "foobar", table_schema, key_schema, {0}, 8, HashFunction<GenericKey<8>>{},
+      IndexType::BPlusTree);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+  auto *index = dynamic_cast<BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>> *>(index_info->index_.get());
+  ASSERT_NE(nullptr, index);
+
+  for (int64_t key = 0; key < key_count; key++) {
+    Tuple key_tuple{{ValueFactory::GetBigIntValue(key)}, index->GetKeySchema()};
+    std::vector<RID> results;
+    index->ScanKey(key_tuple, &results, txn.get());
+    std::sort(results.begin(), results.end(), [](const RID &a, const RID &b) { return a.Get() < b.Get(); });
+    std::sort(rids[key].begin(), rids[key].end(), [](const RID &a, const RID &b) { return a.Get() < b.Get(); });
+    ASSERT_EQ(rids[key], results) << key;
+  }
+  // 逐条插入的叶子平均只有七成满, 自底向上建的叶子几乎是满的
+  index->Analyze();
+  EXPECT_GT(index->GetStatistics().fill_factor_, 0.85);
+
+  // 建好之后照常逐条插入和删除
+  Tuple key_tuple{{ValueFactory::GetBigIntValue(key_count)}, index->GetKeySchema()};
+  index->InsertEntry(key_tuple, RID{1, 1}, txn.get());
+  std::vector<RID> results;
+  index->ScanKey(key_tuple, &results, txn.get());
+  ASSERT_EQ(std::vector<RID>{RID(1, 1)}, results);
+  index->DeleteEntry(key_tuple, RID{1, 1}, txn.get());
+  results.clear();
+  index->ScanKey(key_tuple, &results, txn.get());
+  ASSERT_TRUE(results.empty());
+
+  // 哈希索引放不下包含列
+  EXPECT_THROW((catalog->CreateIndex<GenericKey<32>, RID, GenericComparator<32>>(
+                   txn.get(), "index2", "foobar", table_schema, key_schema, {0}, 32, HashFunction<GenericKey<32>>{},
+                   IndexType::ExtendibleHash, {0})),
+               Exception);
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+TEST(CatalogTest, LongVarcharKeyRecheck) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(32, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+  // B+树索引的 header page 必须是 page 0
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  // names longer than the 20 key bytes a GenericKey<32> has left next to the rid and the included column
+  std::vector<Column> columns{{"name", TypeId::VARCHAR, 64}, {"n", TypeId::INTEGER}};
+  Schema table_schema{columns};
+  auto *table_info = catalog->CreateTable(txn.get(), "foobar", table_schema);
+  std::string prefix(40, 'x');
+  std::vector<RID> rids;
+  for (int i = 0; i < 10; i++) {
+    Tuple tuple{{ValueFactory::GetVarcharValue(prefix + std::to_string(i)), ValueFactory::GetIntegerValue(i)},
+                &table_schema};
+    RID rid;
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rid, txn.get()));
+    rids.push_back(rid);
+  }
+  Schema key_schema{std::vector<Column>{{"name", TypeId::VARCHAR, 64}}};
+  auto *index_info = catalog->CreateIndex<GenericKey<32>, RID, GenericComparator<32>>(
+      txn.get(), "index1", "foobar", table_schema, key_schema, {0}, 32, HashFunction<GenericKey<32>>{},
+      IndexType::BPlusTree, {1});
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+  auto *index = index_info->index_.get();
+
+  // every name shares the cut-off prefix, the recheck keeps only the row that really matches
+  for (int i = 0; i < 10; i++) {
+    Tuple key{{ValueFactory::GetVarcharValue(prefix + std::to_string(i)), ValueFactory::GetIntegerValue(0)},
+              index->GetKeySchema()};
+    std::vector<RID> results;
+    index->ScanKey(key, &results, txn.get());
+    ASSERT_EQ(std::vector<RID>{rids[i]}, results) << i;
+  }
+  Tuple missing{{ValueFactory::GetVarcharValue(prefix + "missing"), ValueFactory::GetIntegerValue(0)},
+                index->GetKeySchema()};
+  std::vector<std::vector<RID>> batch;
+  index->ScanKeys({missing}, &batch, txn.get());
+  ASSERT_EQ(1, batch.size());
+  EXPECT_TRUE(batch[0].empty());
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
 }  // namespace bustub
@@ -0,0 +1,181 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// cuckoo_hash_table_test.cpp
+//
+// Identification: test/container/cuckoo_hash_table_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "container/hash/cuckoo_hash_table.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(CuckooHashTableTest, SampleTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  CuckooHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 2, HashFunction<int>());
+
+  // the table starts with two buckets and grows as inserts run out of room
+  int num_keys = 20000;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i)) << i;
+    EXPECT_FALSE(ht.Insert(nullptr, i, i));
+  }
+  EXPECT_GT(ht.GetSize(), 2);
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_TRUE(ht.GetValue(nullptr, i, &res)) << i;
+    ASSERT_EQ(1, res.size());
+    EXPECT_EQ(i, res[0]);
+  }
+
+  // a second value for every even key
+  for (int i = 0; i < num_keys; i += 2) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, num_keys + i)) << i;
+  }
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, i, &res);
+    ASSERT_EQ(i % 2 == 0 ? 2 : 1, res.size()) << i;
+  }
+
+  // an explicit resize keeps every entry
+  auto size = ht.GetSize();
+  ht.Resize(size);
+  EXPECT_GE(ht.GetSize(), 2 * size);
+
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, i, i)) << i;
+    EXPECT_FALSE(ht.Remove(nullptr, i, i));
+    std::vector<int> res;
+    ASSERT_EQ(i % 2 == 0, ht.GetValue(nullptr, i, &res)) << i;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(CuckooHashTableTest, DuplicateKeyTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  CuckooHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 16, HashFunction<int>());
+
+  for (int i = 0; i < 2000; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i)) << i;
+  }
+  // a run of one key longer than its two buckets hold spills into an overflow chain
+  int num_dups = 2000;
+  for (int i = 0; i < num_dups; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, -1, i)) << i;
+  }
+  EXPECT_FALSE(ht.Insert(nullptr, -1, 0));
+  std::vector<int> res;
+  ASSERT_TRUE(ht.GetValue(nullptr, -1, &res));
+  EXPECT_EQ(num_dups, res.size());
+  for (int i = 0; i < 2000; i++) {
+    res.clear();
+    ASSERT_TRUE(ht.GetValue(nullptr, i, &res)) << i;
+    ASSERT_EQ(1, res.size());
+  }
+
+  for (int i = 0; i < num_dups; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, -1, i)) << i;
+  }
+  res.clear();
+  EXPECT_FALSE(ht.GetValue(nullptr, -1, &res));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(CuckooHashTableTest, LargeTableTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  CuckooHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 2, HashFunction<int>());
+
+  // more buckets than one header page lists, the bucket page ids go on a chain of header pages
+  ht.Resize(HEADER_ARRAY_SIZE);
+  EXPECT_GE(ht.GetSize(), 2 * HEADER_ARRAY_SIZE);
+  int num_keys = 20000;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i)) << i;
+  }
+  auto size = ht.GetSize();
+  ht.Resize(size);
+  EXPECT_GE(ht.GetSize(), 2 * size);
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_TRUE(ht.GetValue(nullptr, i, &res)) << i;
+    ASSERT_EQ(1, res.size());
+    EXPECT_EQ(i, res[0]);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(CuckooHashTableTest, ConcurrentTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  CuckooHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 2, HashFunction<int>());
+
+  // inserts that find room, displace entries and resize the table run at the same time
+  int num_threads = 4;
+  int keys_per_thread = 10000;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&, tid]() {
+      for (int i = tid; i < num_threads * keys_per_thread; i += num_threads) {
+        ASSERT_TRUE(ht.Insert(nullptr, i, i));
+        std::vector<int> res;
+        ASSERT_TRUE(ht.GetValue(nullptr, i, &res));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&, tid]() {
+      for (int i = tid; i < num_threads * keys_per_thread; i += num_threads) {
+        if (i % 3 != 0) {
+          ASSERT_TRUE(ht.Remove(nullptr, i, i));
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < num_threads * keys_per_thread; i++) {
+    std::vector<int> res;
+    ASSERT_EQ(i % 3 == 0, ht.GetValue(nullptr, i, &res)) << i;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+}  // namespace bustub
@@ -406,6 +406,62 @@ void MixTest2Call() {
   }
 }
 
+void ThroughputTestCall() {
+  const int num_preserved = 20000;
+  const int keys_per_thread = 10000;
+  for (size_t num_threads : {1, 2, 4, 8}) {
+    auto *disk_manager = new DiskManager("test.db");
+    auto *bpm = new BufferPoolManagerInstance(1024, disk_manager);
+    ExtendibleHashTable<int, int, IntComparator> hash_table("foo_pk", bpm, IntComparator(), HashFunction<int>());
+
+    std::vector<int> perserved_keys;
+    for (int key = 0; key < num_preserved; key++) {
+      perserved_keys.emplace_back(key);
+    }
+    InsertHelper(&hash_table, perserved_keys, 1);
+
+    // every thread inserts its own key range, splitting buckets, and looks up a preserved key after each insert
+    auto mixed_task = [&](size_t tid) {
+      int first = num_preserved + static_cast<int>(tid) * keys_per_thread;
+      for (int i = 0; i < keys_per_thread; i++) {
+        hash_table.Insert(nullptr, first + i, first + i);
+        int key = (first + i * 7) % num_preserved;
+        std::vector<int> result;
+        hash_table.GetValue(nullptr, key, &result);
+        EXPECT_EQ(result.size(), 1);
+      }
+    };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; i++) {
+      threads.emplace_back(std::thread{mixed_task, i});
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+      threads[i].join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t ops = 2 * num_threads * keys_per_thread;
+    std::cout << "[ THROUGHPUT ] threads: " << num_threads << ", ops: " << ops
+              << ", ops/s: " << static_cast<size_t>(ops / elapsed) << std::endl;
+
+    size_t size = 0;
+    int total_keys = num_preserved + static_cast<int>(num_threads) * keys_per_thread;
+    for (int key = 0; key < total_keys; key++) {
+      std::vector<int> result;
+      hash_table.GetValue(nullptr, key, &result);
+      size += static_cast<size_t>(result.size() == 1 && result[0] == key);
+    }
+    EXPECT_EQ(size, total_keys);
+    hash_table.VerifyIntegrity();
+
+    disk_manager->ShutDown();
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
 /*
  * Score: 5
  * Description: Concurrently insert a set of keys.
@@ -475,4 +531,15 @@ TEST(HashTableConcurrentTest2, MixTest2) {
   TEST_TIMEOUT_FAIL_END(3 * 1000 * 120)
 }
 
+/*
+ * Description: Mixed inserts and lookups with 1, 2, 4 and 8 threads.
+ * Reports the throughput for each thread count and checks that every
+ * key is found afterwards.
+ */
+TEST(HashTableConcurrentTest2, ThroughputTest) {
+  TEST_TIMEOUT_BEGIN
+  ThroughputTestCall();
+  TEST_TIMEOUT_FAIL_END(3 * 1000 * 120)
+}
+
 }  // namespace bustub
@@ -10,6 +10,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <chrono>  // NOLINT
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -115,4 +117,73 @@ TEST(HashTablePageTest, BucketPageSampleTest) {
   delete bpm;
 }
 
+// NOLINTNEXTLINE
+TEST(HashTablePageTest, BucketPageFingerprintProbeTest) {
+  using KeyType = int;
+  using ValueType = int;
+  const uint32_t capacity = BUCKET_ARRAY_SIZE;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
+
+  for (uint32_t fill_percent : {25, 50, 75, 100}) {
+    page_id_t bucket_page_id = INVALID_PAGE_ID;
+    auto bucket_page = reinterpret_cast<HashTableBucketPage<int, int, IntComparator> *>(
+        bpm->NewPage(&bucket_page_id, nullptr)->GetData());
+    int num_keys = static_cast<int>(capacity * fill_percent / 100);
+    for (int i = 0; i < num_keys; i++) {
+      ASSERT_TRUE(bucket_page->Insert(i, i, IntComparator()));
+    }
+    EXPECT_EQ(bucket_page->IsFull(), fill_percent == 100);
+
+    // tombstones and duplicate keys are still handled through the fingerprints
+    if (num_keys > 2) {
+      EXPECT_FALSE(bucket_page->Insert(1, 1, IntComparator()));
+      EXPECT_TRUE(bucket_page->Remove(1, 1, IntComparator()));
+      EXPECT_TRUE(bucket_page->Insert(2, -2, IntComparator()));
+      std::vector<int> res;
+      EXPECT_FALSE(bucket_page->GetValue(1, IntComparator(), &res));
+      EXPECT_TRUE(bucket_page->GetValue(2, IntComparator(), &res));
+      EXPECT_EQ(res.size(), 2);
+      EXPECT_TRUE(bucket_page->Remove(2, -2, IntComparator()));
+      EXPECT_TRUE(bucket_page->Insert(1, 1, IntComparator()));
+      EXPECT_EQ(bucket_page->KeyAt(1), 1);
+    }
+
+    // probe ns/op for hits and misses, against a scan that compares every readable slot
+    const int rounds = 20;
+    int64_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+      for (int i = 0; i < num_keys; i++) {
+        std::vector<int> res;
+        found += static_cast<int64_t>(bucket_page->GetValue(i + round % 2 * num_keys, IntComparator(), &res));
+      }
+    }
+    auto fingerprint_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    int64_t scanned = 0;
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+      for (int i = 0; i < num_keys; i++) {
+        int key = i + round % 2 * num_keys;
+        for (uint32_t slot = 0; slot < capacity && bucket_page->IsOccupied(slot); slot++) {
+          scanned += static_cast<int64_t>(bucket_page->IsReadable(slot) && bucket_page->KeyAt(slot) == key);
+        }
+      }
+    }
+    auto scan_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(found, scanned);
+    EXPECT_EQ(found, static_cast<int64_t>(rounds / 2) * num_keys);
+    int probes = std::max(rounds * num_keys, 1);
+    std::cout << "[ PROBE ] fill: " << fill_percent << "%, fingerprint ns/op: " << fingerprint_ns / probes
+              << ", scan ns/op: " << scan_ns / probes << std::endl;
+
+    bpm->UnpinPage(bucket_page_id, true, nullptr);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
 }  // namespace bustub
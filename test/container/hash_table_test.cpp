@@ -10,10 +10,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <memory>
 #include <thread>  // NOLINT
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include "common/config.h"
 #include "common/logger.h"
 #include "container/hash/extendible_hash_table.h"
 #include "gtest/gtest.h"
@@ -150,4 +153,638 @@ TEST(HashTableTest, SampleTest) {
   std::cout << "[----------] all test ends" << std::endl;
 }
 
+// NOLINTNEXTLINE
+TEST(HashTableTest, BatchedLookupTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // enough keys to split buckets, every key has two values and odd keys are missing
+  int num_keys = 2000;
+  for (int i = 0; i < num_keys; i += 2) {
+    ht.Insert(nullptr, i, i);
+    ht.Insert(nullptr, i, -i - 1);
+  }
+
+  std::vector<int> keys;
+  for (int i = num_keys + 9; i >= -10; i -= 3) {
+    keys.push_back(i);
+  }
+  keys.push_back(4);
+  keys.push_back(4);
+  std::vector<std::vector<int>> results;
+  int found = ht.GetValues(nullptr, keys, &results);
+  ASSERT_EQ(results.size(), keys.size());
+  int expected_found = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::vector<int> res;
+    expected_found += static_cast<int>(ht.GetValue(nullptr, keys[i], &res));
+    EXPECT_EQ(results[i], res) << keys[i];
+  }
+  EXPECT_EQ(found, expected_found);
+  EXPECT_EQ(ht.GetValues(nullptr, {}, &results), 0);
+  EXPECT_TRUE(results.empty());
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, BatchedLookupWindowTest) {
+  // a pool of 16 frames lets a batch pin only two buckets at a time
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(16, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  int num_keys = 20000;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i));
+  }
+  std::vector<int> keys;
+  for (int i = -100; i < num_keys + 100; i++) {
+    keys.push_back(i);
+  }
+  std::vector<std::vector<int>> results;
+  EXPECT_EQ(ht.GetValues(nullptr, keys, &results), num_keys);
+  for (size_t i = 0; i < keys.size(); i++) {
+    bool present = keys[i] >= 0 && keys[i] < num_keys;
+    ASSERT_EQ(results[i], present ? std::vector<int>{keys[i]} : std::vector<int>()) << keys[i];
+  }
+  ht.VerifyIntegrity();
+
+  // with every frame but two pinned elsewhere the window shrinks to a single bucket and a directory segment
+  std::vector<page_id_t> pinned(14);
+  for (auto &page_id : pinned) {
+    ASSERT_NE(bpm->NewPage(&page_id), nullptr);
+  }
+  EXPECT_EQ(ht.GetValues(nullptr, keys, &results), num_keys);
+  for (size_t i = 0; i < keys.size(); i++) {
+    ASSERT_EQ(results[i].size(), keys[i] >= 0 && keys[i] < num_keys ? 1 : 0) << keys[i];
+  }
+  // with one free frame the bucket and its segment no longer fit, so the lookup fails and leaves the table usable
+  page_id_t last_page_id;
+  ASSERT_NE(bpm->NewPage(&last_page_id), nullptr);
+  EXPECT_THROW(ht.GetValues(nullptr, keys, &results), Exception);
+  bpm->UnpinPage(last_page_id, false);
+  for (auto page_id : pinned) {
+    bpm->UnpinPage(page_id, false);
+  }
+  EXPECT_EQ(ht.GetValues(nullptr, keys, &results), num_keys);
+  EXPECT_TRUE(ht.Insert(nullptr, num_keys, num_keys));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, MultiPageDirectoryTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // more keys than 512 buckets can hold, so the directory spills into more segments
+  int num_keys = 300000;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i)) << i;
+  }
+  EXPECT_GT(ht.GetGlobalDepth(), MAX_BUCKET_DEPTH);
+  ht.VerifyIntegrity();
+
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_TRUE(ht.GetValue(nullptr, i, &res)) << i;
+    ASSERT_EQ(1, res.size());
+    EXPECT_EQ(i, res[0]);
+  }
+  std::vector<int> keys;
+  for (int i = 0; i < num_keys + 1000; i += 7) {
+    keys.push_back(i);
+  }
+  std::vector<std::vector<int>> results;
+  EXPECT_EQ(ht.GetValues(nullptr, keys, &results), (num_keys + 6) / 7);
+
+  // removing everything merges the buckets back and shrinks the directory to a single page
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, i, i)) << i;
+  }
+  ht.VerifyIntegrity();
+  EXPECT_LE(ht.GetGlobalDepth(), 1);
+  for (int i = 0; i < num_keys; i += 97) {
+    std::vector<int> res;
+    EXPECT_FALSE(ht.GetValue(nullptr, i, &res));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, ConcurrentDirectoryGrowthTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // the threads keep reading back their own keys while the directory doubles past one page under them
+  int num_threads = 4;
+  int keys_per_thread = 75000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&ht, t, num_threads, keys_per_thread] {
+      for (int i = 0; i < keys_per_thread; i++) {
+        int key = i * num_threads + t;
+        EXPECT_TRUE(ht.Insert(nullptr, key, key));
+        std::vector<int> res;
+        int probe = (i / 2) * num_threads + t;
+        EXPECT_TRUE(ht.GetValue(nullptr, probe, &res)) << probe;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_GT(ht.GetGlobalDepth(), MAX_BUCKET_DEPTH);
+  ht.VerifyIntegrity();
+
+  threads.clear();
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&ht, t, num_threads, keys_per_thread] {
+      for (int i = 0; i < keys_per_thread; i++) {
+        int key = i * num_threads + t;
+        EXPECT_TRUE(ht.Remove(nullptr, key, key)) << key;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ht.VerifyIntegrity();
+  EXPECT_LE(ht.GetGlobalDepth(), 1);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+TEST(HashTableTest, OverflowChainTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // one key with a run of values filling several buckets, mixed with ordinary keys
+  int dup_key = 7;
+  int num_dups = 1500;
+  for (int i = 0; i < num_dups; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, dup_key, i)) << i;
+    ASSERT_TRUE(ht.Insert(nullptr, 1000 + i, i)) << i;
+  }
+  EXPECT_FALSE(ht.Insert(nullptr, dup_key, 0));
+  EXPECT_FALSE(ht.Insert(nullptr, dup_key, num_dups - 1));
+  ht.VerifyIntegrity();
+
+  std::vector<int> res;
+  ASSERT_TRUE(ht.GetValue(nullptr, dup_key, &res));
+  ASSERT_EQ(num_dups, res.size());
+  std::sort(res.begin(), res.end());
+  for (int i = 0; i < num_dups; i++) {
+    EXPECT_EQ(i, res[i]);
+  }
+  for (int i = 0; i < num_dups; i += 13) {
+    res.clear();
+    ASSERT_TRUE(ht.GetValue(nullptr, 1000 + i, &res)) << i;
+    ASSERT_EQ(1, res.size());
+    EXPECT_EQ(i, res[0]);
+  }
+
+  // streaming visits every value once and stops as soon as the callback asks it to
+  int visited = 0;
+  EXPECT_TRUE(ht.ScanValues(nullptr, dup_key, [&visited](const int & /*value*/) {
+    visited++;
+    return true;
+  }));
+  EXPECT_EQ(num_dups, visited);
+  visited = 0;
+  EXPECT_FALSE(ht.ScanValues(nullptr, dup_key, [&visited](const int & /*value*/) { return ++visited < 10; }));
+  EXPECT_EQ(10, visited);
+
+  // removing the run unlinks the overflow pages, after which the buckets merge again
+  for (int i = 0; i < num_dups; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, dup_key, i)) << i;
+  }
+  EXPECT_FALSE(ht.Remove(nullptr, dup_key, 0));
+  res.clear();
+  EXPECT_FALSE(ht.GetValue(nullptr, dup_key, &res));
+  ht.VerifyIntegrity();
+  for (int i = 0; i < num_dups; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, 1000 + i, i)) << i;
+  }
+  ht.VerifyIntegrity();
+  EXPECT_LE(ht.GetGlobalDepth(), 1);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+TEST(HashTableTest, BulkLoadTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // enough keys for a multi-segment directory, plus a run of one key that needs an overflow chain
+  int num_keys = 100000;
+  int dup_key = -1;
+  int num_dups = 1000;
+  int next_key = 0;
+  auto next = [&](std::pair<int, int> *entry) {
+    if (next_key == num_keys + num_dups) {
+      return false;
+    }
+    *entry = next_key < num_keys ? std::make_pair(next_key, next_key) : std::make_pair(dup_key, next_key);
+    next_key++;
+    return true;
+  };
+  EXPECT_TRUE(ht.BulkLoad(nullptr, next));
+  EXPECT_GT(ht.GetGlobalDepth(), MAX_BUCKET_DEPTH);
+  ht.VerifyIntegrity();
+
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_TRUE(ht.GetValue(nullptr, i, &res)) << i;
+    ASSERT_EQ(1, res.size());
+    EXPECT_EQ(i, res[0]);
+  }
+  std::vector<int> res;
+  ASSERT_TRUE(ht.GetValue(nullptr, dup_key, &res));
+  EXPECT_EQ(num_dups, res.size());
+
+  // a loaded table is not empty, so a second load is refused without reading the input
+  next_key = 0;
+  EXPECT_FALSE(ht.BulkLoad(nullptr, next));
+  EXPECT_EQ(0, next_key);
+
+  // the loaded table keeps working with ordinary inserts and removes
+  EXPECT_FALSE(ht.Insert(nullptr, 7, 7));
+  for (int i = num_keys; i < num_keys + 1000; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i)) << i;
+  }
+  for (int i = 0; i < num_keys + 1000; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, i, i)) << i;
+  }
+  for (int i = num_keys; i < num_keys + num_dups; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, dup_key, i)) << i;
+  }
+  ht.VerifyIntegrity();
+  EXPECT_LE(ht.GetGlobalDepth(), 1);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+TEST(HashTableTest, BulkLoadSmallPoolTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(10, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // the input is many times what the pool holds, it is sorted in runs spilled to temporary pages
+  int num_keys = 50000;
+  int next_key = 0;
+  EXPECT_TRUE(ht.BulkLoad(nullptr, [&](std::pair<int, int> *entry) {
+    if (next_key == num_keys) {
+      return false;
+    }
+    *entry = std::make_pair(next_key, next_key);
+    next_key++;
+    return true;
+  }));
+  ht.VerifyIntegrity();
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_TRUE(ht.GetValue(nullptr, i, &res)) << i;
+    ASSERT_EQ(1, res.size());
+    EXPECT_EQ(i, res[0]);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, HashAlgorithmTest) {
+  // CRC32C check value, and the interleaved batch agrees with one-at-a-time hashing (13 bytes: word and byte tails)
+  EXPECT_EQ(0xE3069283, HashUtil::Crc32c("123456789", 9));
+  char records[7 * 13];
+  for (size_t i = 0; i < sizeof(records); i++) {
+    records[i] = static_cast<char>(i * 31);
+  }
+  uint32_t crcs[7];
+  HashUtil::Crc32cBatch(records, 13, 7, crcs);
+  for (size_t i = 0; i < 7; i++) {
+    EXPECT_EQ(HashUtil::Crc32c(records + i * 13, 13), crcs[i]);
+  }
+
+  for (auto algorithm : {HashAlgorithm::MURMUR3, HashAlgorithm::CRC32C, HashAlgorithm::WYHASH}) {
+    HashFunction<int> hash_fn(algorithm);
+    std::vector<int> keys(1000);
+    for (int i = 0; i < static_cast<int>(keys.size()); i++) {
+      keys[i] = i;
+    }
+    std::vector<uint64_t> hashes(keys.size());
+    hash_fn.GetHashes(keys.data(), keys.size(), hashes.data());
+    for (size_t i = 0; i < keys.size(); i++) {
+      ASSERT_EQ(hash_fn.GetHash(keys[i]), hashes[i]);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    EXPECT_EQ(hashes.end(), std::adjacent_find(hashes.begin(), hashes.end()));
+
+    // the table spreads keys over the directory with every algorithm
+    auto *disk_manager = new DiskManager("test.db");
+    auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+    ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), hash_fn);
+    int num_keys = 20000;
+    for (int i = 0; i < num_keys; i++) {
+      ASSERT_TRUE(ht.Insert(nullptr, i, i)) << i;
+    }
+    EXPECT_LE(ht.GetGlobalDepth(), 10);
+    ht.VerifyIntegrity();
+    std::vector<std::vector<int>> results;
+    EXPECT_EQ(keys.size(), ht.GetValues(nullptr, keys, &results));
+    for (int i = 0; i < num_keys; i++) {
+      ASSERT_TRUE(ht.Remove(nullptr, i, i)) << i;
+    }
+    EXPECT_LE(ht.GetGlobalDepth(), 1);
+
+    disk_manager->ShutDown();
+    remove("test.db");
+    delete disk_manager;
+    delete bpm;
+  }
+
+  // the interleaved CRC32C batch hashes like CRC32C one key at a time, also through a base class reference
+  Crc32cHashFunction<int> crc32c;
+  HashFunction<int> &batch_fn = crc32c;
+  HashFunction<int> single_fn(HashAlgorithm::CRC32C);
+  std::vector<int> keys(1000);
+  for (int i = 0; i < static_cast<int>(keys.size()); i++) {
+    keys[i] = i * 7919;
+  }
+  std::vector<uint64_t> hashes(keys.size());
+  batch_fn.GetHashes(keys.data(), keys.size(), hashes.data());
+  for (size_t i = 0; i < keys.size(); i++) {
+    ASSERT_EQ(single_fn.GetHash(keys[i]), hashes[i]);
+    ASSERT_EQ(batch_fn.GetHash(keys[i]), hashes[i]);
+  }
+  EXPECT_EQ(HashAlgorithm::CRC32C, batch_fn.Clone()->GetAlgorithm());
+}
+
+// a hash function that overrides GetHash only
+template <typename KeyType>
+class SkewedHashFunction : public HashFunction<KeyType> {
+ public:
+  using HashFunction<KeyType>::HashFunction;
+  auto GetHash(KeyType key) -> uint64_t override { return static_cast<uint64_t>(key) * 0x100000001ULL; }
+  auto Clone() const -> std::unique_ptr<HashFunction<KeyType>> override {
+    return std::make_unique<SkewedHashFunction>(*this);
+  }
+};
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, GetHashOnlySubclassTest) {
+  // the batch API falls back to the overridden GetHash for every algorithm
+  for (auto algorithm : {HashAlgorithm::MURMUR3, HashAlgorithm::CRC32C, HashAlgorithm::WYHASH}) {
+    SkewedHashFunction<int> skewed(algorithm);
+    HashFunction<int> &hash_fn = skewed;
+    std::vector<int> keys{0, 1, 7, 42, 1000, -3};
+    std::vector<uint64_t> hashes(keys.size());
+    hash_fn.GetHashes(keys.data(), keys.size(), hashes.data());
+    for (size_t i = 0; i < keys.size(); i++) {
+      EXPECT_EQ(hash_fn.GetHash(keys[i]), hashes[i]) << keys[i];
+    }
+  }
+
+  // batched lookups and bulk loads place keys where single inserts and lookups do
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(),
+                                                  SkewedHashFunction<int>(HashAlgorithm::CRC32C));
+  int num_keys = 5000;
+  std::vector<int> keys;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i)) << i;
+    keys.push_back(i);
+  }
+  std::vector<std::vector<int>> results;
+  EXPECT_EQ(num_keys, ht.GetValues(nullptr, keys, &results));
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_EQ(std::vector<int>{i}, results[i]) << i;
+  }
+  ht.VerifyIntegrity();
+
+  ExtendibleHashTable<int, int, IntComparator> loaded("blah", bpm, IntComparator(),
+                                                      SkewedHashFunction<int>(HashAlgorithm::CRC32C));
+  int next_key = 0;
+  EXPECT_TRUE(loaded.BulkLoad(nullptr, [&](std::pair<int, int> *entry) {
+    *entry = {next_key, next_key};
+    return next_key++ < num_keys;
+  }));
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_TRUE(loaded.GetValue(nullptr, i, &res)) << i;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// a hash function whose low MAX_GLOBAL_DEPTH bits are zero for every key
+template <typename KeyType>
+class HighBitsHashFunction : public HashFunction<KeyType> {
+ public:
+  auto GetHash(KeyType key) -> uint64_t override { return static_cast<uint64_t>(key) << MAX_GLOBAL_DEPTH; }
+  auto Clone() const -> std::unique_ptr<HashFunction<KeyType>> override {
+    return std::make_unique<HighBitsHashFunction>(*this);
+  }
+};
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, BulkLoadOverflowTest) {
+  using KeyType = int;
+  using ValueType = int;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HighBitsHashFunction<int>());
+
+  // more distinct hashes than a bucket holds, none of them separable within MAX_GLOBAL_DEPTH bits
+  int num_keys = 2 * BUCKET_ARRAY_SIZE;
+  int next_key = 0;
+  EXPECT_THROW(ht.BulkLoad(nullptr,
+                           [&](std::pair<int, int> *entry) {
+                             *entry = {next_key, next_key};
+                             return next_key++ < num_keys;
+                           }),
+               Exception);
+  ht.VerifyIntegrity();
+  int found = 0;
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    found += static_cast<int>(ht.GetValue(nullptr, i, &res));
+  }
+  EXPECT_GT(found, 0);
+  EXPECT_LT(found, num_keys);
+  EXPECT_FALSE(ht.Insert(nullptr, num_keys, num_keys));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, CompactionTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // a wave of inserts, then every key but one in ten expires: buckets thin out but none empties
+  int num_keys = 40000;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i)) << i;
+  }
+  auto peak_depth = ht.GetGlobalDepth();
+  for (int i = 0; i < num_keys; i++) {
+    if (i % 10 != 0) {
+      ASSERT_TRUE(ht.Remove(nullptr, i, i)) << i;
+    }
+  }
+  EXPECT_EQ(peak_depth, ht.GetGlobalDepth());
+
+  EXPECT_GT(ht.Compact(), 0);
+  EXPECT_LT(ht.GetGlobalDepth(), peak_depth);
+  ht.VerifyIntegrity();
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_EQ(i % 10 == 0, ht.GetValue(nullptr, i, &res)) << i;
+  }
+  // nothing was removed since, so there is nothing left to merge
+  EXPECT_EQ(0, ht.Compact());
+
+  // waves of churn with the background thread merging what each wave leaves behind
+  auto interval = compaction_interval;
+  compaction_interval = std::chrono::milliseconds(1);
+  ht.StartCompaction();
+  std::vector<std::thread> threads;
+  for (int thread_itr = 0; thread_itr < 2; thread_itr++) {
+    threads.emplace_back([&, thread_itr]() {
+      for (int round = 0; round < 3; round++) {
+        for (int i = 1 + thread_itr; i < num_keys; i++) {
+          if (i % 10 != 0 && i % 2 == thread_itr) {
+            ht.Insert(nullptr, i, i);
+          }
+        }
+        for (int i = 1 + thread_itr; i < num_keys; i++) {
+          if (i % 10 != 0 && i % 2 == thread_itr) {
+            ht.Remove(nullptr, i, i);
+          }
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ht.StopCompaction();
+  compaction_interval = interval;
+  ht.Compact();
+
+  // stopping wakes the background thread instead of waiting out its interval
+  compaction_interval = std::chrono::milliseconds(60000);
+  ht.StartCompaction();
+  auto start = std::chrono::steady_clock::now();
+  ht.StopCompaction();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  compaction_interval = interval;
+
+  ht.VerifyIntegrity();
+  EXPECT_LT(ht.GetGlobalDepth(), peak_depth);
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_EQ(i % 10 == 0, ht.GetValue(nullptr, i, &res)) << i;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTableTest, UnderfullSplitImageTest) {
+  using KeyType = int;
+  using ValueType = int;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // a full bucket of hashes ending in 00, then a few ending in 10 split it: the 10 side starts far below the threshold
+  HashFunction<int> hash_fn;
+  std::vector<int> low;
+  std::vector<int> high;
+  for (int key = 0; low.size() < BUCKET_ARRAY_SIZE || high.size() < 5; key++) {
+    auto bits = hash_fn.GetHash(key) & 3;
+    if (bits == 0 && low.size() < BUCKET_ARRAY_SIZE) {
+      low.push_back(key);
+    } else if (bits == 2 && high.size() < 5) {
+      high.push_back(key);
+    }
+  }
+  for (auto key : low) {
+    ASSERT_TRUE(ht.Insert(nullptr, key, key)) << key;
+  }
+  for (auto key : high) {
+    ASSERT_TRUE(ht.Insert(nullptr, key, key)) << key;
+  }
+  EXPECT_EQ(2, ht.GetGlobalDepth());
+
+  // thin the 00 side to the threshold, it is never below it and is not queued
+  while (low.size() > MERGE_CANDIDATE_SIZE) {
+    ASSERT_TRUE(ht.Remove(nullptr, low.back(), low.back()));
+    low.pop_back();
+  }
+  EXPECT_EQ(0, ht.Compact());
+
+  // the 10 side never crosses the threshold, any remove from it queues the bucket
+  ASSERT_TRUE(ht.Remove(nullptr, high.back(), high.back()));
+  high.pop_back();
+  EXPECT_EQ(1, ht.Compact());
+  EXPECT_EQ(1, ht.GetGlobalDepth());
+  ht.VerifyIntegrity();
+  for (auto key : low) {
+    std::vector<int> res;
+    ASSERT_TRUE(ht.GetValue(nullptr, key, &res)) << key;
+  }
+  for (auto key : high) {
+    std::vector<int> res;
+    ASSERT_TRUE(ht.GetValue(nullptr, key, &res)) << key;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
 }  // namespace bustub
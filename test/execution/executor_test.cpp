@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <memory>
 #include <numeric>
 #include <string>
@@ -31,6 +32,7 @@
 #include "execution/plans/delete_plan.h"
 #include "execution/plans/distinct_plan.h"
 #include "execution/plans/hash_join_plan.h"
+#include "execution/plans/index_scan_plan.h"
 #include "execution/plans/limit_plan.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/update_plan.h"
@@ -373,6 +375,137 @@ TEST_F(ExecutorTest, SimpleDeleteTest) {
   ASSERT_TRUE(rids.empty());
 }
 
+// SELECT colB, colC FROM test_1 WHERE colB < 3, through a covering index on colB that includes colC
+TEST_F(ExecutorTest, IndexOnlyScanTest) {
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  auto key_schema = ParseCreateStatement("b integer");
+  auto *index_info = GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<32>, RID, GenericComparator<32>>(
+      GetTxn(), "covering", "test_1", schema, *key_schema, {1}, 32, HashFunction<GenericKey<32>>{},
+      IndexType::BPlusTree, {2});
+  ASSERT_NE(index_info, Catalog::NULL_INDEX_INFO);
+  EXPECT_TRUE(index_info->index_->Covers({1, 2}));
+  EXPECT_FALSE(index_info->index_->Covers({1, 3}));
+
+  auto col_b = MakeColumnValueExpression(schema, 0, "colB");
+  auto col_c = MakeColumnValueExpression(schema, 0, "colC");
+  auto col_d = MakeColumnValueExpression(schema, 0, "colD");
+  auto const3 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(3));
+  auto predicate = MakeComparisonExpression(col_b, const3, ComparisonType::LessThan);
+  auto out_schema = MakeOutputSchema({{"colB", col_b}, {"colC", col_c}});
+  auto wide_schema = MakeOutputSchema({{"colB", col_b}, {"colD", col_d}});
+  SeqScanPlanNode seq_plan{wide_schema, predicate, table_info->oid_};
+  IndexScanPlanNode table_plan{out_schema, predicate, index_info->index_oid_};
+  IndexScanPlanNode index_only_plan{out_schema, predicate, index_info->index_oid_, true};
+  // colD is not covered, the index-only flag falls back to reading the table
+  IndexScanPlanNode fallback_plan{wide_schema, predicate, index_info->index_oid_, true};
+
+  std::vector<Tuple> seq_result;
+  std::vector<Tuple> table_result;
+  std::vector<Tuple> index_only_result;
+  std::vector<Tuple> fallback_result;
+  GetExecutionEngine()->Execute(&seq_plan, &seq_result, GetTxn(), GetExecutorContext());
+  GetExecutionEngine()->Execute(&table_plan, &table_result, GetTxn(), GetExecutorContext());
+  GetExecutionEngine()->Execute(&index_only_plan, &index_only_result, GetTxn(), GetExecutorContext());
+  GetExecutionEngine()->Execute(&fallback_plan, &fallback_result, GetTxn(), GetExecutorContext());
+
+  ASSERT_FALSE(seq_result.empty());
+  ASSERT_EQ(table_result.size(), seq_result.size());
+  ASSERT_EQ(index_only_result.size(), seq_result.size());
+  ASSERT_EQ(fallback_result.size(), seq_result.size());
+  int32_t last_b = 0;
+  for (size_t i = 0; i < table_result.size(); i++) {
+    // 结果按 colB 有序, 两种扫描逐行一致
+    auto b = table_result[i].GetValue(out_schema, 0).GetAs<int32_t>();
+    ASSERT_LT(b, 3);
+    ASSERT_GE(b, last_b);
+    last_b = b;
+    ASSERT_EQ(index_only_result[i].GetValue(out_schema, 0).GetAs<int32_t>(), b);
+    ASSERT_EQ(index_only_result[i].GetValue(out_schema, 1).GetAs<int32_t>(),
+              table_result[i].GetValue(out_schema, 1).GetAs<int32_t>());
+    ASSERT_EQ(fallback_result[i].GetValue(wide_schema, 0).GetAs<int32_t>(), b);
+  }
+
+  // point lookups go through the key part of the entries only
+  std::vector<RID> rids;
+  Tuple index_key({ValueFactory::GetIntegerValue(0), ValueFactory::GetIntegerValue(0)}, &index_info->key_schema_);
+  index_info->index_->ScanKey(index_key, &rids, GetTxn());
+  size_t zeros = 0;
+  for (const auto &tuple : table_result) {
+    zeros += static_cast<size_t>(tuple.GetValue(out_schema, 0).GetAs<int32_t>() == 0);
+  }
+  ASSERT_EQ(rids.size(), zeros);
+  for (const auto &rid : rids) {
+    Tuple tuple;
+    ASSERT_TRUE(table_info->table_->GetTuple(rid, &tuple, GetTxn()));
+    ASSERT_EQ(tuple.GetValue(&schema, 1).GetAs<int32_t>(), 0);
+    index_info->index_->DeleteEntry(tuple.KeyFromTuple(schema, index_info->key_schema_, {1, 2}), rid, GetTxn());
+  }
+  rids.clear();
+  index_info->index_->ScanKey(index_key, &rids, GetTxn());
+  ASSERT_TRUE(rids.empty());
+}
+
+// SELECT colA FROM test_1 WHERE <comparison on colA> [ORDER BY colA DESC], through a B+ tree index on colA
+TEST_F(ExecutorTest, RangeIndexScanTest) {
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  auto key_schema = ParseCreateStatement("a integer");
+  // included columns make the catalog build a B+ tree index
+  auto *index_info = GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<32>, RID, GenericComparator<32>>(
+      GetTxn(), "index_a", "test_1", schema, *key_schema, {0}, 32, HashFunction<GenericKey<32>>{},
+      IndexType::BPlusTree, {1});
+  ASSERT_NE(index_info, Catalog::NULL_INDEX_INFO);
+
+  auto col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto out_schema = MakeOutputSchema({{"colA", col_a}});
+  auto scan = [&](const AbstractExpression *predicate, bool descending) {
+    IndexScanPlanNode plan{out_schema, predicate, index_info->index_oid_, false, descending};
+    std::vector<Tuple> result;
+    GetExecutionEngine()->Execute(&plan, &result, GetTxn(), GetExecutorContext());
+    std::vector<int32_t> values;
+    for (const auto &tuple : result) {
+      values.push_back(tuple.GetValue(out_schema, 0).GetAs<int32_t>());
+    }
+    return values;
+  };
+  auto integer = [&](int32_t value) { return MakeConstantValueExpression(ValueFactory::GetIntegerValue(value)); };
+
+  // the bounds come from the predicate, open ends are rechecked, the constant may stand on either side
+  EXPECT_EQ(scan(MakeComparisonExpression(col_a, integer(996), ComparisonType::GreaterThanOrEqual), false),
+            (std::vector<int32_t>{996, 997, 998, 999}));
+  EXPECT_EQ(scan(MakeComparisonExpression(col_a, integer(996), ComparisonType::GreaterThan), true),
+            (std::vector<int32_t>{999, 998, 997}));
+  EXPECT_EQ(scan(MakeComparisonExpression(integer(3), col_a, ComparisonType::GreaterThan), true),
+            (std::vector<int32_t>{2, 1, 0}));
+  EXPECT_EQ(scan(MakeComparisonExpression(col_a, integer(500), ComparisonType::Equal), false),
+            (std::vector<int32_t>{500}));
+  EXPECT_TRUE(scan(MakeComparisonExpression(col_a, integer(5000), ComparisonType::Equal), true).empty());
+  // a bigint constant is cast to the column type, a decimal one leaves the bound open
+  auto bigint = MakeConstantValueExpression(ValueFactory::GetBigIntValue(997));
+  EXPECT_EQ(scan(MakeComparisonExpression(col_a, bigint, ComparisonType::LessThanOrEqual), true).size(), 998);
+  auto decimal = MakeConstantValueExpression(ValueFactory::GetDecimalValue(1.5));
+  EXPECT_EQ(scan(MakeComparisonExpression(col_a, decimal, ComparisonType::LessThan), false),
+            (std::vector<int32_t>{0, 1}));
+
+  // the bounds limit the walk itself, not just the output
+  auto *tree_index =
+      dynamic_cast<BPlusTreeIndex<GenericKey<32>, RID, GenericComparator<32>> *>(index_info->index_.get());
+  ASSERT_NE(tree_index, nullptr);
+  Value low = ValueFactory::GetIntegerValue(10);
+  Value high = ValueFactory::GetIntegerValue(19);
+  size_t walked = 0;
+  for (auto iterator = tree_index->GetLeadingColumnIterator(&low, &high, true); !iterator.IsEnd(); ++iterator) {
+    walked++;
+  }
+  EXPECT_EQ(walked, 10);
+
+  // without a usable predicate the whole index is walked, in either direction
+  auto all = scan(MakeComparisonExpression(col_a, integer(500), ComparisonType::NotEqual), true);
+  ASSERT_EQ(all.size(), 999);
+  EXPECT_TRUE(std::is_sorted(all.rbegin(), all.rend()));
+}
+
 // SELECT test_1.col_a, test_1.col_b, test_2.col1, test_2.col3 FROM test_1 JOIN test_2 ON test_1.col_a = test_2.col1;
 TEST_F(ExecutorTest, SimpleNestedLoopJoinTest) {
   const Schema *out_schema1;
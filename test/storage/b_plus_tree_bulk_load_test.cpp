@@ -0,0 +1,359 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_bulk_load_test.cpp
+//
+// Identification: test/storage/b_plus_tree_bulk_load_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/external_sorter.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+TEST(BPlusTreeBulkLoadTest, SortedTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 4);
+  GenericKey<8> index_key;
+  RID rid;
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  int64_t scale = 1000;
+  int64_t next_key = 1;
+  auto next = [&](std::pair<GenericKey<8>, RID> *item) {
+    if (next_key > scale) {
+      return false;
+    }
+    item->first.SetFromInteger(next_key);
+    item->second.Set(0, next_key);
+    next_key++;
+    return true;
+  };
+  EXPECT_TRUE(tree.BulkLoad(next));
+
+  std::vector<RID> rids;
+  for (int64_t key = 1; key <= scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+    EXPECT_EQ(rids[0].GetSlotNum(), key);
+  }
+
+  // leaves are packed and allocated one after another
+  Page *page = tree.FindLeafPage(index_key, true);
+  int64_t current_key = 1;
+  while (page != nullptr) {
+    auto *leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>> *>(page->GetData());
+    EXPECT_GE(leaf->GetSize(), leaf->GetMinSize());
+    EXPECT_LT(leaf->GetSize(), leaf->GetMaxSize());
+    for (int i = 0; i < leaf->GetSize(); i++) {
+      EXPECT_EQ(leaf->GetItem(i).second.GetSlotNum(), current_key);
+      current_key++;
+    }
+    page_id_t next_page_id = leaf->GetNextPageId();
+    EXPECT_TRUE(next_page_id == INVALID_PAGE_ID || next_page_id == leaf->GetPageId() + 1);
+    bpm->UnpinPage(page->GetPageId(), false);
+    page = next_page_id == INVALID_PAGE_ID ? nullptr : bpm->FetchPage(next_page_id);
+  }
+  EXPECT_EQ(current_key, scale + 1);
+
+  // the loaded tree keeps working with regular inserts and removes
+  for (int64_t key = scale + 1; key <= scale + 100; key++) {
+    index_key.SetFromInteger(key);
+    rid.Set(0, key);
+    EXPECT_TRUE(tree.Insert(index_key, rid));
+  }
+  for (int64_t key = 1; key <= scale + 100; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key);
+  }
+  current_key = 2;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key += 2;
+  }
+  EXPECT_EQ(current_key, scale + 102);
+
+  // only an empty tree can be bulk loaded
+  next_key = 1;
+  EXPECT_FALSE(tree.BulkLoad(next));
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeBulkLoadTest, UnsortedTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(10, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // every key appears twice, the first copy has slot 0
+  int64_t scale = 10000;
+  std::vector<std::pair<int64_t, uint32_t>> input;
+  for (int64_t key = 1; key <= scale; key++) {
+    input.emplace_back(key, 0);
+  }
+  std::shuffle(input.begin(), input.end(), std::mt19937(15445));
+  for (int64_t key = 1; key <= scale; key++) {
+    input.emplace_back(key, 1);
+  }
+  size_t position = 0;
+  auto next = [&](std::pair<GenericKey<8>, RID> *item) {
+    if (position == input.size()) {
+      return false;
+    }
+    item->first.SetFromInteger(input[position].first);
+    item->second.Set(static_cast<int32_t>(input[position].first), input[position].second);
+    position++;
+    return true;
+  };
+  EXPECT_TRUE(tree.BulkLoad(next, false, 0.7));
+
+  int64_t current_key = 1;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetPageId(), current_key);
+    EXPECT_EQ((*iterator).second.GetSlotNum(), 0);
+    current_key++;
+  }
+  EXPECT_EQ(current_key, scale + 1);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeBulkLoadTest, UnorderedInputTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 3);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  std::vector<int64_t> keys = {1, 2, 3, 4, 5, 6, 8, 7};
+  size_t position = 0;
+  auto next = [&](std::pair<GenericKey<8>, RID> *item) {
+    if (position == keys.size()) {
+      return false;
+    }
+    item->first.SetFromInteger(keys[position]);
+    item->second.Set(0, keys[position]);
+    position++;
+    return true;
+  };
+  // sorted input that is out of order is rejected and leaves the tree empty
+  EXPECT_FALSE(tree.BulkLoad(next));
+  EXPECT_TRUE(tree.IsEmpty());
+  position = 0;
+  EXPECT_TRUE(tree.BulkLoad(next, false));
+  int64_t current_key = 1;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key++;
+  }
+  EXPECT_EQ(current_key, 9);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeBulkLoadTest, ExternalSorterTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(5, disk_manager);
+
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < 5000; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  {
+    // runs are far larger than a page and far more than the pool can hold at once
+    ExternalSorter<GenericKey<8>, RID, GenericComparator<8>> sorter(bpm, comparator, 300);
+    std::pair<GenericKey<8>, RID> item;
+    for (auto key : keys) {
+      item.first.SetFromInteger(key);
+      item.second.Set(0, key);
+      sorter.Add(item);
+    }
+    sorter.Finish();
+    EXPECT_EQ(sorter.GetRunCount(), 17);
+    int64_t current_key = 0;
+    while (sorter.Next(&item)) {
+      EXPECT_EQ(item.second.GetSlotNum(), current_key);
+      current_key++;
+    }
+    EXPECT_EQ(current_key, 5000);
+  }
+
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+namespace {
+
+void NonUniqueBulkLoad(int leaf_max_size, int internal_max_size, bool compress_keys) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  Int64BPlusTree tree("foo_pk", bpm, comparator, leaf_max_size, internal_max_size, compress_keys, false);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // posting lists of every length, some over several overflow pages, and every pair of every third key twice
+  int64_t max_key = 3000;
+  ExpectedPairs expected;
+  std::vector<std::pair<int64_t, int64_t>> input;
+  for (int64_t key = 0; key < max_key; key++) {
+    int64_t values = key % 97 == 0 ? 1500 : key % 6;
+    for (int64_t i = 0; i < values; i++) {
+      expected[key].insert(key * 10000 + i);
+      input.emplace_back(key, key * 10000 + i);
+      if (key % 3 == 0) {
+        input.emplace_back(key, key * 10000 + i);
+      }
+    }
+  }
+  std::shuffle(input.begin(), input.end(), std::mt19937(15445));
+  size_t position = 0;
+  auto next = [&](std::pair<GenericKey<8>, RID> *item) {
+    if (position == input.size()) {
+      return false;
+    }
+    item->first.SetFromInteger(input[position].first);
+    item->second = MakeRid(input[position].second);
+    position++;
+    return true;
+  };
+  ASSERT_TRUE(tree.BulkLoad(next, false));
+  CheckTree(&tree, expected, max_key);
+  int64_t pairs = 0;
+  for (const auto &[key, values] : expected) {
+    pairs += values.size();
+  }
+  EXPECT_EQ(tree.GetStatistics().entry_count_, pairs);
+
+  // the loaded posting lists keep working with inserts and removes
+  GenericKey<8> index_key;
+  index_key.SetFromInteger(97);
+  EXPECT_FALSE(tree.Insert(index_key, MakeRid(97 * 10000 + 3)));
+  EXPECT_TRUE(tree.Insert(index_key, MakeRid(97 * 10000 + 1500)));
+  expected[97].insert(97 * 10000 + 1500);
+  for (int64_t i = 0; i < 1400; i++) {
+    tree.Remove(index_key, MakeRid(97 * 10000 + i));
+    expected[97].erase(97 * 10000 + i);
+  }
+  index_key.SetFromInteger(1);
+  EXPECT_TRUE(tree.Insert(index_key, MakeRid(7)));
+  expected[1].insert(7);
+  CheckTree(&tree, expected, max_key);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace
+
+TEST(BPlusTreeBulkLoadTest, NonUniqueTest) {
+  using KeyType = GenericKey<8>;
+  using ValueType = RID;
+  NonUniqueBulkLoad(LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE, false);
+  NonUniqueBulkLoad(8, 5, false);
+  NonUniqueBulkLoad(LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE, true);
+}
+
+TEST(BPlusTreeBulkLoadTest, NonUniqueUnorderedValuesTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  Int64BPlusTree tree("foo_pk", bpm, comparator, 8, 5, false, false);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // sorted input of a non-unique tree also orders the values of a key by their bytes
+  std::vector<std::pair<int64_t, RID>> input = {{1, RID(0, 1)}, {2, RID(0, 2)}, {2, RID(0, 1)}};
+  size_t position = 0;
+  auto next = [&](std::pair<GenericKey<8>, RID> *item) {
+    if (position == input.size()) {
+      return false;
+    }
+    item->first.SetFromInteger(input[position].first);
+    item->second = input[position].second;
+    position++;
+    return true;
+  };
+  EXPECT_FALSE(tree.BulkLoad(next));
+  EXPECT_TRUE(tree.IsEmpty());
+  position = 0;
+  EXPECT_TRUE(tree.BulkLoad(next, false));
+  CheckTree(&tree, {{1, {RidValue(RID(0, 1))}}, {2, {RidValue(RID(0, 1)), RidValue(RID(0, 2))}}}, 3);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
@@ -0,0 +1,231 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_compaction_test.cpp
+//
+// Identification: test/storage/b_plus_tree_compaction_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <random>
+#include <thread>  // NOLINT
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+namespace {
+
+using KeyType = GenericKey<8>;
+using ValueType = RID;
+using Tree = BPlusTree<KeyType, ValueType, GenericComparator<8>>;
+using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, GenericComparator<8>>;
+
+struct LeafStats {
+  int leaves_ = 0;
+  // next links that do not lead to the following page id
+  int jumps_ = 0;
+};
+
+auto WalkLeaves(Tree *tree, BufferPoolManager *bpm) -> LeafStats {
+  LeafStats stats;
+  GenericKey<8> index_key;
+  index_key.SetFromInteger(0);
+  Page *page = tree->FindLeafPage(index_key, true);
+  page_id_t page_id = page->GetPageId();
+  bpm->UnpinPage(page_id, false);
+  while (page_id != INVALID_PAGE_ID) {
+    auto *leaf = reinterpret_cast<LeafPage *>(bpm->FetchPage(page_id)->GetData());
+    page_id_t next_page_id = leaf->GetNextPageId();
+    bpm->UnpinPage(page_id, false);
+    stats.leaves_++;
+    stats.jumps_ += static_cast<int>(next_page_id != INVALID_PAGE_ID && next_page_id != page_id + 1);
+    page_id = next_page_id;
+  }
+  return stats;
+}
+
+void CompactTest(int leaf_max_size, int internal_max_size, bool compress_keys, bool unique_keys) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  Tree tree("foo_pk", bpm, comparator, leaf_max_size, internal_max_size, compress_keys, unique_keys);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  EXPECT_EQ(tree.Compact(), 0);
+
+  // random inserts scatter the leaves, removing most pairs leaves them sparse
+  int64_t max_key = 5000;
+  std::vector<std::pair<int64_t, int64_t>> pairs;
+  for (int64_t key = 0; key < max_key; key++) {
+    int64_t count = unique_keys ? 1 : 1 + key % 3;
+    for (int64_t i = 0; i < count; i++) {
+      pairs.emplace_back(key, key * 10 + i);
+    }
+  }
+  std::mt19937 rng(15445);
+  std::shuffle(pairs.begin(), pairs.end(), rng);
+  GenericKey<8> index_key;
+  for (const auto &pair : pairs) {
+    index_key.SetFromInteger(pair.first);
+    tree.Insert(index_key, MakeRid(pair.second));
+  }
+  std::shuffle(pairs.begin(), pairs.end(), rng);
+  ExpectedPairs expected;
+  for (size_t i = 0; i < pairs.size(); i++) {
+    index_key.SetFromInteger(pairs[i].first);
+    if (i % 4 == 0) {
+      expected[pairs[i].first].insert(pairs[i].second);
+    } else {
+      tree.Remove(index_key, MakeRid(pairs[i].second));
+    }
+  }
+
+  auto before = WalkLeaves(&tree, bpm);
+  int freed = tree.Compact();
+  auto after = WalkLeaves(&tree, bpm);
+  printf("leaves %d -> %d, jumps %d -> %d\n", before.leaves_, after.leaves_, before.jumps_, after.jumps_);
+  EXPECT_EQ(before.leaves_ - after.leaves_, freed);
+  EXPECT_LT(after.leaves_, before.leaves_);
+  EXPECT_LT(after.jumps_, before.jumps_);
+  CheckTree(&tree, expected, max_key);
+
+  // the tree keeps working as before
+  for (int64_t key = 0; key < max_key; key += 2) {
+    index_key.SetFromInteger(key);
+    if (tree.Insert(index_key, MakeRid(key * 10 + 5))) {
+      expected[key].insert(key * 10 + 5);
+    }
+  }
+  CheckTree(&tree, expected, max_key);
+  for (int64_t key = 0; key < max_key; key++) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key);
+  }
+  EXPECT_TRUE(tree.IsEmpty());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace
+
+TEST(BPlusTreeCompactionTest, CompactTest) {
+  CompactTest(4, 5, false, true);
+  CompactTest(LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE, false, true);
+  CompactTest(6, 5, true, true);
+}
+
+TEST(BPlusTreeCompactionTest, NonUniqueCompactTest) {
+  CompactTest(8, 5, false, false);
+  CompactTest(LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE, false, false);
+}
+
+TEST(BPlusTreeCompactionTest, BackgroundCompactionTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  Tree tree("foo_pk", bpm, comparator, 4, 5);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // even keys stay in the tree while writers churn odd keys and the compaction thread rewrites leaves
+  int64_t max_key = 4000;
+  GenericKey<8> index_key;
+  for (int64_t key = 0; key < max_key; key++) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, MakeRid(key));
+  }
+  auto interval = compaction_interval;
+  compaction_interval = std::chrono::milliseconds(1);
+  tree.StartCompaction();
+  std::vector<std::thread> threads;
+  for (int thread_itr = 0; thread_itr < 2; thread_itr++) {
+    threads.emplace_back([&, thread_itr]() {
+      GenericKey<8> key;
+      for (int round = 0; round < 3; round++) {
+        for (int64_t i = 1 + 2 * thread_itr; i < max_key; i += 4) {
+          key.SetFromInteger(i);
+          tree.Remove(key);
+        }
+        for (int64_t i = 1 + 2 * thread_itr; i < max_key; i += 4) {
+          key.SetFromInteger(i);
+          tree.Insert(key, MakeRid(i));
+        }
+      }
+      for (int64_t i = 1 + 2 * thread_itr; i < max_key; i += 4) {
+        key.SetFromInteger(i);
+        tree.Remove(key);
+      }
+    });
+  }
+  std::vector<RID> rids;
+  for (int scan = 0; scan < 20; scan++) {
+    int64_t expected_even = 0;
+    int64_t last = -1;
+    for (auto iterator = tree.Begin(); !iterator.IsEnd(); ++iterator) {
+      int64_t key = (*iterator).first.ToString();
+      ASSERT_GT(key, last);
+      last = key;
+      if (key % 2 == 0) {
+        ASSERT_EQ(key, expected_even);
+        expected_even += 2;
+      }
+    }
+    ASSERT_EQ(expected_even, max_key);
+    for (int64_t key = 0; key < max_key; key += 50) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      ASSERT_TRUE(tree.GetValue(index_key, &rids)) << key;
+    }
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  tree.StopCompaction();
+
+  // stopping wakes the background thread instead of waiting out its interval
+  compaction_interval = std::chrono::milliseconds(60000);
+  tree.StartCompaction();
+  auto start = std::chrono::steady_clock::now();
+  tree.StopCompaction();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  compaction_interval = interval;
+
+  ExpectedPairs expected;
+  for (int64_t key = 0; key < max_key; key += 2) {
+    expected[key].insert(key);
+  }
+  CheckTree(&tree, expected, max_key);
+  tree.Compact();
+  auto stats = WalkLeaves(&tree, bpm);
+  EXPECT_LT(stats.leaves_, max_key / 2 / 2);
+  CheckTree(&tree, expected, max_key);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
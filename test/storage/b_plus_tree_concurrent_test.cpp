@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
@@ -100,7 +101,7 @@ void DeleteHelperSplit(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree
   delete transaction;
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest1) {
+TEST(BPlusTreeConcurrentTest, InsertTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -152,7 +153,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest2) {
+TEST(BPlusTreeConcurrentTest, InsertTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -203,7 +204,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest1) {
+TEST(BPlusTreeConcurrentTest, DeleteTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -245,7 +246,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest2) {
+TEST(BPlusTreeConcurrentTest, DeleteTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -288,7 +289,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
+TEST(BPlusTreeConcurrentTest, MixTest) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -333,4 +334,141 @@ TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
   remove("test.log");
 }
 
+// readers must find every preloaded key and scan in order while writers split the tree underneath them
+TEST(BPlusTreeConcurrentTest, BLinkReadWhileSplitTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree with a small fan-out so that splits propagate often
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 3);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // even keys are preloaded, odd keys are inserted concurrently
+  std::vector<int64_t> keys;
+  for (int64_t key = 2; key <= 400; key += 2) {
+    keys.push_back(key);
+  }
+  InsertHelper(&tree, keys);
+  std::vector<int64_t> odd_keys;
+  for (int64_t key = 1; key < 400; key += 2) {
+    odd_keys.push_back(key);
+  }
+
+  std::atomic<bool> done = false;
+  std::atomic<int> misses = 0;
+  std::atomic<int> disorders = 0;
+  auto reader = [&](__attribute__((unused)) uint64_t thread_itr) {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    while (!done) {
+      for (auto key : keys) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        if (!tree.GetValue(index_key, &rids) || rids[0].GetSlotNum() != key) {
+          misses++;
+        }
+      }
+      int64_t last = 0;
+      for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+        int64_t current = (*iterator).second.GetSlotNum();
+        if (current <= last) {
+          disorders++;
+        }
+        last = current;
+      }
+    }
+  };
+  std::vector<std::thread> readers;
+  for (uint64_t i = 0; i < 2; i++) {
+    readers.emplace_back(reader, i);
+  }
+  LaunchParallelTest(2, InsertHelperSplit, &tree, odd_keys, 2);
+  done = true;
+  for (auto &thread : readers) {
+    thread.join();
+  }
+  EXPECT_EQ(misses, 0);
+  EXPECT_EQ(disorders, 0);
+
+  // walk the leaf level: sibling fences must line up and bound every key
+  GenericKey<8> index_key;
+  Page *page = tree.FindLeafPage(index_key, true);
+  int64_t current_key = 1;
+  bool has_low_key = false;
+  GenericKey<8> low_key;
+  while (page != nullptr) {
+    auto *leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>> *>(page->GetData());
+    EXPECT_EQ(leaf->HasLowKey(), has_low_key);
+    if (has_low_key) {
+      EXPECT_EQ(comparator(leaf->GetLowKey(), low_key), 0);
+    }
+    for (int i = 0; i < leaf->GetSize(); i++) {
+      EXPECT_EQ(leaf->GetItem(i).second.GetSlotNum(), current_key);
+      current_key++;
+      EXPECT_FALSE(leaf->IsBelowLowKey(leaf->KeyAt(i), comparator));
+      EXPECT_FALSE(leaf->IsBeyondHighKey(leaf->KeyAt(i), comparator));
+    }
+    has_low_key = leaf->HasHighKey();
+    low_key = leaf->GetHighKey();
+    page_id_t next_page_id = leaf->GetNextPageId();
+    EXPECT_EQ(has_low_key, next_page_id != INVALID_PAGE_ID);
+    bpm->UnpinPage(page->GetPageId(), false);
+    page = next_page_id == INVALID_PAGE_ID ? nullptr : bpm->FetchPage(next_page_id);
+  }
+  EXPECT_EQ(current_key, 401);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, AppendTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 5);
+
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // threads append interleaved increasing keys through the rightmost leaf while the head is removed
+  std::vector<int64_t> head_keys;
+  for (int64_t key = 1; key < 1000; key++) {
+    head_keys.push_back(key);
+  }
+  InsertHelper(&tree, head_keys);
+  std::vector<int64_t> tail_keys;
+  for (int64_t key = 1000; key < 5000; key++) {
+    tail_keys.push_back(key);
+  }
+  std::thread remover(DeleteHelper, &tree, head_keys, 0);
+  LaunchParallelTest(4, InsertHelperSplit, &tree, tail_keys, 4);
+  remover.join();
+
+  int64_t current_key = 1000;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key++;
+  }
+  EXPECT_EQ(current_key, 5000);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
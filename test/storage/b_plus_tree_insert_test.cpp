@@ -12,6 +12,7 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <random>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "gtest/gtest.h"
@@ -20,7 +21,7 @@
 
 namespace bustub {
 
-TEST(BPlusTreeTests, DISABLED_InsertTest1) {
+TEST(BPlusTreeTests, InsertTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -78,7 +79,7 @@ TEST(BPlusTreeTests, DISABLED_InsertTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeTests, DISABLED_InsertTest2) {
+TEST(BPlusTreeTests, InsertTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -145,4 +146,81 @@ TEST(BPlusTreeTests, DISABLED_InsertTest2) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(BPlusTreeTests, SequentialInsertTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+  GenericKey<8> index_key;
+  RID rid;
+
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // increasing keys take the rightmost leaf fast path and 90/10 splits
+  int64_t scale = 20000;
+  for (int64_t key = 0; key < scale; key++) {
+    rid.Set(static_cast<int32_t>(key >> 32), key & 0xFFFFFFFF);
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree.Insert(index_key, rid));
+  }
+  index_key.SetFromInteger(scale / 2);
+  EXPECT_FALSE(tree.Insert(index_key, rid));
+
+  // every leaf but the last is about 90% full
+  int leaves = 0;
+  int entries = 0;
+  int max_size = 0;
+  Page *page = tree.FindLeafPage(index_key, true);
+  while (true) {
+    auto *leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>> *>(page->GetData());
+    leaves++;
+    entries += leaf->GetSize();
+    max_size = leaf->GetMaxSize();
+    page_id_t next_page_id = leaf->GetNextPageId();
+    bpm->UnpinPage(page->GetPageId(), false);
+    if (next_page_id == INVALID_PAGE_ID) {
+      break;
+    }
+    page = bpm->FetchPage(next_page_id);
+  }
+  EXPECT_EQ(entries, scale);
+  EXPECT_GE(entries, static_cast<int>((leaves - 1) * max_size * 0.85));
+
+  // removals merge the tail away under the cached leaf, appends go on after them
+  std::vector<int64_t> keys(scale);
+  for (int64_t key = 0; key < scale; key++) {
+    keys[key] = key;
+  }
+  std::shuffle(keys.begin() + scale / 2, keys.end(), std::mt19937(15445));
+  for (int64_t i = scale / 2; i < scale; i++) {
+    index_key.SetFromInteger(keys[i]);
+    tree.Remove(index_key);
+    if (i % 1000 == 0) {
+      index_key.SetFromInteger(scale + i);
+      rid.Set(0, scale + i);
+      ASSERT_TRUE(tree.Insert(index_key, rid));
+    }
+  }
+  int64_t expected = 0;
+  for (auto iterator = tree.Begin(); !iterator.IsEnd(); ++iterator) {
+    int64_t key = (*iterator).first.ToString();
+    if (expected == scale / 2) {
+      expected = scale + scale / 2;
+    }
+    ASSERT_EQ(key, expected);
+    expected += expected >= scale ? 1000 : 1;
+  }
+  EXPECT_EQ(expected, 2 * scale);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
 }  // namespace bustub
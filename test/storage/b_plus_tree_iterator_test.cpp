@@ -0,0 +1,380 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_iterator_test.cpp
+//
+// Identification: test/storage/b_plus_tree_iterator_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <thread>  // NOLINT
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+namespace {
+
+using KeyType = GenericKey<8>;
+using ValueType = RID;
+using Tree = BPlusTree<KeyType, ValueType, GenericComparator<8>>;
+using Iterator = IndexIterator<KeyType, ValueType, GenericComparator<8>>;
+using Entry = std::pair<int64_t, int64_t>;
+
+auto Collect(Iterator iterator) -> std::vector<Entry> {
+  std::vector<Entry> entries;
+  for (; !iterator.IsEnd(); ++iterator) {
+    entries.emplace_back((*iterator).first.ToString(), RidValue((*iterator).second));
+  }
+  return entries;
+}
+
+// every kind of scan agrees with the forward scan of the whole tree
+void CheckScans(Tree *tree, int64_t max_key) {
+  auto forward = Collect(tree->Begin());
+  auto reverse = Collect(tree->RBegin());
+  std::reverse(reverse.begin(), reverse.end());
+  ASSERT_EQ(forward, reverse);
+
+  GenericKey<8> key;
+  GenericKey<8> end_key;
+  for (int64_t low = -1; low <= max_key + 1; low += 7) {
+    int64_t high = low + 25;
+    key.SetFromInteger(low);
+    end_key.SetFromInteger(high);
+    for (bool inclusive : {true, false}) {
+      std::vector<Entry> expected;
+      for (const auto &entry : forward) {
+        if (entry.first >= low && (entry.first < high || (inclusive && entry.first == high))) {
+          expected.push_back(entry);
+        }
+      }
+      ASSERT_EQ(Collect(tree->Begin(key, end_key, inclusive)), expected) << low;
+
+      // reverse from high down to low
+      expected.clear();
+      for (auto it = forward.rbegin(); it != forward.rend(); ++it) {
+        if (it->first <= high && (it->first > low || (inclusive && it->first == low))) {
+          expected.push_back(*it);
+        }
+      }
+      key.SetFromInteger(high);
+      end_key.SetFromInteger(low);
+      ASSERT_EQ(Collect(tree->RBegin(key, end_key, inclusive)), expected) << low;
+      key.SetFromInteger(low);
+      end_key.SetFromInteger(high);
+    }
+
+    // an unbounded reverse scan from low
+    std::vector<Entry> expected;
+    for (auto it = forward.rbegin(); it != forward.rend(); ++it) {
+      if (it->first <= low) {
+        expected.push_back(*it);
+      }
+    }
+    ASSERT_EQ(Collect(tree->RBegin(key)), expected) << low;
+  }
+}
+
+void ScanTest(int leaf_max_size, int internal_max_size, bool compress_keys, bool unique_keys) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  Tree tree("foo_pk", bpm, comparator, leaf_max_size, internal_max_size, compress_keys, unique_keys);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  EXPECT_TRUE(tree.RBegin().IsEnd());
+
+  // non-unique trees get a few values per key and one list long enough for overflow pages
+  int64_t max_key = 600;
+  std::vector<Entry> pairs;
+  for (int64_t key = 0; key < max_key; key++) {
+    int64_t count = unique_keys ? 1 : (key == 300 ? 400 : 1 + key % 4);
+    for (int64_t i = 0; i < count; i++) {
+      pairs.emplace_back(key, key * 1000 + i);
+    }
+  }
+  std::mt19937 rng(15445);
+  std::shuffle(pairs.begin(), pairs.end(), rng);
+  GenericKey<8> index_key;
+  for (const auto &pair : pairs) {
+    index_key.SetFromInteger(pair.first);
+    tree.Insert(index_key, MakeRid(pair.second));
+  }
+  CheckScans(&tree, max_key);
+
+  // removals merge and redistribute leaves, the left links have to follow
+  for (size_t i = 0; i < pairs.size() * 2 / 3; i++) {
+    index_key.SetFromInteger(pairs[i].first);
+    if (unique_keys) {
+      tree.Remove(index_key);
+    } else {
+      tree.Remove(index_key, MakeRid(pairs[i].second));
+    }
+  }
+  CheckScans(&tree, max_key);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// the partitions of [low, high] are consecutive and together scan what one bounded scan does
+void CheckPartitions(Tree *tree, const std::vector<Entry> &forward, int partitions, const GenericKey<8> *low,
+                     const GenericKey<8> *high) {
+  std::vector<Entry> expected;
+  for (const auto &entry : forward) {
+    if ((low == nullptr || entry.first >= low->ToString()) && (high == nullptr || entry.first <= high->ToString())) {
+      expected.push_back(entry);
+    }
+  }
+  auto iterators = tree->PartitionBegin(partitions, low, high);
+  ASSERT_GE(iterators.size(), 1);
+  ASSERT_LE(iterators.size(), partitions);
+  std::vector<Entry> scanned;
+  for (auto &iterator : iterators) {
+    auto entries = Collect(std::move(iterator));
+    if (!scanned.empty() && !entries.empty()) {
+      ASSERT_LT(scanned.back().first, entries.front().first);
+    }
+    scanned.insert(scanned.end(), entries.begin(), entries.end());
+  }
+  ASSERT_EQ(scanned, expected) << partitions;
+}
+
+}  // namespace
+
+TEST(BPlusTreeIteratorTest, ScanTest) {
+  ScanTest(3, 5, false, true);
+  ScanTest(LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE, false, true);
+  ScanTest(4, 5, true, true);
+}
+
+TEST(BPlusTreeIteratorTest, NonUniqueScanTest) {
+  ScanTest(4, 5, false, false);
+  ScanTest(LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE, false, false);
+}
+
+TEST(BPlusTreeIteratorTest, PartitionScanTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  for (bool unique_keys : {true, false}) {
+    Tree tree("foo_pk", bpm, comparator, 4, 5, false, unique_keys);
+    EXPECT_EQ(tree.PartitionBegin(4).size(), 1);
+    EXPECT_TRUE(tree.PartitionBegin(4)[0].IsEnd());
+
+    int64_t max_key = 3000;
+    std::vector<Entry> pairs;
+    for (int64_t key = 0; key < max_key; key++) {
+      for (int64_t i = 0; i < (unique_keys ? 1 : 1 + key % 3); i++) {
+        pairs.emplace_back(key, key * 1000 + i);
+      }
+    }
+    std::mt19937 rng(15445);
+    std::shuffle(pairs.begin(), pairs.end(), rng);
+    GenericKey<8> index_key;
+    for (const auto &pair : pairs) {
+      index_key.SetFromInteger(pair.first);
+      tree.Insert(index_key, MakeRid(pair.second));
+    }
+
+    // the whole tree in equal parts
+    auto forward = Collect(tree.Begin());
+    for (int partitions : {1, 2, 4, 7, 16}) {
+      CheckPartitions(&tree, forward, partitions, nullptr, nullptr);
+      int64_t largest = 0;
+      for (auto &iterator : tree.PartitionBegin(partitions)) {
+        largest = std::max<int64_t>(largest, Collect(std::move(iterator)).size());
+      }
+      EXPECT_LE(largest, 3 * static_cast<int64_t>(pairs.size()) / partitions) << partitions;
+    }
+    EXPECT_EQ(tree.PartitionBegin(16).size(), 16);
+
+    // bounded and half-open ranges, including ones within a single leaf
+    GenericKey<8> low;
+    GenericKey<8> high;
+    for (auto [from, to] : std::vector<Entry>{{-10, 10}, {1234, 1236}, {100, 4000}, {2500, 9000}, {2999, 2999}}) {
+      low.SetFromInteger(from);
+      high.SetFromInteger(to);
+      for (int partitions : {1, 3, 8}) {
+        CheckPartitions(&tree, forward, partitions, &low, &high);
+        CheckPartitions(&tree, forward, partitions, &low, nullptr);
+        CheckPartitions(&tree, forward, partitions, nullptr, &high);
+      }
+    }
+    low.SetFromInteger(100);
+    high.SetFromInteger(4000);
+    auto cuts = tree.Partition(8, &low, &high);
+    EXPECT_EQ(cuts.size(), 7);
+    for (const auto &cut : cuts) {
+      EXPECT_GT(comparator(cut, low), 0);
+      EXPECT_LT(comparator(cut, high), 0);
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeIteratorTest, ConcurrentPartitionScanTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  Tree tree("foo_pk", bpm, comparator, 3, 5);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // even keys stay in the tree while writers insert and remove odd keys, one reader per partition
+  int64_t max_key = 4000;
+  GenericKey<8> index_key;
+  for (int64_t key = 0; key < max_key; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, MakeRid(key));
+  }
+  std::atomic<bool> done{false};
+  std::vector<std::thread> writers;
+  for (int thread_itr = 0; thread_itr < 2; thread_itr++) {
+    writers.emplace_back([&, thread_itr]() {
+      GenericKey<8> key;
+      while (!done) {
+        for (int64_t i = 1 + 2 * thread_itr; i < max_key; i += 4) {
+          key.SetFromInteger(i);
+          tree.Insert(key, MakeRid(i));
+        }
+        for (int64_t i = 1 + 2 * thread_itr; i < max_key; i += 4) {
+          key.SetFromInteger(i);
+          tree.Remove(key);
+        }
+      }
+    });
+  }
+  for (int scan = 0; scan < 10; scan++) {
+    auto iterators = tree.PartitionBegin(4);
+    std::vector<std::vector<int64_t>> evens(iterators.size());
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < iterators.size(); i++) {
+      readers.emplace_back([&, i]() {
+        int64_t last = -1;
+        for (; !iterators[i].IsEnd(); ++iterators[i]) {
+          int64_t key = (*iterators[i]).first.ToString();
+          EXPECT_GT(key, last);
+          last = key;
+          if (key % 2 == 0) {
+            evens[i].push_back(key);
+          }
+        }
+      });
+    }
+    for (auto &reader : readers) {
+      reader.join();
+    }
+    int64_t expected_even = 0;
+    for (const auto &partition : evens) {
+      for (int64_t key : partition) {
+        ASSERT_EQ(key, expected_even);
+        expected_even += 2;
+      }
+    }
+    ASSERT_EQ(expected_even, max_key);
+  }
+  done = true;
+  for (auto &writer : writers) {
+    writer.join();
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeIteratorTest, ConcurrentReverseScanTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  Tree tree("foo_pk", bpm, comparator, 3, 5);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // even keys stay in the tree, writers keep inserting and removing odd keys
+  int64_t max_key = 2000;
+  GenericKey<8> index_key;
+  for (int64_t key = 0; key < max_key; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, MakeRid(key));
+  }
+  std::vector<std::thread> threads;
+  for (int thread_itr = 0; thread_itr < 2; thread_itr++) {
+    threads.emplace_back([&, thread_itr]() {
+      GenericKey<8> key;
+      for (int round = 0; round < 3; round++) {
+        for (int64_t i = 1 + 2 * thread_itr; i < max_key; i += 4) {
+          key.SetFromInteger(i);
+          tree.Insert(key, MakeRid(i));
+        }
+        for (int64_t i = 1 + 2 * thread_itr; i < max_key; i += 4) {
+          key.SetFromInteger(i);
+          tree.Remove(key);
+        }
+      }
+    });
+  }
+  for (int scan = 0; scan < 20; scan++) {
+    int64_t last = max_key;
+    int64_t expected_even = max_key - 2;
+    for (auto iterator = tree.RBegin(); !iterator.IsEnd(); ++iterator) {
+      int64_t key = (*iterator).first.ToString();
+      ASSERT_LT(key, last);
+      last = key;
+      if (key % 2 == 0) {
+        ASSERT_EQ(key, expected_even);
+        expected_even -= 2;
+      }
+    }
+    ASSERT_EQ(expected_even, -2);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
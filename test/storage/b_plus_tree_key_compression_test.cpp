@@ -0,0 +1,373 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_key_compression_test.cpp
+//
+// Identification: test/storage/b_plus_tree_key_compression_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/table/tuple.h"
+#include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+using KeyType = GenericKey<16>;
+using ValueType = RID;
+using CompositeTree = BPlusTree<KeyType, ValueType, GenericComparator<16>>;
+// full page max sizes, the tree only caps compressed pages with smaller ones
+constexpr int LEAF_MAX_SIZE = LEAF_PAGE_SIZE;
+constexpr int INTERNAL_MAX_SIZE = INTERNAL_PAGE_SIZE;
+
+// (a, b) with a = key / 1000, so neighbouring keys share their first column
+void SetCompositeKey(GenericKey<16> *index_key, int64_t key, Schema *key_schema) {
+  Tuple tuple({ValueFactory::GetBigIntValue(key / 1000), ValueFactory::GetBigIntValue(key % 1000)}, key_schema);
+  index_key->SetFromKey(tuple);
+}
+
+struct TreeShape {
+  int height_ = 0;
+  int leaves_ = 0;
+  int64_t entries_ = 0;
+  // pages and children of every internal level, bottom-up
+  std::vector<std::pair<int, int64_t>> internal_levels_;
+};
+
+// walk every level from its leftmost page through the next links
+auto MeasureTree(CompositeTree *tree, BufferPoolManager *bpm, const GenericKey<16> &any_key) -> TreeShape {
+  TreeShape shape;
+  Page *page = tree->FindLeafPage(any_key, true);
+  page_id_t level_page_id = page->GetPageId();
+  bpm->UnpinPage(level_page_id, false);
+  while (level_page_id != INVALID_PAGE_ID) {
+    int pages = 0;
+    int64_t entries = 0;
+    page_id_t parent_page_id = INVALID_PAGE_ID;
+    bool is_leaf = false;
+    for (page_id_t page_id = level_page_id; page_id != INVALID_PAGE_ID;) {
+      auto *node = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(page_id)->GetData());
+      if (pages == 0) {
+        parent_page_id = node->GetParentPageId();
+        is_leaf = node->IsLeafPage();
+      }
+      pages++;
+      entries += node->GetSize();
+      page_id_t next_page_id = node->GetNextPageId();
+      bpm->UnpinPage(page_id, false);
+      page_id = next_page_id;
+    }
+    if (is_leaf) {
+      shape.leaves_ = pages;
+      shape.entries_ = entries;
+    } else {
+      shape.internal_levels_.emplace_back(pages, entries);
+    }
+    shape.height_++;
+    level_page_id = parent_page_id;
+  }
+  return shape;
+}
+
+void PrintShape(const std::string &name, const TreeShape &shape) {
+  printf("%s: height %d, %d leaves, %.1f entries per leaf", name.c_str(), shape.height_, shape.leaves_,
+         static_cast<double>(shape.entries_) / shape.leaves_);
+  for (const auto &level : shape.internal_levels_) {
+    printf(", %d internal pages with fanout %.1f", level.first, static_cast<double>(level.second) / level.first);
+  }
+  printf("\n");
+}
+
+// bulk load keys [0, scale) with and without compression and compare the shapes
+void CompareShapes(int64_t scale, int pool_size) {
+  auto key_schema = ParseCreateStatement("a bigint,b bigint");
+  GenericComparator<16> comparator(key_schema.get());
+  std::vector<TreeShape> shapes;
+  for (bool compress_keys : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManagerInstance(pool_size, disk_manager);
+    CompositeTree tree("foo_pk", bpm, comparator, LEAF_MAX_SIZE, INTERNAL_MAX_SIZE, compress_keys);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+
+    int64_t next_key = 0;
+    auto next = [&](std::pair<GenericKey<16>, RID> *item) {
+      if (next_key == scale) {
+        return false;
+      }
+      SetCompositeKey(&item->first, next_key, key_schema.get());
+      item->second.Set(static_cast<int32_t>(next_key >> 32), next_key & 0xFFFFFFFF);
+      next_key++;
+      return true;
+    };
+    EXPECT_TRUE(tree.BulkLoad(next));
+
+    GenericKey<16> index_key;
+    std::vector<RID> rids;
+    std::mt19937 rng(15445);
+    for (int i = 0; i < 1000; i++) {
+      int64_t key = std::uniform_int_distribution<int64_t>(0, scale - 1)(rng);
+      rids.clear();
+      SetCompositeKey(&index_key, key, key_schema.get());
+      EXPECT_TRUE(tree.GetValue(index_key, &rids));
+      EXPECT_EQ(rids[0].GetSlotNum(), key & 0xFFFFFFFF);
+    }
+    shapes.push_back(MeasureTree(&tree, bpm, index_key));
+    EXPECT_EQ(shapes.back().entries_, scale);
+    PrintShape(compress_keys ? "compressed" : "uncompressed", shapes.back());
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+  }
+  EXPECT_LT(shapes[1].leaves_, shapes[0].leaves_);
+  EXPECT_LE(shapes[1].height_, shapes[0].height_);
+}
+
+using StringTree = BPlusTree<GenericKey<64>, RID, GenericComparator<64>>;
+
+// full page max sizes of a tree with 64 byte keys, the macros read KeyType
+auto StringTreeMaxSizes() -> std::pair<int, int> {
+  using KeyType = GenericKey<64>;
+  return {LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE};
+}
+
+// normalized VARCHAR key, zero padded to the key size; strings longer than the key are cut off
+void SetStringKey(GenericKey<64> *index_key, const std::string &key, Schema *key_schema) {
+  Tuple tuple({ValueFactory::GetVarcharValue(key)}, key_schema);
+  index_key->SetNormalizedFromKey(tuple, key_schema);
+}
+
+// count distinct strings of [min_length, max_length] lowercase letters starting with one of first, in random order
+auto MakeStrings(int count, int min_length, int max_length, const std::string &first, std::mt19937 *rng)
+    -> std::vector<std::string> {
+  std::set<std::string> strings;
+  while (static_cast<int>(strings.size()) < count) {
+    int length = min_length + (*rng)() % (max_length - min_length + 1);
+    std::string string(1, first[(*rng)() % first.size()]);
+    for (int i = 1; i < length; i++) {
+      string.push_back(static_cast<char>('a' + (*rng)() % 26));
+    }
+    strings.insert(string);
+  }
+  std::vector<std::string> shuffled(strings.begin(), strings.end());
+  std::shuffle(shuffled.begin(), shuffled.end(), *rng);
+  return shuffled;
+}
+
+}  // namespace
+
+TEST(BPlusTreeKeyCompressionTest, InsertRemoveTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint,b bigint");
+  GenericComparator<16> comparator(key_schema.get());
+
+  for (auto max_sizes : {std::make_pair(4, 5), std::make_pair(LEAF_MAX_SIZE, INTERNAL_MAX_SIZE)}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+    // create b+ tree
+    CompositeTree tree("foo_pk", bpm, comparator, max_sizes.first, max_sizes.second, true);
+    GenericKey<16> index_key;
+    RID rid;
+
+    // create and fetch header_page
+    page_id_t page_id;
+    auto header_page = bpm->NewPage(&page_id);
+    (void)header_page;
+
+    // keys spread over many values of the first column, inserted and removed in random order
+    int64_t scale = 20000;
+    std::vector<int64_t> keys;
+    for (int64_t key = 0; key < scale; key++) {
+      keys.push_back(key * 37);
+    }
+    std::mt19937 rng(15445);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    std::set<int64_t> expected;
+    for (auto key : keys) {
+      SetCompositeKey(&index_key, key, key_schema.get());
+      rid.Set(static_cast<int32_t>(key >> 32), key & 0xFFFFFFFF);
+      EXPECT_TRUE(tree.Insert(index_key, rid));
+      expected.insert(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), rng);
+    for (size_t i = 0; i < keys.size() * 3 / 4; i++) {
+      SetCompositeKey(&index_key, keys[i], key_schema.get());
+      tree.Remove(index_key);
+      expected.erase(keys[i]);
+    }
+
+    std::vector<RID> rids;
+    for (auto key : keys) {
+      rids.clear();
+      SetCompositeKey(&index_key, key, key_schema.get());
+      EXPECT_EQ(tree.GetValue(index_key, &rids), expected.count(key) == 1);
+    }
+    auto expected_key = expected.begin();
+    for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator, ++expected_key) {
+      ASSERT_NE(expected_key, expected.end());
+      EXPECT_EQ((*iterator).second.GetSlotNum(), *expected_key & 0xFFFFFFFF);
+    }
+    EXPECT_EQ(expected_key, expected.end());
+
+    for (auto key : expected) {
+      SetCompositeKey(&index_key, key, key_schema.get());
+      tree.Remove(index_key);
+    }
+    EXPECT_TRUE(tree.IsEmpty());
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+TEST(BPlusTreeKeyCompressionTest, ConcurrentInsertTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint,b bigint");
+  GenericComparator<16> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree
+  CompositeTree tree("foo_pk", bpm, comparator, LEAF_MAX_SIZE, INTERNAL_MAX_SIZE, true);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  int64_t scale = 20000;
+  int num_threads = 4;
+  std::vector<std::thread> threads;
+  for (int thread_itr = 0; thread_itr < num_threads; thread_itr++) {
+    threads.emplace_back([&, thread_itr]() {
+      GenericKey<16> index_key;
+      RID rid;
+      for (int64_t key = thread_itr; key < scale; key += num_threads) {
+        SetCompositeKey(&index_key, key, key_schema.get());
+        rid.Set(static_cast<int32_t>(key >> 32), key & 0xFFFFFFFF);
+        tree.Insert(index_key, rid);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  int64_t current_key = 0;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key++;
+  }
+  EXPECT_EQ(current_key, scale);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeKeyCompressionTest, VariableLengthKeyTest) {
+  auto key_schema = ParseCreateStatement("a varchar(64)");
+  GenericComparator<64> comparator(key_schema.get(), true);
+  std::mt19937 rng(15445);
+  // short strings with long ones at the end of the key order; the late ones are long strings that land in leaves
+  // of short ones, which widen or split before storing them. Strings longer than the key are cut off.
+  auto strings = MakeStrings(18000, 1, 8, "abcdefghijklmnopqrstuvwxy", &rng);
+  auto long_strings = MakeStrings(2000, 40, 70, "z", &rng);
+  strings.insert(strings.end(), long_strings.begin(), long_strings.end());
+  std::shuffle(strings.begin(), strings.end(), rng);
+  int first_late = strings.size();
+  auto late_strings = MakeStrings(500, 40, 70, "abcdefghijklmnopqrstuvwxy", &rng);
+  strings.insert(strings.end(), late_strings.begin(), late_strings.end());
+
+  std::vector<int> leaf_counts;
+  for (bool compress_keys : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+    auto max_sizes = StringTreeMaxSizes();
+    StringTree tree("foo_pk", bpm, comparator, max_sizes.first, max_sizes.second, compress_keys);
+    GenericKey<64> index_key;
+    RID rid;
+
+    // create and fetch header_page
+    page_id_t page_id;
+    auto header_page = bpm->NewPage(&page_id);
+    (void)header_page;
+
+    std::map<std::string, int> expected;
+    for (int i = 0; i < static_cast<int>(strings.size()); i++) {
+      if (i == first_late) {
+        leaf_counts.push_back(tree.GetStatistics().leaf_count_);
+      }
+      SetStringKey(&index_key, strings[i], key_schema.get());
+      rid.Set(0, i);
+      EXPECT_TRUE(tree.Insert(index_key, rid));
+      expected[strings[i]] = i;
+    }
+
+    // remove most short strings, the long ones are left in leaves laid out for short keys
+    for (int i = 0; i < static_cast<int>(strings.size()); i++) {
+      if (i % 4 != 0 && strings[i].size() <= 8) {
+        SetStringKey(&index_key, strings[i], key_schema.get());
+        tree.Remove(index_key);
+        expected.erase(strings[i]);
+      }
+    }
+    std::vector<RID> rids;
+    for (int i = 0; i < static_cast<int>(strings.size()); i++) {
+      rids.clear();
+      SetStringKey(&index_key, strings[i], key_schema.get());
+      bool found = tree.GetValue(index_key, &rids);
+      EXPECT_EQ(found, expected.count(strings[i]) == 1);
+      if (found) {
+        EXPECT_EQ(rids[0].GetSlotNum(), i);
+      }
+    }
+    auto expected_item = expected.begin();
+    for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator, ++expected_item) {
+      ASSERT_NE(expected_item, expected.end());
+      EXPECT_EQ((*iterator).second.GetSlotNum(), expected_item->second);
+    }
+    EXPECT_EQ(expected_item, expected.end());
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+  }
+  printf("leaves: %d uncompressed, %d compressed\n", leaf_counts[0], leaf_counts[1]);
+  // short strings take a few bytes of the 64 byte key; a compressed leaf must still split into halves that take a
+  // full width key, which caps it below twice the uncompressed size
+  EXPECT_LT(leaf_counts[1] * 3, leaf_counts[0] * 2);
+}
+
+TEST(BPlusTreeKeyCompressionTest, FanoutTest) { CompareShapes(200000, 50); }
+
+// the 10M key comparison takes a while, run with --gtest_also_run_disabled_tests
+TEST(BPlusTreeKeyCompressionTest, DISABLED_FanoutTenMillionTest) { CompareShapes(10000000, 256); }
+
+}  // namespace bustub
@@ -0,0 +1,155 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_key_search_test.cpp
+//
+// Identification: test/storage/b_plus_tree_key_search_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <random>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/page/b_plus_tree_key_search.h"
+#include "storage/page/b_plus_tree_leaf_page.h"
+#include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+using KeySearch = BPlusTreeKeySearch<GenericKey<8>, GenericComparator<8>>;
+
+// n sorted normalized keys drawn from [-range, range], so duplicates show up
+auto SortedKeys(int n, int64_t range, std::mt19937 *rng) -> std::vector<GenericKey<8>> {
+  std::vector<int64_t> values(n);
+  for (auto &value : values) {
+    value = std::uniform_int_distribution<int64_t>(-range, range)(*rng);
+  }
+  std::sort(values.begin(), values.end());
+  std::vector<GenericKey<8>> keys(n);
+  for (int i = 0; i < n; i++) {
+    keys[i].SetNormalizedFromInteger(values[i]);
+  }
+  return keys;
+}
+
+// average ns of one GetValue over random existing keys of a bulk loaded tree
+auto TimeTreeLookups(bool normalized, int64_t scale, int lookups) -> double {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get(), normalized);
+  auto set_key = [&](GenericKey<8> *index_key, int64_t key) {
+    if (normalized) {
+      index_key->SetNormalizedFromInteger(key);
+    } else {
+      index_key->SetFromKey(Tuple({ValueFactory::GetBigIntValue(key)}, key_schema.get()));
+    }
+  };
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(1024, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+
+  int64_t next_key = 0;
+  auto next = [&](std::pair<GenericKey<8>, RID> *item) {
+    if (next_key == scale) {
+      return false;
+    }
+    set_key(&item->first, next_key);
+    item->second.Set(static_cast<int32_t>(next_key >> 32), next_key & 0xFFFFFFFF);
+    next_key++;
+    return true;
+  };
+  EXPECT_TRUE(tree.BulkLoad(next));
+
+  std::mt19937 rng(15445);
+  std::vector<GenericKey<8>> probes(lookups);
+  for (auto &probe : probes) {
+    set_key(&probe, std::uniform_int_distribution<int64_t>(0, scale - 1)(rng));
+  }
+  std::vector<RID> rids;
+  int found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const auto &probe : probes) {
+    rids.clear();
+    found += static_cast<int>(tree.GetValue(probe, &rids));
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  EXPECT_EQ(found, lookups);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+  return static_cast<double>(elapsed.count()) / lookups;
+}
+
+}  // namespace
+
+TEST(BPlusTreeKeySearchTest, BranchFreeSearchTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get(), true);
+  std::mt19937 rng(15445);
+  for (int n = 0; n < 300; n++) {
+    auto keys = SortedKeys(n, n / 2 + 1, &rng);
+    const auto *bytes = reinterpret_cast<const char *>(keys.data());
+    for (int64_t value = -(n / 2 + 2); value <= n / 2 + 2; value++) {
+      GenericKey<8> key;
+      key.SetNormalizedFromInteger(value);
+      auto less = [&](const GenericKey<8> &lhs, const GenericKey<8> &rhs) { return comparator(lhs, rhs) < 0; };
+      int lower = std::lower_bound(keys.begin(), keys.end(), key, less) - keys.begin();
+      int upper = std::upper_bound(keys.begin(), keys.end(), key, less) - keys.begin();
+      ASSERT_EQ(KeySearch::LowerBound(bytes, n, key, comparator), lower) << n << " " << value;
+      ASSERT_EQ(KeySearch::UpperBound(bytes, n, key, comparator), upper) << n << " " << value;
+      ASSERT_EQ(KeySearch::ComparatorSearch(bytes, n, key, comparator, false), lower);
+      ASSERT_EQ(KeySearch::ComparatorSearch(bytes, n, key, comparator, true), upper);
+    }
+  }
+}
+
+TEST(BPlusTreeKeySearchTest, LookupBenchmarkTest) {
+  // one full leaf worth of keys, searched with and without the branch-free path
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get(), true);
+  std::mt19937 rng(15445);
+  using KeyType = GenericKey<8>;
+  using ValueType = RID;
+  int n = LEAF_PAGE_SIZE;
+  auto keys = SortedKeys(n, INT32_MAX, &rng);
+  const auto *bytes = reinterpret_cast<const char *>(keys.data());
+  int lookups = 1000000;
+  std::vector<GenericKey<8>> probes(lookups);
+  for (auto &probe : probes) {
+    probe = keys[std::uniform_int_distribution<int>(0, n - 1)(rng)];
+  }
+  for (bool branch_free : {false, true}) {
+    int64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &probe : probes) {
+      checksum += branch_free ? KeySearch::LowerBound(bytes, n, probe, comparator)
+                              : KeySearch::ComparatorSearch(bytes, n, probe, comparator, false);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    printf("%s page search over %d keys: %.1f ns/op (checksum %ld)\n", branch_free ? "branch-free" : "comparator",
+           n, static_cast<double>(elapsed.count()) / lookups, checksum);
+  }
+
+  // whole tree lookups, schema comparator against normalized keys; these include the buffer pool round trips
+  int64_t scale = 200000;
+  printf("tree lookup, schema comparator: %.1f ns/op\n", TimeTreeLookups(false, scale, lookups / 20));
+  printf("tree lookup, normalized keys: %.1f ns/op\n", TimeTreeLookups(true, scale, lookups / 20));
+}
+
+}  // namespace bustub
@@ -0,0 +1,203 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_message_buffer_test.cpp
+//
+// Identification: test/storage/b_plus_tree_message_buffer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+namespace {
+
+using KeyType = GenericKey<8>;
+using ValueType = RID;
+using Tree = BPlusTree<KeyType, ValueType, GenericComparator<8>>;
+
+// random inserts and removes against a model, lookups run while messages are pending
+void ModelTest(bool unique_keys, int message_buffer_size) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // the tree goes away before its buffer pool, it unpins its last message page
+  {
+    Tree tree("foo_pk", bpm, comparator, 4, 5, false, unique_keys, message_buffer_size);
+    int64_t max_key = 300;
+    ExpectedPairs expected;
+    std::mt19937 rng(15445);
+    GenericKey<8> index_key;
+    for (int round = 0; round < 6000; round++) {
+      int64_t key = std::uniform_int_distribution<int64_t>(0, max_key - 1)(rng);
+      int64_t value = key * 100 + std::uniform_int_distribution<int64_t>(0, unique_keys ? 0 : 5)(rng);
+      index_key.SetFromInteger(key);
+      int op = std::uniform_int_distribution<int>(0, 9)(rng);
+      if (op < 6) {
+        bool fresh = unique_keys ? expected.count(key) == 0 : expected[key].count(value) == 0;
+        ASSERT_EQ(tree.Insert(index_key, MakeRid(value)), fresh) << round;
+        if (fresh) {
+          expected[key].insert(value);
+        }
+      } else if (op < 8) {
+        tree.Remove(index_key, MakeRid(value));
+        if (expected.count(key) != 0 && expected[key].erase(value) != 0 && expected[key].empty()) {
+          expected.erase(key);
+        }
+      } else {
+        tree.Remove(index_key);
+        expected.erase(key);
+      }
+      if (expected.count(key) != 0 && expected[key].empty()) {
+        expected.erase(key);
+      }
+      if (round % 1000 == 999) {
+        CheckLookups(&tree, expected, max_key);
+      }
+    }
+
+    // a scan flushes the buffer and sees the same pairs
+    CheckScans(&tree, expected);
+    CheckLookups(&tree, expected, max_key);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// pages written to disk for random inserts through a small buffer pool
+auto CountWrites(int message_buffer_size, int64_t scale) -> int {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(32, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  int writes;
+  {
+    Tree tree("foo_pk", bpm, comparator, LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE, false, true, message_buffer_size);
+    std::vector<int64_t> keys(scale);
+    for (int64_t key = 0; key < scale; key++) {
+      keys[key] = key;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+    GenericKey<8> index_key;
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, MakeRid(key));
+    }
+    tree.FlushMessages();
+    writes = disk_manager->GetNumWrites();
+
+    std::vector<RID> rids;
+    for (int64_t key = 0; key < scale; key += 97) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(tree.GetValue(index_key, &rids));
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+  return writes;
+}
+
+}  // namespace
+
+TEST(BPlusTreeMessageBufferTest, UniqueModelTest) {
+  ModelTest(true, 1);
+  ModelTest(true, 7);
+  ModelTest(true, 100);
+}
+
+TEST(BPlusTreeMessageBufferTest, NonUniqueModelTest) {
+  ModelTest(false, 7);
+  ModelTest(false, 100);
+}
+
+TEST(BPlusTreeMessageBufferTest, ReopenTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // the buffer never fills, so every write is still pending when the tree goes away
+  GenericKey<8> index_key;
+  int64_t num_keys = 500;
+  ExpectedPairs expected;
+  {
+    Tree tree("foo_pk", bpm, comparator, 4, 5, false, false, 10000);
+    for (int64_t key = 0; key < num_keys; key++) {
+      index_key.SetFromInteger(key);
+      ASSERT_TRUE(tree.Insert(index_key, MakeRid(key)));
+      ASSERT_TRUE(tree.Insert(index_key, MakeRid(key + num_keys)));
+      expected[key] = {key, key + num_keys};
+    }
+    for (int64_t key = 0; key < num_keys; key += 5) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key);
+      expected.erase(key);
+    }
+  }
+
+  // only the message pages hold the pending writes now, they come back into the buffer of the reopened tree
+  {
+    Tree reopened("foo_pk", bpm, comparator, 4, 5, false, false, 10000);
+    ASSERT_TRUE(reopened.LoadRootPageId());
+    CheckLookups(&reopened, expected, num_keys);
+    index_key.SetFromInteger(1);
+    ASSERT_FALSE(reopened.Insert(index_key, MakeRid(1)));
+  }
+
+  // a tree without a buffer applies them to the leaves
+  Tree plain("foo_pk", bpm, comparator, 4, 5, false, false);
+  ASSERT_TRUE(plain.LoadRootPageId());
+  CheckTree(&plain, expected, num_keys);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeMessageBufferTest, WriteAmplificationTest) {
+  int64_t scale = 100000;
+  int plain = CountWrites(0, scale);
+  int buffered = CountWrites(4096, scale);
+  printf("page writes for %ld random inserts: %d unbuffered, %d buffered\n", scale, plain, buffered);
+  EXPECT_LT(buffered * 5, plain);
+}
+
+}  // namespace bustub
@@ -0,0 +1,213 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_non_unique_test.cpp
+//
+// Identification: test/storage/b_plus_tree_non_unique_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <thread>  // NOLINT
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+namespace {
+
+using KeyType = GenericKey<8>;
+using ValueType = RID;
+using Tree = BPlusTree<KeyType, ValueType, GenericComparator<8>>;
+// full page max sizes
+constexpr int LEAF_MAX_SIZE = LEAF_PAGE_SIZE;
+constexpr int INTERNAL_MAX_SIZE = INTERNAL_PAGE_SIZE;
+
+// key k gets about 1 + k % 7 values, a few keys get long posting lists that spill to overflow pages
+void InsertRemoveTest(int leaf_max_size, int internal_max_size, bool compress_keys) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  Tree tree("foo_pk", bpm, comparator, leaf_max_size, internal_max_size, compress_keys, false);
+  GenericKey<8> index_key;
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  int64_t max_key = 500;
+  std::vector<std::pair<int64_t, int64_t>> pairs;
+  for (int64_t key = 0; key < max_key; key++) {
+    int64_t count = key % 100 == 42 ? 1200 : 1 + key % 7;
+    for (int64_t i = 0; i < count; i++) {
+      pairs.emplace_back(key, key * 10000 + i);
+    }
+  }
+  std::mt19937 rng(15445);
+  std::shuffle(pairs.begin(), pairs.end(), rng);
+  ExpectedPairs expected;
+  for (const auto &pair : pairs) {
+    index_key.SetFromInteger(pair.first);
+    ASSERT_TRUE(tree.Insert(index_key, MakeRid(pair.second)));
+    expected[pair.first].insert(pair.second);
+  }
+  // a pair goes in once
+  index_key.SetFromInteger(42);
+  EXPECT_FALSE(tree.Insert(index_key, MakeRid(42 * 10000)));
+  CheckTree(&tree, expected, max_key);
+
+  // remove half of the pairs, then whole keys
+  std::shuffle(pairs.begin(), pairs.end(), rng);
+  for (size_t i = 0; i < pairs.size() / 2; i++) {
+    index_key.SetFromInteger(pairs[i].first);
+    tree.Remove(index_key, MakeRid(pairs[i].second));
+    expected[pairs[i].first].erase(pairs[i].second);
+    if (expected[pairs[i].first].empty()) {
+      expected.erase(pairs[i].first);
+    }
+  }
+  CheckTree(&tree, expected, max_key);
+  for (int64_t key = 0; key < max_key; key += 3) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key);
+    expected.erase(key);
+  }
+  CheckTree(&tree, expected, max_key);
+
+  for (int64_t key = 0; key < max_key; key++) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key);
+  }
+  EXPECT_TRUE(tree.IsEmpty());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace
+
+TEST(BPlusTreeNonUniqueTest, SmallPageTest) { InsertRemoveTest(4, 5, false); }
+
+TEST(BPlusTreeNonUniqueTest, FullPageTest) { InsertRemoveTest(LEAF_MAX_SIZE, INTERNAL_MAX_SIZE, false); }
+
+TEST(BPlusTreeNonUniqueTest, CompressedTest) { InsertRemoveTest(4, 5, true); }
+
+TEST(BPlusTreeNonUniqueTest, BatchedLookupTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // even keys only, odd keys miss; unique and non-unique trees answer the same batches
+  for (bool unique_keys : {true, false}) {
+    Tree tree("foo_pk", bpm, comparator, 4, 5, false, unique_keys);
+    GenericKey<8> index_key;
+    std::vector<std::vector<RID>> results;
+    index_key.SetFromInteger(0);
+    EXPECT_EQ(tree.GetValues({index_key}, &results), 0);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_TRUE(results[0].empty());
+
+    int64_t max_key = 1000;
+    int64_t per_key = unique_keys ? 1 : 3;
+    for (int64_t key = 0; key < max_key; key += 2) {
+      index_key.SetFromInteger(key);
+      for (int64_t i = 0; i < per_key; i++) {
+        tree.Insert(index_key, MakeRid(key * 10 + i));
+      }
+    }
+
+    std::mt19937 rng(15445);
+    for (size_t batch_size : {1, 7, 100, 2000}) {
+      std::vector<GenericKey<8>> keys(batch_size);
+      std::vector<int64_t> values(batch_size);
+      for (size_t i = 0; i < batch_size; i++) {
+        values[i] = std::uniform_int_distribution<int64_t>(-10, max_key + 10)(rng);
+        keys[i].SetFromInteger(values[i]);
+      }
+      int expected_found = 0;
+      for (int64_t value : values) {
+        expected_found += static_cast<int>(value >= 0 && value < max_key && value % 2 == 0);
+      }
+      ASSERT_EQ(tree.GetValues(keys, &results), expected_found);
+      ASSERT_EQ(results.size(), batch_size);
+      for (size_t i = 0; i < batch_size; i++) {
+        std::vector<RID> rids;
+        tree.GetValue(keys[i], &rids);
+        ASSERT_EQ(results[i], rids) << values[i];
+      }
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeNonUniqueTest, ConcurrentInsertTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  Tree tree("foo_pk", bpm, comparator, 8, 5, false, false);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // every thread adds its own values to the same small set of keys
+  int64_t max_key = 50;
+  int64_t per_key = 40;
+  int num_threads = 4;
+  std::vector<std::thread> threads;
+  for (int thread_itr = 0; thread_itr < num_threads; thread_itr++) {
+    threads.emplace_back([&, thread_itr]() {
+      GenericKey<8> index_key;
+      for (int64_t i = thread_itr; i < max_key * per_key; i += num_threads) {
+        index_key.SetFromInteger(i % max_key);
+        tree.Insert(index_key, MakeRid(i));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  ExpectedPairs expected;
+  for (int64_t i = 0; i < max_key * per_key; i++) {
+    expected[i % max_key].insert(i);
+  }
+  CheckTree(&tree, expected, max_key);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
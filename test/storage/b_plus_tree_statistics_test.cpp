@@ -0,0 +1,250 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_statistics_test.cpp
+//
+// Identification: test/storage/b_plus_tree_statistics_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/page/header_page.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+namespace {
+
+using KeyType = GenericKey<8>;
+using ValueType = RID;
+using Tree = BPlusTree<KeyType, ValueType, GenericComparator<8>>;
+using InternalPage = BPlusTreeInternalPage<KeyType, page_id_t, GenericComparator<8>>;
+using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, GenericComparator<8>>;
+
+// leaf count and height by walking the tree from the root the header page records
+auto WalkTree(BufferPoolManager *bpm, const std::string &name) -> std::pair<int, int> {
+  auto *header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  page_id_t page_id = INVALID_PAGE_ID;
+  bool found = header_page->GetRootId(name, &page_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  if (!found || page_id == INVALID_PAGE_ID) {
+    return {0, 0};
+  }
+  int height = 1;
+  while (true) {
+    auto *node = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(page_id)->GetData());
+    bpm->UnpinPage(page_id, false);
+    if (node->IsLeafPage()) {
+      break;
+    }
+    page_id = reinterpret_cast<InternalPage *>(node)->ValueAt(0);
+    height++;
+  }
+  int leaves = 0;
+  while (page_id != INVALID_PAGE_ID) {
+    auto *leaf = reinterpret_cast<LeafPage *>(bpm->FetchPage(page_id)->GetData());
+    bpm->UnpinPage(page_id, false);
+    page_id = leaf->GetNextPageId();
+    leaves++;
+  }
+  return {leaves, height};
+}
+
+void CheckCounters(Tree *tree, BufferPoolManager *bpm, int64_t entries) {
+  auto statistics = tree->GetStatistics();
+  auto [leaves, height] = WalkTree(bpm, "foo_pk");
+  EXPECT_EQ(statistics.entry_count_, entries);
+  EXPECT_EQ(statistics.leaf_count_, leaves);
+  EXPECT_EQ(statistics.height_, height);
+}
+
+}  // namespace
+
+TEST(BPlusTreeStatisticsTest, CounterTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  for (bool unique_keys : {true, false}) {
+    Tree tree("foo_pk", bpm, comparator, 4, 5, false, unique_keys);
+    CheckCounters(&tree, bpm, 0);
+    // non-unique trees get long posting lists on every 100th key
+    int64_t max_key = 3000;
+    std::vector<std::pair<int64_t, int64_t>> pairs;
+    for (int64_t key = 0; key < max_key; key++) {
+      int64_t count = unique_keys ? 1 : (key % 100 == 0 ? 30 : 1 + key % 3);
+      for (int64_t i = 0; i < count; i++) {
+        pairs.emplace_back(key, key * 100 + i);
+      }
+    }
+    std::mt19937 rng(15445);
+    std::shuffle(pairs.begin(), pairs.end(), rng);
+    GenericKey<8> index_key;
+    for (const auto &pair : pairs) {
+      index_key.SetFromInteger(pair.first);
+      tree.Insert(index_key, MakeRid(pair.second));
+    }
+    index_key.SetFromInteger(pairs[0].first);
+    EXPECT_FALSE(tree.Insert(index_key, MakeRid(pairs[0].second)));
+    int64_t entries = pairs.size();
+    CheckCounters(&tree, bpm, entries);
+
+    // single pairs, then whole keys including the long posting lists
+    std::shuffle(pairs.begin(), pairs.end(), rng);
+    for (size_t i = 0; i < pairs.size() / 3; i++) {
+      index_key.SetFromInteger(pairs[i].first);
+      tree.Remove(index_key, MakeRid(pairs[i].second));
+      tree.Remove(index_key, MakeRid(pairs[i].second));
+    }
+    entries -= pairs.size() / 3;
+    CheckCounters(&tree, bpm, entries);
+    for (int64_t key = 0; key < max_key; key++) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key);
+    }
+    CheckCounters(&tree, bpm, 0);
+    EXPECT_TRUE(tree.IsEmpty());
+  }
+
+  // bulk load and compaction keep the counters too
+  Tree tree("foo_pk", bpm, comparator, 4, 5);
+  int64_t next_key = 0;
+  auto next = [&](std::pair<GenericKey<8>, RID> *item) {
+    if (next_key == 1000) {
+      return false;
+    }
+    item->first.SetFromInteger(next_key);
+    item->second = MakeRid(next_key++);
+    return true;
+  };
+  ASSERT_TRUE(tree.BulkLoad(next, true, 0.5));
+  CheckCounters(&tree, bpm, 1000);
+  tree.Compact();
+  CheckCounters(&tree, bpm, 1000);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeStatisticsTest, HistogramTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // skewed keys: about half of the entries are on key 5000
+  Tree tree("foo_pk", bpm, comparator, LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE, false, false);
+  int64_t max_key = 10000;
+  GenericKey<8> index_key;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < max_key; key += 2) {
+    keys.push_back(key);
+  }
+  std::mt19937 rng(15445);
+  std::shuffle(keys.begin(), keys.end(), rng);
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, MakeRid(key));
+  }
+  index_key.SetFromInteger(5000);
+  for (int64_t i = 1; i < 5000; i++) {
+    tree.Insert(index_key, MakeRid(-i));
+  }
+  int64_t entries = max_key / 2 + 4999;
+
+  tree.Analyze(20);
+  auto statistics = tree.GetStatistics();
+  EXPECT_EQ(statistics.entry_count_, entries);
+  EXPECT_GT(statistics.fill_factor_, 0.5);
+  EXPECT_LE(statistics.fill_factor_, 1.0);
+  int buckets = statistics.counts_.size();
+  ASSERT_GT(buckets, 1);
+  ASSERT_LE(buckets, 20);
+  ASSERT_EQ(statistics.bounds_.size(), buckets + 1);
+  int64_t total = 0;
+  int64_t depth = (entries + 19) / 20;
+  for (int i = 0; i < buckets; i++) {
+    total += statistics.counts_[i];
+    // a bucket closes at the first key past depth entries, only the heavy key overshoots
+    if (statistics.distinct_[i] > 1 && i + 1 < buckets) {
+      EXPECT_LE(statistics.counts_[i], depth + 1) << i;
+    }
+  }
+  EXPECT_EQ(total, entries);
+
+  // estimates against the truth
+  EXPECT_NEAR(statistics.EstimateEqual(index_key, comparator), 5000, 1);
+  index_key.SetFromInteger(1234);
+  EXPECT_NEAR(statistics.EstimateEqual(index_key, comparator), 1, 0.1);
+  index_key.SetFromInteger(-5);
+  EXPECT_EQ(statistics.EstimateEqual(index_key, comparator), 0);
+  GenericKey<8> low;
+  GenericKey<8> high;
+  low.SetFromInteger(1000);
+  high.SetFromInteger(3999);
+  EXPECT_NEAR(statistics.EstimateRange(&low, &high, comparator), 1500, depth);
+  low.SetFromInteger(4000);
+  high.SetFromInteger(6000);
+  EXPECT_NEAR(statistics.EstimateRange(&low, &high, comparator), 1001 + 4999, depth);
+  EXPECT_NEAR(statistics.EstimateRange(nullptr, nullptr, comparator), entries, 0.1);
+  EXPECT_EQ(statistics.EstimateRange(nullptr, &index_key, comparator), 0);
+
+  // a second tree over the same file reads the persisted statistics back
+  Tree reopened("foo_pk", bpm, comparator, LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE, false, false);
+  Tree other("bar_pk", bpm, comparator);
+  EXPECT_FALSE(other.LoadStatistics());
+  ASSERT_TRUE(reopened.LoadStatistics());
+  auto loaded = reopened.GetStatistics();
+  EXPECT_EQ(loaded.entry_count_, statistics.entry_count_);
+  EXPECT_EQ(loaded.leaf_count_, statistics.leaf_count_);
+  EXPECT_EQ(loaded.height_, statistics.height_);
+  EXPECT_EQ(loaded.fill_factor_, statistics.fill_factor_);
+  EXPECT_EQ(loaded.counts_, statistics.counts_);
+  EXPECT_EQ(loaded.distinct_, statistics.distinct_);
+  ASSERT_EQ(loaded.bounds_.size(), statistics.bounds_.size());
+  for (size_t i = 0; i < loaded.bounds_.size(); i++) {
+    EXPECT_EQ(comparator(loaded.bounds_[i], statistics.bounds_[i]), 0);
+  }
+
+  // analyzing again overwrites the same page
+  for (int64_t key = 0; key < 2000; key += 2) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key);
+  }
+  tree.Analyze();
+  ASSERT_TRUE(reopened.LoadStatistics());
+  EXPECT_EQ(reopened.GetStatistics().entry_count_, entries - 1000);
+  low.SetFromInteger(0);
+  high.SetFromInteger(1999);
+  EXPECT_EQ(reopened.GetStatistics().EstimateRange(&low, &high, comparator), 0);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
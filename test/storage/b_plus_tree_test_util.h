@@ -0,0 +1,92 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_test_util.h
+//
+// Identification: test/storage/b_plus_tree_test_util.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "common/rid.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+
+namespace bustub {
+
+/** The tree the model tests run against: bigint keys and RID values. */
+using Int64BPlusTree = BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
+
+/** The pairs a tree should hold, each key with the set of its values. */
+using ExpectedPairs = std::map<int64_t, std::set<int64_t>>;
+
+/** Packs a 64-bit test value into a RID, the page id takes the high half. */
+inline auto MakeRid(int64_t value) -> RID { return RID(static_cast<int32_t>(value >> 32), value & 0xFFFFFFFF); }
+
+/** The 64-bit test value a RID was made from. */
+inline auto RidValue(const RID &rid) -> int64_t {
+  return (static_cast<int64_t>(rid.GetPageId()) << 32) | rid.GetSlotNum();
+}
+
+/** GetValue of every key below max_key and one GetValues of all of them see exactly the expected pairs. */
+inline void CheckLookups(Int64BPlusTree *tree, const ExpectedPairs &expected, int64_t max_key) {
+  GenericKey<8> index_key;
+  std::vector<RID> rids;
+  std::vector<GenericKey<8>> keys;
+  for (int64_t key = 0; key < max_key; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    keys.push_back(index_key);
+    auto it = expected.find(key);
+    ASSERT_EQ(tree->GetValue(index_key, &rids), it != expected.end()) << key;
+    std::set<int64_t> values;
+    for (const auto &rid : rids) {
+      values.insert(RidValue(rid));
+    }
+    ASSERT_EQ(values.size(), rids.size()) << key;
+    if (it != expected.end()) {
+      ASSERT_EQ(values, it->second) << key;
+    }
+  }
+  std::vector<std::vector<RID>> results;
+  ASSERT_EQ(tree->GetValues(keys, &results), static_cast<int>(expected.size()));
+}
+
+/** A forward and a reverse scan both see exactly the expected pairs, in key order and each pair once. */
+inline void CheckScans(Int64BPlusTree *tree, const ExpectedPairs &expected) {
+  ExpectedPairs forward;
+  int64_t last_key = INT64_MIN;
+  for (auto iterator = tree->Begin(); !iterator.IsEnd(); ++iterator) {
+    int64_t key = (*iterator).first.ToString();
+    ASSERT_GE(key, last_key);
+    last_key = key;
+    ASSERT_TRUE(forward[key].insert(RidValue((*iterator).second)).second) << key;
+  }
+  ASSERT_EQ(forward, expected);
+
+  ExpectedPairs reverse;
+  last_key = INT64_MAX;
+  for (auto iterator = tree->RBegin(); !iterator.IsEnd(); ++iterator) {
+    int64_t key = (*iterator).first.ToString();
+    ASSERT_LE(key, last_key);
+    last_key = key;
+    ASSERT_TRUE(reverse[key].insert(RidValue((*iterator).second)).second) << key;
+  }
+  ASSERT_EQ(reverse, expected);
+}
+
+/** Lookups and scans all see exactly the expected pairs. */
+inline void CheckTree(Int64BPlusTree *tree, const ExpectedPairs &expected, int64_t max_key) {
+  CheckLookups(tree, expected, max_key);
+  CheckScans(tree, expected);
+}
+
+}  // namespace bustub
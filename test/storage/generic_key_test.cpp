@@ -0,0 +1,134 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// generic_key_test.cpp
+//
+// Identification: test/storage/generic_key_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/generic_key.h"
+#include "storage/table/tuple.h"
+#include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+// memcmp on normalized keys orders random tuples like the schema comparator on their raw images
+template <size_t KeySize>
+void CheckNormalizedOrder(const std::string &create_statement,
+                          const std::function<std::vector<Value>(std::mt19937 *)> &random_values) {
+  auto key_schema = ParseCreateStatement(create_statement);
+  GenericComparator<KeySize> raw_comparator(key_schema.get());
+  GenericComparator<KeySize> normalized_comparator(key_schema.get(), true);
+  std::mt19937 rng(15445);
+  for (int i = 0; i < 10000; i++) {
+    Tuple lhs(random_values(&rng), key_schema.get());
+    Tuple rhs(random_values(&rng), key_schema.get());
+    GenericKey<KeySize> lhs_raw;
+    GenericKey<KeySize> rhs_raw;
+    GenericKey<KeySize> lhs_normalized;
+    GenericKey<KeySize> rhs_normalized;
+    lhs_raw.SetFromKey(lhs);
+    rhs_raw.SetFromKey(rhs);
+    lhs_normalized.SetNormalizedFromKey(lhs, key_schema.get());
+    rhs_normalized.SetNormalizedFromKey(rhs, key_schema.get());
+    ASSERT_EQ(raw_comparator(lhs_raw, rhs_raw), normalized_comparator(lhs_normalized, rhs_normalized))
+        << lhs.ToString(key_schema.get()) << " vs " << rhs.ToString(key_schema.get());
+  }
+}
+
+}  // namespace
+
+TEST(GenericKeyTest, NormalizedIntegerTest) {
+  // small ranges so that equal columns show up, INT*_MIN is the NULL sentinel
+  CheckNormalizedOrder<16>("a tinyint,b smallint,c integer,d bigint", [](std::mt19937 *rng) {
+    return std::vector<Value>{
+        ValueFactory::GetTinyIntValue(std::uniform_int_distribution<int>(-3, 3)(*rng)),
+        ValueFactory::GetSmallIntValue(std::uniform_int_distribution<int>(-300, 300)(*rng)),
+        ValueFactory::GetIntegerValue(std::uniform_int_distribution<int32_t>(-3, 3)(*rng) * 100000),
+        ValueFactory::GetBigIntValue(std::uniform_int_distribution<int64_t>(-INT64_MAX, INT64_MAX)(*rng))};
+  });
+}
+
+TEST(GenericKeyTest, NormalizedDecimalTest) {
+  CheckNormalizedOrder<16>("a double,b integer", [](std::mt19937 *rng) {
+    double decimal = std::uniform_int_distribution<int>(-5, 5)(*rng) * 0.25;
+    if (std::uniform_int_distribution<int>(0, 3)(*rng) == 0) {
+      decimal = std::uniform_real_distribution<double>(-1e12, 1e12)(*rng);
+    }
+    return std::vector<Value>{ValueFactory::GetDecimalValue(decimal),
+                              ValueFactory::GetIntegerValue(std::uniform_int_distribution<int32_t>(-5, 5)(*rng))};
+  });
+}
+
+TEST(GenericKeyTest, NormalizedVarcharTest) {
+  // short strings over a small alphabet, so prefixes of each other are common
+  CheckNormalizedOrder<32>("a varchar(8),b integer", [](std::mt19937 *rng) {
+    std::string str(std::uniform_int_distribution<int>(0, 4)(*rng), 'a');
+    for (auto &c : str) {
+      c = static_cast<char>('a' + std::uniform_int_distribution<int>(0, 2)(*rng));
+    }
+    return std::vector<Value>{ValueFactory::GetVarcharValue(str),
+                              ValueFactory::GetIntegerValue(std::uniform_int_distribution<int32_t>(-5, 5)(*rng))};
+  });
+}
+
+TEST(GenericKeyTest, NormalizedTreeTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get(), true);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  // create b+ tree
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5, true);
+  GenericKey<8> index_key;
+  RID rid;
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // negative keys sort before positive ones under memcmp
+  std::vector<int64_t> keys;
+  for (int64_t key = -5000; key < 5000; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  for (auto key : keys) {
+    index_key.SetNormalizedFromInteger(key);
+    rid.Set(static_cast<int32_t>(key >> 32), key & 0xFFFFFFFF);
+    EXPECT_TRUE(tree.Insert(index_key, rid));
+  }
+
+  int64_t current_key = -5000;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key & 0xFFFFFFFF);
+    current_key++;
+  }
+  EXPECT_EQ(current_key, 5000);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub